@@ -6,11 +6,17 @@
 // modified from https://labjack.com/sites/default/files/software/labjack_ljm_software_2016_05_15_i386.tar_0.gz/labjack_ljm_examples/examples/ain/dual_ain_loop.c
 //
 //  created: Friday, November 17, 2017 (2017321)
-// modified: Thursday, December 20, 2018 (2018354)
+// modified: Saturday, October 17, 2026 (2026290)
 //  history:
 //           [2017321] - created document
 //           [2018354] - changed network code from PB to 2J
 //           [2019242] - updated LabJack T7 serial number and calibration coefficients
+//           [2026290] - moved miniSEED writing to the shared mseed_writer module
+//           [2026290] - fringe channels can be compressed with Steim-1 or Steim-2 (see EF)
+//           [2026290] - day volumes are written from a separate thread (see QueueLength)
+//           [2026290] - sample windows are scheduled with clock_nanosleep (see ReadsPerSample)
+//           [2026290] - added hardware-timed stream acquisition (see ScanRate)
+//           [2026290] - phases are computed a block of scans at a time by the shared threefringe kernel
 //
 
 #include <stdio.h>
@@ -19,25 +25,29 @@
 #include <stdint.h>
 #include <math.h>
 #include <time.h>
-#include <sys/time.h>
+#include <signal.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <ctype.h>
 #include <LabJackM.h>
 #include "LJM_StreamUtilities.h"
+#include "mseed_writer.h"
+#include "sampler.h"
+#include "t7_stream.h"
+#include "threefringe.h"
 
 // function definitions
 double compute_fs(int16_t SRF, int16_t SRM);
-double threefringe_phase(double x, double y, double z);
-void write_mseed(char *LI, char *CI, uint16_t Yr, uint16_t DoY, uint8_t Hr, uint8_t Mn, uint8_t Sc, uint16_t S0001, uint8_t EF, double data, int chan_idx);
-void write_mseed_header(char *fn, int SqNu, char *LI, char *CI, uint16_t Yr, uint16_t DoY, uint8_t Hr, uint8_t Mn, uint8_t Sc, uint16_t S0001, uint8_t EF);
-void append_mseed(char *fn, int SqNu, uint16_t SpNu, uint8_t EF, double data);
-int last_mseed_seqnum(char *fn);
+double fringe_counts(double volts);
+void stop_daq(int sig);
 
 // global constants
 const int16_t SRF = 20;               // Sample Rate Factor
 const int16_t SRM = 1;                // Sample Rate Multiplier
-const double pi = 3.1415926535897932; // can't live without pi!
+const int ReadsPerSample = 0;         // reads per sample window (0 = as fast as the instrument answers)
+const double ScanRate = 4000;         // hardware-timed scans per second (0 = poll with LJM_eReadNames)
+const int ScansPerRead = 200;         // scans delivered by each LJM_eStreamRead
+const uint8_t EF = 1;                 // Encoding Format of the fringe channels (1 = 16-bit signed integer, 10 = Steim-1, 11 = Steim-2)
 
 // non-dimensional ellipse parameters
 const double cx = 0.13819872657768428325653076171875;
@@ -47,13 +57,12 @@ const double sx = 0.49707804271019995212554931640625;
 const double sy = -0.32177283870987594127655029296875;
 const double sz = -0.22558399266563355922698974609375;
 
-// global variables for phase computations
-double p_old = 0, p_new = 0;
-int M = 0;
-
 // global variables for writing to miniSEED volumes
-const int NumSamp[4] = {2016,2016,2016,504}; // (Record Length - Header Size) / Data Size = (2^12 - 64) / sizeof(data)
-int SeqNum[4] = {0,0,0,0}, SampNum[4] = {1,1,1,1};
+const double FlushInterval = 60; // seconds between writes of a partially filled record
+const size_t QueueLength = 65536; // samples held for the writer thread while the day volumes can't be written
+
+// cleared by SIGINT or SIGTERM to leave the main loop
+volatile sig_atomic_t running = 1;
 
 int main(void)
 {
@@ -76,10 +85,11 @@ int main(void)
   double aValuesAIN[NUM_FRAMES_AIN] = {0};
   const char *aNamesAIN[NUM_FRAMES_AIN] = {"AIN0", "AIN1", "AIN2"};
 
-  // variables for getting the epoch time with microseconds
-  struct timeval tv;
+  // variables for the sample windows and their epoch times
+  sampler ss;
+  t7_stream st = {0};
   uint64_t isc; uint32_t usc;
-  double t, t_center, t_stop;
+  double t_center, t_stop;
 
   // variables for getting the year, doy, hours, minutes, and seconds
   time_t t_temp;
@@ -90,6 +100,15 @@ int main(void)
   double p = 0;
   double fs;
 
+  // scans waiting for the phase computation and the fringe state of the interferometer
+  enum { BLOCK = 256 };
+  double xb[BLOCK], yb[BLOCK], zb[BLOCK], pb[BLOCK];
+  int i, nb = 0;
+  threefringe tf;
+
+  // miniSEED volumes written by this program
+  mseed_writer ms;
+
   // compute sample rate (in Hz)
   fs = compute_fs(SRF, SRM);
 
@@ -102,37 +121,81 @@ int main(void)
   err = LJM_eWriteNames(handle, NUM_FRAMES_CONFIG, aNamesConfig, aValuesConfig, &errorAddress);
   ErrorCheckWithAddress(err, errorAddress, "LJM_eWriteNames");
 
-  // main data collection and storage (infinite) loop
-  while (1)
+  // set up the miniSEED volumes
+  mseed_init(&ms, "/home/sbf0/Data", "2J", "SBF1", SRF, SRM, FlushInterval);
+  mseed_add_channel(&ms, "X1", "AYX", EF);
+  mseed_add_channel(&ms, "Y1", "AYY", EF);
+  mseed_add_channel(&ms, "Z1", "AYZ", EF);
+  mseed_add_channel(&ms, "P1", "BS1", 5);
+
+  // write the day volumes from a separate thread so storage stalls can't delay sampling
+  mseed_start_writer(&ms, QueueLength);
+
+  // leave the main loop cleanly on SIGINT or SIGTERM
+  signal(SIGINT, stop_daq);
+  signal(SIGTERM, stop_daq);
+
+  // fringe counting starts from phase 0
+  threefringe_init(&tf, cx, cy, cz, sx, sy, sz);
+
+  // wake up ReadsPerSample times per sample window
+  sampler_init(&ss, fs, ReadsPerSample, NULL);
+
+  // start the hardware-timed stream of the AINs
+  if (ScanRate > 0)
+  {
+    err = t7_stream_start(&st, handle, NUM_FRAMES_AIN, aNamesAIN, ScanRate, ScansPerRead);
+    ErrorCheck(err, "t7_stream_start");
+  }
+
+  // main data collection and storage loop
+  while (running)
   {
-    // get epoch time in microseconds
-    gettimeofday(&tv, NULL);
-    isc = (uint64_t)(tv.tv_sec);
-    usc = (uint32_t)(tv.tv_usec);
-    t = (double)isc + (double)usc / 1000000;
-    t_center = (floor(t * fs) + 1) / fs;
+    // start the next sample window (t_center +/- 0.5 / fs)
+    if (ScanRate > 0)
+      t_center = t7_stream_window(&st, fs);
+    else
+      t_center = sampler_window(&ss);
     t_stop = t_center + 0.5 / fs;
 
-    // collect data for 1 sample period
-    while (t < t_stop)
+    // collect data for 1 sample period: the scans the T7 took during the
+    // window in stream mode, otherwise reads scheduled by the sampler
+    while ((ScanRate > 0) ? t7_stream_scan(&st, t_stop, aValuesAIN) : sampler_read(&ss))
     {
       // read AINs from the LabJack
-      err = LJM_eReadNames(handle, NUM_FRAMES_AIN, aNamesAIN, aValuesAIN, &errorAddress);
-      ErrorCheckWithAddress(err, errorAddress, "LJM_eReadNames");
-
-      // compute phase from instantaneous x,y,z
-      p += threefringe_phase(aValuesAIN[0], aValuesAIN[1], aValuesAIN[2]);
+      if (ScanRate == 0)
+      {
+        err = LJM_eReadNames(handle, NUM_FRAMES_AIN, aNamesAIN, aValuesAIN, &errorAddress);
+        ErrorCheckWithAddress(err, errorAddress, "LJM_eReadNames");
+      }
+
+      // queue instantaneous x,y,z and compute the phases once the block is full
+      xb[nb] = aValuesAIN[0];
+      yb[nb] = aValuesAIN[1];
+      zb[nb] = aValuesAIN[2];
+      if (++nb == BLOCK)
+      {
+        threefringe_block(&tf, 1, nb, BLOCK, xb, yb, zb, pb);
+        for (i = 0; i < nb; i++)
+          p += pb[i];
+        nb = 0;
+      }
 
       // increment loop counter
       N++;
-
-      // update epoch time with microseconds
-      gettimeofday(&tv, NULL);
-      isc = (uint64_t)(tv.tv_sec);
-      usc = (uint32_t)(tv.tv_usec);
-      t = (double)isc + (double)usc / 1000000;
     }
 
+    // a stream read failed, or every scan of the window was lost
+    ErrorCheck(st.err, "LJM_eStreamRead");
+    if (N == 0)
+      continue;
+
+    // phases of the scans left in the block
+    threefringe_block(&tf, 1, nb, BLOCK, xb, yb, zb, pb);
+    for (i = 0; i < nb; i++)
+      p += pb[i];
+    nb = 0;
+
     // compute average phase
     p = p / (double)N;
 
@@ -145,20 +208,23 @@ int main(void)
     memcpy(&tt, gmtime(&t_temp), sizeof(struct tm));
 
     // display results
-    printf("t = %i:%03i:%02i:%02i:%02i.%06i  N = %i  X1 = %0.5f  Y1 = %0.5f  Z1 = %0.5f  M = %i P1 = %0.5f\n", tt.tm_year+1900, tt.tm_yday+1, tt.tm_hour, tt.tm_min, tt.tm_sec, usc, N, aValuesAIN[0], aValuesAIN[1], aValuesAIN[2], M, p);
+    printf("t = %i:%03i:%02i:%02i:%02i.%06i  N = %i  X1 = %0.5f  Y1 = %0.5f  Z1 = %0.5f  M = %i P1 = %0.5f\n", tt.tm_year+1900, tt.tm_yday+1, tt.tm_hour, tt.tm_min, tt.tm_sec, usc, N, aValuesAIN[0], aValuesAIN[1], aValuesAIN[2], tf.M, p);
 
     // create or append miniSEED volume
-    write_mseed("X1", "AYX", (uint16_t)tt.tm_year+1900, (uint16_t)tt.tm_yday+1, (uint8_t)tt.tm_hour, (uint8_t)tt.tm_min, (uint8_t)tt.tm_sec, (uint16_t)(usc/100), 1, aValuesAIN[0], 0);
-    write_mseed("Y1", "AYY", (uint16_t)tt.tm_year+1900, (uint16_t)tt.tm_yday+1, (uint8_t)tt.tm_hour, (uint8_t)tt.tm_min, (uint8_t)tt.tm_sec, (uint16_t)(usc/100), 1, aValuesAIN[1], 1);
-    write_mseed("Z1", "AYZ", (uint16_t)tt.tm_year+1900, (uint16_t)tt.tm_yday+1, (uint8_t)tt.tm_hour, (uint8_t)tt.tm_min, (uint8_t)tt.tm_sec, (uint16_t)(usc/100), 1, aValuesAIN[2], 2);
-    write_mseed("P1", "BS1", (uint16_t)tt.tm_year+1900, (uint16_t)tt.tm_yday+1, (uint8_t)tt.tm_hour, (uint8_t)tt.tm_min, (uint8_t)tt.tm_sec, (uint16_t)(usc/100), 5, p, 3);
+    write_mseed(&ms, 0, t_center, fringe_counts(aValuesAIN[0]));
+    write_mseed(&ms, 1, t_center, fringe_counts(aValuesAIN[1]));
+    write_mseed(&ms, 2, t_center, fringe_counts(aValuesAIN[2]));
+    write_mseed(&ms, 3, t_center, p);
 
     // reset loop variables
     N = 0;
     p = 0;
   }
 
-  // close (this will never will happen under normal operation...)
+  // flush the miniSEED volumes and close
+  close_mseed(&ms);
+  if (ScanRate > 0)
+    t7_stream_stop(&st);
   err = LJM_Close(handle);
   ErrorCheck(err, "LJM_Close");
 
@@ -168,7 +234,7 @@ int main(void)
 double compute_fs(int16_t SRF, int16_t SRM)
 {
 
-  double fs;
+  double fs = 0;
   // If Sample rate factor > 0 and Sample rate Multiplier > 0,
   if ((SRF > 0) & (SRM > 0))
   {
@@ -196,205 +262,13 @@ double compute_fs(int16_t SRF, int16_t SRM)
   return fs;
 }
 
-double threefringe_phase(double x, double y, double z)
-{
-  // declare intermediate variables
-  double cosp, sinp;
-
-  // compute phase
-  cosp = cx * x + cy * y + cz * z;
-  sinp = sx * x + sy * y + sz * z;
-  p_new = atan2(sinp, cosp) + 2 * M * pi;
-
-  // unwrap phase
-  if (abs(p_new - p_old) > pi)
-  {
-    if (p_new < p_old)
-    {
-      M++;
-      p_new = p_new + 2 * pi;
-    }
-    else // (p_new > p_old)
-    {
-      M--;
-      p_new = p_new - 2 * pi;
-    }
-  }
-  p_old = p_new;
-
-  // return instantaneous phase
-  return p_new;
-}
-
-void write_mseed(char *LI, char *CI, uint16_t Yr, uint16_t DoY, uint8_t Hr, uint8_t Mn, uint8_t Sc, uint16_t S0001, uint8_t EF, double data, int chan_idx)
-{
-  // variables for making yearday filename and year/day directory
-  struct stat st = {0};
-  char path[200];
-  char fn[200];
-
-  // create /home/station/Data/yyyy path if it is not present
-  sprintf(path, "/home/sbf0/Data/%4i", Yr);
-  if (stat(path, &st) == -1)
-    mkdir(path, 0755);
-
-  // create /home/station/LabJack/data/yyyy/ddd path if it is not present
-  sprintf(path, "/home/sbf0/Data/%4i/%03i", Yr, DoY);
-  if (stat(path, &st) == -1)
-    mkdir(path, 0755);
-
-  // create full path and filename
-  sprintf(fn, "%s/2J.SBF1.%s.%s.%i.%03i.mseed", path, LI, CI, Yr, DoY);
-
-  // the file doesn't exist, i.e., this is the first time writing to a new file:
-  // 1) on startup
-  // 2) at the beginning of a new day
-  // 3) or it was deleted during data acquisition (how rude!)
-  if ( (stat(fn, &st) == -1) )
-  {
-    SeqNum[chan_idx] = 1;
-    SampNum[chan_idx] = 1;
-    write_mseed_header(fn, SeqNum[chan_idx], LI, CI, Yr, DoY, Hr, Mn, Sc, S0001, EF);
-    append_mseed(fn, SeqNum[chan_idx], (uint16_t)SampNum[chan_idx], EF, data);
-    SampNum[chan_idx]++;
-  }
-  // the file exists but SeqNum = 0, e.g., data acquisition is restarted during a given day
-  else if ( (stat(fn, &st) == 0) & (SeqNum[chan_idx] == 0) )
-  {
-    SeqNum[chan_idx] = last_mseed_seqnum(fn);
-    write_mseed_header(fn, SeqNum[chan_idx], LI, CI, Yr, DoY, Hr, Mn, Sc, S0001, EF);
-    append_mseed(fn, SeqNum[chan_idx], (uint16_t)SampNum[chan_idx], EF, data);
-    SampNum[chan_idx]++;
-  }
-  // the first sample to be written to a new data record block
-  else if (SampNum[chan_idx] == 1)
-  {
-    write_mseed_header(fn, SeqNum[chan_idx], LI, CI, Yr, DoY, Hr, Mn, Sc, S0001, EF);
-    append_mseed(fn, SeqNum[chan_idx], (uint16_t)SampNum[chan_idx], EF, data);
-    SampNum[chan_idx]++;
-  }
-  // the last sample to be written to an existing data record block
-  else if (SampNum[chan_idx] == NumSamp[chan_idx])
-  {
-    append_mseed(fn, SeqNum[chan_idx], (uint16_t)SampNum[chan_idx], EF, data);
-    SeqNum[chan_idx]++;
-    SampNum[chan_idx] = 1;
-  }
-  // just a normal file write, i.e., adding data to the end of data record block in an existing file 
-  else // if (SampNum[chan_idx] < NumSamp)
-  {
-    append_mseed(fn, SeqNum[chan_idx], (uint16_t)SampNum[chan_idx], EF, data);
-    SampNum[chan_idx]++;
-  }
-}
-
-void write_mseed_header(char *fn, int SqNu, char *LI, char *CI, uint16_t Yr, uint16_t DoY, uint8_t Hr, uint8_t Mn, uint8_t Sc, uint16_t S0001, uint8_t EF)
+double fringe_counts(double volts)
 {
-  // create (if necessary) and open file, scan to the end, write zeros, and rewind
-  FILE *fid;
-  struct stat st = {0};
-  if (stat(fn, &st) == -1)
-    fid = fopen(fn, "w+");
-  else
-    fid = fopen(fn, "r+");
-  fseek(fid, (SqNu-1)*4096, SEEK_SET);
-  char buff[4096] = {0};
-  fwrite(buff, 1, 4096, fid);
-  fseek(fid, (SqNu-1)*4096, SEEK_SET);
-
-  // Fixed Section of Data Header (48 bytes)
-  fprintf(fid, "%06i", SqNu);            // Sequence Number
-  fprintf(fid, "D");                     // Data Quality Indicator
-  fprintf(fid, " ");                     // Reserved Byte
-  fprintf(fid, "SBF1 ");                 // Station Identifier Code
-  fprintf(fid, "%s", LI);                // Location Identifier
-  fprintf(fid, "%s", CI);                // Channel Identifier
-  fprintf(fid, "2J");                    // Network Code
-  fwrite(&Yr, sizeof(Yr), 1, fid);       // Year
-  fwrite(&DoY, sizeof(DoY), 1, fid);     // Day of Year
-  fwrite(&Hr, sizeof(Hr), 1, fid);       // Hours
-  fwrite(&Mn, sizeof(Mn), 1, fid);       // Minutes
-  fwrite(&Sc, sizeof(Sc), 1, fid);       // Seconds
-  fprintf(fid, " ");                     // Skip 1 Byte (unused)
-  fwrite(&S0001, sizeof(S0001), 1, fid); // Seconds0001 (why not microseconds?)
-  uint16_t NoS = 0;
-  fwrite(&NoS, sizeof(NoS), 1, fid);     // Number of Samples (none so far...)
-  fwrite(&SRF, sizeof(SRF), 1, fid);     // Sample Rate Factor
-  fwrite(&SRM, sizeof(SRM), 1, fid);     // Sample Rate Multiplier
-  uint8_t AID = 0;
-  fwrite(&AID, sizeof(AID), 1, fid);     // Activity Flags
-  fwrite(&AID, sizeof(AID), 1, fid);     // IO Flags
-  fwrite(&AID, sizeof(AID), 1, fid);     // Data Quality Flags
-  uint8_t NBF = 1;
-  fwrite(&NBF, sizeof(NBF), 1, fid);     // Number Blockettes to Follow
-  int32_t TC = 0;
-  fwrite(&TC, sizeof(TC), 1, fid);       // Time Correction
-  uint16_t OBD = 64;
-  fwrite(&OBD, sizeof(OBD), 1, fid);     // Offset to the Beginning of Data
-  uint16_t OFB = 48;
-  fwrite(&OFB, sizeof(OFB), 1, fid);     // Offset to the First Blockette
-  uint16_t BT = 1000;
-  fwrite(&BT, sizeof(BT), 1, fid);       // Blockette Type
-
-  // [1000] Data Only SEED Blockette (8 bytes)
-  uint16_t ONB = 0;
-  fwrite(&ONB, sizeof(ONB), 1, fid);     // Offset to the Next Blockette
-  fwrite(&EF, sizeof(EF), 1, fid);       // Encoding Format
-  uint8_t WO = 0;
-  fwrite(&WO, sizeof(WO), 1, fid);       // Word Order (0 = little endian)
-  uint8_t DRL = 12;
-  fwrite(&DRL, sizeof(DRL), 1, fid);     // Data Record Length (12, since 2^12 = 4096)
-  uint8_t Res = 0;
-  fwrite(&Res, sizeof(Res), 1, fid);     // Reserved
-
-  // close file
-  fclose(fid);
-}
-
-void append_mseed(char *fn, int SqNu, uint16_t SpNu, uint8_t EF, double data)
-{
-  // open file
-  FILE *fid;
-  fid = fopen(fn, "r+");
-
-  // seek to and update sample number in header block
-  fseek(fid, (SqNu-1)*4096+30, SEEK_SET);
-  fwrite(&SpNu, sizeof(SpNu), 1, fid);
-
-  // if Encoding Format = 1 (implying int16_t) convert fringe data to 16-bit
-  int16_t fringe;
-  if (EF == 1)
-  {
-    // convert to int16_t (these calibration numbers are specific to LabJack T7 470015424)
-    fringe = (int16_t)((data + 10.5730266571044921875) / 0.00031549786217510700225830078125 - 33512.19921875);
-    // seek to and write latest sample to data block
-    fseek(fid, (SqNu-1)*4096+64+(SpNu-1)*sizeof(fringe), SEEK_SET);
-    fwrite(&fringe, sizeof(fringe), 1, fid);
-  }
-  // otherwise write phase data (EF = 5 = float64)
-  else
-  {
-    // seek to and write latest sample to data block
-    fseek(fid, (SqNu-1)*4096+64+(SpNu-1)*sizeof(data), SEEK_SET);
-    fwrite(&data, sizeof(data), 1, fid);
-  }
-
-  // close file
-  fclose(fid);
+  // convert fringe voltage to int16_t counts (these calibration numbers are specific to LabJack T7 470015424)
+  return (volts + 10.5730266571044921875) / 0.00031549786217510700225830078125 - 33512.19921875;
 }
 
-int last_mseed_seqnum(char *fn)
+void stop_daq(int sig)
 {
-  // open file and seek to the end
-  FILE *fid;
-  fid = fopen(fn, "r");
-  fseek(fid, 0, SEEK_END);
-
-  // compute new Sequence Number from file size and Data Record Length
-  int SqNu;
-  SqNu = ftell(fid) / 4096 + 1;
-
-  // close file and return Sequence Number
-  fclose(fid);
-  return SqNu;
+  running = 0;
 }
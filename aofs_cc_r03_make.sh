@@ -1,7 +1,7 @@
 #!/bin/bash
 
 echo -e "\nCompiling AOFS-CC Rev.03 data acquisition code for the LabJack T7 . . . \c"
-gcc aofs_cc_r03_daq.c -g -Wall -lLabJackM -lm -o acc3_daq
+gcc aofs_cc_r03_daq.c mseed_writer.c io_batch.c steim.c spsc_ring.c sampler.c t7_stream.c threefringe.c -O2 -g -Wall -pthread -lLabJackM -lm -o acc3_daq
 echo -e "done!\n"
 
 rm -f *~ > /dev/null
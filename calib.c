@@ -0,0 +1,294 @@
+// channel calibrations shared by the data acquisition programs
+//
+// by: Scott DeWolf
+//
+// The programs used to calibrate each channel with its own expression, e.g.,
+// 515.29*pow(s1,5)-10486.13*pow(s1,4)+...+50771368.77, which takes five pow()
+// calls per channel and sample and has the coefficients compiled in. Here
+// the coefficients come from a calibration file (see calib_read()) and every
+// polynomial is evaluated in Horner form, one multiply-add per coefficient.
+// calib_apply() does all the channels of a frame together; calib_eval() is
+// the same arithmetic for a single channel, so both give identical results
+// (calib_bench compares them with the old expressions).
+//
+//  created: Saturday, October 17, 2026 (2026290)
+// modified: Saturday, October 17, 2026 (2026290)
+//  history:
+//           [2026290] - created document
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include "calib.h"
+
+#define MAX_TOKEN 32
+
+// y * x + c in one rounding where the CPU has fused multiply-add (FP_FAST_FMA
+// is defined when fma() is a single instruction), otherwise in two
+#ifdef FP_FAST_FMA
+#define MULADD(y, x, c) fma((y), (x), (c))
+#else
+#define MULADD(y, x, c) ((y) * (x) + (c))
+#endif
+
+// local function definitions
+static double horner(const double *coef, int ncoef, double x);
+static int parse_line(calib_channel *cc, int argc, char **argv, const char **why);
+static int get_coefs(int argc, char **argv, double *coef, const char **why);
+
+void calib_none(calib_channel *cc)
+{
+  memset(cc, 0, sizeof(*cc));
+  cc->type = CALIB_NONE;
+}
+
+int calib_poly(calib_channel *cc, int ncoef, const double *coef)
+{
+  if ((ncoef < 1) | (ncoef > CALIB_MAX_COEF))
+    return -1;
+
+  memset(cc, 0, sizeof(*cc));
+  cc->type = CALIB_POLY;
+  cc->npiece = 1;
+  cc->ncoef[0] = ncoef;
+  memcpy(cc->coef[0], coef, ncoef * sizeof(double));
+  return 0;
+}
+
+void calib_scale(calib_channel *cc, double a, double b)
+{
+  memset(cc, 0, sizeof(*cc));
+  cc->type = CALIB_SCALE;
+  cc->npiece = 1;
+  cc->ncoef[0] = 2;
+  cc->coef[0][0] = a;
+  cc->coef[0][1] = b;
+}
+
+int calib_piece(calib_channel *cc, double upper, int ncoef, const double *coef)
+{
+  int k;
+
+  if (cc->type != CALIB_PIECEWISE)
+    memset(cc, 0, sizeof(*cc));
+  k = cc->npiece;
+  if ((k == CALIB_MAX_PIECE) | (ncoef < 1) | (ncoef > CALIB_MAX_COEF))
+    return -1;
+  if ((k > 0) && (upper <= cc->upper[k-1]))
+    return -1;
+
+  cc->type = CALIB_PIECEWISE;
+  cc->upper[k] = upper;
+  cc->ncoef[k] = ncoef;
+  memcpy(cc->coef[k], coef, ncoef * sizeof(double));
+  cc->npiece++;
+  return 0;
+}
+
+double calib_eval(const calib_channel *cc, double x)
+{
+  int k;
+
+  switch (cc->type)
+  {
+    case CALIB_POLY:
+      return horner(cc->coef[0], cc->ncoef[0], x);
+    case CALIB_SCALE:
+      return MULADD(cc->coef[0][0], x + cc->coef[0][1], 0.0);
+    case CALIB_PIECEWISE:
+      for (k = 0; (k < cc->npiece - 1) && (x >= cc->upper[k]); k++)
+        ;
+      return horner(cc->coef[k], cc->ncoef[k], x);
+  }
+  return x;
+}
+
+int calib_init(calib *cb, int nchan, const calib_channel *cc)
+{
+  int j, k, n;
+
+  if ((nchan < 0) | (nchan > CALIB_MAX_CHAN))
+    return -1;
+  memset(cb, 0, sizeof(*cb));
+  cb->nchan = nchan;
+  memcpy(cb->ch, cc, nchan * sizeof(calib_channel));
+
+  // longest polynomial (y = 1 x + 0 without calibration)
+  cb->ncoef = 2;
+  for (j = 0; j < nchan; j++)
+    if ((cc[j].type == CALIB_POLY) && (cc[j].ncoef[0] > cb->ncoef))
+      cb->ncoef = cc[j].ncoef[0];
+
+  // coefficients right-aligned, i.e., padded with leading zeros
+  for (j = 0; j < nchan; j++)
+  {
+    switch (cc[j].type)
+    {
+      case CALIB_NONE:
+        cb->c[cb->ncoef-2][j] = 1;
+        break;
+      case CALIB_POLY:
+        n = cc[j].ncoef[0];
+        for (k = 0; k < n; k++)
+          cb->c[cb->ncoef-n+k][j] = cc[j].coef[0][k];
+        break;
+      case CALIB_SCALE:
+        cb->c[cb->ncoef-2][j] = cc[j].coef[0][0];
+        cb->off[j] = cc[j].coef[0][1];
+        break;
+      case CALIB_PIECEWISE:
+        cb->piecewise[cb->npiecewise++] = j;
+        break;
+    }
+  }
+
+  return 0;
+}
+
+void calib_apply(const calib *cb, const double *x, double *y)
+{
+  double u[CALIB_MAX_CHAN];
+  int j, k, n = cb->nchan;
+
+  // one Horner step per power across the channels
+  for (j = 0; j < n; j++)
+  {
+    u[j] = x[j] + cb->off[j];
+    y[j] = cb->c[0][j];
+  }
+  for (k = 1; k < cb->ncoef; k++)
+    for (j = 0; j < n; j++)
+      y[j] = MULADD(y[j], u[j], cb->c[k][j]);
+
+  // the piece depends on the value
+  for (k = 0; k < cb->npiecewise; k++)
+  {
+    j = cb->piecewise[k];
+    y[j] = calib_eval(&cb->ch[j], x[j]);
+  }
+}
+
+int calib_read(calib_channel *cc, int nchan, const char **LI, const char **CI, const char *path)
+{
+  FILE *fid;
+  char line[1024], *argv[MAX_TOKEN], *p;
+  const char *why = NULL;
+  int argc, j, n = 0;
+
+  fid = fopen(path, "r");
+  if (fid == NULL)
+  {
+    perror(path);
+    return -1;
+  }
+
+  while (fgets(line, sizeof(line), fid) != NULL)
+  {
+    n++;
+
+    // drop the comment and split the line into words
+    if ((p = strchr(line, '#')) != NULL)
+      *p = '\0';
+    argc = 0;
+    for (p = strtok(line, " \t\r\n"); (p != NULL) & (argc < MAX_TOKEN); p = strtok(NULL, " \t\r\n"))
+      argv[argc++] = p;
+    if (argc == 0)
+      continue;
+
+    // the channel the line is about
+    why = "a calibration needs LI CI and its type";
+    j = nchan;
+    if (argc >= 3)
+    {
+      why = "unknown channel";
+      for (j = 0; j < nchan; j++)
+        if ((strcmp(argv[0], LI[j]) == 0) & (strcmp(argv[1], CI[j]) == 0))
+          break;
+    }
+    if ((j == nchan) || (parse_line(&cc[j], argc - 2, argv + 2, &why) == -1))
+    {
+      fprintf(stderr, "%s:%i: %s\n", path, n, why);
+      fclose(fid);
+      return -1;
+    }
+  }
+  fclose(fid);
+
+  return 0;
+}
+
+static double horner(const double *coef, int ncoef, double x)
+{
+  double y = coef[0];
+  int k;
+
+  for (k = 1; k < ncoef; k++)
+    y = MULADD(y, x, coef[k]);
+  return y;
+}
+
+static int parse_line(calib_channel *cc, int argc, char **argv, const char **why)
+{
+  double coef[CALIB_MAX_COEF], upper;
+  char *end;
+  int n;
+
+  if (strcmp(argv[0], "poly") == 0)
+  {
+    if ((n = get_coefs(argc - 1, argv + 1, coef, why)) == -1)
+      return -1;
+    calib_poly(cc, n, coef);
+  }
+  else if (strcmp(argv[0], "scale") == 0)
+  {
+    *why = "scale needs a and b of a (x + b)";
+    if ((argc != 3) || (get_coefs(argc - 1, argv + 1, coef, why) != 2))
+      return -1;
+    calib_scale(cc, coef[0], coef[1]);
+  }
+  else if (strcmp(argv[0], "piece") == 0)
+  {
+    *why = "piece needs its upper bound and a poly";
+    if ((argc < 4) || (strcmp(argv[2], "poly") != 0))
+      return -1;
+    errno = 0;
+    upper = strtod(argv[1], &end);
+    if ((end == argv[1]) | (*end != '\0') | (errno != 0))
+      return -1;
+    if ((n = get_coefs(argc - 3, argv + 3, coef, why)) == -1)
+      return -1;
+    *why = "too many pieces, or not in increasing order of their upper bounds";
+    if (calib_piece(cc, upper, n, coef) == -1)
+      return -1;
+  }
+  else
+  {
+    *why = "a calibration is poly, scale or piece";
+    return -1;
+  }
+
+  return 0;
+}
+
+static int get_coefs(int argc, char **argv, double *coef, const char **why)
+{
+  char *end;
+  int k;
+
+  *why = "poly needs 1 to 8 coefficients";
+  if ((argc < 1) | (argc > CALIB_MAX_COEF))
+    return -1;
+
+  *why = "bad coefficient";
+  for (k = 0; k < argc; k++)
+  {
+    errno = 0;
+    coef[k] = strtod(argv[k], &end);
+    if ((end == argv[k]) | (*end != '\0') | (errno != 0))
+      return -1;
+  }
+  return argc;
+}
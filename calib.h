@@ -0,0 +1,79 @@
+// channel calibrations shared by the data acquisition programs
+//
+// by: Scott DeWolf
+//
+//  created: Saturday, October 17, 2026 (2026290)
+// modified: Saturday, October 17, 2026 (2026290)
+//  history:
+//           [2026290] - created document
+//
+
+#ifndef CALIB_H
+#define CALIB_H
+
+#define CALIB_MAX_CHAN 64    // most channels in a frame
+#define CALIB_MAX_COEF 8     // most coefficients of a polynomial (degree 7)
+#define CALIB_MAX_PIECE 8    // most pieces of a piecewise calibration
+
+// kinds of calibration
+enum
+{
+  CALIB_NONE,                       // y = x
+  CALIB_POLY,                       // y = c[0] x^(n-1) + ... + c[n-1]
+  CALIB_SCALE,                      // y = a (x + b), e.g., kd = 214748364.8 * (kd + 0.895...)
+  CALIB_PIECEWISE                   // a polynomial for each range of x
+};
+
+// calibration of one channel
+typedef struct
+{
+  int type;                         // CALIB_NONE, CALIB_POLY, CALIB_SCALE or CALIB_PIECEWISE
+  int npiece;                       // polynomials (1 unless piecewise)
+  double upper[CALIB_MAX_PIECE];    // piece k applies to x < upper[k] (the last one to any x above)
+  int ncoef[CALIB_MAX_PIECE];
+  double coef[CALIB_MAX_PIECE][CALIB_MAX_COEF]; // highest power first (a, b for CALIB_SCALE)
+} calib_channel;
+
+// calibrations of every channel of a frame
+//
+// The polynomials are stored coefficient by coefficient across the channels
+// (shorter ones padded with leading zeros), so calib_apply() evaluates all of
+// them with one Horner step per power, each step a loop over the channels the
+// compiler turns into SIMD multiply-adds (fused where the CPU has FMA).
+typedef struct
+{
+  int nchan;
+  int ncoef;                              // longest polynomial
+  int npiecewise;                         // piecewise channels (evaluated one at a time)
+  int piecewise[CALIB_MAX_CHAN];
+  double off[CALIB_MAX_CHAN];             // added to x first (b of CALIB_SCALE)
+  double c[CALIB_MAX_COEF][CALIB_MAX_CHAN]; // coefficient k (highest power first) of every channel
+  calib_channel ch[CALIB_MAX_CHAN];
+} calib;
+
+// no calibration, a polynomial (highest power first), or a (x + b)
+void calib_none(calib_channel *cc);
+int calib_poly(calib_channel *cc, int ncoef, const double *coef);
+void calib_scale(calib_channel *cc, double a, double b);
+
+// add a piece that applies below upper (pieces go in increasing order of upper)
+int calib_piece(calib_channel *cc, double upper, int ncoef, const double *coef);
+
+// calibrated value of one channel (the reference for calib_apply())
+double calib_eval(const calib_channel *cc, double x);
+
+// lay out the calibrations of nchan channels for calib_apply()
+int calib_init(calib *cb, int nchan, const calib_channel *cc);
+
+// y[j] = calibrated x[j] for every channel of the frame
+void calib_apply(const calib *cb, const double *x, double *y);
+
+// read the calibrations of the channels named LI[j] CI[j] from a file of
+//   LI CI poly c...              polynomial, highest power first
+//   LI CI scale a b              a (x + b)
+//   LI CI piece upper poly c...  piecewise polynomials, in increasing order of upper (inf for the last)
+// channels the file doesn't name are left as they are; returns -1 (after
+// saying why) if the file can't be read or isn't valid
+int calib_read(calib_channel *cc, int nchan, const char **LI, const char **CI, const char *path);
+
+#endif
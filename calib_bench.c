@@ -0,0 +1,176 @@
+// benchmark and agreement check of the channel calibrations
+//
+// by: Scott DeWolf
+//
+// Reads the calibration files of the Closed TBECS TAPPT Rev.01 and Rev.02 and
+// evaluates them with calib_apply() on voltages swept over the +/-10 V range
+// of the AINs, against the pow() expressions of closed_tbecs_tappt_r01_daq.c
+// and closed_tbecs_tappt_r02_daq.c. Reports the largest absolute and relative
+// differences, how many int32 counts (as written to the miniSEED volumes)
+// differ, and the time per frame of both. Also checks the cubic tilt of the
+// *_lev.c programs against calib_eval().
+//
+// usage: ./calib_bench [number of frames] [directory of the .cal files]
+//
+//  created: Saturday, October 17, 2026 (2026290)
+// modified: Saturday, October 17, 2026 (2026290)
+//  history:
+//           [2026290] - created document
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include "calib.h"
+
+#define NCHAN 7
+
+// function definitions
+void tbecs_r01(const double *x, double *y);
+void tbecs_r02(const double *x, double *y);
+int compare(const char *name, const char *path, void (*old)(const double *, double *), int n);
+double elapsed(struct timespec *t0);
+
+// channels of the TBECS programs
+const char *LI[NCHAN] = {"E1", "E1", "E1", "E1", "E1", "E1", "E1"};
+const char *CI[NCHAN] = {"VAX", "VAY", "VS1", "VS2", "VS3", "VSZ", "VKD"};
+
+// x tilt calibration of closed_tbecs_tappt_r02_lev.c
+const double X0[4] = {0.021118, -0.016270, 0.926724, -5.042287};
+
+int main(int argc, char **argv)
+{
+  int n = (argc > 1) ? atoi(argv[1]) : 1000000;
+  const char *dir = (argc > 2) ? argv[2] : ".";
+  char path[256];
+  calib_channel cc;
+  double v, t, err, err_max = 0;
+  int i, rc = 0;
+
+  snprintf(path, sizeof(path), "%s/closed_tbecs_tappt_r01.cal", dir);
+  rc |= compare("closed_tbecs_tappt_r01", path, tbecs_r01, n);
+  snprintf(path, sizeof(path), "%s/closed_tbecs_tappt_r02.cal", dir);
+  rc |= compare("closed_tbecs_tappt_r02", path, tbecs_r02, n);
+
+  // cubic tilt of the leveling programs
+  calib_poly(&cc, 4, X0);
+  for (i = 0; i <= 200000; i++)
+  {
+    v = -10 + 20 * (double)i / 200000;
+    t = X0[0]*pow(v,3)+X0[1]*pow(v,2)+X0[2]*v+X0[3];
+    err = fabs(calib_eval(&cc, v) - t);
+    if (err > err_max)
+      err_max = err;
+  }
+  printf("leveling tilt: largest |calib_eval - pow()| = %0.3g degrees\n", err_max);
+
+  return rc;
+}
+
+int compare(const char *name, const char *path, void (*old)(const double *, double *), int n)
+{
+  calib_channel cc[NCHAN];
+  calib cb;
+  double *x, *y_old, *y_new, err, err_max[NCHAN] = {0}, rel_max[NCHAN] = {0}, t_old, t_new;
+  struct timespec t0;
+  int i, j, ndiff[NCHAN] = {0}, nbig[NCHAN] = {0};
+
+  for (j = 0; j < NCHAN; j++)
+    calib_none(&cc[j]);
+  if ((calib_read(cc, NCHAN, LI, CI, path) == -1) || (calib_init(&cb, NCHAN, cc) == -1))
+    return 1;
+
+  x = malloc(n * NCHAN * sizeof(double));
+  y_old = malloc(n * NCHAN * sizeof(double));
+  y_new = malloc(n * NCHAN * sizeof(double));
+  if ((x == NULL) | (y_old == NULL) | (y_new == NULL))
+  {
+    perror("malloc");
+    return 1;
+  }
+
+  // random voltages over the +/-10 V range of every channel
+  srand(1);
+  for (i = 0; i < n * NCHAN; i++)
+    x[i] = 20 * ((double)rand() / RAND_MAX - 0.5);
+
+  // the expressions of the *_daq.c programs
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  for (i = 0; i < n; i++)
+    old(x + i * NCHAN, y_old + i * NCHAN);
+  t_old = elapsed(&t0);
+
+  // the calibration engine
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  for (i = 0; i < n; i++)
+    calib_apply(&cb, x + i * NCHAN, y_new + i * NCHAN);
+  t_new = elapsed(&t0);
+
+  // agreement (counts only where they fit an int32)
+  for (i = 0; i < n * NCHAN; i++)
+  {
+    j = i % NCHAN;
+    err = fabs(y_new[i] - y_old[i]);
+    if (err > err_max[j])
+      err_max[j] = err;
+    if ((y_old[i] != 0) && (err / fabs(y_old[i]) > rel_max[j]))
+      rel_max[j] = err / fabs(y_old[i]);
+    if (fabs(y_old[i]) >= 2147483647.0)
+      nbig[j]++;
+    else if ((int32_t)y_new[i] != (int32_t)y_old[i])
+      ndiff[j]++;
+  }
+
+  printf("%s: %i frames of %i channels (%s)\n", name, n, NCHAN, path);
+  printf("  pow() expressions: %8.2f ns/frame\n", 1e9 * t_old / n);
+  printf("  calib_apply:       %8.2f ns/frame  (%0.1fx)\n", 1e9 * t_new / n, t_old / t_new);
+  for (j = 0; j < NCHAN; j++)
+    printf("  %s.%s  largest difference %0.3g counts (relative %0.3g), %i int32 samples differ (%i beyond int32)\n", LI[j], CI[j], err_max[j], rel_max[j], ndiff[j], nbig[j]);
+
+  free(x);
+  free(y_old);
+  free(y_new);
+  return 0;
+}
+
+void tbecs_r01(const double *x, double *y)
+{
+  double ax = x[0], ay = x[1], s1 = x[2], s2 = x[3], s3 = x[4], sz = x[5], kd = x[6];
+
+  // apply calibrations (1 count = 1E-12 m)
+  ax=-90295398.9713483899831772*ax-116217901.7253157496452332;
+  ay=-89668905.5438365489244461*ay-221364851.3930167257785797;
+  s1=19189.6997255055648566*pow(s1,5)-512197.9469103727024049*pow(s1,4)+5603744.7275238242000341*pow(s1,3)-30511461.4624261818826199*pow(s1,2)+114781725.7509997934103012*s1-214612580.8191534876823425;
+  s2=22971.1520200886297971*pow(s2,5)-627946.6206770762801170*pow(s2,4)+6870698.0004415744915605*pow(s2,3)-36773177.0652942359447479*pow(s2,2)+128710786.2826501280069351*s2-253762335.7343097925186157;
+  s3=25415.2760133468618733*pow(s3,5)-724152.4976645695278421*pow(s3,4)+8065154.5399690307676792*pow(s3,3)-43525412.8637012690305710*pow(s3,2)+148378297.5192890465259552*s3-317455703.0723627805709839;
+  sz=61651.9291711860787473*pow(sz,5)-1720721.9158203348051757*pow(sz,4)+18425728.7218700572848320*pow(sz,3)-88360397.1458755731582642*pow(sz,2)+245503406.4919264018535614*sz-770741818.5607926845550537;
+  kd=214748364.8*(kd+1.76818084716797);
+
+  y[0] = ax; y[1] = ay; y[2] = s1; y[3] = s2; y[4] = s3; y[5] = sz; y[6] = kd;
+}
+
+void tbecs_r02(const double *x, double *y)
+{
+  double ax = x[0], ay = x[1], s1 = x[2], s2 = x[3], s3 = x[4], sz = x[5], kd = x[6];
+
+  // apply calibrations (1 count = 1E-12 m)
+  ax=179507.3225190506200306*pow(ax,5)-38282.1201270477613434*pow(ax,4)-118093.4076375856238883*pow(ax,3)+719481.6821073147002608*pow(ax,2)+72180186.9633625894784927*ax+10522637.8121735211461782;
+  ay=149010.7198039616923779*pow(ay,5)-55737.1362173277884722*pow(ay,4)-314494.8896113458322361*pow(ay,3)+509934.6190561389084905*pow(ay,2)+78332481.6705755293369293*ay-4494977.0440397597849369;
+  s1=515.2985601768933748*pow(s1,5)-10486.1330110110302485*pow(s1,4)+83500.5904828658094630*pow(s1,3)-551221.0093463045777753*pow(s1,2)+12518479.5051706321537495*s1+50771368.7720859646797180;
+  s2=310.0068297741872811*pow(s2,5)-6416.1177080221868891*pow(s2,4)+49525.0775287273354479*pow(s2,3)-494734.4071620409376919*pow(s2,2)+13261651.3407142497599125*s2-76301788.5156911313533783;
+  s3=93.1160882272134529*pow(s3,5)-1767.9009701423797196*pow(s3,4)+23306.1446351256599883*pow(s3,3)-533699.4606133586494252*pow(s3,2)+13776951.2137680370360613*s3-32834530.5010114014148712;
+  sz=698.5563976893054132*pow(sz,5)-14980.5462963050813414*pow(sz,4)+115023.2165908774477430*pow(sz,3)-502657.4391966568073258*pow(sz,2)+11499344.4804664254188538*sz-16256409.8159562051296234;
+  kd=214748364.8*(kd+0.895270586013794);
+
+  y[0] = ax; y[1] = ay; y[2] = s1; y[3] = s2; y[4] = s3; y[5] = sz; y[6] = kd;
+}
+
+double elapsed(struct timespec *t0)
+{
+  struct timespec t1;
+
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  return (double)(t1.tv_sec - t0->tv_sec) + (double)(t1.tv_nsec - t0->tv_nsec) / 1000000000;
+}
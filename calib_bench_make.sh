@@ -0,0 +1,7 @@
+#!/bin/bash
+
+echo -e "\nCompiling channel calibration benchmark . . . \c"
+gcc calib_bench.c calib.c -O2 -g -Wall -lm -o calib_bench
+echo -e "done!\n"
+
+rm -f *~ > /dev/null
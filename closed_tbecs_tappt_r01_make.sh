@@ -1,7 +1,7 @@
 #!/bin/bash
 
 echo -e "\nCompiling 4.5in Closed TBECS TAPPT Rev.01 data acquisition code for the LabJack T7 . . . \c"
-gcc closed_tbecs_tappt_r01_daq.c -g -Wall -lLabJackM -lm -o ctt1_daq
+gcc closed_tbecs_tappt_r01_daq.c mseed_writer.c io_batch.c steim.c spsc_ring.c sampler.c -g -Wall -pthread -lLabJackM -lm -o ctt1_daq
 echo -e "done!\n"
 
 echo -e "Compiling 4.5in Closed TBECS TAPPT Rev.01 tiltmeter levelling code for the LabJack T7 . . . \c"
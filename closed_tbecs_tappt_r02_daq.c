@@ -5,7 +5,7 @@
 // modified from https://labjack.com/sites/default/files/software/labjack_ljm_software_2016_05_15_i386.tar_0.gz/labjack_ljm_examples/examples/ain/dual_ain_loop.c
 //
 //  created: Monday, June 26, 2017 (2017177)
-// modified: Wednesday, March 6, 2019 (2019065)
+// modified: Saturday, October 17, 2026 (2026290)
 //  history:
 //           [2016239] - created document
 //           [2018115] - major revision to include direct recording to miniSEED
@@ -13,10 +13,15 @@
 //           [2018354] - changed network code from PB to 2J
 //           [2019064] - changed output from uncalibrated int32 to uncalibrated float32
 //           [2019065] - changed output from uncalibrated float32 to calibrated int32 (1 count = 1E-12 m)
+//           [2026290] - moved miniSEED writing to the shared mseed_writer module
+//           [2026290] - strain channels can be compressed with Steim-1 or Steim-2 (see EF)
+//           [2026290] - day volumes are written from a separate thread (see QueueLength)
+//           [2026290] - sample windows are scheduled with clock_nanosleep (see ReadsPerSample)
 //
 
 #include <stdio.h>
 #include <time.h>
+#include <signal.h>
 #include <math.h>
 #include "LabJackM.h"
 #include "LJM_Utilities.h"
@@ -24,22 +29,25 @@
 #include <sys/stat.h>
 #include <unistd.h>
 #include <string.h>
+#include "mseed_writer.h"
+#include "sampler.h"
 
 // function definitions
 double compute_fs(int16_t SRF, int16_t SRM);
-void write_mseed(char *LI, char *CI, uint16_t Yr, uint16_t DoY, uint8_t Hr, uint8_t Mn, uint8_t Sc, uint16_t S0001, double data, int chan_idx);
-void write_mseed_header(char *fn, int SqNu, char *LI, char *CI, uint16_t Yr, uint16_t DoY, uint8_t Hr, uint8_t Mn, uint8_t Sc, uint16_t S0001);
-void append_mseed(char *fn, int SqNu, uint16_t SpNu, double data);
-int last_mseed_seqnum(char *fn);
+void stop_daq(int sig);
 
 // global constants
 const int16_t SRF = 2;                // Sample Rate Factor
 const int16_t SRM = -10;              // Sample Rate Mutiplier
-const uint8_t EF = 3;                 // Encoding Format (3 = 32-bit signed integer)
+const int ReadsPerSample = 0;         // reads per sample window (0 = as fast as the instrument answers)
+const uint8_t EF = 3;                 // Encoding Format (3 = 32-bit signed integer, 10 = Steim-1, 11 = Steim-2)
 
 // global variables for writing to miniSEED volumes
-const int NumSamp[7] = {1008,1008,1008,1008,1008,1008,1008}; // (Record Length - Header Size) / Data Size = (2^12 - 64) / sizeof(data)
-int SeqNum[7] = {0,0,0,0,0,0,0}, SampNum[7] = {1,1,1,1,1,1,1};
+const double FlushInterval = 60; // seconds between writes of a partially filled record
+const size_t QueueLength = 65536; // samples held for the writer thread while the day volumes can't be written
+
+// cleared by SIGINT or SIGTERM to leave the main loop
+volatile sig_atomic_t running = 1;
 
 int main()
 {
@@ -73,10 +81,10 @@ int main()
   double aValuesAIN[NUM_FRAMES_AIN] = {0};
   const char * aNamesAIN[NUM_FRAMES_AIN] = {"AIN0", "AIN1", "AIN2", "AIN3", "AIN4", "AIN5", "AIN6"};
 
-  // variables for getting the epoch time with microseconds
-  struct timeval tv;
+  // variables for the sample windows and their epoch times
+  sampler ss;
   uint64_t isc; uint32_t usc;
-  double t, t_center, t_stop;
+  double t_center;
 
   // variables for getting the year, doy, hours, minutes, and seconds
   time_t t_temp;
@@ -87,6 +95,9 @@ int main()
   double ax = 0, ay = 0, s1 = 0, s2 = 0, s3 = 0, sz = 0, kd = 0;
   double fs;
 
+  // miniSEED volumes written by this program
+  mseed_writer ms;
+
   // compute sample rate (in Hz)
   fs = compute_fs(SRF, SRM);
 
@@ -99,19 +110,34 @@ int main()
   err = LJM_eWriteNames(handle, NUM_FRAMES_CONFIG, aNamesConfig, aValuesConfig, &errorAddress);
   ErrorCheckWithAddress(err, errorAddress, "LJM_eWriteNames");
 
-  // main data collection and storage (infinite) loop
-  while (1)
+  // set up the miniSEED volumes
+  mseed_init(&ms, "/home/avn3/Data", "2J", "AVN3", SRF, SRM, FlushInterval);
+  mseed_add_channel(&ms, "E1", "VAX", EF);
+  mseed_add_channel(&ms, "E1", "VAY", EF);
+  mseed_add_channel(&ms, "E1", "VS1", EF);
+  mseed_add_channel(&ms, "E1", "VS2", EF);
+  mseed_add_channel(&ms, "E1", "VS3", EF);
+  mseed_add_channel(&ms, "E1", "VSZ", EF);
+  mseed_add_channel(&ms, "E1", "VKD", EF);
+
+  // write the day volumes from a separate thread so storage stalls can't delay sampling
+  mseed_start_writer(&ms, QueueLength);
+
+  // leave the main loop cleanly on SIGINT or SIGTERM
+  signal(SIGINT, stop_daq);
+  signal(SIGTERM, stop_daq);
+
+  // wake up ReadsPerSample times per sample window
+  sampler_init(&ss, fs, ReadsPerSample, NULL);
+
+  // main data collection and storage loop
+  while (running)
   {
-    // get epoch time in microseconds
-    gettimeofday(&tv, NULL);
-    isc = (uint64_t)(tv.tv_sec);
-    usc = (uint32_t)(tv.tv_usec);
-    t = (double)isc + (double)usc / 1000000;
-    t_center = (floor(t * fs) + 1) / fs;
-    t_stop = t_center + 0.5 / fs;
-
-    // collect data for 1 sample period
-    while (t < t_stop)
+    // start the next sample window (t_center +/- 0.5 / fs)
+    t_center = sampler_window(&ss);
+
+    // collect data for 1 sample period, sleeping until each read
+    while (sampler_read(&ss))
     {
       // read AINs from the LabJack
       err = LJM_eReadNames(handle, NUM_FRAMES_AIN, aNamesAIN, aValuesAIN, &errorAddress);
@@ -128,12 +154,6 @@ int main()
 
       // increment loop counter
       N++;
-
-      // update epoch time with microseconds
-      gettimeofday(&tv, NULL);
-      isc = (uint64_t)(tv.tv_sec);
-      usc = (uint32_t)(tv.tv_usec);
-      t = (double)isc + (double)usc / 1000000;
     }
 
     // compute average tilts, strains and temperatures
@@ -174,13 +194,13 @@ int main()
     kd=214748364.8*(kd+0.895270586013794);
 
     // create or append miniSEED volume
-    write_mseed("E1", "VAX", (uint16_t)tt.tm_year+1900, (uint16_t)tt.tm_yday+1, (uint8_t)tt.tm_hour, (uint8_t)tt.tm_min, (uint8_t)tt.tm_sec, (uint16_t)(usc/100), ax, 0);
-    write_mseed("E1", "VAY", (uint16_t)tt.tm_year+1900, (uint16_t)tt.tm_yday+1, (uint8_t)tt.tm_hour, (uint8_t)tt.tm_min, (uint8_t)tt.tm_sec, (uint16_t)(usc/100), ay, 1);
-    write_mseed("E1", "VS1", (uint16_t)tt.tm_year+1900, (uint16_t)tt.tm_yday+1, (uint8_t)tt.tm_hour, (uint8_t)tt.tm_min, (uint8_t)tt.tm_sec, (uint16_t)(usc/100), s1, 2);
-    write_mseed("E1", "VS2", (uint16_t)tt.tm_year+1900, (uint16_t)tt.tm_yday+1, (uint8_t)tt.tm_hour, (uint8_t)tt.tm_min, (uint8_t)tt.tm_sec, (uint16_t)(usc/100), s2, 3);
-    write_mseed("E1", "VS3", (uint16_t)tt.tm_year+1900, (uint16_t)tt.tm_yday+1, (uint8_t)tt.tm_hour, (uint8_t)tt.tm_min, (uint8_t)tt.tm_sec, (uint16_t)(usc/100), s3, 4);
-    write_mseed("E1", "VSZ", (uint16_t)tt.tm_year+1900, (uint16_t)tt.tm_yday+1, (uint8_t)tt.tm_hour, (uint8_t)tt.tm_min, (uint8_t)tt.tm_sec, (uint16_t)(usc/100), sz, 5);
-    write_mseed("E1", "VKD", (uint16_t)tt.tm_year+1900, (uint16_t)tt.tm_yday+1, (uint8_t)tt.tm_hour, (uint8_t)tt.tm_min, (uint8_t)tt.tm_sec, (uint16_t)(usc/100), kd, 6);
+    write_mseed(&ms, 0, t_center, ax);
+    write_mseed(&ms, 1, t_center, ay);
+    write_mseed(&ms, 2, t_center, s1);
+    write_mseed(&ms, 3, t_center, s2);
+    write_mseed(&ms, 4, t_center, s3);
+    write_mseed(&ms, 5, t_center, sz);
+    write_mseed(&ms, 6, t_center, kd);
 
     // reset loop variables
     N = 0;
@@ -193,7 +213,8 @@ int main()
     kd = 0;
   }
 
-  // close (this will never will happen under normal operation...)
+  // flush the miniSEED volumes and close
+  close_mseed(&ms);
   err = LJM_Close(handle);
   ErrorCheck(err, "LJM_Close");
 
@@ -231,166 +252,7 @@ double compute_fs(int16_t SRF, int16_t SRM)
   return fs;
 }
 
-void write_mseed(char *LI, char *CI, uint16_t Yr, uint16_t DoY, uint8_t Hr, uint8_t Mn, uint8_t Sc, uint16_t S0001, double data, int chan_idx)
-{
-  // variables for making yearday filename and year/day directory
-  struct stat st = {0};
-  char path[200];
-  char fn[200];
-
-  // create /home/station/Data/yyyy path if it is not present
-  sprintf(path, "/home/avn3/Data/%4i", Yr);
-  if (stat(path, &st) == -1)
-    mkdir(path, 0755);
-
-  // create /home/station/LabJack/data/yyyy/ddd path if it is not present
-  sprintf(path, "/home/avn3/Data/%4i/%03i", Yr, DoY);
-  if (stat(path, &st) == -1)
-    mkdir(path, 0755);
-
-  // create full path and filename
-  sprintf(fn, "%s/2J.AVN3.%s.%s.%i.%03i.mseed", path, LI, CI, Yr, DoY);
-
-  // the file doesn't exist, i.e., this is the first time writing to a new file:
-  // 1) on startup
-  // 2) at the beginning of a new day
-  // 3) or it was deleted during data acquisition (how rude!)
-  if ( (stat(fn, &st) == -1) )
-  {
-    SeqNum[chan_idx] = 1;
-    SampNum[chan_idx] = 1;
-    write_mseed_header(fn, SeqNum[chan_idx], LI, CI, Yr, DoY, Hr, Mn, Sc, S0001);
-    append_mseed(fn, SeqNum[chan_idx], (uint16_t)SampNum[chan_idx], data);
-    SampNum[chan_idx]++;
-  }
-  // the file exists but SeqNum = 0, e.g., data acquisition is restarted during a given day
-  else if ( (stat(fn, &st) == 0) & (SeqNum[chan_idx] == 0) )
-  {
-    SeqNum[chan_idx] = last_mseed_seqnum(fn);
-    write_mseed_header(fn, SeqNum[chan_idx], LI, CI, Yr, DoY, Hr, Mn, Sc, S0001);
-    append_mseed(fn, SeqNum[chan_idx], (uint16_t)SampNum[chan_idx], data);
-    SampNum[chan_idx]++;
-  }
-  // the first sample to be written to a new data record block
-  else if (SampNum[chan_idx] == 1)
-  {
-    write_mseed_header(fn, SeqNum[chan_idx], LI, CI, Yr, DoY, Hr, Mn, Sc, S0001);
-    append_mseed(fn, SeqNum[chan_idx], (uint16_t)SampNum[chan_idx], data);
-    SampNum[chan_idx]++;
-  }
-  // the last sample to be written to an existing data record block
-  else if (SampNum[chan_idx] == NumSamp[chan_idx])
-  {
-    append_mseed(fn, SeqNum[chan_idx], (uint16_t)SampNum[chan_idx], data);
-    SeqNum[chan_idx]++;
-    SampNum[chan_idx] = 1;
-  }
-  // just a normal file write, i.e., adding data to the end of data record block in an existing file 
-  else // if (SampNum[chan_idx] < NumSamp)
-  {
-    append_mseed(fn, SeqNum[chan_idx], (uint16_t)SampNum[chan_idx], data);
-    SampNum[chan_idx]++;
-  }
-}
-
-void write_mseed_header(char *fn, int SqNu, char *LI, char *CI, uint16_t Yr, uint16_t DoY, uint8_t Hr, uint8_t Mn, uint8_t Sc, uint16_t S0001)
-{
-  // create (if necessary) and open file, scan to the end, write zeros, and rewind
-  FILE *fid;
-  struct stat st = {0};
-  if (stat(fn, &st) == -1)
-    fid = fopen(fn, "w+");
-  else
-    fid = fopen(fn, "r+");
-  fseek(fid, (SqNu-1)*4096, SEEK_SET);
-  char buff[4096] = {0};
-  fwrite(buff, 1, 4096, fid);
-  fseek(fid, (SqNu-1)*4096, SEEK_SET);
-
-  // Fixed Section of Data Header (48 bytes)
-  fprintf(fid, "%06i", SqNu);            // Sequence Number
-  fprintf(fid, "D");                     // Data Quality Indicator
-  fprintf(fid, " ");                     // Reserved Byte
-  fprintf(fid, "AVN3 ");                 // Station Identifier Code
-  fprintf(fid, "%s", LI);                // Location Identifier
-  fprintf(fid, "%s", CI);                // Channel Identifier
-  fprintf(fid, "2J");                    // Network Code
-  fwrite(&Yr, sizeof(Yr), 1, fid);       // Year
-  fwrite(&DoY, sizeof(DoY), 1, fid);     // Day of Year
-  fwrite(&Hr, sizeof(Hr), 1, fid);       // Hours
-  fwrite(&Mn, sizeof(Mn), 1, fid);       // Minutes
-  fwrite(&Sc, sizeof(Sc), 1, fid);       // Seconds
-  fprintf(fid, " ");                     // Skip 1 Byte (unused)
-  fwrite(&S0001, sizeof(S0001), 1, fid); // Seconds0001 (why not microseconds?)
-  uint16_t NoS = 0;
-  fwrite(&NoS, sizeof(NoS), 1, fid);     // Number of Samples (none so far...)
-  fwrite(&SRF, sizeof(SRF), 1, fid);     // Sample Rate Factor
-  fwrite(&SRM, sizeof(SRM), 1, fid);     // Sample Rate Multiplier
-  uint8_t AID = 0;
-  fwrite(&AID, sizeof(AID), 1, fid);     // Activity Flags
-  fwrite(&AID, sizeof(AID), 1, fid);     // IO Flags
-  fwrite(&AID, sizeof(AID), 1, fid);     // Data Quality Flags
-  uint8_t NBF = 1;
-  fwrite(&NBF, sizeof(NBF), 1, fid);     // Number Blockettes to Follow
-  int32_t TC = 0;
-  fwrite(&TC, sizeof(TC), 1, fid);       // Time Correction
-  uint16_t OBD = 64;
-  fwrite(&OBD, sizeof(OBD), 1, fid);     // Offset to the Beginning of Data
-  uint16_t OFB = 48;
-  fwrite(&OFB, sizeof(OFB), 1, fid);     // Offset to the First Blockette
-  uint16_t BT = 1000;
-  fwrite(&BT, sizeof(BT), 1, fid);       // Blockette Type
-
-  // [1000] Data Only SEED Blockette (8 bytes)
-  uint16_t ONB = 0;
-  fwrite(&ONB, sizeof(ONB), 1, fid);     // Offset to the Next Blockette
-  fwrite(&EF, sizeof(EF), 1, fid);       // Encoding Format
-  uint8_t WO = 0;
-  fwrite(&WO, sizeof(WO), 1, fid);       // Word Order (0 = little endian)
-  uint8_t DRL = 12;
-  fwrite(&DRL, sizeof(DRL), 1, fid);     // Data Record Length (12, since 2^12 = 4096)
-  uint8_t Res = 0;
-  fwrite(&Res, sizeof(Res), 1, fid);     // Reserved
-
-  // close file
-  fclose(fid);
-}
-
-void append_mseed(char *fn, int SqNu, uint16_t SpNu, double data)
+void stop_daq(int sig)
 {
-  // open file
-  FILE *fid;
-  fid = fopen(fn, "r+");
-
-  // seek to and update sample number in header block
-  fseek(fid, (SqNu-1)*4096+30, SEEK_SET);
-  fwrite(&SpNu, sizeof(SpNu), 1, fid);
-
-  // convert double to int32
-  int32_t data32;
-  data32 = (int32_t)data;  
-
-  // seek to and write latest sample to data block
-  fseek(fid, (SqNu-1)*4096+64+(SpNu-1)*sizeof(data32), SEEK_SET);
-  fwrite(&data32, sizeof(data32), 1, fid);
-
-  // close file
-  fclose(fid);
+  running = 0;
 }
-
-int last_mseed_seqnum(char *fn)
-{
-  // open file and seek to the end
-  FILE *fid;
-  fid = fopen(fn, "r");
-  fseek(fid, 0, SEEK_END);
-
-  // compute new Sequence Number from file size and Data Record Length
-  int SqNu;
-  SqNu = ftell(fid) / 4096 + 1;
-
-  // close file and return Sequence Number
-  fclose(fid);
-  return SqNu;
-}
-
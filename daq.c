@@ -0,0 +1,1073 @@
+// configuration-driven data acquisition program
+//
+// by: Scott DeWolf
+//
+// One program for every station: the instrument, the channels and their
+// calibrations come from a station configuration file (see daq_config.c and
+// the *.conf files next to this one), so a new station needs no recompiling.
+// The instrument is read through a driver (daq_labjack.c, daq_serial.c,
+// daq_modbus.c) and each sample window is reduced and written to miniSEED
+// the same way as in the *_daq.c programs.
+//
+// Several instruments (one configuration file each) can share one process:
+// a single epoll loop waits for the read instants of every instrument
+// (a timerfd each), the answers of the serial ports and Modbus links, and
+// the LabJack stream blocks, so each instrument keeps its own sample windows
+// while the process only wakes up when one of them has something to do. The
+// channels of all of them go to one miniSEED writer. An instrument that is
+// lost is closed and the others carry on.
+//
+// With a seedlink setting the records are also served to real-time clients
+// (see seedlink.c) as the writer writes them, and, with latency, the record
+// being filled every few seconds. One server serves every instrument; it
+// takes its port and address from the first configuration that has one, and
+// listens on 127.0.0.1 only unless the address is another one (or *, every
+// interface), so records aren't served to the network by accident.
+//
+// The calibrations and ellipse parameters can be changed while the program
+// runs: edit the configuration or calibration file (or send SIGHUP) and the
+// new values are read in the loop and take effect from the next sample
+// window, without reopening the instrument or losing the fringe counts. Any
+// other change to a configuration file still needs a restart.
+//
+// With a fit setting the ellipse parameters of the phase channels are also
+// fitted to the scans themselves, every so many seconds, by a thread of
+// their own (see threefringe_fit.c) that the sampling loop hands its blocks
+// of scans to without waiting. Each fit is printed with how well it and the
+// parameters in use describe the scans; with fit ... apply a fit that
+// describes them clearly better, from scans all around the ellipse, replaces the
+// parameters in use from the next sample window on, like a reload (the
+// fringe counts carry on). A reload of the configuration file in the
+// meantime takes precedence, and puts back its own parameters.
+//
+// The fringe counts of the phase channels are saved after every window (see
+// threefringe_state.c, root/.checkpoint/NC.SIC.fringe), so after a restart
+// shorter than the resume setting (60 s unless set) the phase channels carry
+// on from where they were instead of stepping back by whole fringes.
+//
+// usage: ./daq aofs_cc_r04.conf
+//        ./daq closed_tbecs_tappt_r01.conf lily_8209.conf vaisala_wxt520_m2310477.conf
+//
+//  created: Saturday, October 17, 2026 (2026290)
+// modified: Saturday, October 17, 2026 (2026290)
+//  history:
+//           [2026290] - created document from the *_daq.c programs
+//           [2026290] - read several instruments from one epoll loop
+//           [2026290] - calibrate all channels of a window at once (calib_apply)
+//           [2026290] - reload calibrations and ellipse parameters on SIGHUP or file changes
+//           [2026290] - the channels of a window are written with write_mseed_frame()
+//           [2026290] - day volumes can be preallocated and mapped (mapped setting)
+//           [2026290] - day volumes can hold only final records (tail setting)
+//           [2026290] - records can be written big endian (bigendian setting)
+//           [2026290] - channels can have their own record length and closing interval (record setting)
+//           [2026290] - day volumes can be written as miniSEED 3 (miniseed3 setting)
+//           [2026290] - records can be served over SeedLink (seedlink and latency settings)
+//           [2026290] - day volumes can have a time index (index setting)
+//           [2026290] - ellipse parameters can be fitted while running (fit setting)
+//           [2026290] - fringe counts are kept across restarts (resume setting)
+//           [2026290] - the SeedLink server only listens on every interface if asked to (seedlink ... *)
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/signalfd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <limits.h>
+#include <pthread.h>
+#include "daq.h"
+#include "mseed_writer.h"
+#include "seedlink.h"
+#include "sampler.h"
+#include "threefringe.h"
+#include "threefringe_fit.h"
+#include "threefringe_state.h"
+#include "calib.h"
+
+// scans waiting for the phase computation
+enum { BLOCK = 256 };
+
+// epoll data of the SIGHUP, file change and fit descriptors (instruments use idx << 1 | 0 or 1)
+enum { EV_SIGNAL = 2*MSEED_MAX_STATION, EV_NOTIFY, EV_FIT };
+
+// where reloaded parameters come from
+enum { RELOAD_FILE = 1, RELOAD_FIT };
+
+// one instrument and the sample window it is filling
+typedef struct
+{
+  const char *path;                 // configuration file
+  int idx;                          // position in inst[] (and epoll data >> 1)
+  daq_config cfg;
+  daq_device dev;
+  int chan0;                        // chan_idx of the first channel
+  double fs;                        // sample rate (in Hz)
+  calib cb;                         // calibrations of the channels
+
+  // sample windows and read instants
+  sampler ss;
+  double t_center, t_stop;          // current window (t_center = 0: none yet)
+  int tfd;                          // timerfd of the next read instant or answer deadline
+  int wfd;                          // descriptor watched for answers (-1 = none)
+  int busy;                         // a read was requested and hasn't been answered
+
+  // variables for data collection/averaging
+  double v[DAQ_MAX_INPUT];
+  double sum[MSEED_MAX_CHAN], sum2[MSEED_MAX_CHAN];
+  int N;
+
+  // scans waiting for the phase computation (phase channel k from k * BLOCK on)
+  // and the fringe state of the phase channels
+  double xb[DAQ_MAX_PHASE*BLOCK], yb[DAQ_MAX_PHASE*BLOCK], zb[DAQ_MAX_PHASE*BLOCK], pb[DAQ_MAX_PHASE*BLOCK];
+  int phase[DAQ_MAX_PHASE];
+  int nphase, nb;
+  threefringe tf[DAQ_MAX_PHASE];
+  int fit_id[DAQ_MAX_PHASE];        // ids of the phase channels in the fitter (-1 = not fitted)
+  threefringe_state fst;            // fringe counts kept across restarts
+
+  // reloaded parameters waiting for the next window (RELOAD_FILE or RELOAD_FIT)
+  int reload;
+  daq_channel next[MSEED_MAX_CHAN];
+  calib next_cb;
+  int wd[2];                        // watches of the configuration and calibration files
+  char file[2][PATH_MAX];           // and their names in the watched directories
+} instrument;
+
+// function definitions
+static const daq_driver *find_driver(const char *name);
+static instrument *open_instrument(const char *path);
+static void close_instrument(instrument *in);
+static void start_window(instrument *in);
+static void next_read(instrument *in);
+static void read_due(instrument *in);
+static void answer_due(instrument *in);
+static void stream_due(instrument *in);
+static void add_read(instrument *in);
+static void end_window(instrument *in);
+static void watch(instrument *in);
+static void arm(int tfd, double t);
+static int watch_files(void);
+static void notified(void);
+static void reload(instrument *in);
+static void swap_params(instrument *in);
+static void print_time(double t);
+static int start_seedlink(void);
+static void resume_fringes(instrument *in);
+static int start_fit(void);
+static void feed_fit(instrument *in);
+static void fitted(void);
+void stop_daq(int sig);
+
+// global constants
+const double pi = 3.1415926535897932; // can't live without pi!
+
+// drivers built into this program
+static const daq_driver *drivers[] = {
+  &daq_serial,
+#ifdef HAVE_LABJACK
+  &daq_labjack,
+#endif
+#ifdef HAVE_MODBUS
+  &daq_modbus,
+#endif
+};
+
+// cleared by SIGINT or SIGTERM to leave the main loop
+volatile sig_atomic_t running = 1;
+
+// instruments of this program, the miniSEED volumes they write and the event loop
+static instrument *inst[MSEED_MAX_STATION];
+static int ninst = 0;
+static mseed_writer ms;
+static seedlink_server sl;
+static int epfd, sfd = -1, nfd = -1;
+static threefringe_fitter fit;
+
+int main(int argc, char **argv)
+{
+  struct epoll_event ev[2*MSEED_MAX_STATION+3];
+  struct signalfd_siginfo si;
+  sigset_t mask;
+  instrument *in;
+  size_t queue = 0;
+  int i, k, n, alive, lost = 0;
+
+  if ((argc < 2) | (argc > MSEED_MAX_STATION + 1))
+  {
+    fprintf(stderr, "usage: %s station.conf [station.conf ...] (up to %i)\n", argv[0], MSEED_MAX_STATION);
+    return 1;
+  }
+
+  // SIGHUP (reload) is blocked before any thread starts, so only the event loop takes it
+  sigemptyset(&mask);
+  sigaddset(&mask, SIGHUP);
+  pthread_sigmask(SIG_BLOCK, &mask, NULL);
+
+  epfd = epoll_create1(0);
+  if (epfd == -1)
+  {
+    perror("epoll_create1");
+    return 1;
+  }
+
+  // read the station configurations and open the instruments
+  for (i = 1; i < argc; i++)
+  {
+    in = open_instrument(argv[i]);
+    if (in == NULL)
+      return 1;
+    inst[ninst++] = in;
+    queue += in->cfg.queue;
+  }
+  alive = ninst;
+
+  // serve the records to real-time clients as well
+  if (start_seedlink() == -1)
+    return 1;
+
+  // write the day volumes from a separate thread so storage stalls can't delay sampling
+  if (queue > 0)
+    mseed_start_writer(&ms, queue);
+
+  // leave the main loop cleanly on SIGINT or SIGTERM
+  signal(SIGINT, stop_daq);
+  signal(SIGTERM, stop_daq);
+
+  // reload the parameters on SIGHUP or when their files change
+  if (watch_files() == -1)
+    return 1;
+
+  // fit the ellipse parameters of the phase channels in a thread of their own
+  if (start_fit() == -1)
+    return 1;
+
+  // schedule the first read of each instrument (a stream starts with its first block)
+  for (i = 0; i < ninst; i++)
+  {
+    if (inst[i]->dev.timed)
+      continue;
+    start_window(inst[i]);
+    next_read(inst[i]);
+  }
+
+  // main data collection and storage loop
+  while ((running) & (alive > 0))
+  {
+    n = epoll_wait(epfd, ev, 2*MSEED_MAX_STATION+3, -1);
+    if ((n == -1) & (errno != EINTR))
+    {
+      perror("epoll_wait");
+      break;
+    }
+
+    for (i = 0; i < n; i++)
+    {
+      // parameters to reload
+      if (ev[i].data.u32 == EV_SIGNAL)
+      {
+        if (read(sfd, &si, sizeof(si)) == sizeof(si))
+          for (k = 0; k < ninst; k++)
+            if (!inst[k]->dev.err)
+              reload(inst[k]);
+        continue;
+      }
+      if (ev[i].data.u32 == EV_NOTIFY)
+      {
+        notified();
+        continue;
+      }
+      if (ev[i].data.u32 == EV_FIT)
+      {
+        fitted();
+        continue;
+      }
+
+      // an event may still be pending for an instrument lost earlier in this round
+      in = inst[ev[i].data.u32 >> 1];
+      if (in->dev.err)
+        continue;
+
+      // answers (or stream blocks), otherwise a read instant or deadline
+      if (ev[i].data.u32 & 1)
+        answer_due(in);
+      else
+        read_due(in);
+
+      // the instrument was lost
+      if (in->dev.err)
+      {
+        fprintf(stderr, "%s: instrument lost\n", in->path);
+        close_instrument(in);
+        alive--;
+        lost++;
+      }
+    }
+  }
+
+  // flush the miniSEED volumes (the last records still go to the SeedLink clients) and close
+  close_mseed(&ms);
+  seedlink_stop(&sl);
+  threefringe_fitter_stop(&fit);
+  for (i = 0; i < ninst; i++)
+    if (!inst[i]->dev.err)
+      close_instrument(inst[i]);
+
+  return (lost > 0) ? 1 : 0;
+}
+
+static const daq_driver *find_driver(const char *name)
+{
+  int i;
+
+  for (i = 0; i < (int)(sizeof(drivers) / sizeof(drivers[0])); i++)
+    if (strcmp(drivers[i]->name, name) == 0)
+      return drivers[i];
+  return NULL;
+}
+
+static instrument *open_instrument(const char *path)
+{
+  struct epoll_event ev = {0};
+  calib_channel cal[MSEED_MAX_CHAN];
+  const daq_config *cfg;
+  const daq_channel *ch;
+  instrument *in;
+  int c, sta;
+
+  in = calloc(1, sizeof(instrument));
+  if (in == NULL)
+  {
+    perror(path);
+    return NULL;
+  }
+  in->path = path;
+  in->idx = ninst;
+  cfg = &in->cfg;
+
+  // read the station configuration
+  if (daq_read_config(&in->cfg, path) == -1)
+    return NULL;
+  in->dev.cfg = cfg;
+  in->dev.drv = find_driver(cfg->driver);
+  in->dev.fd = -1;
+  if (in->dev.drv == NULL)
+  {
+    fprintf(stderr, "%s: no %s driver in this build (see daq_make.sh)\n", path, cfg->driver);
+    return NULL;
+  }
+
+  // set up the miniSEED volumes
+  if (ninst == 0)
+  {
+    mseed_init(&ms, cfg->root, cfg->NC, cfg->SIC, cfg->SRF, cfg->SRM, cfg->flush);
+    sta = 0;
+  }
+  else
+    sta = mseed_add_station(&ms, cfg->root, cfg->NC, cfg->SIC, cfg->SRF, cfg->SRM, cfg->flush);
+  if (cfg->mapped)
+    mseed_map_volumes(&ms);
+  if (cfg->tail)
+    mseed_tail_records(&ms);
+  if (cfg->big)
+    mseed_big_endian(&ms);
+  if (cfg->v3)
+    mseed_format3(&ms);
+  if (cfg->index)
+    mseed_index_volumes(&ms);
+  if (cfg->latency > 0)
+    mseed_stream_records(&ms, cfg->latency);
+  in->chan0 = ms.NumChan;
+  for (c = 0; c < cfg->nchan; c++)
+  {
+    ch = &cfg->chan[c];
+    if (mseed_add_channel(&ms, ch->LI, ch->CI, ch->EF) == -1)
+      return NULL;
+    if ((ch->reclen > 0) && (mseed_record_length(&ms, ms.NumChan - 1, ch->reclen, ch->span) == -1))
+      return NULL;
+
+    // fringe counting starts from phase 0
+    if (ch->kind == DAQ_PHASE)
+    {
+      threefringe_init(&in->tf[in->nphase], ch->ellipse[0], ch->ellipse[1], ch->ellipse[2], ch->ellipse[3], ch->ellipse[4], ch->ellipse[5]);
+      in->phase[in->nphase++] = c;
+    }
+    cal[c] = ch->cal;
+  }
+  calib_init(&in->cb, cfg->nchan, cal);
+
+  // or from the counts saved before a short restart
+  resume_fringes(in);
+
+  // sample rate (in Hz)
+  in->fs = ms.st[sta].fs;
+
+  // open the instrument
+  if (in->dev.drv->open(&in->dev) == -1)
+    return NULL;
+
+  // wake up cfg->reads times per sample window (or at the stream blocks)
+  sampler_init(&in->ss, in->fs, cfg->reads, NULL);
+  in->tfd = -1;
+  if (!in->dev.timed)
+  {
+    in->tfd = timerfd_create(CLOCK_REALTIME, TFD_NONBLOCK);
+    ev.events = EPOLLIN;
+    ev.data.u32 = in->idx << 1;
+    if ((in->tfd == -1) || (epoll_ctl(epfd, EPOLL_CTL_ADD, in->tfd, &ev) == -1))
+    {
+      perror("timerfd");
+      in->dev.drv->close(&in->dev);
+      return NULL;
+    }
+  }
+  in->wfd = -1;
+  watch(in);
+
+  return in;
+}
+
+static void close_instrument(instrument *in)
+{
+  threefringe_state_close(&in->fst);
+  if (in->wfd != -1)
+    epoll_ctl(epfd, EPOLL_CTL_DEL, in->wfd, NULL);
+  if (in->tfd != -1)
+    close(in->tfd);
+  in->dev.drv->close(&in->dev);
+}
+
+static void start_window(instrument *in)
+{
+  // start the next sample window (t_center +/- 0.5 / fs)
+  in->t_center = sampler_window(&in->ss);
+  in->t_stop = in->t_center + 0.5 / in->fs;
+  swap_params(in);
+}
+
+static void next_read(instrument *in)
+{
+  double t = sampler_next(&in->ss);
+
+  // the window has had its reads
+  if (t == 0)
+  {
+    end_window(in);
+    start_window(in);
+    t = sampler_next(&in->ss);
+  }
+
+  arm(in->tfd, t);
+}
+
+static void read_due(instrument *in)
+{
+  const daq_driver *drv = in->dev.drv;
+  uint64_t expirations;
+  int rc;
+
+  if (read(in->tfd, &expirations, sizeof(expirations)) != sizeof(expirations))
+    return;
+
+  // the answer didn't come before the end of the window
+  if (in->busy)
+  {
+    in->busy = 0;
+    next_read(in);
+    return;
+  }
+
+  // read the instrument, or ask it and wait (until the end of the window at most)
+  if (drv->request == NULL)
+    rc = drv->read(&in->dev, in->v);
+  else
+  {
+    rc = drv->request(&in->dev);
+    watch(in);
+    if (rc == 0)
+    {
+      in->busy = 1;
+      arm(in->tfd, in->t_stop);
+      return;
+    }
+  }
+  if (rc == -1)
+  {
+    in->dev.err = -1;
+    return;
+  }
+
+  add_read(in);
+  next_read(in);
+}
+
+static void answer_due(instrument *in)
+{
+  int rc;
+
+  if (in->dev.timed)
+  {
+    stream_due(in);
+    return;
+  }
+
+  rc = in->dev.drv->receive(&in->dev, in->v);
+  watch(in);
+  if (rc == -1)
+  {
+    in->dev.err = -1;
+    return;
+  }
+
+  // an answer that came after its window was given up on is dropped
+  if ((rc == 1) & (in->busy))
+  {
+    in->busy = 0;
+    add_read(in);
+    next_read(in);
+  }
+}
+
+static void stream_due(instrument *in)
+{
+  const daq_driver *drv = in->dev.drv;
+  int rc;
+
+  // hand out the scans of every block that arrived
+  while (1)
+  {
+    // start the sample window holding the next scan
+    if (in->t_center == 0)
+    {
+      in->t_center = drv->window(&in->dev, in->fs);
+      if (in->t_center == 0)
+        return;
+      in->t_stop = in->t_center + 0.5 / in->fs;
+      swap_params(in);
+    }
+
+    // collect the scans the instrument clocked during the window
+    rc = drv->scan(&in->dev, in->t_stop, in->v);
+    if (rc == -1)
+      return;
+    if (rc == 1)
+      add_read(in);
+    else if (in->dev.err)
+      return;
+    else
+    {
+      end_window(in);
+      in->t_center = 0;
+    }
+  }
+}
+
+static void add_read(instrument *in)
+{
+  const daq_config *cfg = &in->cfg;
+  const daq_channel *ch;
+  const double *v = in->v;
+  int c, i, k;
+
+  // running sum for averaging data
+  for (c = 0; c < cfg->nchan; c++)
+  {
+    ch = &cfg->chan[c];
+    if (ch->kind == DAQ_MEAN)
+      in->sum[c] += v[ch->in[0]];
+    else if (ch->kind == DAQ_LAST)
+      in->sum[c] = v[ch->in[0]];
+    else if (ch->kind == DAQ_ANGLE)
+    {
+      in->sum[c] += cos(pi * v[ch->in[0]] / 180);
+      in->sum2[c] += sin(pi * v[ch->in[0]] / 180);
+    }
+  }
+
+  // queue instantaneous x,y,z and compute the phases once the block is full
+  for (k = 0; k < in->nphase; k++)
+  {
+    ch = &cfg->chan[in->phase[k]];
+    in->xb[k*BLOCK+in->nb] = v[ch->in[0]];
+    in->yb[k*BLOCK+in->nb] = v[ch->in[1]];
+    in->zb[k*BLOCK+in->nb] = v[ch->in[2]];
+  }
+  if ((in->nphase > 0) && (++in->nb == BLOCK))
+  {
+    threefringe_block(in->tf, in->nphase, in->nb, BLOCK, in->xb, in->yb, in->zb, in->pb);
+    for (k = 0; k < in->nphase; k++)
+      for (i = 0; i < in->nb; i++)
+        in->sum[in->phase[k]] += in->pb[k*BLOCK+i];
+    feed_fit(in);
+    in->nb = 0;
+  }
+
+  // increment loop counter
+  in->N++;
+}
+
+static void end_window(instrument *in)
+{
+  const daq_config *cfg = &in->cfg;
+  const daq_channel *ch;
+  double x[MSEED_MAX_CHAN], y[MSEED_MAX_CHAN];
+  int c, i, k;
+
+  // every read of the window was lost
+  if (in->N == 0)
+    return;
+
+  // phases of the scans left in the block
+  threefringe_block(in->tf, in->nphase, in->nb, BLOCK, in->xb, in->yb, in->zb, in->pb);
+  for (k = 0; k < in->nphase; k++)
+    for (i = 0; i < in->nb; i++)
+      in->sum[in->phase[k]] += in->pb[k*BLOCK+i];
+  feed_fit(in);
+  in->nb = 0;
+  threefringe_state_save(&in->fst, in->tf, in->t_center);
+
+  // compute averages
+  for (c = 0; c < cfg->nchan; c++)
+  {
+    ch = &cfg->chan[c];
+    if (ch->kind == DAQ_LAST)
+      x[c] = in->sum[c];
+    else if (ch->kind == DAQ_ANGLE)
+    {
+      x[c] = 180 * atan2(in->sum2[c], in->sum[c]) / pi;
+      if (x[c] < 0)
+        x[c] = x[c] + 360;
+    }
+    else
+      x[c] = in->sum[c] / (double)in->N;
+  }
+
+  // apply calibrations
+  calib_apply(&in->cb, x, y);
+
+  // display results (named after the configuration when there are several instruments)
+  if (ninst > 1)
+    printf("%s  ", in->path);
+  print_time(in->t_center);
+  printf("  N = %i", in->N);
+  for (k = 0; k < in->nphase; k++)
+    printf("  M%i = %i", k + 1, in->tf[k].M);
+  for (c = 0; c < cfg->nchan; c++)
+    printf("  %s.%s = %0.5f", cfg->chan[c].LI, cfg->chan[c].CI, y[c]);
+  printf("\n");
+
+  // create or append miniSEED volume (every channel in one batch)
+  write_mseed_frame(&ms, in->chan0, cfg->nchan, in->t_center, y);
+
+  // reset loop variables
+  in->N = 0;
+  memset(in->sum, 0, sizeof(in->sum));
+  memset(in->sum2, 0, sizeof(in->sum2));
+}
+
+static void watch(instrument *in)
+{
+  struct epoll_event ev = {0};
+
+  // a driver that reconnected may answer on a new descriptor (or a reused
+  // number whose registration went away when the old one was closed)
+  if ((in->wfd != -1) & (in->wfd != in->dev.fd))
+    epoll_ctl(epfd, EPOLL_CTL_DEL, in->wfd, NULL);
+  in->wfd = in->dev.fd;
+  if (in->wfd == -1)
+    return;
+
+  ev.events = EPOLLIN;
+  ev.data.u32 = (in->idx << 1) | 1;
+  if ((epoll_ctl(epfd, EPOLL_CTL_ADD, in->wfd, &ev) == -1) & (errno != EEXIST))
+    perror(in->path);
+}
+
+static void arm(int tfd, double t)
+{
+  struct itimerspec its = {{0, 0}, {0, 0}};
+
+  // a time already past fires right away (t = 0 would disarm the timer)
+  its.it_value.tv_sec = (time_t)floor(t);
+  its.it_value.tv_nsec = (long)((t - floor(t)) * 1000000000);
+  if (its.it_value.tv_nsec > 999999999)
+    its.it_value.tv_nsec = 999999999;
+  if ((its.it_value.tv_sec == 0) & (its.it_value.tv_nsec == 0))
+    its.it_value.tv_nsec = 1;
+
+  timerfd_settime(tfd, TFD_TIMER_ABSTIME, &its, NULL);
+}
+
+static int watch_files(void)
+{
+  struct epoll_event ev = {0};
+  instrument *in;
+  char path[PATH_MAX], *dir, *base;
+  sigset_t mask;
+  int i, k;
+
+  // SIGHUP is taken from a descriptor of the event loop (blocked in main())
+  sigemptyset(&mask);
+  sigaddset(&mask, SIGHUP);
+  sfd = signalfd(-1, &mask, SFD_NONBLOCK);
+  ev.events = EPOLLIN;
+  ev.data.u32 = EV_SIGNAL;
+  if ((sfd == -1) || (epoll_ctl(epfd, EPOLL_CTL_ADD, sfd, &ev) == -1))
+  {
+    perror("signalfd");
+    return -1;
+  }
+
+  // files are watched through their directories, since editors replace them
+  // rather than write them in place
+  nfd = inotify_init1(IN_NONBLOCK);
+  ev.data.u32 = EV_NOTIFY;
+  if ((nfd == -1) || (epoll_ctl(epfd, EPOLL_CTL_ADD, nfd, &ev) == -1))
+  {
+    perror("inotify");
+    return -1;
+  }
+  for (i = 0; i < ninst; i++)
+  {
+    in = inst[i];
+    for (k = 0; k < 2; k++)
+    {
+      in->wd[k] = -1;
+      if (k == 0)
+        snprintf(path, sizeof(path), "%s", in->path);
+      else if (in->cfg.calib[0] == '\0')
+        continue;
+      else if ((in->cfg.calib[0] == '/') | (strrchr(in->path, '/') == NULL))
+        snprintf(path, sizeof(path), "%s", in->cfg.calib);
+      else
+        snprintf(path, sizeof(path), "%.*s/%s", (int)(strrchr(in->path, '/') - in->path), in->path, in->cfg.calib);
+
+      base = strrchr(path, '/');
+      if (base == NULL)
+      {
+        dir = ".";
+        base = path;
+      }
+      else
+      {
+        *base++ = '\0';
+        dir = (path[0] == '\0') ? "/" : path;
+      }
+      snprintf(in->file[k], sizeof(in->file[k]), "%s", base);
+      in->wd[k] = inotify_add_watch(nfd, dir, IN_CLOSE_WRITE | IN_MOVED_TO);
+      if (in->wd[k] == -1)
+        perror(dir);
+    }
+  }
+
+  return 0;
+}
+
+static void notified(void)
+{
+  char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+  const struct inotify_event *ie;
+  int i, k, want[MSEED_MAX_STATION] = {0};
+  ssize_t n, p;
+
+  // instruments whose configuration or calibration file was written or replaced
+  while ((n = read(nfd, buf, sizeof(buf))) > 0)
+  {
+    for (p = 0; p < n; p += sizeof(struct inotify_event) + ie->len)
+    {
+      ie = (const struct inotify_event *)(buf + p);
+      if (ie->len == 0)
+        continue;
+      for (i = 0; i < ninst; i++)
+        for (k = 0; k < 2; k++)
+          if ((ie->wd == inst[i]->wd[k]) && (strcmp(ie->name, inst[i]->file[k]) == 0))
+            want[i] = 1;
+    }
+  }
+
+  for (i = 0; i < ninst; i++)
+    if ((want[i]) && (!inst[i]->dev.err))
+      reload(inst[i]);
+}
+
+static void reload(instrument *in)
+{
+  daq_config *cfg;
+  calib_channel cal[MSEED_MAX_CHAN];
+  int c;
+
+  cfg = malloc(sizeof(daq_config));
+  if (cfg == NULL)
+  {
+    perror(in->path);
+    return;
+  }
+
+  // read the files again; only the calibrations and ellipse parameters may
+  // change (the rest is compared with them copied over from the running ones)
+  if (daq_read_config(cfg, in->path) == -1)
+  {
+    fprintf(stderr, "%s: keeping the current parameters\n", in->path);
+    free(cfg);
+    return;
+  }
+  memcpy(in->next, cfg->chan, sizeof(in->next));
+  for (c = 0; c < cfg->nchan; c++)
+  {
+    cfg->chan[c].cal = in->cfg.chan[c].cal;
+    memcpy(cfg->chan[c].ellipse, in->cfg.chan[c].ellipse, sizeof(cfg->chan[c].ellipse));
+  }
+  memcpy(cfg->calib, in->cfg.calib, sizeof(cfg->calib));
+  if (memcmp(cfg, &in->cfg, sizeof(daq_config)) != 0)
+  {
+    fprintf(stderr, "%s: only calibrations and ellipse parameters can be reloaded (restart for the other changes), keeping the current parameters\n", in->path);
+    free(cfg);
+    return;
+  }
+  free(cfg);
+
+  // nothing new (a fit waiting for the next window is dropped either way)
+  if (memcmp(in->next, in->cfg.chan, in->cfg.nchan * sizeof(daq_channel)) == 0)
+  {
+    in->reload = 0;
+    return;
+  }
+
+  // lay out the new calibrations now so the swap is a copy
+  for (c = 0; c < in->cfg.nchan; c++)
+    cal[c] = in->next[c].cal;
+  calib_init(&in->next_cb, in->cfg.nchan, cal);
+  in->reload = RELOAD_FILE;
+}
+
+static void swap_params(instrument *in)
+{
+  const daq_channel *ch;
+  int k;
+
+  if (!in->reload)
+    return;
+
+  // the new parameters apply from this window on (no scans of it are queued
+  // yet), and the fringe counts carry on
+  memcpy(in->cfg.chan, in->next, in->cfg.nchan * sizeof(daq_channel));
+  in->cb = in->next_cb;
+  for (k = 0; k < in->nphase; k++)
+  {
+    ch = &in->cfg.chan[in->phase[k]];
+    in->tf[k].cx = ch->ellipse[0];
+    in->tf[k].cy = ch->ellipse[1];
+    in->tf[k].cz = ch->ellipse[2];
+    in->tf[k].sx = ch->ellipse[3];
+    in->tf[k].sy = ch->ellipse[4];
+    in->tf[k].sz = ch->ellipse[5];
+  }
+
+  printf("%s  %s, in effect from ", in->path, (in->reload == RELOAD_FIT) ? "fitted ellipse parameters applied" : "parameters reloaded");
+  print_time(in->t_center);
+  printf("\n");
+  in->reload = 0;
+}
+
+static void print_time(double t)
+{
+  // variables for getting the year, doy, hours, minutes, and seconds
+  uint64_t isc; uint32_t usc;
+  time_t t_temp;
+  struct tm tt;
+
+  // recompute isec and usec to match t
+  isc = (uint64_t)t;
+  usc = (uint32_t)round(1000000 * (t - isc));
+
+  // compute Year, DayOfYear, Hours, Minutes, and Seconds from t
+  t_temp = (time_t)isc;
+  memcpy(&tt, gmtime(&t_temp), sizeof(struct tm));
+
+  printf("t = %i:%03i:%02i:%02i:%02i.%06i", tt.tm_year+1900, tt.tm_yday+1, tt.tm_hour, tt.tm_min, tt.tm_sec, usc);
+}
+
+static int start_seedlink(void)
+{
+  const daq_config *cfg = NULL;
+  int i;
+
+  // one server, on the port of the first configuration that has one
+  for (i = 0; i < ninst; i++)
+  {
+    if (inst[i]->cfg.sl_port == 0)
+      continue;
+    if (cfg == NULL)
+      cfg = &inst[i]->cfg;
+    else if (inst[i]->cfg.sl_port != cfg->sl_port)
+      fprintf(stderr, "%s: one SeedLink server serves every instrument, on port %i\n", inst[i]->path, cfg->sl_port);
+  }
+  if (cfg == NULL)
+    return 0;
+
+  if (seedlink_start(&sl, (strcmp(cfg->sl_addr, "*") != 0) ? cfg->sl_addr : NULL, cfg->sl_port, cfg->sl_packets) == -1)
+    return -1;
+  mseed_on_record(&ms, seedlink_record, &sl);
+  return 0;
+}
+
+static void resume_fringes(instrument *in)
+{
+  const daq_config *cfg = &in->cfg;
+  const daq_channel *ch;
+  char fn[300], name[DAQ_MAX_PHASE][THREEFRINGE_NAME];
+  struct timespec now;
+  int k, n;
+
+  if ((in->nphase == 0) | (cfg->resume == 0))
+    return;
+
+  // root/.checkpoint/NC.SIC.fringe, next to the checkpoints of the writer
+  snprintf(fn, sizeof(fn), "%s/.checkpoint", cfg->root);
+  if ((mkdir(fn, 0755) == -1) & (errno != EEXIST))
+    perror(fn);
+  snprintf(fn, sizeof(fn), "%s/.checkpoint/%s.%s.fringe", cfg->root, cfg->NC, cfg->SIC);
+  for (k = 0; k < in->nphase; k++)
+  {
+    ch = &cfg->chan[in->phase[k]];
+    snprintf(name[k], sizeof(name[k]), "%s.%s", ch->LI, ch->CI);
+  }
+
+  clock_gettime(CLOCK_REALTIME, &now);
+  n = threefringe_state_open(&in->fst, fn, in->tf, in->nphase, name, now.tv_sec + 1e-9 * now.tv_nsec, cfg->resume);
+  if (n <= 0)
+    return;
+  printf("%s  fringe counts resumed:", in->path);
+  for (k = 0; k < in->nphase; k++)
+    printf("  M%i = %i", k + 1, in->tf[k].M);
+  printf("\n");
+}
+
+static int start_fit(void)
+{
+  struct epoll_event ev = {0};
+  instrument *in;
+  int i, k, n = 0;
+
+  // every phase channel of the instruments with a fit setting
+  threefringe_fitter_init(&fit);
+  for (i = 0; i < ninst; i++)
+  {
+    in = inst[i];
+    for (k = 0; k < in->nphase; k++)
+    {
+      in->fit_id[k] = -1;
+      if (in->cfg.fit <= 0)
+        continue;
+      in->fit_id[k] = threefringe_fitter_add(&fit, in->cfg.fit);
+      if (in->fit_id[k] == -1)
+        return -1;
+      n++;
+    }
+    if ((in->cfg.fit > 0) & (in->nphase == 0))
+      fprintf(stderr, "%s: no phase channels to fit\n", in->path);
+  }
+  if (n == 0)
+    return 0;
+
+  // a block of scans per phase channel queued is plenty (the fits are far quicker)
+  if (threefringe_fitter_start(&fit, 256) == -1)
+    return -1;
+  ev.events = EPOLLIN;
+  ev.data.u32 = EV_FIT;
+  if (epoll_ctl(epfd, EPOLL_CTL_ADD, fit.efd, &ev) == -1)
+  {
+    perror("epoll_ctl");
+    return -1;
+  }
+  return 0;
+}
+
+static void feed_fit(instrument *in)
+{
+  const threefringe *tf;
+  double ellipse[6];
+  int k;
+
+  // the scans just turned into phases, with the parameters they were turned with
+  for (k = 0; k < in->nphase; k++)
+  {
+    if (in->fit_id[k] == -1)
+      continue;
+    tf = &in->tf[k];
+    ellipse[0] = tf->cx;
+    ellipse[1] = tf->cy;
+    ellipse[2] = tf->cz;
+    ellipse[3] = tf->sx;
+    ellipse[4] = tf->sy;
+    ellipse[5] = tf->sz;
+    threefringe_fitter_push(&fit, in->fit_id[k], in->t_center, ellipse, in->nb, &in->xb[k*BLOCK], &in->yb[k*BLOCK], &in->zb[k*BLOCK]);
+  }
+}
+
+static void fitted(void)
+{
+  threefringe_result r;
+  const threefringe_quality *q;
+  const daq_channel *ch;
+  instrument *in = NULL;
+  int i, k = 0, apply;
+
+  while (threefringe_fitter_result(&fit, &r) == 0)
+  {
+    // the phase channel fitted
+    for (i = 0; (i < ninst) & (in == NULL); i++)
+      for (k = 0; k < inst[i]->nphase; k++)
+        if (inst[i]->fit_id[k] == r.id)
+        {
+          in = inst[i];
+          break;
+        }
+    if ((in == NULL) || (in->dev.err))
+    {
+      in = NULL;
+      continue;
+    }
+    ch = &in->cfg.chan[in->phase[k]];
+    q = &r.q;
+
+    // a fit that describes the scans clearly better (by a tenth) than the parameters in use, from
+    // scans all around the ellipse, takes over from the next window (unless reloaded parameters are waiting)
+    apply = (in->cfg.fit_apply) & (!isnan(r.ellipse[0])) & (q->misfit < 0.9 * q->misfit_old) & (q->resultant < 0.5) & (in->reload != RELOAD_FILE);
+
+    if (ninst > 1)
+      printf("%s  ", in->path);
+    print_time(r.t1);
+    printf("  %s.%s fit of %.0f scans", ch->LI, ch->CI, q->n);
+    if (isnan(r.ellipse[0]))
+      printf(" failed (resultant %.3f, flatness %.2e)\n", q->resultant, q->flatness);
+    else
+      printf(": %.9f %.9f %.9f %.9f %.9f %.9f  misfit %.2e (in use %.2e)  resultant %.3f  flatness %.2e%s\n",
+             r.ellipse[0], r.ellipse[1], r.ellipse[2], r.ellipse[3], r.ellipse[4], r.ellipse[5],
+             q->misfit, q->misfit_old, q->resultant, q->flatness, (apply) ? "  applied" : "");
+    if (apply)
+    {
+      if (in->reload == 0)
+      {
+        memcpy(in->next, in->cfg.chan, in->cfg.nchan * sizeof(daq_channel));
+        in->next_cb = in->cb;
+      }
+      memcpy(in->next[in->phase[k]].ellipse, r.ellipse, sizeof(r.ellipse));
+      in->reload = RELOAD_FIT;
+    }
+    in = NULL;
+  }
+}
+
+void stop_daq(int sig)
+{
+  running = 0;
+}
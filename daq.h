@@ -0,0 +1,167 @@
+// configuration-driven data acquisition engine
+//
+// by: Scott DeWolf
+//
+//  created: Saturday, October 17, 2026 (2026290)
+// modified: Saturday, October 17, 2026 (2026290)
+//  history:
+//           [2026290] - created document from the *_daq.c programs
+//           [2026290] - added request() and receive() so several instruments share one event loop
+//           [2026290] - channel calibrations (calib.h) may come from a calibration file
+//           [2026290] - added mapped (preallocated, memory-mapped day volumes)
+//           [2026290] - added tail (final records only in the day volumes)
+//           [2026290] - added big (big endian headers and samples)
+//           [2026290] - added the record length and closing interval of a channel
+//           [2026290] - added v3 (miniSEED 3 day volumes)
+//           [2026290] - added the SeedLink server settings and latency
+//           [2026290] - added index (time indexes of the day volumes)
+//           [2026290] - added fit (online fits of the ellipse parameters)
+//           [2026290] - added resume (fringe counts kept across restarts)
+//           [2026290] - the SeedLink server listens on 127.0.0.1 by default
+//
+
+#ifndef DAQ_H
+#define DAQ_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "mseed_writer.h"
+#include "calib.h"
+
+#define DAQ_MAX_INPUT 32   // most values delivered by one read of an instrument
+#define DAQ_MAX_WRITE 64   // most registers written to set up an instrument
+#define DAQ_MAX_ARG 8      // most arguments of a device or input line
+#define DAQ_MAX_PHASE 8    // most phase channels of a station
+
+// how a channel turns the reads of a sample window into one sample
+enum
+{
+  DAQ_MEAN,                         // average of an input
+  DAQ_LAST,                         // input of the last read in the window
+  DAQ_ANGLE,                        // average direction (degrees, 0-360) of an input in degrees
+  DAQ_PHASE                         // average unwrapped phase of three fringe inputs
+};
+
+// one value delivered by every read of the instrument
+typedef struct
+{
+  char name[16];                    // name the channels refer to
+  int narg;
+  char arg[DAQ_MAX_ARG][64];        // where the driver finds the value (see daq_labjack.c, ...)
+} daq_input;
+
+// one miniSEED channel written by the station
+typedef struct
+{
+  char LI[3];                       // Location Identifier
+  char CI[4];                       // Channel Identifier
+  uint8_t EF;                       // Encoding Format
+  int kind;                         // DAQ_MEAN, DAQ_LAST, DAQ_ANGLE or DAQ_PHASE
+  int in[3];                        // inputs (x, y, z for DAQ_PHASE)
+  double ellipse[6];                // cx, cy, cz, sx, sy, sz (DAQ_PHASE)
+  calib_channel cal;                // calibration applied to the window value
+  int reclen;                       // Data Record Length (0 = MSEED_RECLEN)
+  double span;                      // seconds a record covers at most (0 = records close when full)
+} daq_channel;
+
+// everything the engine needs to know about one station (see *.conf)
+typedef struct
+{
+  // station and miniSEED settings
+  char root[200];                   // /home/station/Data
+  char NC[3];                       // Network Code
+  char SIC[6];                      // Station Identifier Code
+  int16_t SRF, SRM;                 // Sample Rate Factor and Multiplier
+  double flush;                     // seconds between writes of a partially filled record
+  size_t queue;                     // samples held for the writer thread
+  int mapped;                       // day volumes are preallocated and mapped (mseed_map_volumes)
+  int tail;                         // the record being filled goes to a tail file (mseed_tail_records)
+  int big;                          // big endian headers and samples (mseed_big_endian)
+  int v3;                           // FDSN miniSEED 3 day volumes (mseed_format3)
+  int index;                        // time index next to each day volume (mseed_index_volumes)
+  double latency;                   // seconds between records being filled sent to SeedLink (mseed_stream_records)
+  int sl_port;                      // SeedLink server port (0 = none)
+  int sl_packets;                   // records kept for SeedLink clients resuming
+  char sl_addr[48];                 // address the SeedLink server listens on (* = every interface)
+  double fit;                       // seconds of scans per fit of the ellipse parameters (0 = none)
+  int fit_apply;                    // good fits replace the ellipse parameters in use
+  double resume;                    // longest restart (seconds) the fringe counts carry over (0 = none)
+  int reads;                        // reads per sample window (0 = as fast as the instrument answers)
+  char calib[200];                  // calibration file of the channels (relative to the configuration file)
+
+  // instrument
+  char driver[16];                  // labjack, serial or modbus
+  int ndev;
+  char dev[DAQ_MAX_ARG][64];        // arguments of the device line (see the drivers)
+  char relay[200];                  // script that power cycles the instrument before it is opened
+  double ScanRate;                  // LabJack hardware-timed scans per second (0 = poll)
+  int ScansPerRead;                 // LabJack scans delivered by each stream read
+  int slave;                        // Modbus slave ID
+  int discard;                      // serial messages dropped after opening the port
+  int flushinput;                   // drop serial input received before each read
+  char format[200];                 // sscanf() format of a serial message (empty = fixed columns)
+  int nwrite;
+  char wname[DAQ_MAX_WRITE][32];    // registers written to set up the instrument
+  double wvalue[DAQ_MAX_WRITE];
+  int ninput;
+  daq_input input[DAQ_MAX_INPUT];
+
+  // channels
+  int nchan;
+  daq_channel chan[MSEED_MAX_CHAN];
+} daq_config;
+
+typedef struct daq_device daq_device;
+
+// instrument driver
+//
+// read() fills one value per input and returns 0 (a value that couldn't be
+// read keeps its previous value), or -1 if the instrument is lost. It blocks
+// until the instrument answers, so drivers that can leave the wait to the
+// event loop of daq.c give request() and receive() instead: request() starts
+// a read and returns 0 if the answer is to come on d->fd (1 if the read is
+// already complete, -1 if the instrument is lost), and receive() is called
+// whenever d->fd is readable and returns 1 once the requested read is
+// complete, 0 if it isn't, or -1 if the instrument is lost.
+//
+// Drivers that clock the reads themselves set timed in open() and then
+// deliver the reads of each window through window() and scan(). They never
+// block: window() returns 0 and scan() returns -1 until more scans have
+// arrived (d->fd then becomes readable), and scan() returns 0 when the window
+// is over.
+typedef struct
+{
+  const char *name;
+  int (*open)(daq_device *d);
+  int (*read)(daq_device *d, double *v);
+  double (*window)(daq_device *d, double fs);
+  int (*scan)(daq_device *d, double t_stop, double *v);
+  void (*close)(daq_device *d);
+  int (*request)(daq_device *d);
+  int (*receive)(daq_device *d, double *v);
+} daq_driver;
+
+// an open instrument
+struct daq_device
+{
+  const daq_config *cfg;
+  const daq_driver *drv;
+  int timed;                        // reads are clocked by the instrument (window() and scan())
+  int err;                          // scan() stopped on an error
+  int fd;                           // descriptor the answers arrive on (-1 = none)
+  void *priv;                       // driver state
+};
+
+// read a station configuration file; returns -1 (after saying why) if it is not valid
+int daq_read_config(daq_config *cfg, const char *path);
+
+// drivers
+extern const daq_driver daq_serial;
+#ifdef HAVE_LABJACK
+extern const daq_driver daq_labjack;
+#endif
+#ifdef HAVE_MODBUS
+extern const daq_driver daq_modbus;
+#endif
+
+#endif
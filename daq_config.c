@@ -0,0 +1,549 @@
+// station configuration files of the data acquisition engine
+//
+// by: Scott DeWolf
+//
+// A configuration file has one setting per line; # starts a comment.
+//
+//   root /home/avn4/Data               where the day volumes go
+//   network 2J                         Network Code
+//   station AVN4                       Station Identifier Code
+//   rate 20 1                          Sample Rate Factor and Multiplier
+//   flush 60                           seconds between writes of a partial record
+//   queue 65536                        samples held for the writer thread
+//   mapped                             preallocate and memory-map the day volumes
+//   tail                               only final records in the day volumes (see mseed_tail_records)
+//   bigendian                          big endian headers and samples (Word Order 1)
+//   miniseed3                          FDSN miniSEED 3 day volumes (*.mseed3, see mseed_format3)
+//   index                              time index next to each day volume (*.idx, see mseed_index_volumes)
+//   seedlink 18000 4096 127.0.0.1      SeedLink server port, records kept and address
+//                                      (127.0.0.1 unless given; * = every interface)
+//   latency 1                          seconds between SeedLink records being filled
+//   reads 0                            reads per sample window (0 = continuously)
+//   resume 60                          fringe counts carried over a restart this short (0 = never)
+//   fit 600 apply                      fit the ellipse parameters every 600 s and,
+//                                      optionally, apply good fits (see threefringe_fit.c)
+//   calibration ctt2.cal               calibration file of the channels (see calib.h)
+//
+//   device labjack 470012941 ethernet  instrument driver and where to find it
+//   relay /home/avn4/Data/usbrelay0.pl power cycle the instrument first
+//   stream 4000 200                    LabJack ScanRate and ScansPerRead
+//   write AIN0_RANGE 10.0              register written at startup (LabJack)
+//   slave 1                            Modbus slave ID
+//   discard 2                          serial messages dropped at startup
+//   flushinput                         drop serial input received before each read
+//   format 0R0,Dm=%lfD,Sm=%lfM         sscanf() format of a serial message
+//
+//   input x1 AIN0                      a value read from the instrument
+//
+//   channel X1 AYX 1 last x1 poly 3169.8 -0.0
+//   channel P1 BS1 5 phase x1 y1 z1 cx cy cz sx sy sz
+//   channel E1 VKD 3 mean kd scale 214748364.8 0.895270586013794
+//   record E1 VKD 512 3600             record length of a channel and, optionally,
+//                                      seconds after which its records close
+//
+// A channel line gives the Location and Channel Identifiers, the Encoding
+// Format, how the reads of a window become a sample (mean, last, angle or
+// phase) with its inputs, and an optional calibration applied to the
+// sample: a polynomial (highest power first) or a (x + b). A calibration
+// file overrides these for the channels it names, and can also give
+// piecewise polynomials.
+//
+//  created: Saturday, October 17, 2026 (2026290)
+// modified: Saturday, October 17, 2026 (2026290)
+//  history:
+//           [2026290] - created document
+//           [2026290] - added calibration files and scale calibrations
+//           [2026290] - added the mapped setting (preallocated, memory-mapped day volumes)
+//           [2026290] - added the tail setting (final records only, plus a tail file)
+//           [2026290] - added the bigendian setting
+//           [2026290] - added the record setting (record length and closing interval of a channel)
+//           [2026290] - added the miniseed3 setting
+//           [2026290] - added the seedlink and latency settings
+//           [2026290] - added the index setting
+//           [2026290] - added the fit setting
+//           [2026290] - added the resume setting
+//           [2026290] - the SeedLink server listens on 127.0.0.1 unless another address (or *) is given
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "daq.h"
+
+#define MAX_TOKEN 32
+
+// local function definitions
+static int parse_line(daq_config *cfg, int argc, char **argv, const char **why);
+static int parse_channel(daq_config *cfg, int argc, char **argv, const char **why);
+static int check_config(daq_config *cfg, const char **why);
+static int find_input(const daq_config *cfg, const char *name);
+static int get_num(const char *s, double *x);
+static int get_int(const char *s, int *x);
+static int count_conversions(const char *format);
+static int read_calib(daq_config *cfg, const char *path);
+
+int daq_read_config(daq_config *cfg, const char *path)
+{
+  FILE *fid;
+  char line[1024], *argv[MAX_TOKEN], *p;
+  const char *why = NULL;
+  int argc, n = 0;
+
+  fid = fopen(path, "r");
+  if (fid == NULL)
+  {
+    perror(path);
+    return -1;
+  }
+
+  // defaults
+  memset(cfg, 0, sizeof(*cfg));
+  cfg->flush = 60;
+  cfg->queue = 65536;
+  cfg->sl_packets = 4096;
+  snprintf(cfg->sl_addr, sizeof(cfg->sl_addr), "127.0.0.1");
+  cfg->slave = 1;
+  cfg->resume = 60;
+
+  while (fgets(line, sizeof(line), fid) != NULL)
+  {
+    n++;
+
+    // drop the comment and split the line into words
+    if ((p = strchr(line, '#')) != NULL)
+      *p = '\0';
+    argc = 0;
+    for (p = strtok(line, " \t\r\n"); (p != NULL) & (argc < MAX_TOKEN); p = strtok(NULL, " \t\r\n"))
+      argv[argc++] = p;
+    if (argc == 0)
+      continue;
+
+    if (parse_line(cfg, argc, argv, &why) == -1)
+    {
+      fprintf(stderr, "%s:%i: %s\n", path, n, why);
+      fclose(fid);
+      return -1;
+    }
+  }
+  fclose(fid);
+
+  if (check_config(cfg, &why) == -1)
+  {
+    fprintf(stderr, "%s: %s\n", path, why);
+    return -1;
+  }
+  if ((cfg->calib[0] != '\0') && (read_calib(cfg, path) == -1))
+    return -1;
+  return 0;
+}
+
+static int parse_line(daq_config *cfg, int argc, char **argv, const char **why)
+{
+  double x;
+  int i, a, b;
+
+  *why = "wrong number of values";
+  if (strcmp(argv[0], "root") == 0)
+  {
+    if (argc != 2)
+      return -1;
+    snprintf(cfg->root, sizeof(cfg->root), "%s", argv[1]);
+  }
+  else if (strcmp(argv[0], "network") == 0)
+  {
+    if (argc != 2)
+      return -1;
+    snprintf(cfg->NC, sizeof(cfg->NC), "%s", argv[1]);
+  }
+  else if (strcmp(argv[0], "station") == 0)
+  {
+    if (argc != 2)
+      return -1;
+    snprintf(cfg->SIC, sizeof(cfg->SIC), "%s", argv[1]);
+  }
+  else if (strcmp(argv[0], "rate") == 0)
+  {
+    *why = "rate needs a nonzero Sample Rate Factor and Multiplier";
+    if ((argc != 3) || (get_int(argv[1], &a) == -1) || (get_int(argv[2], &b) == -1) || (a == 0) || (b == 0))
+      return -1;
+    cfg->SRF = (int16_t)a;
+    cfg->SRM = (int16_t)b;
+  }
+  else if (strcmp(argv[0], "flush") == 0)
+  {
+    if ((argc != 2) || (get_num(argv[1], &cfg->flush) == -1))
+      return -1;
+  }
+  else if (strcmp(argv[0], "queue") == 0)
+  {
+    if ((argc != 2) || (get_int(argv[1], &a) == -1) || (a < 0))
+      return -1;
+    cfg->queue = (size_t)a;
+  }
+  else if (strcmp(argv[0], "mapped") == 0)
+  {
+    if (argc != 1)
+      return -1;
+    cfg->mapped = 1;
+  }
+  else if (strcmp(argv[0], "tail") == 0)
+  {
+    if (argc != 1)
+      return -1;
+    cfg->tail = 1;
+  }
+  else if (strcmp(argv[0], "bigendian") == 0)
+  {
+    if (argc != 1)
+      return -1;
+    cfg->big = 1;
+  }
+  else if (strcmp(argv[0], "miniseed3") == 0)
+  {
+    if (argc != 1)
+      return -1;
+    cfg->v3 = 1;
+  }
+  else if (strcmp(argv[0], "index") == 0)
+  {
+    if (argc != 1)
+      return -1;
+    cfg->index = 1;
+  }
+  else if (strcmp(argv[0], "seedlink") == 0)
+  {
+    *why = "seedlink needs a port and, optionally, records kept (> 0) and an address";
+    if ((argc < 2) || (argc > 4) || (get_int(argv[1], &cfg->sl_port) == -1) || (cfg->sl_port <= 0) || (cfg->sl_port > 65535))
+      return -1;
+    if ((argc > 2) && ((get_int(argv[2], &cfg->sl_packets) == -1) || (cfg->sl_packets <= 0)))
+      return -1;
+    if (argc > 3)
+      snprintf(cfg->sl_addr, sizeof(cfg->sl_addr), "%s", argv[3]);
+  }
+  else if (strcmp(argv[0], "latency") == 0)
+  {
+    if ((argc != 2) || (get_num(argv[1], &cfg->latency) == -1) || (cfg->latency < 0))
+      return -1;
+  }
+  else if (strcmp(argv[0], "fit") == 0)
+  {
+    *why = "fit needs seconds (> 0) and, optionally, apply";
+    if ((argc < 2) || (argc > 3) || (get_num(argv[1], &cfg->fit) == -1) || (cfg->fit <= 0))
+      return -1;
+    if ((argc == 3) && (strcmp(argv[2], "apply") != 0))
+      return -1;
+    cfg->fit_apply = (argc == 3);
+  }
+  else if (strcmp(argv[0], "resume") == 0)
+  {
+    if ((argc != 2) || (get_num(argv[1], &cfg->resume) == -1) || (cfg->resume < 0))
+      return -1;
+  }
+  else if (strcmp(argv[0], "reads") == 0)
+  {
+    if ((argc != 2) || (get_int(argv[1], &cfg->reads) == -1) || (cfg->reads < 0))
+      return -1;
+  }
+  else if (strcmp(argv[0], "calibration") == 0)
+  {
+    if (argc != 2)
+      return -1;
+    snprintf(cfg->calib, sizeof(cfg->calib), "%s", argv[1]);
+  }
+  else if (strcmp(argv[0], "device") == 0)
+  {
+    if ((argc < 2) || (argc - 2 > DAQ_MAX_ARG))
+      return -1;
+    snprintf(cfg->driver, sizeof(cfg->driver), "%s", argv[1]);
+    cfg->ndev = argc - 2;
+    for (i = 2; i < argc; i++)
+      snprintf(cfg->dev[i-2], sizeof(cfg->dev[0]), "%s", argv[i]);
+  }
+  else if (strcmp(argv[0], "relay") == 0)
+  {
+    if (argc != 2)
+      return -1;
+    snprintf(cfg->relay, sizeof(cfg->relay), "%s", argv[1]);
+  }
+  else if (strcmp(argv[0], "stream") == 0)
+  {
+    if ((argc != 3) || (get_num(argv[1], &cfg->ScanRate) == -1) || (get_int(argv[2], &cfg->ScansPerRead) == -1))
+      return -1;
+  }
+  else if (strcmp(argv[0], "slave") == 0)
+  {
+    if ((argc != 2) || (get_int(argv[1], &cfg->slave) == -1))
+      return -1;
+  }
+  else if (strcmp(argv[0], "discard") == 0)
+  {
+    if ((argc != 2) || (get_int(argv[1], &cfg->discard) == -1))
+      return -1;
+  }
+  else if (strcmp(argv[0], "flushinput") == 0)
+  {
+    if (argc != 1)
+      return -1;
+    cfg->flushinput = 1;
+  }
+  else if (strcmp(argv[0], "format") == 0)
+  {
+    if (argc != 2)
+      return -1;
+    snprintf(cfg->format, sizeof(cfg->format), "%s", argv[1]);
+  }
+  else if (strcmp(argv[0], "write") == 0)
+  {
+    if ((argc != 3) || (get_num(argv[2], &x) == -1))
+      return -1;
+    *why = "too many write lines";
+    if (cfg->nwrite == DAQ_MAX_WRITE)
+      return -1;
+    snprintf(cfg->wname[cfg->nwrite], sizeof(cfg->wname[0]), "%s", argv[1]);
+    cfg->wvalue[cfg->nwrite++] = x;
+  }
+  else if (strcmp(argv[0], "input") == 0)
+  {
+    if ((argc < 2) || (argc - 2 > DAQ_MAX_ARG))
+      return -1;
+    *why = "too many inputs";
+    if (cfg->ninput == DAQ_MAX_INPUT)
+      return -1;
+    *why = "input defined twice";
+    if (find_input(cfg, argv[1]) != -1)
+      return -1;
+    snprintf(cfg->input[cfg->ninput].name, sizeof(cfg->input[0].name), "%s", argv[1]);
+    cfg->input[cfg->ninput].narg = argc - 2;
+    for (i = 2; i < argc; i++)
+      snprintf(cfg->input[cfg->ninput].arg[i-2], sizeof(cfg->input[0].arg[0]), "%s", argv[i]);
+    cfg->ninput++;
+  }
+  else if (strcmp(argv[0], "channel") == 0)
+    return parse_channel(cfg, argc, argv, why);
+  else if (strcmp(argv[0], "record") == 0)
+  {
+    if ((argc != 4) && (argc != 5))
+      return -1;
+    for (i = 0; i < cfg->nchan; i++)
+      if ((strcmp(cfg->chan[i].LI, argv[1]) == 0) & (strcmp(cfg->chan[i].CI, argv[2]) == 0))
+        break;
+    *why = "record names a channel defined above it";
+    if (i == cfg->nchan)
+      return -1;
+    *why = "record length must be a power of 2 from 512 to 8192 bytes";
+    if ((get_int(argv[3], &a) == -1) || (a < MSEED_MIN_RECLEN) || (a > MSEED_MAX_RECLEN) || ((a & (a - 1)) != 0))
+      return -1;
+    *why = "bad record closing interval";
+    if ((argc == 5) && ((get_num(argv[4], &x) == -1) || (x < 0)))
+      return -1;
+    cfg->chan[i].reclen = a;
+    cfg->chan[i].span = (argc == 5) ? x : 0;
+  }
+  else
+  {
+    *why = "unknown setting";
+    return -1;
+  }
+
+  return 0;
+}
+
+static int parse_channel(daq_config *cfg, int argc, char **argv, const char **why)
+{
+  daq_channel *ch = &cfg->chan[cfg->nchan];
+  double coef[CALIB_MAX_COEF];
+  int i, k, nin, EF;
+
+  *why = "too many channels";
+  if (cfg->nchan == MSEED_MAX_CHAN)
+    return -1;
+  *why = "a channel needs LI CI EF and how to reduce its inputs";
+  if (argc < 6)
+    return -1;
+  memset(ch, 0, sizeof(*ch));
+
+  snprintf(ch->LI, sizeof(ch->LI), "%s", argv[1]);
+  snprintf(ch->CI, sizeof(ch->CI), "%s", argv[2]);
+  *why = "Encoding Format must be 1, 3, 4, 5, 10 or 11";
+  if ((get_int(argv[3], &EF) == -1) || ((EF != 1) & (EF != 3) & (EF != 4) & (EF != 5) & (EF != 10) & (EF != 11)))
+    return -1;
+  ch->EF = (uint8_t)EF;
+
+  // reduction and its inputs
+  if (strcmp(argv[4], "mean") == 0)
+    ch->kind = DAQ_MEAN;
+  else if (strcmp(argv[4], "last") == 0)
+    ch->kind = DAQ_LAST;
+  else if (strcmp(argv[4], "angle") == 0)
+    ch->kind = DAQ_ANGLE;
+  else if (strcmp(argv[4], "phase") == 0)
+    ch->kind = DAQ_PHASE;
+  else
+  {
+    *why = "a channel is reduced by mean, last, angle or phase";
+    return -1;
+  }
+  nin = (ch->kind == DAQ_PHASE) ? 3 : 1;
+  k = 5;
+  *why = "missing inputs or ellipse parameters";
+  if (argc < k + nin + ((ch->kind == DAQ_PHASE) ? 6 : 0))
+    return -1;
+  for (i = 0; i < nin; i++, k++)
+  {
+    *why = "unknown input";
+    if ((ch->in[i] = find_input(cfg, argv[k])) == -1)
+      return -1;
+  }
+  if (ch->kind == DAQ_PHASE)
+  {
+    *why = "bad ellipse parameter";
+    for (i = 0; i < 6; i++, k++)
+      if (get_num(argv[k], &ch->ellipse[i]) == -1)
+        return -1;
+  }
+
+  // calibration
+  calib_none(&ch->cal);
+  if ((k < argc) && (strcmp(argv[k], "poly") == 0))
+  {
+    *why = "poly needs 1 to 8 coefficients";
+    if ((argc - k - 1 < 1) || (argc - k - 1 > CALIB_MAX_COEF))
+      return -1;
+    *why = "bad polynomial coefficient";
+    for (i = k + 1; i < argc; i++)
+      if (get_num(argv[i], &coef[i-k-1]) == -1)
+        return -1;
+    calib_poly(&ch->cal, argc - k - 1, coef);
+  }
+  else if ((k < argc) && (strcmp(argv[k], "scale") == 0))
+  {
+    *why = "scale needs a and b of a (x + b)";
+    if ((argc - k != 3) || (get_num(argv[k+1], &coef[0]) == -1) || (get_num(argv[k+2], &coef[1]) == -1))
+      return -1;
+    calib_scale(&ch->cal, coef[0], coef[1]);
+  }
+  else if (k < argc)
+  {
+    *why = "a channel is calibrated by poly or scale";
+    return -1;
+  }
+
+  cfg->nchan++;
+  return 0;
+}
+
+static int check_config(daq_config *cfg, const char **why)
+{
+  int i, nphase = 0;
+
+  *why = "root, network and station are required";
+  if ((cfg->root[0] == '\0') | (cfg->NC[0] == '\0') | (cfg->SIC[0] == '\0'))
+    return -1;
+  *why = "rate is required";
+  if (cfg->SRF == 0)
+    return -1;
+  *why = "device is required";
+  if (cfg->driver[0] == '\0')
+    return -1;
+  *why = "no channels";
+  if (cfg->nchan == 0)
+    return -1;
+  *why = "stream needs ScansPerRead > 0";
+  if ((cfg->ScanRate > 0) & (cfg->ScansPerRead <= 0))
+    return -1;
+  *why = "miniseed3 can't be combined with mapped, tail or bigendian";
+  if ((cfg->v3) & ((cfg->mapped) | (cfg->tail) | (cfg->big)))
+    return -1;
+  *why = "format must convert every input with %lf";
+  if ((cfg->format[0] != '\0') & (count_conversions(cfg->format) != cfg->ninput))
+    return -1;
+
+  for (i = 0; i < cfg->nchan; i++)
+    if (cfg->chan[i].kind == DAQ_PHASE)
+      nphase++;
+  *why = "too many phase channels";
+  if (nphase > DAQ_MAX_PHASE)
+    return -1;
+
+  return 0;
+}
+
+static int find_input(const daq_config *cfg, const char *name)
+{
+  int i;
+
+  for (i = 0; i < cfg->ninput; i++)
+    if (strcmp(cfg->input[i].name, name) == 0)
+      return i;
+  return -1;
+}
+
+static int get_num(const char *s, double *x)
+{
+  char *end;
+
+  errno = 0;
+  *x = strtod(s, &end);
+  return ((end == s) | (*end != '\0') | (errno != 0)) ? -1 : 0;
+}
+
+static int get_int(const char *s, int *x)
+{
+  char *end;
+  long v;
+
+  errno = 0;
+  v = strtol(s, &end, 10);
+  *x = (int)v;
+  return ((end == s) | (*end != '\0') | (errno != 0) | (v != *x)) ? -1 : 0;
+}
+
+static int count_conversions(const char *format)
+{
+  const char *p;
+  int n = 0;
+
+  // every conversion must be %lf (the values are doubles); %% is a literal %
+  for (p = strchr(format, '%'); p != NULL; p = strchr(p, '%'))
+  {
+    if (p[1] == '%')
+      p += 2;
+    else if ((p[1] == 'l') && (p[2] == 'f'))
+    {
+      n++;
+      p += 3;
+    }
+    else
+      return -1;
+  }
+  return n;
+}
+
+static int read_calib(daq_config *cfg, const char *path)
+{
+  calib_channel cal[MSEED_MAX_CHAN];
+  const char *LI[MSEED_MAX_CHAN], *CI[MSEED_MAX_CHAN];
+  const char *dir = strrchr(path, '/');
+  char fn[400];
+  int i;
+
+  // a relative file name is taken from the directory of the configuration file
+  if ((cfg->calib[0] == '/') | (dir == NULL))
+    snprintf(fn, sizeof(fn), "%s", cfg->calib);
+  else
+    snprintf(fn, sizeof(fn), "%.*s/%s", (int)(dir - path), path, cfg->calib);
+
+  for (i = 0; i < cfg->nchan; i++)
+  {
+    cal[i] = cfg->chan[i].cal;
+    LI[i] = cfg->chan[i].LI;
+    CI[i] = cfg->chan[i].CI;
+  }
+  if (calib_read(cal, cfg->nchan, LI, CI, fn) == -1)
+    return -1;
+  for (i = 0; i < cfg->nchan; i++)
+    cfg->chan[i].cal = cal[i];
+
+  return 0;
+}
@@ -0,0 +1,218 @@
+// LabJack T7 instrument driver of the data acquisition engine
+//
+// by: Scott DeWolf
+//
+//   device labjack 470012941 ethernet  identifier and connection (ethernet, usb or any)
+//   relay /home/avn4/Data/usbrelay0.pl power cycle the T7 before opening it
+//   write AIN0_RANGE 10.0              registers written once the T7 is open
+//   stream 4000 200                    hardware-timed ScanRate and ScansPerRead (see t7_stream.h)
+//   input x1 AIN0                      register read (or streamed) for the input
+//
+// Without a stream line the inputs are read at the instants given by the
+// sampler; LJM has no way to wait for the answer elsewhere, so the event loop
+// blocks during each read (a few ms). The register names are resolved to
+// Modbus addresses and types once, when the T7 is opened (a misspelled
+// register is caught there too), and every read is an LJM_eReadAddresses()
+// into the same arrays, so LJM doesn't look the names up again on each read
+// (lj_bench measures the scans per second either way). The blocks of a
+// stream are announced on a descriptor instead (see t7_stream_notify()).
+// Built with -DHAVE_LABJACK (see daq_make.sh).
+//
+//  created: Saturday, October 17, 2026 (2026290)
+// modified: Saturday, October 17, 2026 (2026290)
+//  history:
+//           [2026290] - created document from the AOFS-CC, TAOFT and TBECS programs
+//           [2026290] - wait for the stream blocks in the event loop
+//           [2026290] - read and write by address (names resolved once, when opened)
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <LabJackM.h>
+#include "daq.h"
+#include "t7_stream.h"
+
+// state of an open T7
+typedef struct
+{
+  int handle;
+  const char *aNames[DAQ_MAX_INPUT];  // registers of the inputs
+  int aAddresses[DAQ_MAX_INPUT];    // and their Modbus addresses
+  int aTypes[DAQ_MAX_INPUT];        // and data types
+  t7_stream st;
+} labjack_t7;
+
+// local function definitions
+static int labjack_open(daq_device *d);
+static int labjack_read(daq_device *d, double *v);
+static double labjack_window(daq_device *d, double fs);
+static int labjack_scan(daq_device *d, double t_stop, double *v);
+static void labjack_close(daq_device *d);
+static int labjack_error(int err, int errorAddress, const char *what);
+
+const daq_driver daq_labjack = {"labjack", labjack_open, labjack_read, labjack_window, labjack_scan, labjack_close, NULL, NULL};
+
+static int labjack_open(daq_device *d)
+{
+  const daq_config *cfg = d->cfg;
+  const char *aNamesConfig[DAQ_MAX_WRITE];
+  int aAddressesConfig[DAQ_MAX_WRITE], aTypesConfig[DAQ_MAX_WRITE];
+  char cmd[256];
+  labjack_t7 *lj;
+  int i, err, ct;
+  int errorAddress = -1;
+
+  if ((cfg->ndev < 1) | (cfg->ndev > 2))
+  {
+    fprintf(stderr, "labjack: device labjack <identifier> [ethernet|usb|any]\n");
+    return -1;
+  }
+  ct = LJM_ctETHERNET;
+  if (cfg->ndev == 2)
+  {
+    if (strcmp(cfg->dev[1], "usb") == 0)
+      ct = LJM_ctUSB;
+    else if (strcmp(cfg->dev[1], "any") == 0)
+      ct = LJM_ctANY;
+    else if (strcmp(cfg->dev[1], "ethernet") != 0)
+    {
+      fprintf(stderr, "labjack: unknown connection %s\n", cfg->dev[1]);
+      return -1;
+    }
+  }
+  for (i = 0; i < cfg->ninput; i++)
+  {
+    if (cfg->input[i].narg != 1)
+    {
+      fprintf(stderr, "labjack: input %s needs the register to read\n", cfg->input[i].name);
+      return -1;
+    }
+  }
+
+  lj = calloc(1, sizeof(labjack_t7));
+  if (lj == NULL)
+    return -1;
+  for (i = 0; i < cfg->ninput; i++)
+    lj->aNames[i] = cfg->input[i].arg[0];
+  for (i = 0; i < cfg->nwrite; i++)
+    aNamesConfig[i] = cfg->wname[i];
+
+  // resolve the registers once (before power cycling anything for a misspelled one)
+  err = LJM_NamesToAddresses(cfg->ninput, lj->aNames, lj->aAddresses, lj->aTypes);
+  if ((err == LJME_NOERROR) & (cfg->nwrite > 0))
+    err = LJM_NamesToAddresses(cfg->nwrite, aNamesConfig, aAddressesConfig, aTypesConfig);
+  if (labjack_error(err, -1, "LJM_NamesToAddresses"))
+  {
+    free(lj);
+    return -1;
+  }
+
+  // power cycle and open the LabJack T7
+  if (cfg->relay[0] != '\0')
+  {
+    snprintf(cmd, sizeof(cmd), "/usr/bin/perl %s", cfg->relay);
+    system(cmd);
+  }
+  err = LJM_Open(LJM_dtT7, ct, cfg->dev[0], &lj->handle);
+  if (labjack_error(err, -1, "LJM_Open"))
+  {
+    free(lj);
+    return -1;
+  }
+
+  // configure the AINs
+  if (cfg->nwrite > 0)
+  {
+    err = LJM_eWriteAddresses(lj->handle, cfg->nwrite, aAddressesConfig, aTypesConfig, cfg->wvalue, &errorAddress);
+    if (labjack_error(err, errorAddress, "LJM_eWriteAddresses"))
+    {
+      LJM_Close(lj->handle);
+      free(lj);
+      return -1;
+    }
+  }
+
+  // start the hardware-timed stream of the inputs
+  if (cfg->ScanRate > 0)
+  {
+    err = t7_stream_start(&lj->st, lj->handle, cfg->ninput, lj->aNames, cfg->ScanRate, cfg->ScansPerRead);
+    if (labjack_error(err, -1, "t7_stream_start"))
+    {
+      LJM_Close(lj->handle);
+      free(lj);
+      return -1;
+    }
+    d->timed = 1;
+    d->fd = t7_stream_notify(&lj->st);
+    if (d->fd == -1)
+    {
+      t7_stream_stop(&lj->st);
+      LJM_Close(lj->handle);
+      free(lj);
+      return -1;
+    }
+  }
+
+  d->priv = lj;
+  return 0;
+}
+
+static int labjack_read(daq_device *d, double *v)
+{
+  labjack_t7 *lj = d->priv;
+  int err, errorAddress = -1;
+
+  err = LJM_eReadAddresses(lj->handle, d->cfg->ninput, lj->aAddresses, lj->aTypes, v, &errorAddress);
+  return (labjack_error(err, errorAddress, "LJM_eReadAddresses")) ? -1 : 0;
+}
+
+static double labjack_window(daq_device *d, double fs)
+{
+  labjack_t7 *lj = d->priv;
+  double t_center = t7_stream_window(&lj->st, fs);
+
+  // a stream read failed (rather than the next block not having arrived)
+  if ((t_center == 0) && (labjack_error(lj->st.err, -1, "LJM_eStreamRead")))
+    d->err = lj->st.err;
+  return t_center;
+}
+
+static int labjack_scan(daq_device *d, double t_stop, double *v)
+{
+  labjack_t7 *lj = d->priv;
+  int rc = t7_stream_scan(&lj->st, t_stop, v);
+
+  // a scan, or none arrived yet
+  if (rc != 0)
+    return rc;
+
+  // a stream read failed
+  if (labjack_error(lj->st.err, -1, "LJM_eStreamRead"))
+    d->err = lj->st.err;
+  return 0;
+}
+
+static void labjack_close(daq_device *d)
+{
+  labjack_t7 *lj = d->priv;
+
+  if (d->timed)
+    t7_stream_stop(&lj->st);
+  labjack_error(LJM_Close(lj->handle), -1, "LJM_Close");
+  free(lj);
+}
+
+static int labjack_error(int err, int errorAddress, const char *what)
+{
+  char errName[LJM_STRING_ALLOCATION_SIZE];
+
+  if (err == LJME_NOERROR)
+    return 0;
+  LJM_ErrorToString(err, errName);
+  if (errorAddress >= 0)
+    fprintf(stderr, "%s error (address %i): %s\n", what, errorAddress, errName);
+  else
+    fprintf(stderr, "%s error: %s\n", what, errName);
+  return 1;
+}
@@ -0,0 +1,19 @@
+#!/bin/bash
+
+# the LabJack and Modbus drivers are only built where their libraries are installed
+SRC="daq.c daq_config.c daq_serial.c mseed_writer.c io_batch.c steim.c spsc_ring.c seedlink.c sampler.c threefringe.c threefringe_fit.c threefringe_state.c calib.c"
+LIB=""
+if [ -f /usr/local/include/LabJackM.h ]; then
+  SRC="$SRC daq_labjack.c t7_stream.c -DHAVE_LABJACK"
+  LIB="$LIB -lLabJackM"
+fi
+if pkg-config --exists libmodbus; then
+  SRC="$SRC daq_modbus.c -DHAVE_MODBUS"
+  LIB="$LIB `pkg-config --cflags --libs libmodbus`"
+fi
+
+echo -e "\nCompiling configuration-driven data acquisition code . . . \c"
+gcc $SRC -O2 -g -Wall -pthread $LIB -lm -o daq
+echo -e "done!\n"
+
+rm -f *~ > /dev/null
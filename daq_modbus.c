@@ -0,0 +1,240 @@
+// Modbus instrument driver of the data acquisition engine
+//
+// by: Scott DeWolf
+//
+//   device modbus rtu /dev/ttyUSB4 9600 N 8 2  Modbus RTU: port, baud rate, parity, data and stop bits
+//   device modbus tcp 192.168.13.31 8899       Modbus TCP: host and port
+//   slave 1                                    slave ID
+//   input bv 8 u16                             holding register and type (u16, s16,
+//                                              float_abcd, float_badc, float_cdab, float_dcba)
+//
+// An input whose register can't be read keeps its previous value. The
+// registers are requested one after the other, each request being sent when
+// the answer to the previous one has come (on the socket or port the event
+// loop waits on). Built with -DHAVE_MODBUS (see daq_make.sh).
+//
+//  created: Saturday, October 17, 2026 (2026290)
+// modified: Saturday, October 17, 2026 (2026290)
+//  history:
+//           [2026290] - created document from the BaroTROLL and SunSaver programs
+//           [2026290] - read the registers from the event loop (mbus_request, mbus_receive)
+//           [2026290] - stray bytes on an RTU port are dropped rather than closing it
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <modbus.h>
+#include "daq.h"
+
+// register types
+enum { U16, S16, FLOAT_ABCD, FLOAT_BADC, FLOAT_CDAB, FLOAT_DCBA };
+
+// state of an open connection
+typedef struct
+{
+  modbus_t *ctx;
+  int addr[DAQ_MAX_INPUT], type[DAQ_MAX_INPUT];  // registers of the inputs
+  int next;                                      // input whose answer is awaited (-1 = none)
+  int tcp;                                       // Modbus TCP (rather than RTU)
+} modbus_dev;
+
+// local function definitions
+static int mbus_open(daq_device *d);
+static int mbus_read(daq_device *d, double *v);
+static int mbus_request(daq_device *d);
+static int mbus_receive(daq_device *d, double *v);
+static void mbus_close(daq_device *d);
+static int send_request(daq_device *d, int i);
+static void set_value(double *v, int type, const uint16_t *tab);
+static int register_type(const char *s);
+
+const daq_driver daq_modbus = {"modbus", mbus_open, mbus_read, NULL, NULL, mbus_close, mbus_request, mbus_receive};
+
+static int mbus_open(daq_device *d)
+{
+  const daq_config *cfg = d->cfg;
+  modbus_dev *mb;
+  int i, rc;
+
+  if (!(((cfg->ndev == 6) && (strcmp(cfg->dev[0], "rtu") == 0)) || ((cfg->ndev == 3) && (strcmp(cfg->dev[0], "tcp") == 0))))
+  {
+    fprintf(stderr, "modbus: device modbus rtu <port> <baud rate> <N|E|O> <data bits> <stop bits>\n"
+                    "        device modbus tcp <host> <port>\n");
+    return -1;
+  }
+
+  mb = calloc(1, sizeof(modbus_dev));
+  if (mb == NULL)
+    return -1;
+  for (i = 0; i < cfg->ninput; i++)
+  {
+    if ((cfg->input[i].narg != 2) || ((mb->type[i] = register_type(cfg->input[i].arg[1])) == -1))
+    {
+      fprintf(stderr, "modbus: input %s needs a register and its type\n", cfg->input[i].name);
+      free(mb);
+      return -1;
+    }
+    mb->addr[i] = atoi(cfg->input[i].arg[0]);
+  }
+
+  if (strcmp(cfg->dev[0], "rtu") == 0)
+    mb->ctx = modbus_new_rtu(cfg->dev[1], atoi(cfg->dev[2]), cfg->dev[3][0], atoi(cfg->dev[4]), atoi(cfg->dev[5]));
+  else
+  {
+    mb->ctx = modbus_new_tcp(cfg->dev[1], atoi(cfg->dev[2]));
+    mb->tcp = 1;
+  }
+  if (mb->ctx == NULL)
+  {
+    fprintf(stderr, "Could not connect to MODBUS: %s\n", modbus_strerror(errno));
+    free(mb);
+    return -1;
+  }
+
+  rc = modbus_set_slave(mb->ctx, cfg->slave);
+  if (rc == -1)
+  {
+    fprintf(stderr, "server_id = %i Invalid slave ID: %s\n", cfg->slave, modbus_strerror(errno));
+    modbus_free(mb->ctx);
+    free(mb);
+    return -1;
+  }
+
+  modbus_set_error_recovery(mb->ctx,
+                            MODBUS_ERROR_RECOVERY_LINK |
+                            MODBUS_ERROR_RECOVERY_PROTOCOL);
+
+  // a failed connection is retried by the error recovery on the first read
+  if (modbus_connect(mb->ctx) == -1)
+    fprintf(stderr, "modbus_connect: %s\n", modbus_strerror(errno));
+
+  mb->next = -1;
+  d->priv = mb;
+  d->fd = modbus_get_socket(mb->ctx);
+  return 0;
+}
+
+static int mbus_read(daq_device *d, double *v)
+{
+  modbus_dev *mb = d->priv;
+  uint16_t tab[2];
+  int i, rc;
+
+  for (i = 0; i < d->cfg->ninput; i++)
+  {
+    rc = modbus_read_registers(mb->ctx, mb->addr[i], (mb->type[i] <= S16) ? 1 : 2, tab);
+    if (rc > 0)
+      set_value(&v[i], mb->type[i], tab);
+  }
+
+  return 0;
+}
+
+static int mbus_request(daq_device *d)
+{
+  modbus_dev *mb = d->priv;
+  int i;
+
+  // forget an answer that never came and reconnect a lost link
+  if (mb->next >= 0)
+    modbus_flush(mb->ctx);
+  mb->next = -1;
+  if ((modbus_get_socket(mb->ctx) == -1) && (modbus_connect(mb->ctx) == -1))
+    fprintf(stderr, "modbus_connect: %s\n", modbus_strerror(errno));
+
+  // the read is over (with the previous values) if no request can be sent
+  for (i = 0; (i < d->cfg->ninput) && (send_request(d, i) == -1); i++)
+    ;
+  d->fd = modbus_get_socket(mb->ctx);
+  return (i < d->cfg->ninput) ? 0 : 1;
+}
+
+static int mbus_receive(daq_device *d, double *v)
+{
+  modbus_dev *mb = d->priv;
+  uint8_t rsp[MODBUS_MAX_ADU_LENGTH];
+  uint16_t tab[2];
+  int h, i, rc;
+
+  // nothing was asked: drop the bytes, or close the link if the other end of
+  // a TCP link did (modbus_flush() returns the bytes dropped for TCP, but
+  // tcflush()'s 0 for RTU, where stray bytes are line noise or the echo of an
+  // RS-485 adapter) or the port failed
+  if (mb->next == -1)
+  {
+    rc = modbus_flush(mb->ctx);
+    if ((rc == -1) || ((mb->tcp) & (rc == 0)))
+    {
+      modbus_close(mb->ctx);
+      d->fd = -1;
+    }
+    return 0;
+  }
+
+  // answer of holding registers: function code, byte count, registers (big endian)
+  i = mb->next;
+  mb->next = -1;
+  rc = modbus_receive_confirmation(mb->ctx, rsp);
+  h = modbus_get_header_length(mb->ctx);
+  if ((rc > h + 2) && (rsp[h] == 0x03) && (rsp[h+1] >= ((mb->type[i] <= S16) ? 2 : 4)))
+  {
+    tab[0] = (uint16_t)MODBUS_GET_INT16_FROM_INT8(rsp, h + 2);
+    tab[1] = (uint16_t)MODBUS_GET_INT16_FROM_INT8(rsp, h + 4);
+    set_value(&v[i], mb->type[i], tab);
+  }
+
+  // request the next register
+  for (i = i + 1; (i < d->cfg->ninput) && (send_request(d, i) == -1); i++)
+    ;
+  d->fd = modbus_get_socket(mb->ctx);
+  return (i < d->cfg->ninput) ? 0 : 1;
+}
+
+static void mbus_close(daq_device *d)
+{
+  modbus_dev *mb = d->priv;
+
+  modbus_close(mb->ctx);
+  modbus_free(mb->ctx);
+  free(mb);
+}
+
+static int send_request(daq_device *d, int i)
+{
+  modbus_dev *mb = d->priv;
+  int nb = (mb->type[i] <= S16) ? 1 : 2;
+  uint8_t req[6] = {(uint8_t)d->cfg->slave, 0x03, mb->addr[i] >> 8, mb->addr[i] & 0xff, 0, nb};
+
+  // read holding registers (the header and checksum are added by libmodbus)
+  if (modbus_send_raw_request(mb->ctx, req, sizeof(req)) == -1)
+    return -1;
+  mb->next = i;
+  return 0;
+}
+
+static void set_value(double *v, int type, const uint16_t *tab)
+{
+  switch (type)
+  {
+    case U16: *v = (double)tab[0]; break;
+    case S16: *v = (double)(int16_t)tab[0]; break;
+    case FLOAT_ABCD: *v = (double)modbus_get_float_abcd(tab); break;
+    case FLOAT_BADC: *v = (double)modbus_get_float_badc(tab); break;
+    case FLOAT_CDAB: *v = (double)modbus_get_float_cdab(tab); break;
+    case FLOAT_DCBA: *v = (double)modbus_get_float_dcba(tab); break;
+  }
+}
+
+static int register_type(const char *s)
+{
+  const char *names[] = {"u16", "s16", "float_abcd", "float_badc", "float_cdab", "float_dcba"};
+  int i;
+
+  for (i = 0; i < (int)(sizeof(names) / sizeof(names[0])); i++)
+    if (strcmp(s, names[i]) == 0)
+      return i;
+  return -1;
+}
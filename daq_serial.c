@@ -0,0 +1,278 @@
+// serial ASCII instrument driver of the data acquisition engine
+//
+// by: Scott DeWolf
+//
+// modified from user sawdust's answer at https://stackoverflow.com/questions/6947413/how-to-open-read-and-write-from-serial-port-in-c
+//
+//   device serial /dev/ttyS0 19200     port and baud rate (8 bits, no parity, 1 stop bit)
+//   format 0R0,Dm=%lfD,Sm=%lfM,...     the inputs, in order, are parsed from each message
+//   input x 1 8                        (without format) the input is in columns 1 to 8
+//
+// The port is read without blocking as its bytes arrive and a read takes the
+// first complete message (up to a newline) received after it was requested
+// in which every input parses; a message that doesn't parse is dropped and the
+// read waits for the next one. With flushinput, the bytes up to the first
+// newline after the flush are dropped too, as they may be the end of a message
+// the flush cut.
+//
+//  created: Saturday, October 17, 2026 (2026290)
+// modified: Saturday, October 17, 2026 (2026290)
+//  history:
+//           [2026290] - created document from the Vaisala WXT520 and LILY programs
+//           [2026290] - read the port from the event loop (serial_request, serial_receive)
+//           [2026290] - a read only takes a whole message whose inputs all parse
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include "daq.h"
+
+#define MAX_FORMAT 16  // most inputs parsed with format
+
+// state of an open port
+typedef struct
+{
+  int fd;
+  int col[DAQ_MAX_INPUT], len[DAQ_MAX_INPUT];  // fixed columns of the inputs
+  int want;                                    // a read is waiting for the next message
+  int n;                                       // bytes received of the next message
+  int skip;                                    // drop the bytes up to the next newline (after a flush)
+  char buf[200];
+} serial_port;
+
+// local function definitions
+static int serial_open(daq_device *d);
+static int serial_request(daq_device *d);
+static int serial_receive(daq_device *d, double *v);
+static void serial_close(daq_device *d);
+static int parse_message(daq_device *d, double *v, char *msg, int n);
+static int set_interface_attribs(int fd, speed_t speed);
+static speed_t baud_rate(int baud);
+
+const daq_driver daq_serial = {"serial", serial_open, NULL, NULL, NULL, serial_close, serial_request, serial_receive};
+
+static int serial_open(daq_device *d)
+{
+  const daq_config *cfg = d->cfg;
+  serial_port *sp;
+  speed_t speed;
+  int i;
+
+  if (cfg->ndev != 2)
+  {
+    fprintf(stderr, "serial: device serial <port> <baud rate>\n");
+    return -1;
+  }
+  if ((speed = baud_rate(atoi(cfg->dev[1]))) == 0)
+  {
+    fprintf(stderr, "serial: unsupported baud rate %s\n", cfg->dev[1]);
+    return -1;
+  }
+  if ((cfg->format[0] == '\0') & (cfg->ninput > 0))
+  {
+    for (i = 0; i < cfg->ninput; i++)
+      if (cfg->input[i].narg != 2)
+      {
+        fprintf(stderr, "serial: input %s needs its first column and width\n", cfg->input[i].name);
+        return -1;
+      }
+  }
+  if (cfg->ninput > MAX_FORMAT)
+  {
+    fprintf(stderr, "serial: too many inputs (%i)\n", MAX_FORMAT);
+    return -1;
+  }
+
+  sp = calloc(1, sizeof(serial_port));
+  if (sp == NULL)
+    return -1;
+  for (i = 0; (i < cfg->ninput) & (cfg->format[0] == '\0'); i++)
+  {
+    sp->col[i] = atoi(cfg->input[i].arg[0]);
+    sp->len[i] = atoi(cfg->input[i].arg[1]);
+  }
+
+  // open serial port
+  sp->fd = open(cfg->dev[0], O_RDWR | O_NOCTTY | O_SYNC);
+  if (sp->fd == -1)
+  {
+    perror(cfg->dev[0]);
+    free(sp);
+    return -1;
+  }
+
+  // configure serial port: 8 bits, no parity, 1 stop bit
+  set_interface_attribs(sp->fd, speed);
+
+  // discard the first messages
+  for (i = 0; i < cfg->discard; i++)
+    read(sp->fd, sp->buf, sizeof(sp->buf) - 1);
+
+  // from now on the event loop waits for the bytes
+  fcntl(sp->fd, F_SETFL, fcntl(sp->fd, F_GETFL) | O_NONBLOCK);
+
+  d->priv = sp;
+  d->fd = sp->fd;
+  return 0;
+}
+
+static int serial_request(daq_device *d)
+{
+  serial_port *sp = d->priv;
+
+  // drop messages sent since the last read so this one is current
+  if (d->cfg->flushinput)
+  {
+    tcflush(sp->fd, TCIFLUSH);
+    sp->n = 0;
+    sp->skip = 1;
+  }
+
+  sp->want = 1;
+  return 0;
+}
+
+static int serial_receive(daq_device *d, double *v)
+{
+  serial_port *sp = d->priv;
+  char *end;
+  ssize_t n;
+  int len, done = 0;
+
+  // read the serial buffer
+  n = read(sp->fd, sp->buf + sp->n, sizeof(sp->buf) - 1 - sp->n);
+  if ((n == -1) && ((errno == EAGAIN) | (errno == EINTR)))
+    return 0;
+  if (n == 0)
+  {
+    fprintf(stderr, "%s: port closed\n", d->cfg->dev[0]);
+    return -1;
+  }
+  if (n == -1)
+  {
+    perror(d->cfg->dev[0]);
+    return -1;
+  }
+  sp->n += n;
+  sp->buf[sp->n] = '\0';
+
+  // the first complete message is the read; the ones nobody asked for (or
+  // cut by the flush, or that don't parse) are dropped
+  while ((end = memchr(sp->buf, '\n', sp->n)) != NULL)
+  {
+    len = (int)(end - sp->buf) + 1;
+    if ((sp->want) & (!sp->skip) && (parse_message(d, v, sp->buf, len)))
+    {
+      sp->want = 0;
+      done = 1;
+    }
+    sp->skip = 0;
+    sp->n -= len;
+    memmove(sp->buf, sp->buf + len, sp->n + 1);
+    if (done)
+      break;
+  }
+
+  // a message that doesn't fit is garbage
+  if (sp->n == (int)sizeof(sp->buf) - 1)
+    sp->n = 0;
+
+  return done;
+}
+
+static void serial_close(daq_device *d)
+{
+  serial_port *sp = d->priv;
+
+  close(sp->fd);
+  free(sp);
+}
+
+static int parse_message(daq_device *d, double *v, char *msg, int n)
+{
+  const daq_config *cfg = d->cfg;
+  serial_port *sp = d->priv;
+  double x[MAX_FORMAT];
+  char field[64], c;
+  int i, nparsed = 0;
+
+  // parse the message; the inputs only change if all of them are in it
+  c = msg[n];
+  msg[n] = '\0';
+  if (cfg->format[0] != '\0')
+    nparsed = sscanf(msg, cfg->format, &x[0], &x[1], &x[2], &x[3], &x[4], &x[5], &x[6], &x[7],
+                     &x[8], &x[9], &x[10], &x[11], &x[12], &x[13], &x[14], &x[15]);
+  else
+  {
+    for (i = 0; i < cfg->ninput; i++)
+    {
+      if ((sp->col[i] + sp->len[i] > n) | (sp->len[i] >= (int)sizeof(field)))
+        break;
+      memcpy(field, msg + sp->col[i], sp->len[i]);
+      field[sp->len[i]] = '\0';
+      x[i] = atof(field);
+      nparsed++;
+    }
+  }
+  msg[n] = c;
+
+  if (nparsed < cfg->ninput)
+    return 0;
+  memcpy(v, x, cfg->ninput * sizeof(double));
+  return 1;
+}
+
+static int set_interface_attribs(int fd, speed_t speed)
+{
+  struct termios tty;
+
+  // populate tty struct with default values
+  tcgetattr(fd, &tty);
+
+  // setup input and output baud rates
+  cfsetospeed(&tty, speed);
+  cfsetispeed(&tty, speed);
+
+  // setup other serial configs
+  tty.c_cflag |= (CLOCAL | CREAD); // ignore modem controls
+  tty.c_cflag &= ~CSIZE;           // clear the character size bits
+  tty.c_cflag |= CS8;              // 8-bit characters
+  tty.c_cflag &= ~PARENB;          // no parity bit
+  tty.c_cflag &= ~CSTOPB;          // only need 1 stop bit
+  tty.c_cflag &= ~CRTSCTS;         // no hardware flowcontrol
+
+  // setup for non-canonical mode
+  tty.c_iflag &= ~(IGNBRK | BRKINT | PARMRK | ISTRIP | INLCR | IGNCR | ICRNL | IXON);
+  tty.c_lflag &= ~(ECHO | ECHONL | ICANON | ISIG | IEXTEN);
+  tty.c_oflag &= ~OPOST;
+
+  // fetch bytes as they become available
+  tty.c_cc[VMIN] = 58;
+  tty.c_cc[VTIME] = 1;
+
+  // set serial port attributes
+  tcsetattr(fd, TCSANOW, &tty);
+
+  return 0;
+}
+
+static speed_t baud_rate(int baud)
+{
+  switch (baud)
+  {
+    case 1200: return B1200;
+    case 2400: return B2400;
+    case 4800: return B4800;
+    case 9600: return B9600;
+    case 19200: return B19200;
+    case 38400: return B38400;
+    case 57600: return B57600;
+    case 115200: return B115200;
+  }
+  return 0;
+}
@@ -2,7 +2,7 @@
 
 echo -e "\nCompiling In-Situ BaroTROLL SN: 493599 data acquisition code using RS485 . . . \c"
 #gcc insitu_barotroll_493599_daq.c -g -Wall -lm -o ww29_daq
-gcc  insitu_barotroll_493599_daq.c -g -Wall -lm -o w29_daq  `pkg-config --cflags --libs libmodbus`
+gcc  insitu_barotroll_493599_daq.c mseed_writer.c io_batch.c steim.c spsc_ring.c sampler.c -g -Wall -pthread -lm -o w29_daq  `pkg-config --cflags --libs libmodbus`
 echo -e "done!\n"
 
 rm -f *~ > /dev/null
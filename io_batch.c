@@ -0,0 +1,351 @@
+// batches of positioned writes submitted together
+//
+// by: Scott DeWolf
+//
+// The miniSEED writer ends up writing a record (and its checkpoint) to
+// several files at the same moment, e.g., when the flush interval of a
+// station passes, every channel has a partial record to write. Instead of a
+// pwrite() or fdatasync() system call each, the writes are copied into a
+// batch and submitted together: through an io_uring with a single
+// io_uring_enter() where the kernel has one (Linux 5.1 on, and not disabled
+// by a seccomp profile), otherwise with one pwritev() per file for each run of
+// consecutive offsets. A sync is queued as IORING_OP_FSYNC with
+// IOSQE_IO_DRAIN, so it only starts once the writes before it are done, which
+// keeps the order pwritev() and fdatasync() would have.
+//
+//  created: Saturday, October 17, 2026 (2026290)
+// modified: Saturday, October 17, 2026 (2026290)
+//  history:
+//           [2026290] - created document
+//           [2026290] - a newer write at the same offset replaces a queued one of another length
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include "io_batch.h"
+#ifdef __NR_io_uring_setup
+#include <linux/io_uring.h>
+#endif
+
+// local function definitions
+static int uring_setup(io_batch *b);
+static int uring_submit(io_batch *b);
+static int plain_submit(io_batch *b);
+static void uring_free(io_batch *b);
+
+int io_batch_init(io_batch *b, int use_uring)
+{
+  int i;
+
+  memset(b, 0, sizeof(*b));
+  b->ring_fd = -1;
+  b->op = calloc(IO_BATCH_MAX, sizeof(io_batch_op));
+  b->mem = malloc(IO_BATCH_MAX * IO_BATCH_BUF);
+  if ((b->op == NULL) | (b->mem == NULL))
+  {
+    free(b->op);
+    free(b->mem);
+    b->op = NULL;
+    b->mem = NULL;
+    return -1;
+  }
+  for (i = 0; i < IO_BATCH_MAX; i++)
+    b->op[i].buf = b->mem + i * IO_BATCH_BUF;
+
+  // pwritev() is used if the kernel won't give an io_uring
+  if (use_uring)
+    uring_setup(b);
+
+  return 0;
+}
+
+void io_batch_write(io_batch *b, int fd, const void *buf, size_t len, off_t off)
+{
+  io_batch_op *op;
+  int i;
+
+  // a newer copy of a queued write (e.g., a partial record that filled up,
+  // or a miniSEED 3 record that grew), which the ring mustn't reorder
+  for (i = b->n - 1; i >= 0; i--)
+  {
+    op = &b->op[i];
+    if ((op->fd == fd) & (op->off == off) & (op->len > 0))
+    {
+      memcpy(op->buf, buf, len);
+      op->len = len;
+      return;
+    }
+  }
+
+  if (b->n == IO_BATCH_MAX)
+    io_batch_submit(b);
+  op = &b->op[b->n++];
+  op->fd = fd;
+  op->off = off;
+  op->len = len;
+  memcpy(op->buf, buf, len);
+}
+
+void io_batch_sync(io_batch *b, int fd)
+{
+  int i;
+
+  // nothing was written to the file since its last queued sync
+  for (i = b->n - 1; i >= 0; i--)
+  {
+    if (b->op[i].fd != fd)
+      continue;
+    if (b->op[i].len == 0)
+      return;
+    break;
+  }
+
+  if (b->n == IO_BATCH_MAX)
+    io_batch_submit(b);
+  b->op[b->n].fd = fd;
+  b->op[b->n].off = 0;
+  b->op[b->n].len = 0;
+  b->n++;
+}
+
+int io_batch_submit(io_batch *b)
+{
+  int fail;
+
+  if (b->n == 0)
+    return 0;
+
+  // a single write gains nothing from the ring
+  if ((b->ring_fd == -1) | (b->n == 1))
+    fail = plain_submit(b);
+  else
+    fail = uring_submit(b);
+
+  b->batches++;
+  b->ops += b->n;
+  b->n = 0;
+  return fail;
+}
+
+const char *io_batch_path(const io_batch *b)
+{
+  return (b->ring_fd != -1) ? "io_uring" : "pwritev";
+}
+
+void io_batch_free(io_batch *b)
+{
+  io_batch_submit(b);
+  uring_free(b);
+  free(b->op);
+  free(b->mem);
+  b->op = NULL;
+  b->mem = NULL;
+}
+
+static int plain_submit(io_batch *b)
+{
+  struct iovec iov[IO_BATCH_MAX];
+  char done[IO_BATCH_MAX] = {0};
+  const io_batch_op *op;
+  size_t total;
+  int i, k, nv, fail = 0;
+
+  for (i = 0; i < b->n; i++)
+  {
+    if (done[i])
+      continue;
+    op = &b->op[i];
+
+    // every earlier write of the file has been made
+    if (op->len == 0)
+    {
+      b->calls++;
+      if (fdatasync(op->fd) == -1)
+      {
+        perror("io_batch: fdatasync");
+        fail++;
+      }
+      continue;
+    }
+
+    // the writes of this file that follow on from this one, up to its next sync
+    nv = 0;
+    total = 0;
+    for (k = i; k < b->n; k++)
+    {
+      if ((done[k]) || (b->op[k].fd != op->fd))
+        continue;
+      if (b->op[k].len == 0)
+        break;
+      if (b->op[k].off != op->off + (off_t)total)
+        continue;
+      iov[nv].iov_base = b->op[k].buf;
+      iov[nv].iov_len = b->op[k].len;
+      total += b->op[k].len;
+      done[k] = 1;
+      nv++;
+    }
+
+    b->calls++;
+    if (pwritev(op->fd, iov, nv, op->off) != (ssize_t)total)
+    {
+      perror("io_batch: pwritev");
+      fail += nv;
+    }
+  }
+
+  return fail;
+}
+
+#ifdef __NR_io_uring_setup
+
+static int uring_setup(io_batch *b)
+{
+  struct io_uring_params p;
+  int fd;
+
+  memset(&p, 0, sizeof(p));
+  fd = (int)syscall(__NR_io_uring_setup, IO_BATCH_MAX, &p);
+  if (fd == -1)
+    return -1;
+
+  // submission and completion rings (one mapping on kernels that share it) and the entries
+  b->sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+  b->cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+  if (p.features & IORING_FEAT_SINGLE_MMAP)
+  {
+    if (b->cq_size > b->sq_size)
+      b->sq_size = b->cq_size;
+    b->cq_size = 0;
+  }
+  b->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+
+  b->sq_ring = mmap(NULL, b->sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+  b->cq_ring = (b->cq_size == 0) ? b->sq_ring : mmap(NULL, b->cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+  b->sqes = mmap(NULL, b->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+  b->ring_fd = fd;
+  if ((b->sq_ring == MAP_FAILED) | (b->cq_ring == MAP_FAILED) | (b->sqes == MAP_FAILED))
+  {
+    uring_free(b);
+    return -1;
+  }
+
+  b->sq_head = (unsigned *)((char *)b->sq_ring + p.sq_off.head);
+  b->sq_tail = (unsigned *)((char *)b->sq_ring + p.sq_off.tail);
+  b->sq_mask = (unsigned *)((char *)b->sq_ring + p.sq_off.ring_mask);
+  b->sq_array = (unsigned *)((char *)b->sq_ring + p.sq_off.array);
+  b->cq_head = (unsigned *)((char *)b->cq_ring + p.cq_off.head);
+  b->cq_tail = (unsigned *)((char *)b->cq_ring + p.cq_off.tail);
+  b->cq_mask = (unsigned *)((char *)b->cq_ring + p.cq_off.ring_mask);
+  b->cqes = (char *)b->cq_ring + p.cq_off.cqes;
+  return 0;
+}
+
+static int uring_submit(io_batch *b)
+{
+  struct io_uring_sqe *sqe;
+  const struct io_uring_cqe *cqe;
+  io_batch_op *op;
+  unsigned tail = *b->sq_tail, mask = *b->sq_mask, idx, head;
+  int i, rc, submitted = 0, completed = 0, fail = 0;
+
+  // one entry per write or sync, in the order they were queued
+  for (i = 0; i < b->n; i++)
+  {
+    op = &b->op[i];
+    idx = (tail + i) & mask;
+    sqe = (struct io_uring_sqe *)b->sqes + idx;
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->fd = op->fd;
+    sqe->user_data = i;
+    if (op->len == 0)
+    {
+      sqe->opcode = IORING_OP_FSYNC;
+      sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+      sqe->flags = IOSQE_IO_DRAIN;
+    }
+    else
+    {
+      op->iov.iov_base = op->buf;
+      op->iov.iov_len = op->len;
+      sqe->opcode = IORING_OP_WRITEV;
+      sqe->addr = (unsigned long)&op->iov;
+      sqe->len = 1;
+      sqe->off = op->off;
+    }
+    b->sq_array[idx] = idx;
+  }
+  __atomic_store_n(b->sq_tail, tail + b->n, __ATOMIC_RELEASE);
+
+  // submit them and wait for them in (usually) one system call (the kernel
+  // doesn't wait if it couldn't take them all)
+  while (completed < b->n)
+  {
+    b->calls++;
+    rc = (int)syscall(__NR_io_uring_enter, b->ring_fd, b->n - submitted, b->n - completed, IORING_ENTER_GETEVENTS, NULL, 0);
+    if ((rc == -1) & (errno == EINTR))
+      continue;
+    if (rc == -1)
+    {
+      // the ring can't be used; the queued entries go with it
+      perror("io_batch: io_uring_enter");
+      uring_free(b);
+      return plain_submit(b);
+    }
+    submitted += rc;
+
+    head = *b->cq_head;
+    while (head != __atomic_load_n(b->cq_tail, __ATOMIC_ACQUIRE))
+    {
+      cqe = (const struct io_uring_cqe *)b->cqes + (head & *b->cq_mask);
+      op = &b->op[cqe->user_data];
+      if ((cqe->res < 0) | ((op->len > 0) & (cqe->res != (int)op->len)))
+      {
+        fprintf(stderr, "io_batch: %s: %s\n", (op->len > 0) ? "write" : "fdatasync", (cqe->res < 0) ? strerror(-cqe->res) : "short write");
+        fail++;
+      }
+      completed++;
+      head++;
+    }
+    __atomic_store_n(b->cq_head, head, __ATOMIC_RELEASE);
+  }
+
+  return fail;
+}
+
+static void uring_free(io_batch *b)
+{
+  if (b->ring_fd == -1)
+    return;
+  if ((b->sqes != NULL) & (b->sqes != MAP_FAILED))
+    munmap(b->sqes, b->sqes_size);
+  if ((b->cq_size > 0) & (b->cq_ring != NULL) & (b->cq_ring != MAP_FAILED))
+    munmap(b->cq_ring, b->cq_size);
+  if ((b->sq_ring != NULL) & (b->sq_ring != MAP_FAILED))
+    munmap(b->sq_ring, b->sq_size);
+  close(b->ring_fd);
+  b->ring_fd = -1;
+}
+
+#else
+
+static int uring_setup(io_batch *b)
+{
+  return -1;
+}
+
+static int uring_submit(io_batch *b)
+{
+  return plain_submit(b);
+}
+
+static void uring_free(io_batch *b)
+{
+}
+
+#endif
@@ -0,0 +1,73 @@
+// batches of positioned writes submitted together
+//
+// by: Scott DeWolf
+//
+//  created: Saturday, October 17, 2026 (2026290)
+// modified: Saturday, October 17, 2026 (2026290)
+//  history:
+//           [2026290] - created document
+//           [2026290] - writes of up to 8192 bytes (the longest miniSEED record)
+//           [2026290] - a newer write at the same offset replaces a queued one of another length
+//
+
+#ifndef IO_BATCH_H
+#define IO_BATCH_H
+
+#include <stddef.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#define IO_BATCH_MAX 128   // most writes and syncs in one batch (a power of 2, at most IOV_MAX)
+#define IO_BATCH_BUF 8192  // largest write
+
+// one write (or data sync, when len = 0) waiting in the batch
+typedef struct
+{
+  int fd;
+  off_t off;
+  size_t len;
+  struct iovec iov;                 // buf, len (for IORING_OP_WRITEV)
+  unsigned char *buf;               // copy of the data (IO_BATCH_BUF bytes)
+} io_batch_op;
+
+// writes queued by io_batch_write() and io_batch_sync(); io_batch_submit()
+// hands them to an io_uring in a single system call where the kernel allows
+// it, or otherwise merges writes to consecutive offsets of a file into one
+// pwritev() each
+typedef struct
+{
+  int n;
+  io_batch_op *op;                  // IO_BATCH_MAX of them
+  unsigned char *mem;               // their buffers
+
+  // io_uring (ring_fd = -1: not used)
+  int ring_fd;
+  unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+  unsigned *cq_head, *cq_tail, *cq_mask;
+  void *sqes, *cqes;
+  void *sq_ring, *cq_ring;
+  size_t sq_size, cq_size, sqes_size;
+
+  unsigned long batches, ops, calls; // batches submitted, writes and syncs, system calls
+} io_batch;
+
+// allocate the buffers and, if use_uring, set up an io_uring; returns -1 if out of memory
+int io_batch_init(io_batch *b, int use_uring);
+
+// queue a copy of len bytes (at most IO_BATCH_BUF) for offset off of fd; a
+// queued write of the same fd and offset is replaced (whatever its length),
+// and a full batch is submitted first
+void io_batch_write(io_batch *b, int fd, const void *buf, size_t len, off_t off);
+
+// queue an fdatasync() of fd after the writes queued before it
+void io_batch_sync(io_batch *b, int fd);
+
+// write everything queued; returns the number of writes or syncs that failed (after saying why)
+int io_batch_submit(io_batch *b);
+
+// "io_uring" or "pwritev"
+const char *io_batch_path(const io_batch *b);
+
+void io_batch_free(io_batch *b);
+
+#endif
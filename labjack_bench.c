@@ -0,0 +1,188 @@
+// command-response read rate of a LabJack T7
+//
+// by: Scott DeWolf
+//
+// Reads AIN0 ... AINn-1 from a T7 as fast as it answers, for several numbers
+// of AINs and resolution indexes (the AINs set up like the stations: single
+// ended, +/-10 V, settling 0 = auto), once with LJM_eReadNames() as the
+// *_daq.c programs do and once with LJM_eReadAddresses() on addresses
+// resolved beforehand as daq_labjack.c does, and reports the scans per second
+// of both and how many reads that makes per sample window at the sample rate
+// given. That is the oversampling a polled station actually gets (the
+// resolution index sets how long each AIN takes to convert, the connection
+// the round trip per read).
+//
+// usage: ./lj_bench identifier [ethernet|usb|any] [seconds per configuration] [sample rate]
+//        ./lj_bench 470012941 ethernet 2 20
+//
+//  created: Saturday, October 17, 2026 (2026290)
+// modified: Saturday, October 17, 2026 (2026290)
+//  history:
+//           [2026290] - created document
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <LabJackM.h>
+
+#define MAX_AIN 8
+
+// function definitions
+double rate_names(int handle, int n, double seconds);
+double rate_addresses(int handle, int n, double seconds);
+int setup_ains(int handle, int n, int ResolutionIndex);
+int ljm_error(int err, int errorAddress, const char *what);
+double elapsed(struct timespec *t0);
+
+// configurations measured
+const int nAIN[] = {1, 2, 3, 4, 6, 8};
+const int ResolutionIndex[] = {0, 1, 2, 4, 6, 8};
+
+// registers read
+const char *aNames[MAX_AIN] = {"AIN0", "AIN1", "AIN2", "AIN3", "AIN4", "AIN5", "AIN6", "AIN7"};
+
+int main(int argc, char **argv)
+{
+  double seconds = (argc > 3) ? atof(argv[3]) : 2;
+  double fs = (argc > 4) ? atof(argv[4]) : 20;
+  double r_names, r_addr;
+  int handle, ct = LJM_ctETHERNET;
+  int i, j;
+
+  if ((argc < 2) | (seconds <= 0) | (fs <= 0))
+  {
+    fprintf(stderr, "usage: %s identifier [ethernet|usb|any] [seconds per configuration] [sample rate]\n", argv[0]);
+    return 2;
+  }
+  if (argc > 2)
+  {
+    if (strcmp(argv[2], "usb") == 0)
+      ct = LJM_ctUSB;
+    else if (strcmp(argv[2], "any") == 0)
+      ct = LJM_ctANY;
+    else if (strcmp(argv[2], "ethernet") != 0)
+    {
+      fprintf(stderr, "unknown connection %s\n", argv[2]);
+      return 2;
+    }
+  }
+
+  if (ljm_error(LJM_Open(LJM_dtT7, ct, argv[1], &handle), -1, "LJM_Open"))
+    return 1;
+
+  printf("AINs  resolution  eReadNames (scans/s)  eReadAddresses (scans/s)  speedup  reads per window at %g Hz\n", fs);
+  for (i = 0; i < (int)(sizeof(nAIN) / sizeof(nAIN[0])); i++)
+    for (j = 0; j < (int)(sizeof(ResolutionIndex) / sizeof(ResolutionIndex[0])); j++)
+    {
+      if (setup_ains(handle, nAIN[i], ResolutionIndex[j]) == -1)
+      {
+        LJM_Close(handle);
+        return 1;
+      }
+      r_names = rate_names(handle, nAIN[i], seconds);
+      r_addr = rate_addresses(handle, nAIN[i], seconds);
+      if ((r_names < 0) | (r_addr < 0))
+      {
+        LJM_Close(handle);
+        return 1;
+      }
+      printf("%4i  %10i  %20.1f  %24.1f  %7.3f  %.1f\n", nAIN[i], ResolutionIndex[j], r_names, r_addr, r_addr / r_names, r_addr / fs);
+      fflush(stdout);
+    }
+
+  ljm_error(LJM_Close(handle), -1, "LJM_Close");
+  return 0;
+}
+
+double rate_names(int handle, int n, double seconds)
+{
+  double v[MAX_AIN], t;
+  struct timespec t0;
+  long scans = 0;
+  int errorAddress = -1;
+
+  // names looked up by LJM on every read
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  do
+  {
+    if (ljm_error(LJM_eReadNames(handle, n, aNames, v, &errorAddress), errorAddress, "LJM_eReadNames"))
+      return -1;
+    scans++;
+  } while ((t = elapsed(&t0)) < seconds);
+
+  return scans / t;
+}
+
+double rate_addresses(int handle, int n, double seconds)
+{
+  int aAddresses[MAX_AIN], aTypes[MAX_AIN];
+  double v[MAX_AIN], t;
+  struct timespec t0;
+  long scans = 0;
+  int errorAddress = -1;
+
+  // resolved once
+  if (ljm_error(LJM_NamesToAddresses(n, aNames, aAddresses, aTypes), -1, "LJM_NamesToAddresses"))
+    return -1;
+
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  do
+  {
+    if (ljm_error(LJM_eReadAddresses(handle, n, aAddresses, aTypes, v, &errorAddress), errorAddress, "LJM_eReadAddresses"))
+      return -1;
+    scans++;
+  } while ((t = elapsed(&t0)) < seconds);
+
+  return scans / t;
+}
+
+int setup_ains(int handle, int n, int ResolutionIndex)
+{
+  const char *aNamesConfig[4*MAX_AIN];
+  double aValuesConfig[4*MAX_AIN];
+  char names[4*MAX_AIN][32];
+  int k, errorAddress = -1;
+
+  // single ended, +/-10 V, the resolution index, settling 0 (auto)
+  for (k = 0; k < n; k++)
+  {
+    snprintf(names[4*k], sizeof(names[0]), "AIN%i_NEGATIVE_CH", k);
+    snprintf(names[4*k+1], sizeof(names[0]), "AIN%i_RANGE", k);
+    snprintf(names[4*k+2], sizeof(names[0]), "AIN%i_RESOLUTION_INDEX", k);
+    snprintf(names[4*k+3], sizeof(names[0]), "AIN%i_SETTLING_US", k);
+    aValuesConfig[4*k] = 199;
+    aValuesConfig[4*k+1] = 10.0;
+    aValuesConfig[4*k+2] = ResolutionIndex;
+    aValuesConfig[4*k+3] = 0;
+  }
+  for (k = 0; k < 4*n; k++)
+    aNamesConfig[k] = names[k];
+
+  if (ljm_error(LJM_eWriteNames(handle, 4*n, aNamesConfig, aValuesConfig, &errorAddress), errorAddress, "LJM_eWriteNames"))
+    return -1;
+  return 0;
+}
+
+int ljm_error(int err, int errorAddress, const char *what)
+{
+  char errName[LJM_STRING_ALLOCATION_SIZE];
+
+  if (err == LJME_NOERROR)
+    return 0;
+  LJM_ErrorToString(err, errName);
+  if (errorAddress >= 0)
+    fprintf(stderr, "%s error (address %i): %s\n", what, errorAddress, errName);
+  else
+    fprintf(stderr, "%s error: %s\n", what, errName);
+  return 1;
+}
+
+double elapsed(struct timespec *t0)
+{
+  struct timespec t1;
+
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  return (double)(t1.tv_sec - t0->tv_sec) + (double)(t1.tv_nsec - t0->tv_nsec) / 1000000000;
+}
@@ -0,0 +1,7 @@
+#!/bin/bash
+
+echo -e "\nCompiling LabJack T7 read rate benchmark . . . \c"
+gcc labjack_bench.c -O2 -g -Wall -lLabJackM -o lj_bench
+echo -e "done!\n"
+
+rm -f *~ > /dev/null
@@ -1,7 +1,7 @@
 #!/bin/bash
 
 echo -e "\nCompiling Applied Geomechanics LILY 8209 data acquisition code using RS422 . . . \c"
-gcc lily_8209_daq.c -g -Wall -lm -o lil2_daq
+gcc lily_8209_daq.c mseed_writer.c io_batch.c steim.c spsc_ring.c sampler.c -g -Wall -pthread -lm -o lil2_daq
 echo -e "done!\n"
 
 echo -e "Compiling Applied Geomechanics LILY 8209 orienting code using RS422 . . . \c"
@@ -0,0 +1,384 @@
+// conformance check of the miniSEED 3 day volumes
+//
+// by: Scott DeWolf
+//
+// Writes a fixed sequence of samples of three channels (int32, Steim-1 and
+// Steim-2, 20 Hz, 512-byte records) through mseed_writer.c with
+// mseed_format3(), compares the day volumes byte for byte with the reference
+// volumes in mseed3_ref/, and walks every record of them with a reader of its
+// own, written from the FDSN miniSEED 3 specification rather than from
+// mseed_writer.c, checking
+//
+//   - the fixed header: "MS", Format Version 3, Encoding Format, Sample Rate,
+//     Data Publication Version, no extra headers;
+//   - the Source Identifier, FDSN:NC_SIC_LI_B_S_SS;
+//   - the start time of every record, decoded to the nanosecond, against the
+//     time of its first sample counted in integer nanoseconds from the first
+//     one (within 1 us: the writer is handed epoch times as doubles, which
+//     only resolve about 0.24 us today);
+//   - the CRC-32C of every record (computed bit by bit, with the CRC field
+//     zero) against the CRC field;
+//   - and the samples (decoded with steim_decode() for Steim) against the
+//     ones written.
+//
+// Any mismatch is reported and the program exits 1. After a deliberate change
+// of the format, -w writes the reference volumes again.
+//
+// usage: ./mseed3_check [-w] [reference directory]
+//
+//  created: Saturday, October 17, 2026 (2026290)
+// modified: Saturday, October 17, 2026 (2026290)
+//  history:
+//           [2026290] - created document
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "mseed_writer.h"
+#include "steim.h"
+
+#define NCHAN 3
+#define NSAMP 2000                    // samples per channel
+#define T0 1760745600                 // 2025:291:00:00:00 (first sample at T0 + NS0 ns)
+#define NS0 250000000
+#define DT 50000000                   // ns per sample (20 Hz)
+
+// function definitions
+int check_volume(const char *path, const char *ref, int c, const int32_t *x);
+int check_record(const unsigned char *rec, long len, int c, const int32_t *x, int *done);
+void sample_sequence(int32_t *x, int c);
+unsigned char *read_file(const char *path, long *len);
+int write_file(const char *path, const unsigned char *p, long len);
+uint32_t crc32c_bitwise(const unsigned char *p, long len);
+int64_t days_from_civil(int y, int m, int d);
+uint32_t get32le(const unsigned char *p);
+
+// the channels
+const char *LI[NCHAN] = {"00", "00", "10"};
+const char *CI[NCHAN] = {"HHZ", "HHN", "HH1"};
+const uint8_t EF[NCHAN] = {3, 10, 11};
+const char *SID[NCHAN] = {"FDSN:XX_CHK_00_H_H_Z", "FDSN:XX_CHK_00_H_H_N", "FDSN:XX_CHK_10_H_H_1"};
+
+// global variables
+int failures = 0, rewrite = 0;
+
+int main(int argc, char **argv)
+{
+  static int32_t x[NCHAN][NSAMP];
+  char root[] = "/tmp/mseed3_check.XXXXXX", path[400], ref[400], cmd[450];
+  const char *refdir = "mseed3_ref";
+  mseed_writer w;
+  int c, j;
+
+  for (c = 1; c < argc; c++)
+  {
+    if (strcmp(argv[c], "-w") == 0)
+      rewrite = 1;
+    else
+      refdir = argv[c];
+  }
+  // the CRC-32C itself, with the check value of the Castagnoli polynomial
+  if (crc32c_bitwise((const unsigned char *)"123456789", 9) != 0xE3069283)
+  {
+    printf("crc32c_bitwise() fails its check value\n");
+    return 1;
+  }
+
+  if (mkdtemp(root) == NULL)
+  {
+    perror(root);
+    return 1;
+  }
+
+  // the fixed sequence, through the writer
+  mseed_init(&w, root, "XX", "CHK", 20, 1, 0);
+  mseed_format3(&w);
+  mseed_skip_checkpoints(&w);
+  for (c = 0; c < NCHAN; c++)
+  {
+    if ((mseed_add_channel(&w, LI[c], CI[c], EF[c]) == -1) || (mseed_record_length(&w, c, 512, 0) == -1))
+      return 1;
+    sample_sequence(x[c], c);
+  }
+  for (j = 0; j < NSAMP; j++)
+    for (c = 0; c < NCHAN; c++)
+      write_mseed(&w, c, T0 + (NS0 + (double)j * DT) / 1e9, x[c][j]);
+  close_mseed(&w);
+
+  // the day volumes
+  for (c = 0; c < NCHAN; c++)
+  {
+    snprintf(path, sizeof(path), "%s/2025/291/XX.CHK.%s.%s.2025.291.mseed3", root, LI[c], CI[c]);
+    snprintf(ref, sizeof(ref), "%s/XX.CHK.%s.%s.2025.291.mseed3", refdir, LI[c], CI[c]);
+    check_volume(path, ref, c, x[c]);
+  }
+
+  snprintf(cmd, sizeof(cmd), "rm -rf %s", root);
+  system(cmd);
+
+  if (failures > 0)
+  {
+    printf("%i failures\n", failures);
+    return 1;
+  }
+  printf("miniSEED 3 volumes conform and match the references\n");
+  return 0;
+}
+
+int check_volume(const char *path, const char *ref, int c, const int32_t *x)
+{
+  unsigned char *p, *q;
+  long len, rlen, off, n;
+  int nrec = 0, done = 0, fail = failures;
+
+  p = read_file(path, &len);
+  if (p == NULL)
+    return failures++;
+
+  // byte for byte against the reference
+  if (rewrite)
+  {
+    if (write_file(ref, p, len) == -1)
+      failures++;
+  }
+  else if ((q = read_file(ref, &rlen)) == NULL)
+    failures++;
+  else
+  {
+    for (off = 0; (off < len) && (off < rlen) && (p[off] == q[off]); off++)
+      ;
+    if ((off < len) | (off < rlen))
+    {
+      printf("%s: differs from %s at byte %li (%li and %li bytes)\n", path, ref, off, len, rlen);
+      failures++;
+    }
+    free(q);
+  }
+
+  // record by record
+  for (off = 0; off < len; off += n, nrec++)
+  {
+    if (len - off < 40)
+    {
+      printf("%s: %li bytes left over at byte %li\n", path, len - off, off);
+      failures++;
+      break;
+    }
+    n = 40 + p[off+33] + (p[off+34] | (p[off+35] << 8)) + (long)get32le(p + off + 36);
+    if (off + n > len)
+    {
+      printf("%s: record at byte %li runs past the end\n", path, off);
+      failures++;
+      break;
+    }
+    if (check_record(p + off, n, c, x, &done) == -1)
+      printf("%s: record %i at byte %li\n", path, nrec + 1, off);
+  }
+  if (done != NSAMP)
+  {
+    printf("%s: %i samples, %i written\n", path, done, NSAMP);
+    failures++;
+  }
+  printf("%-32s %3i records %5i samples  %s\n", strrchr(path, '/') + 1, nrec, done, (failures == fail) ? "ok" : "FAILED");
+
+  free(p);
+  return 0;
+}
+
+int check_record(const unsigned char *rec, long len, int c, const int32_t *x, int *done)
+{
+  static unsigned char buf[8192];
+  static int32_t out[8192];
+  int64_t t_ns, want_ns;
+  int first = *done;
+  uint32_t crc, NoS, DL;
+  double SR;
+  int sidl, yr, doy, i;
+  long k;
+
+  // fixed header (little endian)
+  sidl = rec[33];
+  NoS = get32le(rec + 24);
+  DL = get32le(rec + 36);
+  *done += NoS;                       // (the next record carries on after these samples, whatever they hold)
+  memcpy(&SR, rec + 16, 8);
+  if ((memcmp(rec, "MS", 2) != 0) | (rec[2] != 3) | (rec[15] != EF[c]) | (SR != 20.0) | (rec[32] != 1) | (rec[34] != 0) | (rec[35] != 0))
+  {
+    printf("fixed header: %.2s FV %i EF %i SR %g PV %i EHL %i\n", rec, rec[2], rec[15], SR, rec[32], rec[34] | (rec[35] << 8));
+    failures++;
+    return -1;
+  }
+
+  // Source Identifier
+  if ((sidl != (int)strlen(SID[c])) || (memcmp(rec + 40, SID[c], sidl) != 0))
+  {
+    printf("Source Identifier %.*s, not %s\n", sidl, rec + 40, SID[c]);
+    failures++;
+    return -1;
+  }
+
+  // start time, to the nanosecond
+  yr = rec[8] | (rec[9] << 8);
+  doy = rec[10] | (rec[11] << 8);
+  t_ns = ((days_from_civil(yr, 1, 1) + doy - 1) * 86400 + rec[12] * 3600 + rec[13] * 60 + rec[14]) * (int64_t)1000000000 + get32le(rec + 4);
+  want_ns = (int64_t)T0 * 1000000000 + NS0 + (int64_t)first * DT;
+  if ((llabs(t_ns - want_ns) > 1000) | (get32le(rec + 4) > 999999999))
+  {
+    printf("start time %i:%03i:%02i:%02i:%02i.%09u, not %lli ns after the first sample\n", yr, doy, rec[12], rec[13], rec[14], get32le(rec + 4), (long long)(want_ns - T0 * (int64_t)1000000000 - NS0));
+    failures++;
+    return -1;
+  }
+
+  // CRC-32C with the CRC field zero
+  if (len > (long)sizeof(buf))
+  {
+    printf("record of %li bytes\n", len);
+    failures++;
+    return -1;
+  }
+  memcpy(buf, rec, len);
+  memset(buf + 28, 0, 4);
+  crc = crc32c_bitwise(buf, len);
+  if (crc != get32le(rec + 28))
+  {
+    printf("CRC field %08x, CRC-32C %08x\n", get32le(rec + 28), crc);
+    failures++;
+    return -1;
+  }
+
+  // the samples
+  if ((NoS == 0) | (first + (long)NoS > NSAMP))
+  {
+    printf("%u samples\n", NoS);
+    failures++;
+    return -1;
+  }
+  if (EF[c] == 3)
+  {
+    if (DL != 4 * NoS)
+    {
+      printf("%u bytes of data for %u int32 samples\n", DL, NoS);
+      failures++;
+      return -1;
+    }
+    for (k = 0; k < NoS; k++)
+      out[k] = (int32_t)get32le(rec + 40 + sidl + 4 * k);
+  }
+  else if ((DL % STEIM_FRAME != 0) || (steim_decode(rec + 40 + sidl, DL / STEIM_FRAME, EF[c] - 9, NoS, out) != (int)NoS))
+  {
+    printf("Steim-%i data of %u bytes don't decode to %u samples\n", EF[c] - 9, DL, NoS);
+    failures++;
+    return -1;
+  }
+  for (i = 0; i < (int)NoS; i++)
+    if (out[i] != x[first+i])
+    {
+      printf("sample %i is %i, not %i\n", first + i, out[i], x[first+i]);
+      failures++;
+      return -1;
+    }
+
+  return 0;
+}
+
+void sample_sequence(int32_t *x, int c)
+{
+  int j;
+
+  // a wave with a slow drift, a step, and a few wide jumps
+  for (j = 0; j < NSAMP; j++)
+  {
+    x[j] = (int32_t)lround(20000 * sin(0.05 * j * (c + 1)) + 3 * j) + ((j >= 700) ? 1000000 : 0);
+    if (j % 613 == 300)
+      x[j] += (c == 2) ? (1 << 30) : -(1 << 24);
+  }
+}
+
+unsigned char *read_file(const char *path, long *len)
+{
+  unsigned char *p;
+  FILE *fid;
+
+  fid = fopen(path, "rb");
+  if (fid == NULL)
+  {
+    perror(path);
+    return NULL;
+  }
+  fseek(fid, 0, SEEK_END);
+  *len = ftell(fid);
+  rewind(fid);
+  p = malloc(*len + 1);
+  if ((p == NULL) || (fread(p, 1, *len, fid) != (size_t)*len))
+  {
+    perror(path);
+    free(p);
+    fclose(fid);
+    return NULL;
+  }
+  fclose(fid);
+  return p;
+}
+
+int write_file(const char *path, const unsigned char *p, long len)
+{
+  FILE *fid;
+  char dir[400], *s;
+
+  snprintf(dir, sizeof(dir), "%s", path);
+  if ((s = strrchr(dir, '/')) != NULL)
+  {
+    *s = '\0';
+    mkdir(dir, 0755);
+  }
+  fid = fopen(path, "wb");
+  if ((fid == NULL) || (fwrite(p, 1, len, fid) != (size_t)len))
+  {
+    perror(path);
+    if (fid != NULL)
+      fclose(fid);
+    return -1;
+  }
+  fclose(fid);
+  printf("%s written\n", path);
+  return 0;
+}
+
+uint32_t crc32c_bitwise(const unsigned char *p, long len)
+{
+  uint32_t crc = 0xFFFFFFFF;
+  long i;
+  int b;
+
+  // reflected Castagnoli polynomial, one bit at a time
+  for (i = 0; i < len; i++)
+  {
+    crc ^= p[i];
+    for (b = 0; b < 8; b++)
+      crc = (crc >> 1) ^ (0x82F63B78 & (0 - (crc & 1)));
+  }
+  return ~crc;
+}
+
+int64_t days_from_civil(int y, int m, int d)
+{
+  int64_t era, yoe, doy, doe;
+
+  // days since 1970-01-01 of a proleptic Gregorian date (Howard Hinnant's algorithm)
+  y -= (m <= 2);
+  era = (y >= 0 ? y : y - 399) / 400;
+  yoe = y - era * 400;
+  doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+  doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + doe - 719468;
+}
+
+uint32_t get32le(const unsigned char *p)
+{
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
@@ -0,0 +1,7 @@
+#!/bin/bash
+
+echo -e "\nCompiling miniSEED 3 conformance check . . . \c"
+gcc mseed3_check.c mseed_writer.c io_batch.c steim.c spsc_ring.c -O2 -g -Wall -pthread -lm -o mseed3_check
+echo -e "done!\n"
+
+rm -f *~ > /dev/null
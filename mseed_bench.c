@@ -0,0 +1,407 @@
+// benchmark of the system calls the miniSEED writers make per sample
+//
+// by: Scott DeWolf
+//
+// Writes the 7 channels of the Closed TBECS TAPPT (2J.SBF2, SRF = 2,
+// SRM = -10, int32) once with the write_mseed() every *_daq.c program used to
+// carry, which builds the paths, stats and creates the directories, and opens,
+// seeks, writes and closes the day volume for every sample, and once with
+// mseed_writer.c, which does that only at a day rollover and otherwise adds
+// the sample to the record in memory. Each writer runs in a child process
+// traced with ptrace() to count its system calls (like strace -c), and again
+// untraced to time it. A few days are written so the rollovers are included.
+// The third run hands mseed_writer.c the 7 samples of each frame at once with
+// write_mseed_frame(), so the records and checkpoints written for a frame go
+// out in one batch (one io_uring_enter() where the kernel allows it). The
+// last run does the same with preallocated, memory-mapped day volumes.
+//
+// usage: ./mseed_bench [samples per channel] [directory for the day volumes]
+//
+//  created: Saturday, October 17, 2026 (2026290)
+// modified: Saturday, October 17, 2026 (2026290)
+//  history:
+//           [2026290] - created document
+//           [2026290] - added the write_mseed_frame() run
+//           [2026290] - added the mapped day volume run
+//           [2026290] - the batch counters come from mseed_io_stats()
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <signal.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/ptrace.h>
+#include <sys/wait.h>
+#include "mseed_writer.h"
+
+#define NCHAN 7
+
+// function definitions
+void run_old(const char *dir, int n);
+void run_new(const char *dir, int n);
+void run_frame(const char *dir, int n);
+void run_mapped(const char *dir, int n);
+void frames(const char *dir, int n, int mapped);
+long count_syscalls(void (*run)(const char *, int), const char *dir, int n);
+double time_run(void (*run)(const char *, int), const char *dir, int n);
+void old_write_mseed(char *LI, char *CI, uint16_t Yr, uint16_t DoY, uint8_t Hr, uint8_t Mn, uint8_t Sc, uint16_t S0001, double data, int chan_idx);
+void old_write_mseed_header(char *fn, int SqNu, char *LI, char *CI, uint16_t Yr, uint16_t DoY, uint8_t Hr, uint8_t Mn, uint8_t Sc, uint16_t S0001);
+void old_append_mseed(char *fn, int SqNu, uint16_t SpNu, double data);
+int old_last_mseed_seqnum(char *fn);
+double elapsed(struct timespec *t0);
+
+// global constants
+const int16_t SRF = 2;                // Sample Rate Factor
+const int16_t SRM = -10;              // Sample Rate Mutiplier
+const uint8_t EF = 3;                 // Encoding Format (3 = 32-bit signed integer)
+const double t_start = 1792195200;    // 2026:290:00:00:00
+char *CI[NCHAN] = {"VAX", "VAY", "VS1", "VS2", "VS3", "VSZ", "VKD"};
+
+// global variables for writing to miniSEED volumes (old write_mseed)
+const int NumSamp[7] = {1008,1008,1008,1008,1008,1008,1008}; // (Record Length - Header Size) / Data Size = (2^12 - 64) / sizeof(data)
+int SeqNum[7] = {0,0,0,0,0,0,0}, SampNum[7] = {1,1,1,1,1,1,1};
+char root[200];
+
+int main(int argc, char **argv)
+{
+  int n = (argc > 1) ? atoi(argv[1]) : 50000;
+  const char *dir = (argc > 2) ? argv[2] : "/tmp/mseed_bench";
+  char path[300];
+  long c_old, c_new, c_frame, c_mapped;
+  double t_old, t_new, t_frame, t_mapped;
+
+  if ((mkdir(dir, 0755) == -1) & (errno != EEXIST))
+  {
+    perror(dir);
+    return 1;
+  }
+
+  // each run writes to its own, empty directory
+  snprintf(path, sizeof(path), "%s/old_traced", dir);
+  c_old = count_syscalls(run_old, path, n);
+  snprintf(path, sizeof(path), "%s/new_traced", dir);
+  c_new = count_syscalls(run_new, path, n);
+  snprintf(path, sizeof(path), "%s/frame_traced", dir);
+  c_frame = count_syscalls(run_frame, path, n);
+  snprintf(path, sizeof(path), "%s/mapped_traced", dir);
+  c_mapped = count_syscalls(run_mapped, path, n);
+  snprintf(path, sizeof(path), "%s/old", dir);
+  t_old = time_run(run_old, path, n);
+  snprintf(path, sizeof(path), "%s/new", dir);
+  t_new = time_run(run_new, path, n);
+  snprintf(path, sizeof(path), "%s/frame", dir);
+  t_frame = time_run(run_frame, path, n);
+  snprintf(path, sizeof(path), "%s/mapped", dir);
+  t_mapped = time_run(run_mapped, path, n);
+  if ((c_old < 0) | (c_new < 0) | (c_frame < 0) | (c_mapped < 0))
+    return 1;
+
+  printf("%i samples of %i channels (%0.1f days at %0.1f Hz), day volumes in %s\n", n, NCHAN, n / 0.2 / 86400, 0.2, dir);
+  printf("  old write_mseed: %8.2f system calls/sample  %8.2f us/sample\n", (double)c_old / (n * NCHAN), 1e6 * t_old / (n * NCHAN));
+  printf("  mseed_writer:    %8.4f system calls/sample  %8.2f us/sample  (%0.0fx fewer calls)\n", (double)c_new / (n * NCHAN), 1e6 * t_new / (n * NCHAN), (double)c_old / c_new);
+  printf("  write_mseed_frame: %6.4f system calls/sample  %8.2f us/sample  (%0.0fx fewer calls)\n", (double)c_frame / (n * NCHAN), 1e6 * t_frame / (n * NCHAN), (double)c_old / c_frame);
+  printf("  mapped volumes:    %6.4f system calls/sample  %8.2f us/sample  (%0.0fx fewer calls)\n", (double)c_mapped / (n * NCHAN), 1e6 * t_mapped / (n * NCHAN), (double)c_old / c_mapped);
+  return 0;
+}
+
+void run_old(const char *dir, int n)
+{
+  time_t t_temp;
+  struct tm tt;
+  double t;
+  int c, i;
+
+  snprintf(root, sizeof(root), "%s", dir);
+  mkdir(root, 0755);
+  for (i = 0; i < n; i++)
+  {
+    t = t_start + i / 0.2;
+    t_temp = (time_t)t;
+    gmtime_r(&t_temp, &tt);
+    for (c = 0; c < NCHAN; c++)
+      old_write_mseed("E1", CI[c], (uint16_t)tt.tm_year+1900, (uint16_t)tt.tm_yday+1, (uint8_t)tt.tm_hour, (uint8_t)tt.tm_min, (uint8_t)tt.tm_sec, 0, 1000 * c + i % 1000, c);
+  }
+}
+
+void run_new(const char *dir, int n)
+{
+  mseed_writer ms;
+  double t;
+  int c, i;
+
+  mkdir(dir, 0755);
+  mseed_init(&ms, dir, "2J", "SBF2", SRF, SRM, 60);
+  for (c = 0; c < NCHAN; c++)
+    mseed_add_channel(&ms, "E1", CI[c], EF);
+  for (i = 0; i < n; i++)
+  {
+    t = t_start + i / 0.2;
+    for (c = 0; c < NCHAN; c++)
+      write_mseed(&ms, c, t, 1000 * c + i % 1000);
+  }
+  close_mseed(&ms);
+}
+
+void run_frame(const char *dir, int n)
+{
+  frames(dir, n, 0);
+}
+
+void run_mapped(const char *dir, int n)
+{
+  frames(dir, n, 1);
+}
+
+void frames(const char *dir, int n, int mapped)
+{
+  mseed_writer ms;
+  double t, data[NCHAN];
+  unsigned long ops, batches, calls;
+  const char *path;
+  int c, i;
+
+  mkdir(dir, 0755);
+  mseed_init(&ms, dir, "2J", "SBF2", SRF, SRM, 60);
+  if (mapped)
+    mseed_map_volumes(&ms);
+  for (c = 0; c < NCHAN; c++)
+    mseed_add_channel(&ms, "E1", CI[c], EF);
+  for (i = 0; i < n; i++)
+  {
+    t = t_start + i / 0.2;
+    for (c = 0; c < NCHAN; c++)
+      data[c] = 1000 * c + i % 1000;
+    write_mseed_frame(&ms, 0, NCHAN, t, data);
+  }
+  mseed_io_stats(&ms, &ops, &batches, &calls, &path);
+  fprintf(stderr, "%lu record and checkpoint writes in %lu batches, %lu system calls (%s)\n", ops, batches, calls, path);
+  close_mseed(&ms);
+}
+
+long count_syscalls(void (*run)(const char *, int), const char *dir, int n)
+{
+  long stops = 0;
+  pid_t pid;
+  int status;
+
+  pid = fork();
+  if (pid == -1)
+  {
+    perror("fork");
+    return -1;
+  }
+
+  // the child stops until the parent traces it, runs the writer and exits
+  if (pid == 0)
+  {
+    ptrace(PTRACE_TRACEME, 0, NULL, NULL);
+    raise(SIGSTOP);
+    run(dir, n);
+    _exit(0);
+  }
+
+  // every system call stops the child twice (entry and exit)
+  waitpid(pid, &status, 0);
+  ptrace(PTRACE_SETOPTIONS, pid, NULL, (void *)PTRACE_O_TRACESYSGOOD);
+  while (1)
+  {
+    if (ptrace(PTRACE_SYSCALL, pid, NULL, NULL) == -1)
+    {
+      perror("ptrace");
+      return -1;
+    }
+    if ((waitpid(pid, &status, 0) == -1) || (WIFEXITED(status)))
+      break;
+    if ((WIFSTOPPED(status)) && (WSTOPSIG(status) == (SIGTRAP | 0x80)))
+      stops++;
+  }
+
+  return stops / 2;
+}
+
+double time_run(void (*run)(const char *, int), const char *dir, int n)
+{
+  struct timespec t0;
+
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  run(dir, n);
+  return elapsed(&t0);
+}
+
+void old_write_mseed(char *LI, char *CI, uint16_t Yr, uint16_t DoY, uint8_t Hr, uint8_t Mn, uint8_t Sc, uint16_t S0001, double data, int chan_idx)
+{
+  // variables for making yearday filename and year/day directory
+  struct stat st = {0};
+  char path[300];
+  char fn[400];
+
+  // create /home/station/Data/yyyy path if it is not present
+  sprintf(path, "%s/%4i", root, Yr);
+  if (stat(path, &st) == -1)
+    mkdir(path, 0755);
+
+  // create /home/station/LabJack/data/yyyy/ddd path if it is not present
+  sprintf(path, "%s/%4i/%03i", root, Yr, DoY);
+  if (stat(path, &st) == -1)
+    mkdir(path, 0755);
+
+  // create full path and filename
+  sprintf(fn, "%s/2J.SBF2.%s.%s.%i.%03i.mseed", path, LI, CI, Yr, DoY);
+
+  // the file doesn't exist, i.e., this is the first time writing to a new file:
+  // 1) on startup
+  // 2) at the beginning of a new day
+  // 3) or it was deleted during data acquisition (how rude!)
+  if ( (stat(fn, &st) == -1) )
+  {
+    SeqNum[chan_idx] = 1;
+    SampNum[chan_idx] = 1;
+    old_write_mseed_header(fn, SeqNum[chan_idx], LI, CI, Yr, DoY, Hr, Mn, Sc, S0001);
+    old_append_mseed(fn, SeqNum[chan_idx], (uint16_t)SampNum[chan_idx], data);
+    SampNum[chan_idx]++;
+  }
+  // the file exists but SeqNum = 0, e.g., data acquisition is restarted during a given day
+  else if ( (stat(fn, &st) == 0) & (SeqNum[chan_idx] == 0) )
+  {
+    SeqNum[chan_idx] = old_last_mseed_seqnum(fn);
+    old_write_mseed_header(fn, SeqNum[chan_idx], LI, CI, Yr, DoY, Hr, Mn, Sc, S0001);
+    old_append_mseed(fn, SeqNum[chan_idx], (uint16_t)SampNum[chan_idx], data);
+    SampNum[chan_idx]++;
+  }
+  // the first sample to be written to a new data record block
+  else if (SampNum[chan_idx] == 1)
+  {
+    old_write_mseed_header(fn, SeqNum[chan_idx], LI, CI, Yr, DoY, Hr, Mn, Sc, S0001);
+    old_append_mseed(fn, SeqNum[chan_idx], (uint16_t)SampNum[chan_idx], data);
+    SampNum[chan_idx]++;
+  }
+  // the last sample to be written to an existing data record block
+  else if (SampNum[chan_idx] == NumSamp[chan_idx])
+  {
+    old_append_mseed(fn, SeqNum[chan_idx], (uint16_t)SampNum[chan_idx], data);
+    SeqNum[chan_idx]++;
+    SampNum[chan_idx] = 1;
+  }
+  // just a normal file write, i.e., adding data to the end of data record block in an existing file
+  else // if (SampNum[chan_idx] < NumSamp)
+  {
+    old_append_mseed(fn, SeqNum[chan_idx], (uint16_t)SampNum[chan_idx], data);
+    SampNum[chan_idx]++;
+  }
+}
+
+void old_write_mseed_header(char *fn, int SqNu, char *LI, char *CI, uint16_t Yr, uint16_t DoY, uint8_t Hr, uint8_t Mn, uint8_t Sc, uint16_t S0001)
+{
+  // create (if necessary) and open file, scan to the end, write zeros, and rewind
+  FILE *fid;
+  struct stat st = {0};
+  if (stat(fn, &st) == -1)
+    fid = fopen(fn, "w+");
+  else
+    fid = fopen(fn, "r+");
+  fseek(fid, (SqNu-1)*4096, SEEK_SET);
+  char buff[4096] = {0};
+  fwrite(buff, 1, 4096, fid);
+  fseek(fid, (SqNu-1)*4096, SEEK_SET);
+
+  // Fixed Section of Data Header (48 bytes)
+  fprintf(fid, "%06i", SqNu);            // Sequence Number
+  fprintf(fid, "D");                     // Data Quality Indicator
+  fprintf(fid, " ");                     // Reserved Byte
+  fprintf(fid, "SBF2 ");                 // Station Identifier Code
+  fprintf(fid, "%s", LI);                // Location Identifier
+  fprintf(fid, "%s", CI);                // Channel Identifier
+  fprintf(fid, "2J");                    // Network Code
+  fwrite(&Yr, sizeof(Yr), 1, fid);       // Year
+  fwrite(&DoY, sizeof(DoY), 1, fid);     // Day of Year
+  fwrite(&Hr, sizeof(Hr), 1, fid);       // Hours
+  fwrite(&Mn, sizeof(Mn), 1, fid);       // Minutes
+  fwrite(&Sc, sizeof(Sc), 1, fid);       // Seconds
+  fprintf(fid, " ");                     // Skip 1 Byte (unused)
+  fwrite(&S0001, sizeof(S0001), 1, fid); // Seconds0001 (why not microseconds?)
+  uint16_t NoS = 0;
+  fwrite(&NoS, sizeof(NoS), 1, fid);     // Number of Samples (none so far...)
+  fwrite(&SRF, sizeof(SRF), 1, fid);     // Sample Rate Factor
+  fwrite(&SRM, sizeof(SRM), 1, fid);     // Sample Rate Multiplier
+  uint8_t AID = 0;
+  fwrite(&AID, sizeof(AID), 1, fid);     // Activity Flags
+  fwrite(&AID, sizeof(AID), 1, fid);     // IO Flags
+  fwrite(&AID, sizeof(AID), 1, fid);     // Data Quality Flags
+  uint8_t NBF = 1;
+  fwrite(&NBF, sizeof(NBF), 1, fid);     // Number Blockettes to Follow
+  int32_t TC = 0;
+  fwrite(&TC, sizeof(TC), 1, fid);       // Time Correction
+  uint16_t OBD = 64;
+  fwrite(&OBD, sizeof(OBD), 1, fid);     // Offset to the Beginning of Data
+  uint16_t OFB = 48;
+  fwrite(&OFB, sizeof(OFB), 1, fid);     // Offset to the First Blockette
+  uint16_t BT = 1000;
+  fwrite(&BT, sizeof(BT), 1, fid);       // Blockette Type
+
+  // [1000] Data Only SEED Blockette (8 bytes)
+  uint16_t ONB = 0;
+  fwrite(&ONB, sizeof(ONB), 1, fid);     // Offset to the Next Blockette
+  fwrite(&EF, sizeof(EF), 1, fid);       // Encoding Format
+  uint8_t WO = 0;
+  fwrite(&WO, sizeof(WO), 1, fid);       // Word Order (0 = little endian)
+  uint8_t DRL = 12;
+  fwrite(&DRL, sizeof(DRL), 1, fid);     // Data Record Length (12, since 2^12 = 4096)
+  uint8_t Res = 0;
+  fwrite(&Res, sizeof(Res), 1, fid);     // Reserved
+
+  // close file
+  fclose(fid);
+}
+
+void old_append_mseed(char *fn, int SqNu, uint16_t SpNu, double data)
+{
+  // open file
+  FILE *fid;
+  fid = fopen(fn, "r+");
+
+  // seek to and update sample number in header block
+  fseek(fid, (SqNu-1)*4096+30, SEEK_SET);
+  fwrite(&SpNu, sizeof(SpNu), 1, fid);
+
+  // convert double to int32
+  int32_t data32;
+  data32 = (int32_t)data;
+
+  // seek to and write latest sample to data block
+  fseek(fid, (SqNu-1)*4096+64+(SpNu-1)*sizeof(data32), SEEK_SET);
+  fwrite(&data32, sizeof(data32), 1, fid);
+
+  // close file
+  fclose(fid);
+}
+
+int old_last_mseed_seqnum(char *fn)
+{
+  // open file and seek to the end
+  FILE *fid;
+  fid = fopen(fn, "r");
+  fseek(fid, 0, SEEK_END);
+
+  // compute new Sequence Number from file size and Data Record Length
+  int SqNu;
+  SqNu = ftell(fid) / 4096 + 1;
+
+  // close file and return Sequence Number
+  fclose(fid);
+  return SqNu;
+}
+
+double elapsed(struct timespec *t0)
+{
+  struct timespec t1;
+
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  return (double)(t1.tv_sec - t0->tv_sec) + (double)(t1.tv_nsec - t0->tv_nsec) / 1000000000;
+}
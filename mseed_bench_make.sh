@@ -0,0 +1,7 @@
+#!/bin/bash
+
+echo -e "\nCompiling miniSEED writer system call benchmark . . . \c"
+gcc mseed_bench.c mseed_writer.c io_batch.c steim.c spsc_ring.c -O2 -g -Wall -pthread -lm -o mseed_bench
+echo -e "done!\n"
+
+rm -f *~ > /dev/null
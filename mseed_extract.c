@@ -0,0 +1,113 @@
+// extraction of a time window of miniSEED channels
+//
+// by: Scott DeWolf
+//
+// Writes the records of the channels named that hold samples of the window
+// (start, start + seconds) to stdout, one channel after another, as a
+// miniSEED file any reader takes (the first and last record of a channel may
+// reach outside the window). The day volumes are searched with their time
+// indexes where they have one (see mseed_read.c), so a 10 minute window of a
+// few channels takes a few reads however long the volumes are.
+//
+// usage: ./mseed_extract root start seconds NC.SIC.LI.CI ... > window.mseed
+//        ./mseed_extract /home/avn4/Data 2026:290:13:55:00 600 2J.AVN4.P1.BS1 2J.AVN4.X1.AYX > event.mseed
+//
+// start is yyyy:ddd:hh:mm:ss[.ffffff] (UTC) or epoch seconds.
+//
+//  created: Saturday, October 17, 2026 (2026290)
+// modified: Saturday, October 17, 2026 (2026290)
+//  history:
+//           [2026290] - created document
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "mseed_read.h"
+
+// function definitions
+int put_record(void *arg, const char *path, const unsigned char *rec, int len);
+int parse_time(const char *s, double *t);
+double elapsed(struct timespec *t0);
+
+int main(int argc, char **argv)
+{
+  struct timespec t0;
+  char id[64], *code[4], *p;
+  double start, seconds;
+  long n, total = 0;
+  int i, k;
+
+  if ((argc < 5) || (parse_time(argv[2], &start) == -1) || (sscanf(argv[3], "%lf", &seconds) != 1) || (seconds <= 0))
+  {
+    fprintf(stderr, "usage: %s root start seconds NC.SIC.LI.CI ... > window.mseed\n", argv[0]);
+    fprintf(stderr, "       (start as yyyy:ddd:hh:mm:ss[.ffffff] or epoch seconds)\n");
+    return 2;
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  for (i = 4; i < argc; i++)
+  {
+    // NC.SIC.LI.CI (an empty location is allowed)
+    snprintf(id, sizeof(id), "%s", argv[i]);
+    p = id;
+    for (k = 0; (k < 4) & (p != NULL); k++)
+      code[k] = strsep(&p, ".");
+    if ((k < 4) | (p != NULL))
+    {
+      fprintf(stderr, "%s: not NC.SIC.LI.CI\n", argv[i]);
+      return 2;
+    }
+
+    n = mseed_extract(argv[1], code[0], code[1], code[2], code[3], start, start + seconds, put_record, stdout);
+    if (n == -1)
+      return 1;
+    fprintf(stderr, "%s: %li records\n", argv[i], n);
+    total += n;
+  }
+  fprintf(stderr, "%li records in %.3f s\n", total, elapsed(&t0));
+
+  return (total > 0) ? 0 : 1;
+}
+
+int put_record(void *arg, const char *path, const unsigned char *rec, int len)
+{
+  if (fwrite(rec, 1, len, arg) != (size_t)len)
+  {
+    perror("mseed_extract");
+    return -1;
+  }
+  return 0;
+}
+
+int parse_time(const char *s, double *t)
+{
+  struct tm tt = {0};
+  double sec;
+  char *end;
+  int yr, doy, hr, mn;
+
+  // yyyy:ddd:hh:mm:ss[.ffffff]
+  if (sscanf(s, "%d:%d:%d:%d:%lf", &yr, &doy, &hr, &mn, &sec) == 5)
+  {
+    tt.tm_year = yr - 1900;
+    tt.tm_mday = doy;                   // timegm() normalizes day doy of January
+    tt.tm_hour = hr;
+    tt.tm_min = mn;
+    *t = (double)timegm(&tt) + sec;
+    return 0;
+  }
+
+  // or epoch seconds
+  *t = strtod(s, &end);
+  return ((end == s) | (*end != '\0')) ? -1 : 0;
+}
+
+double elapsed(struct timespec *t0)
+{
+  struct timespec t1;
+
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  return (t1.tv_sec - t0->tv_sec) + 1e-9 * (t1.tv_nsec - t0->tv_nsec);
+}
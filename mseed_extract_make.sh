@@ -0,0 +1,7 @@
+#!/bin/bash
+
+echo -e "\nCompiling miniSEED time window extraction . . . \c"
+gcc mseed_extract.c mseed_read.c steim.c -O2 -g -Wall -lm -o mseed_extract
+echo -e "done!\n"
+
+rm -f *~ > /dev/null
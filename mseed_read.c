@@ -0,0 +1,355 @@
+// reading time windows out of the miniSEED day volumes
+//
+// by: Scott DeWolf
+//
+// A day volume is a run of records in time order, so the records of a time
+// window are a run of consecutive records. The time index the writer keeps
+// next to a volume (mseed_index_volumes()) has a fixed-size entry per record
+// with its start time, end time and place in the volume; it is mapped and
+// binary searched for the first record ending after the start of the window,
+// which touches a handful of its pages, and the run of records from there to
+// the last one starting before the end of the window is read with one
+// pread() per MAX_RUN bytes. Entries past the end of the volume (written
+// before a record that didn't make it to the disk) are left out the same way.
+//
+// Records after the last indexed one (a tail record appended to its volume
+// on the next day, or a volume written without an index) are found by walking
+// their headers, as every reader had to before.
+//
+// mseed_decode() turns a record found this way back into its samples, so a
+// program can reprocess archived channels (threefringe_reprocess).
+//
+//  created: Saturday, October 17, 2026 (2026290)
+// modified: Saturday, October 17, 2026 (2026290)
+//  history:
+//           [2026290] - created document
+//           [2026290] - added mseed_decode()
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stddef.h>
+#include <math.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "mseed_read.h"
+
+#define MAX_RUN (1 << 20)  // most bytes read with one pread()
+
+// local function definitions
+static long extract_volume(const char *path, int fd, off_t size, int v3, double t0, double t1, mseed_extract_fn fn, void *arg);
+static long extract_run(const char *path, int fd, const mseed_index *e, int n, mseed_extract_fn fn, void *arg);
+static int header_entry(const unsigned char *h, int v3, off_t off, mseed_index *e, double *fs);
+static double get_sample(const unsigned char *p, int EF, int big);
+static double sample_rate(int16_t SRF, int16_t SRM);
+static uint16_t get16(const unsigned char *p, int big);
+static uint32_t get32(const unsigned char *p, int big);
+static uint64_t get64(const unsigned char *p, int big);
+
+long mseed_extract(const char *root, const char *NC, const char *SIC, const char *LI, const char *CI,
+                   double t0, double t1, mseed_extract_fn fn, void *arg)
+{
+  struct stat st;
+  struct tm tt;
+  time_t t_temp;
+  char path[400];
+  long n = 0, k;
+  int day, v3, fd;
+
+  // every day the window touches
+  for (day = (int)floor(t0 / 86400); 86400.0 * day < t1; day++)
+  {
+    t_temp = (time_t)day * 86400;
+    gmtime_r(&t_temp, &tt);
+
+    // root/yyyy/ddd/NC.SIC.LI.CI.yyyy.ddd.mseed, or .mseed3
+    for (v3 = 0; v3 < 2; v3++)
+    {
+      snprintf(path, sizeof(path), "%s/%4i/%03i/%s.%s.%s.%s.%i.%03i.%s", root, tt.tm_year + 1900, tt.tm_yday + 1,
+               NC, SIC, LI, CI, tt.tm_year + 1900, tt.tm_yday + 1, (v3) ? "mseed3" : "mseed");
+      fd = open(path, O_RDONLY);
+      if (fd != -1)
+        break;
+    }
+    if (fd == -1)
+      continue;
+
+    k = (fstat(fd, &st) == 0) ? extract_volume(path, fd, st.st_size, v3, t0, t1, fn, arg) : 0;
+    close(fd);
+    if (k == -1)
+      return -1;
+    n += k;
+  }
+
+  return n;
+}
+
+int mseed_decode(const unsigned char *rec, int len, double *t, double *fs, double *x, int max)
+{
+  int32_t d[MSEED_MAX_NOS];
+  mseed_index e;
+  const unsigned char *data;
+  int v3, EF, big, ndata, size, i;
+
+  // the header (as the writers lay it out: blockette 1000 right after the fixed section)
+  v3 = (len >= MSEED3_HDRLEN) && (memcmp(rec, "MS\3", 3) == 0);
+  if ((len < ((v3) ? MSEED3_HDRLEN : MSEED_HDRLEN)) || (header_entry(rec, v3, 0, &e, fs) == -1) || (e.len > len) || (e.NoS > max))
+    return -1;
+  *t = e.t;
+  if (v3)
+  {
+    EF = rec[offsetof(mseed3_header, EF)];
+    big = 0;
+    ndata = get32(rec + offsetof(mseed3_header, DL), 0);
+  }
+  else
+  {
+    big = (get16(rec + offsetof(mseed_header, Yr), 0) > 2100);
+    ndata = e.len - get16(rec + offsetof(mseed_header, OBD), big);
+    EF = rec[offsetof(mseed_header, EF)];
+    big = (rec[offsetof(mseed_header, WO)] == 1);
+  }
+  if ((ndata < 0) | (ndata > e.len))
+    return -1;
+  data = rec + e.len - ndata;
+
+  // Steim frames (always big endian)
+  if ((EF == 10) | (EF == 11))
+  {
+    if ((ndata % STEIM_FRAME != 0) || (steim_decode(data, ndata / STEIM_FRAME, EF - 9, e.NoS, d) != e.NoS))
+      return -1;
+    for (i = 0; i < e.NoS; i++)
+      x[i] = d[i];
+    return e.NoS;
+  }
+
+  // fixed-size samples in the Word Order of the record
+  size = (EF == 1) ? 2 : ((EF == 3) | (EF == 4)) ? 4 : (EF == 5) ? 8 : 0;
+  if ((size == 0) || (e.NoS * size > ndata))
+    return -1;
+  for (i = 0; i < e.NoS; i++)
+    x[i] = get_sample(data + i * size, EF, big);
+  return e.NoS;
+}
+
+static long extract_volume(const char *path, int fd, off_t size, int v3, double t0, double t1, mseed_extract_fn fn, void *arg)
+{
+  unsigned char h[MSEED_HDRLEN];
+  const mseed_index *e = NULL;
+  mseed_index rec;
+  struct stat st;
+  char fn_idx[420];
+  double fs;
+  size_t maplen = 0;
+  off_t off = 0;
+  long n = 0, k;
+  int ifd, lo = 0, hi = 0, mid, first, last;
+
+  // the index, as far as its records are in the volume
+  snprintf(fn_idx, sizeof(fn_idx), "%s.idx", path);
+  ifd = open(fn_idx, O_RDONLY);
+  if ((ifd != -1) && (fstat(ifd, &st) == 0) && (st.st_size >= (off_t)sizeof(mseed_index)))
+  {
+    maplen = st.st_size - st.st_size % sizeof(mseed_index);
+    e = mmap(NULL, maplen, PROT_READ, MAP_SHARED, ifd, 0);
+    if (e == MAP_FAILED)
+      e = NULL;
+  }
+  if (ifd != -1)
+    close(ifd);
+  if (e != NULL)
+  {
+    hi = (int)(maplen / sizeof(mseed_index));
+    while (lo < hi)
+    {
+      mid = (lo + hi) / 2;
+      if ((memcmp(e[mid].magic, "MSIX", 4) == 0) && (e[mid].SeqNum == mid + 1) && (e[mid].off + e[mid].len <= size))
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+    last = lo;
+
+    // the first record ending after t0, and the run up to the last one starting before t1
+    lo = 0;
+    hi = last;
+    while (lo < hi)
+    {
+      mid = (lo + hi) / 2;
+      if (e[mid].t_end <= t0)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+    first = lo;
+    for (mid = first; (mid < last) && (e[mid].t < t1); mid++);
+    if (mid > first)
+      n = extract_run(path, fd, e + first, mid - first, fn, arg);
+    if (last > 0)
+      off = e[last - 1].off + e[last - 1].len;
+    munmap((void *)e, maplen);
+    if (n == -1)
+      return -1;
+  }
+
+  // the records after the index, by their headers
+  while ((off < size) && (pread(fd, h, sizeof(h), off) >= ((v3) ? MSEED3_HDRLEN : 48)) &&
+         (header_entry(h, v3, off, &rec, &fs) == 0) && (off + rec.len <= size))
+  {
+    if ((rec.t_end > t0) & (rec.t < t1))
+    {
+      k = extract_run(path, fd, &rec, 1, fn, arg);
+      if (k == -1)
+        return -1;
+      n += k;
+    }
+    off += rec.len;
+  }
+
+  return n;
+}
+
+static long extract_run(const char *path, int fd, const mseed_index *e, int n, mseed_extract_fn fn, void *arg)
+{
+  unsigned char *buf;
+  off_t start;
+  size_t len;
+  int i, j, k;
+
+  buf = malloc(MAX_RUN + MSEED_MAX_RECLEN);
+  if (buf == NULL)
+  {
+    perror("mseed_extract");
+    return 0;
+  }
+
+  // consecutive records are read together, up to MAX_RUN bytes at a time
+  for (i = 0; i < n; i = j)
+  {
+    start = e[i].off;
+    for (j = i + 1; (j < n) && (e[j].off == e[j - 1].off + e[j - 1].len) && (e[j].off + e[j].len - start <= MAX_RUN); j++);
+    len = e[j - 1].off + e[j - 1].len - start;
+    if (pread(fd, buf, len, start) != (ssize_t)len)
+    {
+      perror(path);
+      break;
+    }
+    for (k = i; k < j; k++)
+    {
+      if (fn(arg, path, buf + (e[k].off - start), e[k].len) == -1)
+      {
+        free(buf);
+        return -1;
+      }
+    }
+  }
+
+  free(buf);
+  return i;
+}
+
+static int header_entry(const unsigned char *h, int v3, off_t off, mseed_index *e, double *fs)
+{
+  struct tm tt = {0};
+  int big;
+
+  memset(e, 0, sizeof(*e));
+  e->off = off;
+
+  // miniSEED 3: the record gives its length and the rate
+  if (v3)
+  {
+    if (memcmp(h, "MS\3", 3) != 0)
+      return -1;
+    e->len = MSEED3_HDRLEN + h[offsetof(mseed3_header, SIDL)] + get16(h + offsetof(mseed3_header, EHL), 0) + get32(h + offsetof(mseed3_header, DL), 0);
+    e->NoS = get32(h + offsetof(mseed3_header, NoS), 0);
+    memcpy(fs, h + offsetof(mseed3_header, SR), sizeof(*fs));
+    *fs = (*fs < 0) ? -1 / *fs : *fs;
+    tt.tm_year = get16(h + offsetof(mseed3_header, Yr), 0) - 1900;
+    tt.tm_mday = get16(h + offsetof(mseed3_header, DoY), 0);
+    tt.tm_hour = h[offsetof(mseed3_header, Hr)];
+    tt.tm_min = h[offsetof(mseed3_header, Mn)];
+    tt.tm_sec = h[offsetof(mseed3_header, Sc)];
+    e->t = (double)timegm(&tt) + get32(h + offsetof(mseed3_header, NS), 0) / 1e9;
+  }
+
+  // miniSEED 2: blockette 1000 gives the length (a zero-filled record ends the volume)
+  else
+  {
+    if ((h[0] == 0) | (h[offsetof(mseed_header, DRL)] < 8) | (h[offsetof(mseed_header, DRL)] > 16))
+      return -1;
+    big = (get16(h + offsetof(mseed_header, Yr), 0) > 2100);
+    e->len = 1 << h[offsetof(mseed_header, DRL)];
+    e->NoS = get16(h + offsetof(mseed_header, NoS), big);
+    *fs = sample_rate((int16_t)get16(h + offsetof(mseed_header, SRF), big), (int16_t)get16(h + offsetof(mseed_header, SRM), big));
+    tt.tm_year = get16(h + offsetof(mseed_header, Yr), big) - 1900;
+    tt.tm_mday = get16(h + offsetof(mseed_header, DoY), big);
+    tt.tm_hour = h[offsetof(mseed_header, Hr)];
+    tt.tm_min = h[offsetof(mseed_header, Mn)];
+    tt.tm_sec = h[offsetof(mseed_header, Sc)];
+    e->t = (double)timegm(&tt) + get16(h + offsetof(mseed_header, S0001), big) / 10000.0;
+  }
+
+  if (!(*fs > 0))
+    return -1;
+  e->t_end = e->t + e->NoS / *fs;
+  return 0;
+}
+
+static double get_sample(const unsigned char *p, int EF, int big)
+{
+  uint32_t u32;
+  uint64_t u64;
+  float f32;
+  double f64;
+
+  switch (EF)
+  {
+    case 1:
+      return (int16_t)get16(p, big);
+    case 3:
+      return (int32_t)get32(p, big);
+    case 4:
+      u32 = get32(p, big);
+      memcpy(&f32, &u32, sizeof(f32));
+      return f32;
+  }
+  u64 = get64(p, big);
+  memcpy(&f64, &u64, sizeof(f64));
+  return f64;
+}
+
+static double sample_rate(int16_t SRF, int16_t SRM)
+{
+  // as mseed_add_station() has it
+  if ((SRF > 0) & (SRM > 0))
+    return (double)SRF * (double)SRM;
+  if ((SRF > 0) & (SRM < 0))
+    return -1 * (double)SRF / (double)SRM;
+  if ((SRF < 0) & (SRM > 0))
+    return -1 * (double)SRM / (double)SRF;
+  if ((SRF < 0) & (SRM < 0))
+    return 1 / ((double)SRF * (double)SRM);
+  return 0;
+}
+
+static uint16_t get16(const unsigned char *p, int big)
+{
+  return (big) ? (uint16_t)(p[0] << 8 | p[1]) : (uint16_t)(p[1] << 8 | p[0]);
+}
+
+static uint32_t get32(const unsigned char *p, int big)
+{
+  return (big) ? (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3]
+               : (uint32_t)p[3] << 24 | (uint32_t)p[2] << 16 | (uint32_t)p[1] << 8 | p[0];
+}
+
+static uint64_t get64(const unsigned char *p, int big)
+{
+  return (big) ? (uint64_t)get32(p, 1) << 32 | get32(p + 4, 1) : (uint64_t)get32(p + 4, 0) << 32 | get32(p, 0);
+}
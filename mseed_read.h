@@ -0,0 +1,39 @@
+// reading time windows out of the miniSEED day volumes
+//
+// by: Scott DeWolf
+//
+//  created: Saturday, October 17, 2026 (2026290)
+// modified: Saturday, October 17, 2026 (2026290)
+//  history:
+//           [2026290] - created document
+//           [2026290] - added mseed_decode()
+//
+
+#ifndef MSEED_READ_H
+#define MSEED_READ_H
+
+#include "mseed_writer.h"
+
+#define MSEED_MAX_NOS (MSEED_MAX_RECLEN / STEIM_FRAME * 105) // most samples of a record (Steim-2, 7 per word)
+
+// called with each record of a window (only valid during the call) and the
+// day volume it is in; returning -1 stops the extraction
+typedef int (*mseed_extract_fn)(void *arg, const char *path, const unsigned char *rec, int len);
+
+// hand fn the records of channel NC.SIC.LI.CI under root (as the writer was
+// given them) that hold samples from t0 up to t1 (epoch seconds), day volume
+// by day volume and in record order. The records are found with a binary
+// search of the time index of each volume (mseed_index_volumes()) where there
+// is one, read with one pread() per run of records, and, after the last
+// indexed record (or in a volume without an index), found by their headers.
+// Returns the number of records, or -1 if fn stopped the extraction.
+long mseed_extract(const char *root, const char *NC, const char *SIC, const char *LI, const char *CI,
+                   double t0, double t1, mseed_extract_fn fn, void *arg);
+
+// the samples of a record of len bytes (either format, any encoding the
+// writer uses) as doubles in x, its start time and its sample rate (Hz);
+// returns the Number of Samples, or -1 if the record can't be decoded or
+// holds more than max samples
+int mseed_decode(const unsigned char *rec, int len, double *t, double *fs, double *x, int max);
+
+#endif
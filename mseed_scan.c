@@ -0,0 +1,705 @@
+// validator and gap scanner of miniSEED day volumes
+//
+// by: Scott DeWolf
+//
+// Checks the day volumes the writers leave behind (mseed_writer.c, and the
+// old write_mseed() of the *_daq.c programs): restarts, day rollovers,
+// crashes and deleted files all leave records that a reader has to cope with.
+// Each volume is mapped and its records are walked in place, without copying
+// them. For every record it checks
+//
+//   - the Sequence Number (record n of a volume is number n, as the writers
+//     number them; a restart that lost count gives a jump or a repeat)
+//   - the Number of Samples against what the record can hold (NumSamp for
+//     the fixed-size encodings, the frames for Steim-1 and Steim-2, whose
+//     data are decoded and must integrate to the reverse integration constant)
+//   - the encoding, sample rate and channel, which must not change within a
+//     volume, and the Data Record Length, Word Order and blockette 1000
+//   - the start time against the end of the record before it: a time tear of
+//     more than half a sample is a gap (or an overlap, if the record starts
+//     before the previous one ends)
+//
+// and counts the records closed before they were full (by a gap, a flush
+// on close, a restart or a record closing interval), and the zero-filled
+// records a crash leaves at the end of a preallocated (mapped) volume.
+// miniSEED 3 volumes (*.mseed3) are walked by the length each record gives
+// and have their CRC-32C checked instead of a Sequence Number. Once every
+// volume is scanned, the volumes of each channel are put in time order, so the
+// gaps between the end of one and the start of the next (a missing day, a
+// volume that was deleted) are found too.
+//
+// The volumes are scanned by a pool of threads (one per core unless -j says
+// otherwise), each mapping and walking the next volume in the list, so a year
+// of a station takes about as long as reading it from the disk once. The
+// problems are printed to stderr, by volume, and the gaps and overlaps go to
+// stdout as a tab-separated index, one per line:
+//
+//   gap|overlap  NC.SIC.LI.CI  start  end  seconds  volume  record
+//
+// with the times as yyyy:ddd:hh:mm:ss.ffffff (UTC), start and end being the
+// missing (or doubled) stretch of time and record the record that starts
+// after the tear (1 for a tear between two volumes).
+//
+// usage: ./mseed_scan [-j threads] [-v] volume|directory ... > gaps.tsv
+//        ./mseed_scan /home/avn4/Data/2026 > 2026_gaps.tsv
+//
+// Directories are searched for *.mseed and *.mseed3 volumes; -v prints a
+// summary line for every volume. The exit status is 1 if any problem, gap or
+// overlap was found.
+//
+//  created: Saturday, October 17, 2026 (2026290)
+// modified: Saturday, October 17, 2026 (2026290)
+//  history:
+//           [2026290] - created document
+//
+
+#define _GNU_SOURCE                      // open_memstream()
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <string.h>
+#include <stddef.h>
+#include <math.h>
+#include <time.h>
+#include <errno.h>
+#include <ftw.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "mseed_writer.h"
+
+#define MAX_THREADS 256
+
+// one volume: what was found in it and where its data start and end
+typedef struct
+{
+  char *path;
+  char sid[48];                     // NC.SIC.LI.CI of the first record
+  int v3;                           // miniSEED 3 volume
+  int nrec, nshort, nzero;          // records, records closed before they were full, zero-filled records
+  long nsamp;                       // samples
+  int EF;                           // Encoding Format of the first record
+  double fs;                        // sample rate of the first record (in Hz)
+  double t_first, t_next;           // first sample, and when the sample after the last is due
+  int nprob, ngap, noverlap;
+  char *log, *index;                // problem lines and index lines (open_memstream)
+  size_t nlog, nindex;
+  FILE *flog, *findex;
+} volume;
+
+// a record as both formats give it
+typedef struct
+{
+  int len;                          // bytes of the record
+  int big;                          // header byte order (miniSEED 2)
+  int SeqNum;                       // Sequence Number (0 = none, miniSEED 3)
+  int crc;                          // the CRC-32C matches (miniSEED 3)
+  char sid[48];                     // NC.SIC.LI.CI
+  int EF, WO;                       // Encoding Format and Word Order of the data
+  double t, fs;                     // start time and sample rate (in Hz)
+  long NoS;                         // Number of Samples
+  const unsigned char *data;        // data section
+  int ndata;                        // bytes of it
+} record;
+
+// local function definitions
+static int add_path(const char *path, const struct stat *sb, int type, struct FTW *ftw);
+static void *scan_thread(void *arg);
+static void scan_volume(volume *v, int32_t **buf, int *nbuf);
+static void check_record(volume *v, const record *r, int n, int last, const record *prev, int32_t **buf, int *nbuf);
+static int read_record2(const unsigned char *p, size_t left, record *r, const char **why);
+static int read_record3(const unsigned char *p, size_t left, record *r, const char **why);
+static void tear(volume *v, double t_end, double t_start, const char *path, int n);
+static void problem(volume *v, int n, const char *fmt, ...) __attribute__((format(printf, 3, 4)));
+static int by_channel(const void *a, const void *b);
+static int by_path(const void *a, const void *b);
+static double sample_rate(int16_t SRF, int16_t SRM);
+static int sample_bytes(int EF);
+static uint16_t get16(const unsigned char *p, int big);
+static uint32_t get32(const unsigned char *p, int big);
+static uint32_t crc32c(const unsigned char *p, size_t len, uint32_t skip);
+static void format_time(double t, char *s, size_t len);
+double elapsed(struct timespec *t0);
+
+// global variables
+volume *vol = NULL;                   // volumes to scan
+int nvol = 0, capvol = 0;
+atomic_int next_vol;                  // next volume a scan thread takes
+uint32_t crc_table[256];              // CRC-32C (Castagnoli, reflected) by byte
+
+int main(int argc, char **argv)
+{
+  pthread_t thread[MAX_THREADS];
+  volume **order;
+  struct timespec t0;
+  struct stat sb;
+  int i, nthread = (int)sysconf(_SC_NPROCESSORS_ONLN), verbose = 0, opt;
+  int nprob = 0, ngap = 0, noverlap = 0, nrec = 0;
+  uint32_t c, k;
+
+  while ((opt = getopt(argc, argv, "j:v")) != -1)
+  {
+    if ((opt == 'j') && (atoi(optarg) > 0))
+      nthread = atoi(optarg);
+    else if (opt == 'v')
+      verbose = 1;
+    else
+      optind = argc + 1;
+  }
+  if (optind >= argc)
+  {
+    fprintf(stderr, "usage: %s [-j threads] [-v] volume|directory ... > gaps.tsv\n", argv[0]);
+    return 2;
+  }
+  if (nthread > MAX_THREADS)
+    nthread = MAX_THREADS;
+
+  // the volumes named and the ones in the directories named, in path order
+  for (i = optind; i < argc; i++)
+  {
+    if (stat(argv[i], &sb) == -1)
+    {
+      perror(argv[i]);
+      return 2;
+    }
+    if (S_ISDIR(sb.st_mode))
+      nftw(argv[i], add_path, 32, FTW_PHYS);
+    else
+      add_path(argv[i], &sb, FTW_F, NULL);
+  }
+  if (nvol == 0)
+  {
+    fprintf(stderr, "%s: no miniSEED volumes found\n", argv[0]);
+    return 2;
+  }
+  qsort(vol, nvol, sizeof(volume), by_path);
+
+  for (k = 0; k < 256; k++)
+  {
+    c = k;
+    for (i = 0; i < 8; i++)
+      c = (c >> 1) ^ (0x82F63B78 & -(c & 1));
+    crc_table[k] = c;
+  }
+
+  // scan them
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  if (nthread > nvol)
+    nthread = nvol;
+  atomic_init(&next_vol, 0);
+  for (i = 0; i < nthread; i++)
+    if (pthread_create(&thread[i], NULL, scan_thread, NULL) != 0)
+      break;
+  if (i == 0)
+    scan_thread(NULL);
+  nthread = i;
+  for (i = 0; i < nthread; i++)
+    pthread_join(thread[i], NULL);
+
+  // the tears between consecutive volumes of a channel
+  order = malloc(nvol * sizeof(volume *));
+  for (i = 0; i < nvol; i++)
+    order[i] = &vol[i];
+  qsort(order, nvol, sizeof(volume *), by_channel);
+  for (i = 1; i < nvol; i++)
+  {
+    if ((order[i]->nrec == 0) | (order[i - 1]->nrec == 0) || (strcmp(order[i]->sid, order[i - 1]->sid) != 0))
+      continue;
+    tear(order[i], order[i - 1]->t_next, order[i]->t_first, order[i]->path, 1);
+  }
+  free(order);
+
+  // report by volume
+  printf("# kind\tsource\tstart\tend\tseconds\tvolume\trecord\n");
+  for (i = 0; i < nvol; i++)
+  {
+    fclose(vol[i].flog);
+    fclose(vol[i].findex);
+    if (vol[i].nlog > 0)
+      fprintf(stderr, "%s", vol[i].log);
+    fwrite(vol[i].index, 1, vol[i].nindex, stdout);
+    if (verbose)
+      fprintf(stderr, "%s: %s, %i records (%i short, %i zero-filled), %li samples at %g Hz, EF %i, %i problems, %i gaps, %i overlaps\n",
+              vol[i].path, (vol[i].nrec > 0) ? vol[i].sid : "-", vol[i].nrec, vol[i].nshort, vol[i].nzero, vol[i].nsamp, vol[i].fs,
+              vol[i].EF, vol[i].nprob, vol[i].ngap, vol[i].noverlap);
+    nprob += vol[i].nprob;
+    ngap += vol[i].ngap;
+    noverlap += vol[i].noverlap;
+    nrec += vol[i].nrec;
+  }
+  fprintf(stderr, "%i volumes, %i records scanned in %.2f s (%i threads): %i problems, %i gaps, %i overlaps\n",
+          nvol, nrec, elapsed(&t0), (nthread > 0) ? nthread : 1, nprob, ngap, noverlap);
+
+  return ((nprob > 0) | (ngap > 0) | (noverlap > 0)) ? 1 : 0;
+}
+
+static int add_path(const char *path, const struct stat *sb, int type, struct FTW *ftw)
+{
+  size_t n = strlen(path);
+  volume *v;
+
+  // day volumes only (not tail files or checkpoints), unless named
+  if ((type != FTW_F) || ((ftw != NULL) && !(((n > 6) && (strcmp(path + n - 6, ".mseed") == 0)) ||
+                                             ((n > 7) && (strcmp(path + n - 7, ".mseed3") == 0)))))
+    return 0;
+
+  if (nvol == capvol)
+  {
+    capvol = (capvol > 0) ? 2 * capvol : 256;
+    vol = realloc(vol, capvol * sizeof(volume));
+    if (vol == NULL)
+    {
+      perror("mseed_scan");
+      exit(2);
+    }
+  }
+  v = &vol[nvol++];
+  memset(v, 0, sizeof(*v));
+  v->path = strdup(path);
+  return 0;
+}
+
+static void *scan_thread(void *arg)
+{
+  int32_t *buf = NULL;
+  int nbuf = 0, i;
+
+  // take the next volume until there are none left
+  while ((i = atomic_fetch_add(&next_vol, 1)) < nvol)
+    scan_volume(&vol[i], &buf, &nbuf);
+
+  free(buf);
+  return NULL;
+}
+
+static void scan_volume(volume *v, int32_t **buf, int *nbuf)
+{
+  const unsigned char *map, *p;
+  const char *why;
+  record r, prev;
+  struct stat sb;
+  size_t off = 0, zero;
+  int fd, n = 0;
+
+  v->flog = open_memstream(&v->log, &v->nlog);
+  v->findex = open_memstream(&v->index, &v->nindex);
+  v->v3 = ((strlen(v->path) > 7) && (strcmp(v->path + strlen(v->path) - 7, ".mseed3") == 0));
+
+  fd = open(v->path, O_RDONLY);
+  if ((fd == -1) || (fstat(fd, &sb) == -1))
+  {
+    problem(v, 0, "%s", strerror(errno));
+    if (fd != -1)
+      close(fd);
+    return;
+  }
+  if (sb.st_size == 0)
+  {
+    problem(v, 0, "empty");
+    close(fd);
+    return;
+  }
+
+  // the records are read where they are mapped
+  map = mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED)
+  {
+    problem(v, 0, "mmap: %s", strerror(errno));
+    return;
+  }
+  madvise((void *)map, sb.st_size, MADV_SEQUENTIAL);
+
+  while (off < (size_t)sb.st_size)
+  {
+    p = map + off;
+
+    // a crash leaves the rest of a preallocated volume zero-filled
+    if (p[0] == 0)
+    {
+      for (zero = off; (zero < (size_t)sb.st_size) && (map[zero] == 0); zero++);
+      if (zero < (size_t)sb.st_size)
+      {
+        problem(v, n + 1, "zero-filled bytes at offset %zu, followed by more data", off);
+        break;
+      }
+      v->nzero = (n > 0) ? (int)((sb.st_size - off + prev.len - 1) / prev.len) : 1;
+      problem(v, n + 1, "%i zero-filled records at the end (the volume was never closed)", v->nzero);
+      break;
+    }
+
+    if (((v->v3) ? read_record3(p, sb.st_size - off, &r, &why) : read_record2(p, sb.st_size - off, &r, &why)) == -1)
+    {
+      problem(v, n + 1, "%s, rest of the volume (%zu bytes) skipped", why, sb.st_size - off);
+      break;
+    }
+
+    n++;
+    check_record(v, &r, n, off + r.len >= (size_t)sb.st_size, (n > 1) ? &prev : NULL, buf, nbuf);
+    prev = r;
+    off += r.len;
+  }
+
+  v->nrec = n;
+  if (n > 0)
+    v->t_next = prev.t + prev.NoS / prev.fs;
+  munmap((void *)map, sb.st_size);
+}
+
+static void check_record(volume *v, const record *r, int n, int last, const record *prev, int32_t **buf, int *nbuf)
+{
+  int size, cap, nframes, level;
+
+  // the channel, encoding and sample rate the volume has
+  if (n == 1)
+  {
+    snprintf(v->sid, sizeof(v->sid), "%s", r->sid);
+    v->EF = r->EF;
+    v->fs = r->fs;
+    v->t_first = r->t;
+  }
+  else
+  {
+    if (strcmp(r->sid, v->sid) != 0)
+      problem(v, n, "a record of %s", r->sid);
+    if (r->EF != v->EF)
+      problem(v, n, "Encoding Format %i, after %i", r->EF, v->EF);
+    if (r->fs != v->fs)
+      problem(v, n, "sample rate %g Hz, after %g Hz", r->fs, v->fs);
+  }
+
+  // records are numbered from 1 in each volume (miniSEED 2), or carry a CRC (miniSEED 3)
+  if ((!v->v3) & (r->SeqNum != n))
+    problem(v, n, "Sequence Number %06i", r->SeqNum);
+  if ((v->v3) & (!r->crc))
+    problem(v, n, "CRC-32C doesn't match");
+
+  // the samples against what the record holds
+  v->nsamp += r->NoS;
+  if (r->NoS == 0)
+    problem(v, n, "no samples");
+  size = sample_bytes(r->EF);
+  if (size > 0)
+  {
+    cap = r->ndata / size;
+    if (r->NoS > cap)
+      problem(v, n, "%li samples, but only %i fit (NumSamp)", r->NoS, cap);
+    else if ((r->NoS < cap) & (!last) & (!v->v3))
+      v->nshort++;
+    if ((v->v3) & (r->NoS * size != r->ndata))
+      problem(v, n, "%li samples in %i bytes of data", r->NoS, r->ndata);
+  }
+  else if ((r->EF == 10) | (r->EF == 11))
+  {
+    level = r->EF - 9;
+    nframes = r->ndata / STEIM_FRAME;
+    if ((r->WO != 1) | (r->ndata % STEIM_FRAME != 0) | (nframes == 0))
+      problem(v, n, "Steim data of %i bytes (Word Order %i)", r->ndata, r->WO);
+    else
+    {
+      // (each frame holds at most 15 words of 7 differences)
+      if (*nbuf < nframes * 105)
+      {
+        *nbuf = nframes * 105;
+        *buf = realloc(*buf, *nbuf * sizeof(int32_t));
+      }
+      if ((r->NoS > *nbuf) || (steim_decode(r->data, nframes, level, (int)r->NoS, *buf) != r->NoS))
+        problem(v, n, "Steim-%i data don't decode to %li samples ending at the reverse integration constant", level, r->NoS);
+      else if ((!last) & (!v->v3) & (get32(r->data + (nframes - 1) * STEIM_FRAME, 1) == 0))
+        v->nshort++;
+    }
+  }
+  else
+    problem(v, n, "unknown Encoding Format %i", r->EF);
+
+  // a time tear from the record before
+  if (prev != NULL)
+    tear(v, prev->t + prev->NoS / prev->fs, r->t, v->path, n);
+}
+
+static int read_record2(const unsigned char *p, size_t left, record *r, const char **why)
+{
+  const mseed_header *h = (const mseed_header *)p;
+  struct tm tt = {0};
+  int i, DoY, bt, next, b1000 = -1, OBD, DRL;
+  char code[4][6];
+
+  memset(r, 0, sizeof(*r));
+  *why = "truncated header";
+  if (left < MSEED_HDRLEN)
+    return -1;
+
+  // a header, in whichever byte order gives a sensible day
+  *why = "not a data record header";
+  for (i = 0; i < 6; i++)
+    if (((p[i] < '0') | (p[i] > '9')) & (p[i] != ' '))
+      return -1;
+  if (strchr("DRQM", h->DQI) == NULL)
+    return -1;
+  for (r->big = 0; r->big < 2; r->big++)
+  {
+    DoY = get16(h->DoY, r->big);
+    if ((get16(h->Yr, r->big) >= 1900) & (get16(h->Yr, r->big) <= 2100) & (DoY >= 1) & (DoY <= 366))
+      break;
+  }
+  if (r->big == 2)
+    return -1;
+  r->SeqNum = atoi(h->SeqNum);
+
+  // blockette 1000 gives the record length, encoding and word order
+  next = get16(h->OFB, r->big);
+  for (i = 0; (i < h->NB) & (next >= 48) & (next + 4 <= MSEED_HDRLEN); i++)
+  {
+    bt = get16(p + next, r->big);
+    if (bt == 1000)
+    {
+      b1000 = next;
+      break;
+    }
+    next = get16(p + next + 2, r->big);
+  }
+  *why = "no blockette 1000";
+  if (b1000 == -1)
+    return -1;
+  r->EF = p[b1000 + 4];
+  r->WO = p[b1000 + 5];
+  DRL = p[b1000 + 6];
+  *why = "Data Record Length out of range";
+  if ((DRL < 8) | (DRL > 16))
+    return -1;
+  r->len = 1 << DRL;
+  *why = "truncated record";
+  if ((size_t)r->len > left)
+    return -1;
+  OBD = get16(h->OBD, r->big);
+  *why = "Offset to the Beginning of Data out of range";
+  if ((OBD < 48) | (OBD >= r->len))
+    return -1;
+
+  // the codes without their padding
+  snprintf(code[0], 6, "%.2s", h->NC);
+  snprintf(code[1], 6, "%.5s", h->SIC);
+  snprintf(code[2], 6, "%.2s", h->LI);
+  snprintf(code[3], 6, "%.3s", h->CI);
+  for (i = 0; i < 4; i++)
+    code[i][strcspn(code[i], " ")] = '\0';
+  snprintf(r->sid, sizeof(r->sid), "%s.%s.%s.%s", code[0], code[1], code[2], code[3]);
+
+  // start time (as the writer reads it back) and rate
+  tt.tm_year = get16(h->Yr, r->big) - 1900;
+  tt.tm_mday = DoY;                     // timegm() normalizes day DoY of January
+  tt.tm_hour = h->Hr;
+  tt.tm_min = h->Mn;
+  tt.tm_sec = h->Sc;
+  r->t = (double)timegm(&tt) + get16(h->S0001, r->big) / 10000.0;
+  r->fs = sample_rate((int16_t)get16(h->SRF, r->big), (int16_t)get16(h->SRM, r->big));
+  *why = "no sample rate";
+  if (r->fs <= 0)
+    return -1;
+  r->NoS = get16(h->NoS, r->big);
+  r->data = p + OBD;
+  r->ndata = r->len - OBD;
+  return 0;
+}
+
+static int read_record3(const unsigned char *p, size_t left, record *r, const char **why)
+{
+  const mseed3_header *h = (const mseed3_header *)p;
+  struct tm tt = {0};
+  size_t len;
+  double sr;
+  int SIDL, i;
+
+  memset(r, 0, sizeof(*r));
+  *why = "truncated header";
+  if (left < MSEED3_HDRLEN)
+    return -1;
+  *why = "not a miniSEED 3 record header";
+  if ((memcmp(h->MS, "MS", 2) != 0) | (h->FV != 3))
+    return -1;
+  SIDL = h->SIDL;
+  len = MSEED3_HDRLEN + SIDL + get16(h->EHL, 0) + (size_t)get32(h->DL, 0);
+  *why = "truncated record";
+  if (len > left)
+    return -1;
+  r->crc = (crc32c(p, len, offsetof(mseed3_header, CRC)) == get32(h->CRC, 0));
+  r->len = (int)len;
+
+  // FDSN:NC_SIC_LI_B_S_SS as NC.SIC.LI.BSSS
+  snprintf(r->sid, sizeof(r->sid), "%.*s", (SIDL < 31) ? SIDL : 31, (const char *)p + MSEED3_HDRLEN);
+  if (strncmp(r->sid, "FDSN:", 5) == 0)
+  {
+    char part[6][8] = {{0}};
+    int k = 0, j = 0;
+    for (i = 5; (r->sid[i] != '\0') & (k < 6); i++)
+    {
+      if (r->sid[i] == '_')
+      {
+        k++;
+        j = 0;
+      }
+      else if (j < 7)
+        part[k][j++] = r->sid[i];
+    }
+    snprintf(r->sid, sizeof(r->sid), "%s.%s.%s.%s%s%s", part[0], part[1], part[2], part[3], part[4], part[5]);
+  }
+
+  // start time to the nanosecond and rate (or negated period)
+  tt.tm_year = get16(h->Yr, 0) - 1900;
+  tt.tm_mday = get16(h->DoY, 0);
+  tt.tm_hour = h->Hr;
+  tt.tm_min = h->Mn;
+  tt.tm_sec = h->Sc;
+  r->t = (double)timegm(&tt) + get32(h->NS, 0) / 1e9;
+  memcpy(&sr, h->SR, sizeof(sr));
+  r->fs = (sr < 0) ? -1 / sr : sr;
+  *why = "no sample rate";
+  if (!(r->fs > 0))
+    return -1;
+  r->EF = h->EF;
+  r->WO = ((r->EF == 10) | (r->EF == 11)) ? 1 : 0;
+  r->NoS = get32(h->NoS, 0);
+  r->ndata = get32(h->DL, 0);
+  r->data = p + len - r->ndata;
+  return 0;
+}
+
+static void tear(volume *v, double t_end, double t_start, const char *path, int n)
+{
+  char s0[40], s1[40];
+  double d = t_start - t_end;
+
+  // more than half a sample either way
+  if (fabs(d) <= 0.5 / v->fs)
+    return;
+
+  if (d > 0)
+  {
+    format_time(t_end, s0, sizeof(s0));
+    format_time(t_start, s1, sizeof(s1));
+    v->ngap++;
+  }
+  else
+  {
+    format_time(t_start, s0, sizeof(s0));
+    format_time(t_end, s1, sizeof(s1));
+    v->noverlap++;
+  }
+  fprintf(v->findex, "%s\t%s\t%s\t%s\t%.6f\t%s\t%i\n", (d > 0) ? "gap" : "overlap", v->sid, s0, s1, fabs(d), path, n);
+}
+
+static void problem(volume *v, int n, const char *fmt, ...)
+{
+  va_list ap;
+
+  v->nprob++;
+  if (n > 0)
+    fprintf(v->flog, "%s: record %i: ", v->path, n);
+  else
+    fprintf(v->flog, "%s: ", v->path);
+  va_start(ap, fmt);
+  vfprintf(v->flog, fmt, ap);
+  va_end(ap);
+  fputc('\n', v->flog);
+}
+
+static int by_channel(const void *a, const void *b)
+{
+  const volume *x = *(const volume **)a, *y = *(const volume **)b;
+  int c = strcmp(x->sid, y->sid);
+
+  // channel, then first sample
+  if (c != 0)
+    return c;
+  return (x->t_first > y->t_first) - (x->t_first < y->t_first);
+}
+
+static int by_path(const void *a, const void *b)
+{
+  return strcmp(((const volume *)a)->path, ((const volume *)b)->path);
+}
+
+static double sample_rate(int16_t SRF, int16_t SRM)
+{
+  // as mseed_add_station() has it
+  if ((SRF == 0) | (SRM == 0))
+    return 0;
+  if ((SRF > 0) & (SRM > 0))
+    return (double)SRF * (double)SRM;
+  if ((SRF > 0) & (SRM < 0))
+    return -1 * (double)SRF / (double)SRM;
+  if ((SRF < 0) & (SRM > 0))
+    return -1 * (double)SRM / (double)SRF;
+  return 1 / ((double)SRF * (double)SRM);
+}
+
+static int sample_bytes(int EF)
+{
+  // fixed-size encodings (0 = compressed or unknown)
+  switch (EF)
+  {
+    case 1:
+      return sizeof(int16_t);
+    case 3:
+      return sizeof(int32_t);
+    case 4:
+      return sizeof(float);
+    case 5:
+      return sizeof(double);
+    default:
+      return 0;
+  }
+}
+
+static uint16_t get16(const unsigned char *p, int big)
+{
+  return (big) ? (uint16_t)(p[0] << 8 | p[1]) : (uint16_t)(p[1] << 8 | p[0]);
+}
+
+static uint32_t get32(const unsigned char *p, int big)
+{
+  return (big) ? (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3]
+               : (uint32_t)p[3] << 24 | (uint32_t)p[2] << 16 | (uint32_t)p[1] << 8 | p[0];
+}
+
+static uint32_t crc32c(const unsigned char *p, size_t len, uint32_t skip)
+{
+  uint32_t crc = 0xFFFFFFFF;
+  size_t i;
+
+  // the 4 bytes of the CRC field count as zero
+  for (i = 0; i < len; i++)
+    crc = (crc >> 8) ^ crc_table[(crc ^ (((i >= skip) & (i < skip + 4)) ? 0 : p[i])) & 0xFF];
+  return ~crc;
+}
+
+static void format_time(double t, char *s, size_t len)
+{
+  time_t t_temp;
+  struct tm tt;
+  int usc;
+
+  // (to the microsecond, so 59.9999996 s doesn't print as 60)
+  t_temp = (time_t)floor(t);
+  usc = (int)round(1000000 * (t - t_temp));
+  if (usc == 1000000)
+  {
+    t_temp++;
+    usc = 0;
+  }
+  gmtime_r(&t_temp, &tt);
+  snprintf(s, len, "%04i:%03i:%02i:%02i:%02i.%06i", (tt.tm_year + 1900) % 10000, tt.tm_yday + 1, tt.tm_hour, tt.tm_min, tt.tm_sec, usc);
+}
+
+double elapsed(struct timespec *t0)
+{
+  struct timespec t1;
+
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  return (t1.tv_sec - t0->tv_sec) + 1e-9 * (t1.tv_nsec - t0->tv_nsec);
+}
@@ -0,0 +1,7 @@
+#!/bin/bash
+
+echo -e "\nCompiling miniSEED day volume validator and gap scanner . . . \c"
+gcc mseed_scan.c steim.c -O2 -g -Wall -pthread -lm -o mseed_scan
+echo -e "done!\n"
+
+rm -f *~ > /dev/null
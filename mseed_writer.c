@@ -0,0 +1,1769 @@
+// miniSEED day volume writer shared by the data acquisition programs
+//
+// by: Scott DeWolf
+//
+// Each channel keeps its day volume open and assembles the current data
+// record (header + samples) in memory, and writes it when it is full, at the
+// flush interval, at a day rollover or on close. The options of a station
+// (writer thread, batching, mapped volumes, tail files, miniSEED 3, indexes,
+// checkpoints) are described with their functions in mseed_writer.h.
+//
+//  created: Saturday, October 17, 2026 (2026290)
+// modified: Saturday, October 17, 2026 (2026290)
+//  history:
+//           [2026290] - created document from the write_mseed() copies in the *_daq.c programs
+//           [2026290] - added Steim-1 and Steim-2 encodings for integer channels
+//           [2026290] - added the writer thread and sample queue (mseed_start_writer)
+//                       a sample that doesn't follow the previous one starts a new record
+//           [2026290] - added stations (mseed_add_station) so one writer serves several instruments
+//           [2026290] - resume the last record of a day volume on restart (checkpoint files)
+//           [2026290] - create the day directories once per station and day
+//           [2026290] - added write_mseed_frame() and batched record writes (io_batch)
+//           [2026290] - added preallocated, memory-mapped day volumes (mseed_map_volumes)
+//           [2026290] - added final-only day volumes with a tail file (mseed_tail_records)
+//           [2026290] - headers are copied from a per-channel template (mseed_header), either byte order
+//           [2026290] - record length (512 to 8192 bytes) and record closing interval per channel
+//           [2026290] - added FDSN miniSEED 3 day volumes (mseed_format3)
+//           [2026290] - records can be handed to a callback as well (mseed_on_record, mseed_stream_records)
+//           [2026290] - added time indexes of the day volumes (mseed_index_volumes)
+//           [2026290] - stations can go without checkpoint files (mseed_skip_checkpoints)
+//           [2026290] - the 0.0001 s of a start time that rounds up carry into the seconds
+//           [2026290] - write_mseed_frame() rejects frames beyond the channels added
+//           [2026290] - a day volume that can't be opened is tried again, and records dropped meanwhile are logged
+//           [2026290] - a day volume without fallocate() is written with pwrite() rather than mapped sparse
+//           [2026290] - the tail file is synced before its rename, and removed only after the batch of the final record
+//           [2026290] - the batch counters are read with mseed_io_stats() instead of printed on close
+//           [2026290] - cut the notes on each feature down to mseed_writer.h
+//
+
+#define _GNU_SOURCE                      // fallocate() and mremap()
+
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include <errno.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "mseed_writer.h"
+
+_Static_assert(sizeof(mseed_header) == MSEED_HDRLEN, "mseed_header must fill the header");
+_Static_assert(sizeof(mseed3_header) == MSEED3_HDRLEN, "mseed3_header must fill the fixed header");
+_Static_assert(MSEED_MAX_RECLEN <= IO_BATCH_BUF, "a batched write must hold a whole record");
+
+// fewest samples a full Steim record of reclen bytes holds (one difference per data word)
+#define STEIM_MIN_SAMP(reclen) ((((reclen) - MSEED_HDRLEN) / STEIM_FRAME) * 15 - 2)
+
+// checkpoint of a channel: the last record written to its day volume
+typedef struct
+{
+  char magic[4];                    // "MSCP"
+  int32_t Yr, DoY;                  // day volume
+  int32_t SeqNum;                   // record
+  int32_t NoS;                      // samples in it
+  int32_t EF;                       // Encoding Format
+  double t_rec;                     // sample time of its first sample
+} mseed_checkpoint;
+
+// local function definitions
+static void *mseed_thread(void *arg);
+static void put_mseed(mseed_writer *w, int chan_idx, double t, double data);
+static void queue_mseed(mseed_writer *w, const mseed_sample *s, int n);
+static void new_mseed_day(mseed_writer *w, mseed_channel *ch, double t);
+static int open_mseed(mseed_writer *w, mseed_channel *ch);
+static int open_volume3(mseed_channel *ch, const char *fn);
+static void set_record_length(mseed_writer *w, mseed_channel *ch, int reclen);
+static void volume_length(mseed_writer *w, mseed_channel *ch, const char *fn);
+static int used_records(int fd, int nrec, int reclen);
+static void close_volume(mseed_writer *w, mseed_channel *ch);
+static void open_index(mseed_writer *w, mseed_channel *ch, const char *fn);
+static void build_index(mseed_writer *w, mseed_channel *ch, const char *path);
+static void index_record(mseed_writer *w, mseed_channel *ch, const unsigned char *rec, off_t off, int len);
+static void map_volume(mseed_writer *w, mseed_channel *ch, double t);
+static int grow_volume(mseed_channel *ch, int nrec);
+static int map_record(mseed_channel *ch);
+static void unmap_volume(mseed_channel *ch);
+static void volume_path(mseed_writer *w, mseed_channel *ch, int Yr, int DoY, const char *suffix, char *fn, size_t len);
+static void resume_mseed(mseed_writer *w, mseed_channel *ch, double t, int nrec);
+static void resume_tail(mseed_writer *w, mseed_channel *ch, double t, int nrec);
+static void finish_tail(mseed_writer *w, mseed_channel *ch);
+static int continue_record(mseed_writer *w, mseed_channel *ch, double t, const unsigned char *rec, int SeqNum);
+static int read_record(mseed_writer *w, mseed_channel *ch, int SeqNum, unsigned char *rec);
+static int check_record(mseed_writer *w, mseed_channel *ch, int SeqNum, const unsigned char *rec);
+static int read_checkpoint(mseed_channel *ch, mseed_checkpoint *ck);
+static void open_checkpoint(mseed_writer *w, mseed_channel *ch);
+static void save_checkpoint(mseed_writer *w, mseed_channel *ch, const unsigned char *rec);
+static void put_record(mseed_writer *w, mseed_channel *ch, const unsigned char *rec);
+static void put_record3(mseed_writer *w, mseed_channel *ch, const unsigned char *rec, int final);
+static void publish_record(mseed_writer *w, mseed_channel *ch, const unsigned char *rec, int final);
+static void write_tail(mseed_writer *w, mseed_channel *ch, const unsigned char *rec);
+static void drop_tail(mseed_writer *w, mseed_channel *ch);
+static void submit_records(mseed_writer *w);
+static double record_time(const unsigned char *h, int big);
+static double record_time3(const unsigned char *h);
+static double record_end(mseed_writer *w, mseed_channel *ch, double t_rec);
+static int record_over(mseed_writer *w, mseed_channel *ch, double t);
+static void build_header(mseed_writer *w, mseed_channel *ch);
+static void build_header3(mseed_writer *w, mseed_channel *ch);
+static void write_mseed_header(mseed_writer *w, mseed_channel *ch, double t);
+static void write_mseed3_header(mseed_writer *w, mseed_channel *ch, double t);
+static void put_nos(mseed_writer *w, mseed_channel *ch, unsigned char *rec, int NoS);
+static void seal_record3(mseed_channel *ch, unsigned char *rec, int nframes);
+static uint32_t crc32c(const unsigned char *p, size_t len);
+static void put16(unsigned char *p, uint16_t v, int big);
+static void put32(unsigned char *p, uint32_t v, int big);
+static void put64(unsigned char *p, uint64_t v, int big);
+static uint16_t get16(const unsigned char *p, int big);
+static uint32_t get32(const unsigned char *p, int big);
+static unsigned char *ready_record(mseed_writer *w, mseed_channel *ch, unsigned char *buf);
+static void write_mseed_record(mseed_writer *w, mseed_channel *ch, int final);
+static void stream_record(mseed_writer *w, mseed_channel *ch, double t);
+static int record_length(mseed_writer *w, mseed_channel *ch, const unsigned char *rec);
+static void end_mseed_record(mseed_writer *w, mseed_channel *ch, int final);
+static void flush_mseed_channel(mseed_writer *w, mseed_channel *ch);
+static void write_steim(mseed_writer *w, mseed_channel *ch, double t, int32_t x);
+static int next_steim_record(mseed_writer *w, mseed_channel *ch);
+static int is_steim(uint8_t EF);
+static int sample_size(uint8_t EF);
+
+void mseed_init(mseed_writer *w, const char *root, const char *NC, const char *SIC, int16_t SRF, int16_t SRM, double flush)
+{
+  memset(w, 0, sizeof(*w));
+  mseed_add_station(w, root, NC, SIC, SRF, SRM, flush);
+
+  // without the batch buffers every record is written directly
+  if (io_batch_init(&w->io, 1) == -1)
+    perror("mseed_init");
+}
+
+int mseed_add_station(mseed_writer *w, const char *root, const char *NC, const char *SIC, int16_t SRF, int16_t SRM, double flush)
+{
+  mseed_station *st;
+
+  if (w->NumStation == MSEED_MAX_STATION)
+  {
+    fprintf(stderr, "mseed_add_station: too many stations (%i)\n", MSEED_MAX_STATION);
+    return -1;
+  }
+  st = &w->st[w->NumStation];
+
+  snprintf(st->root, sizeof(st->root), "%s", root);
+  snprintf(st->NC, sizeof(st->NC), "%-2.2s", NC);
+  snprintf(st->SIC, sizeof(st->SIC), "%-5.5s", SIC);
+  st->SRF = SRF;
+  st->SRM = SRM;
+  st->flush = flush;
+  st->dirday = -1;
+
+  // nominal sample rate (see the SEED manual for the SRF and SRM sign rules)
+  if ((SRF > 0) & (SRM > 0))
+    st->fs = (double)SRF * (double)SRM;
+  else if ((SRF > 0) & (SRM < 0))
+    st->fs = -1 * (double)SRF / (double)SRM;
+  else if ((SRF < 0) & (SRM > 0))
+    st->fs = -1 * (double)SRM / (double)SRF;
+  else if ((SRF < 0) & (SRM < 0))
+    st->fs = 1 / ((double)SRF * (double)SRM);
+
+  return w->NumStation++;
+}
+
+int mseed_add_channel(mseed_writer *w, const char *LI, const char *CI, uint8_t EF)
+{
+  mseed_channel *ch;
+
+  if (w->NumChan == MSEED_MAX_CHAN)
+  {
+    fprintf(stderr, "mseed_add_channel: too many channels (%i)\n", MSEED_MAX_CHAN);
+    return -1;
+  }
+  ch = &w->chan[w->NumChan];
+
+  snprintf(ch->LI, sizeof(ch->LI), "%-2.2s", LI);
+  snprintf(ch->CI, sizeof(ch->CI), "%-3.3s", CI);
+  ch->EF = EF;
+  ch->sta = w->NumStation - 1;
+  ch->setlen = MSEED_RECLEN;
+  ch->span = 0;
+  steim_init(&ch->se, (EF == 10) ? 1 : 2);
+  ch->SeqNum = 0;
+  ch->SampNum = 1;
+  ch->day = -1;
+  ch->fd = -1;
+  ch->ckpt = -1;
+  ch->idx = -1;
+  ch->map = NULL;
+  ch->tailed = 0;
+  ch->droptail = 0;
+  ch->lost = 0;
+  ch->t_retry = 0;
+  set_record_length(w, ch, ch->setlen);
+
+  return w->NumChan++;
+}
+
+int mseed_record_length(mseed_writer *w, int chan_idx, int reclen, double span)
+{
+  mseed_channel *ch = &w->chan[chan_idx];
+
+  if ((reclen < MSEED_MIN_RECLEN) | (reclen > MSEED_MAX_RECLEN) | ((reclen & (reclen - 1)) != 0))
+  {
+    fprintf(stderr, "mseed_record_length: %i bytes isn't a power of 2 from %i to %i\n", reclen, MSEED_MIN_RECLEN, MSEED_MAX_RECLEN);
+    return -1;
+  }
+  ch->setlen = reclen;
+  ch->span = (span > 0) ? span : 0;
+  set_record_length(w, ch, reclen);
+  return 0;
+}
+
+void mseed_map_volumes(mseed_writer *w)
+{
+  w->st[w->NumStation - 1].mapped = !w->st[w->NumStation - 1].v3;
+}
+
+void mseed_tail_records(mseed_writer *w)
+{
+  w->st[w->NumStation - 1].tail = !w->st[w->NumStation - 1].v3;
+}
+
+void mseed_big_endian(mseed_writer *w)
+{
+  int i;
+
+  // (channels of the station added already get new templates)
+  w->st[w->NumStation - 1].big = !w->st[w->NumStation - 1].v3;
+  for (i = 0; i < w->NumChan; i++)
+  {
+    if (w->chan[i].sta == w->NumStation - 1)
+      build_header(w, &w->chan[i]);
+  }
+}
+
+void mseed_format3(mseed_writer *w)
+{
+  mseed_station *st = &w->st[w->NumStation - 1];
+  int i;
+
+  // (miniSEED 3 records are little endian, and only ever written whole or in place)
+  if ((st->mapped) | (st->tail) | (st->big))
+    fprintf(stderr, "mseed_format3: %.*s day volumes won't be mapped, tailed or big endian\n", (int)strcspn(st->SIC, " "), st->SIC);
+  st->v3 = 1;
+  st->mapped = 0;
+  st->tail = 0;
+  st->big = 0;
+  for (i = 0; i < w->NumChan; i++)
+  {
+    if (w->chan[i].sta == w->NumStation - 1)
+      set_record_length(w, &w->chan[i], w->chan[i].reclen);
+  }
+}
+
+void mseed_index_volumes(mseed_writer *w)
+{
+  w->st[w->NumStation - 1].index = 1;
+}
+
+void mseed_skip_checkpoints(mseed_writer *w)
+{
+  w->st[w->NumStation - 1].nockpt = 1;
+}
+
+void mseed_on_record(mseed_writer *w, mseed_record_fn fn, void *arg)
+{
+  w->on_record = fn;
+  w->on_arg = arg;
+}
+
+void mseed_stream_records(mseed_writer *w, double interval)
+{
+  w->st[w->NumStation - 1].stream = (interval > 0) ? interval : 0;
+}
+
+int mseed_start_writer(mseed_writer *w, size_t qlen)
+{
+  sigset_t all, old;
+  int err;
+
+  if (ring_init(&w->queue, sizeof(mseed_sample), qlen) == -1)
+  {
+    perror("mseed_start_writer");
+    return -1;
+  }
+  sem_init(&w->ready, 0, 0);
+  atomic_init(&w->stop, 0);
+  w->max_depth = 0;
+  w->drops = 0;
+  w->dropping = 0;
+
+  // signals are left to the sampling loop
+  sigfillset(&all);
+  pthread_sigmask(SIG_BLOCK, &all, &old);
+  err = pthread_create(&w->thread, NULL, mseed_thread, w);
+  pthread_sigmask(SIG_SETMASK, &old, NULL);
+  if (err != 0)
+  {
+    fprintf(stderr, "mseed_start_writer: %s\n", strerror(err));
+    sem_destroy(&w->ready);
+    ring_free(&w->queue);
+    return -1;
+  }
+
+  w->async = 1;
+  return 0;
+}
+
+void mseed_queue_stats(mseed_writer *w, size_t *depth, size_t *max_depth, unsigned long *drops)
+{
+  *depth = (w->async) ? ring_depth(&w->queue) : 0;
+  *max_depth = w->max_depth;
+  *drops = w->drops;
+}
+
+void mseed_io_stats(mseed_writer *w, unsigned long *ops, unsigned long *batches, unsigned long *calls, const char **path)
+{
+  *ops = w->io.ops;
+  *batches = w->io.batches;
+  *calls = w->io.calls;
+  *path = io_batch_path(&w->io);
+}
+
+void write_mseed(mseed_writer *w, int chan_idx, double t, double data)
+{
+  mseed_sample s = {chan_idx, 0, t, data};
+
+  if (w->async)
+    queue_mseed(w, &s, 1);
+  else
+    put_mseed(w, chan_idx, t, data);
+}
+
+void write_mseed_frame(mseed_writer *w, int chan_idx, int n, double t, const double *data)
+{
+  mseed_sample s[MSEED_MAX_CHAN];
+  int i;
+
+  // the frame must be channels that were added
+  if ((n <= 0) | (chan_idx < 0) || (chan_idx + n > w->NumChan))
+  {
+    fprintf(stderr, "write_mseed_frame: channels %i to %i don't exist (%i channels)\n", chan_idx, chan_idx + n - 1, w->NumChan);
+    return;
+  }
+
+  if (w->async)
+  {
+    for (i = 0; i < n; i++)
+    {
+      s[i].chan_idx = chan_idx + i;
+      s[i].flush = 0;
+      s[i].t = t;
+      s[i].data = data[i];
+    }
+    queue_mseed(w, s, n);
+    return;
+  }
+
+  w->batching = (w->io.op != NULL);
+  for (i = 0; i < n; i++)
+    put_mseed(w, chan_idx + i, t, data[i]);
+  w->batching = 0;
+  submit_records(w);
+}
+
+static void *mseed_thread(void *arg)
+{
+  mseed_writer *w = arg;
+  mseed_sample s;
+  int stop;
+
+  while (1)
+  {
+    sem_wait(&w->ready);
+
+    // every sample queued before close_mseed() set stop is in the ring by now
+    stop = atomic_load(&w->stop);
+    w->batching = (w->io.op != NULL);
+    while (ring_pop(&w->queue, &s) == 0)
+    {
+      if (s.flush)
+        flush_mseed_channel(w, &w->chan[s.chan_idx]);
+      else
+        put_mseed(w, s.chan_idx, s.t, s.data);
+    }
+    w->batching = 0;
+    submit_records(w);
+    if (stop)
+      break;
+  }
+
+  return NULL;
+}
+
+static void queue_mseed(mseed_writer *w, const mseed_sample *s, int n)
+{
+  size_t depth;
+  int i, queued = 0;
+
+  // never wait for the writer thread
+  for (i = 0; i < n; i++)
+  {
+    if (ring_push(&w->queue, &s[i]) == 0)
+    {
+      queued++;
+      continue;
+    }
+    if (!w->dropping)
+      fprintf(stderr, "write_mseed: queue full (%zu samples), dropping samples\n", w->queue.cap);
+    w->dropping = 1;
+    w->drops++;
+  }
+  if (queued == 0)
+    return;
+
+  // one wakeup for the whole frame
+  sem_post(&w->ready);
+
+  depth = ring_depth(&w->queue);
+  if (depth > w->max_depth)
+    w->max_depth = depth;
+
+  // report the end of the outage once the writer thread has caught up halfway
+  if ((w->dropping) && (depth < w->queue.cap / 2))
+  {
+    fprintf(stderr, "write_mseed: queue accepting samples again (%lu dropped so far)\n", w->drops);
+    w->dropping = 0;
+  }
+}
+
+static void put_mseed(mseed_writer *w, int chan_idx, double t, double data)
+{
+  mseed_channel *ch = &w->chan[chan_idx];
+  const mseed_station *st = &w->st[ch->sta];
+  unsigned char *p;
+  size_t off;
+
+  // the day volume isn't open, i.e., this is the first sample:
+  // 1) on startup
+  // 2) at the beginning of a new day
+  if ((int)floor(t / 86400) != ch->day)
+    new_mseed_day(w, ch, t);
+
+  // a skipped or dropped sample ends the record, since a record can only
+  // hold evenly spaced samples
+  else if ((ch->SampNum > 1) && (fabs(t - ch->t_rec - (ch->SampNum - 1) / st->fs) > 0.5 / st->fs))
+  {
+    end_mseed_record(w, ch, 1);
+    ch->SeqNum++;
+  }
+
+  // compressed channels
+  if (is_steim(ch->EF))
+  {
+    write_steim(w, ch, t, (int32_t)data);
+    return;
+  }
+
+  // the first sample to be written to a new data record block
+  if (ch->SampNum == 1)
+    write_mseed_header(w, ch, t);
+
+  // copy the sample into the data block (in the byte order of the record)
+  p = ch->rec + ch->hdrlen + (ch->SampNum - 1) * sample_size(ch->EF);
+  switch (ch->EF)
+  {
+    case 1:
+      put16(p, (uint16_t)(int16_t)data, st->big);
+      break;
+    case 3:
+      put32(p, (uint32_t)(int32_t)data, st->big);
+      break;
+    case 4:
+    {
+      float f32 = (float)data;
+      uint32_t u32;
+      memcpy(&u32, &f32, sizeof(u32));
+      put32(p, u32, st->big);
+      break;
+    }
+    default: // EF = 5 = float64
+    {
+      uint64_t u64;
+      memcpy(&u64, &data, sizeof(u64));
+      put64(p, u64, st->big);
+      break;
+    }
+  }
+
+  // update sample number in header block
+  put_nos(w, ch, ch->rec, ch->SampNum);
+
+  // a mapped day volume gets the sample (and the updated header) right away
+  if (map_record(ch) == 0)
+  {
+    off = (size_t)(ch->SeqNum - 1) * ch->reclen;
+    memcpy(ch->map + off + (p - ch->rec), p, sample_size(ch->EF));
+    memcpy(ch->map + off, ch->rec, MSEED_HDRLEN);
+    if (ch->SeqNum > ch->nused)
+      ch->nused = ch->SeqNum;
+  }
+
+  // the last sample to be written to an existing data record block (or
+  // the last one before the end of its span)
+  if ((ch->SampNum == ch->NumSamp) || (record_over(w, ch, t)))
+  {
+    write_mseed_record(w, ch, 1);
+    ch->SeqNum++;
+    ch->SampNum = 1;
+  }
+  // just a normal sample, i.e., the record is only written every flush interval
+  else
+  {
+    ch->SampNum++;
+    if ((st->flush > 0) && (t - ch->t_flush >= st->flush))
+    {
+      write_mseed_record(w, ch, 0);
+      ch->t_flush = t;
+    }
+    else if ((st->stream > 0) && (t - ch->t_stream >= st->stream))
+      stream_record(w, ch, t);
+  }
+}
+
+void flush_mseed(mseed_writer *w, int chan_idx)
+{
+  mseed_sample s = {chan_idx, 1, 0, 0};
+
+  if (w->async)
+    queue_mseed(w, &s, 1);
+  else
+    flush_mseed_channel(w, &w->chan[chan_idx]);
+}
+
+void close_mseed(mseed_writer *w)
+{
+  int i;
+
+  // let the writer thread finish the queue
+  if (w->async)
+  {
+    atomic_store(&w->stop, 1);
+    sem_post(&w->ready);
+    pthread_join(w->thread, NULL);
+    sem_destroy(&w->ready);
+    ring_free(&w->queue);
+    w->async = 0;
+    fprintf(stderr, "close_mseed: at most %zu samples queued, %lu dropped\n", w->max_depth, w->drops);
+  }
+
+  // (the record being filled stays in the tail file of a station that has one)
+  for (i = 0; i < w->NumChan; i++)
+  {
+    end_mseed_record(w, &w->chan[i], !w->st[w->chan[i].sta].tail);
+    if (w->chan[i].fd != -1)
+      close_volume(w, &w->chan[i]);
+    if (w->chan[i].ckpt != -1)
+      close(w->chan[i].ckpt);
+    w->chan[i].fd = -1;
+    w->chan[i].ckpt = -1;
+    w->chan[i].day = -1;
+    steim_init(&w->chan[i].se, w->chan[i].se.level);
+  }
+  io_batch_free(&w->io);
+}
+
+static void new_mseed_day(mseed_writer *w, mseed_channel *ch, double t)
+{
+  time_t t_temp;
+  struct tm tt;
+  int nrec, restart = (ch->day == -1);
+
+  // finish the previous day volume (and whatever is still queued for it)
+  if (!restart)
+  {
+    end_mseed_record(w, ch, 1);
+    if (ch->fd != -1)
+      close_volume(w, ch);
+  }
+
+  // compute Year and DayOfYear of the new day volume
+  t_temp = (time_t)floor(t);
+  gmtime_r(&t_temp, &tt);
+  ch->day = (int)floor(t / 86400);
+  ch->Yr = tt.tm_year + 1900;
+  ch->DoY = tt.tm_yday + 1;
+
+  // a new file starts at record 1; an existing one (e.g., data acquisition is
+  // restarted during a given day) continues with or after its last record
+  // (or its tail record)
+  if (ch->reclen != ch->setlen)
+    set_record_length(w, ch, ch->setlen);
+  if ((restart) && (w->st[ch->sta].tail))
+    finish_tail(w, ch);
+  nrec = open_mseed(w, ch);
+  ch->SeqNum = nrec + 1;
+  ch->SampNum = 1;
+  ch->t_retry = t;
+  if ((restart) && (w->st[ch->sta].tail))
+    resume_tail(w, ch, t, nrec);
+  else if ((restart) & (nrec > 0) & (!w->st[ch->sta].v3))
+    resume_mseed(w, ch, t, nrec);
+  map_volume(w, ch, t);
+}
+
+static int open_mseed(mseed_writer *w, mseed_channel *ch)
+{
+  mseed_station *ms = &w->st[ch->sta];
+
+  // variables for making yearday filename and year/day directory
+  struct stat st = {0};
+  char path[300];
+  char fn[400];
+
+  // create /home/station/Data/yyyy/ddd path if it is not present (once for
+  // all the channels of the station)
+  snprintf(path, sizeof(path), "%s/%4i/%03i", ms->root, ch->Yr, ch->DoY);
+  if (ms->dirday != ch->day)
+  {
+    path[strlen(ms->root) + 5] = '\0';
+    if ((mkdir(path, 0755) == -1) & (errno != EEXIST))
+      perror(path);
+    path[strlen(ms->root) + 5] = '/';
+    if ((mkdir(path, 0755) == -1) & (errno != EEXIST))
+      perror(path);
+    ms->dirday = ch->day;
+  }
+
+  // create full path and filename
+  volume_path(w, ch, ch->Yr, ch->DoY, "", fn, sizeof(fn));
+
+  // open (creating if necessary) the day volume and the checkpoint (of
+  // a miniSEED 2.4 volume, whose last record may be resumed)
+  if (!ms->v3)
+    open_checkpoint(w, ch);
+  ch->fd = open(fn, O_RDWR | O_CREAT, 0666);
+  if (ch->fd == -1)
+  {
+    perror(fn);
+    return 0;
+  }
+  if (ms->v3)
+    open_volume3(ch, fn);
+
+  // the number of records already in the day volume (of the length it was started with)
+  else
+  {
+    volume_length(w, ch, fn);
+    fstat(ch->fd, &st);
+    ch->nused = used_records(ch->fd, st.st_size / ch->reclen, ch->reclen);
+    if ((off_t)ch->nused * ch->reclen < st.st_size - st.st_size % ch->reclen)
+    {
+      fprintf(stderr, "mseed: %s cut off after record %i (preallocated)\n", fn, ch->nused);
+      if (ftruncate(ch->fd, (off_t)ch->nused * ch->reclen) == -1)
+        perror(fn);
+    }
+  }
+
+  open_index(w, ch, fn);
+  return ch->nused;
+}
+
+static int open_volume3(mseed_channel *ch, const char *fn)
+{
+  unsigned char h[MSEED3_HDRLEN];
+  struct stat st = {0};
+  off_t len;
+  int nrec = 0;
+
+  // walk the records (each gives its own length) up to the last complete one
+  fstat(ch->fd, &st);
+  ch->vend = 0;
+  ch->vlen = 0;
+  while (pread(ch->fd, h, MSEED3_HDRLEN, ch->vend) == MSEED3_HDRLEN)
+  {
+    len = MSEED3_HDRLEN + h[offsetof(mseed3_header, SIDL)] + get16(h + offsetof(mseed3_header, EHL), 0) + (off_t)get32(h + offsetof(mseed3_header, DL), 0);
+    if ((memcmp(h, "MS\3", 3) != 0) || (ch->vend + len > st.st_size))
+      break;
+    ch->vend += len;
+    nrec++;
+  }
+
+  // a record cut off by a crash (or anything that isn't a record) goes
+  if (ch->vend < st.st_size)
+  {
+    fprintf(stderr, "mseed: %s cut off after record %i (incomplete)\n", fn, nrec);
+    if (ftruncate(ch->fd, ch->vend) == -1)
+      perror(fn);
+  }
+  ch->nused = nrec;
+  return nrec;
+}
+
+static void set_record_length(mseed_writer *w, mseed_channel *ch, int reclen)
+{
+  ch->reclen = reclen;
+  build_header(w, ch);
+  ch->NumSamp = (is_steim(ch->EF)) ? 0 : (reclen - ch->hdrlen) / sample_size(ch->EF);
+}
+
+static void volume_length(mseed_writer *w, mseed_channel *ch, const char *fn)
+{
+  unsigned char h[MSEED_HDRLEN];
+  int DRL;
+
+  // the Data Record Length of the first record, if it is one of this channel
+  if ((pread(ch->fd, h, MSEED_HDRLEN, 0) != MSEED_HDRLEN) ||
+      (memcmp(h + offsetof(mseed_header, SIC), ch->hdr.SIC, 12) != 0) ||
+      (memcmp(h + offsetof(mseed_header, EF), &ch->hdr.EF, 2) != 0))
+    return;
+  DRL = h[offsetof(mseed_header, DRL)];
+  if ((DRL < 9) | (DRL > 13) | ((1 << DRL) == ch->reclen))
+    return;
+
+  fprintf(stderr, "mseed: %s has %i-byte records, kept until the day rollover\n", fn, 1 << DRL);
+  set_record_length(w, ch, 1 << DRL);
+}
+
+static void volume_path(mseed_writer *w, mseed_channel *ch, int Yr, int DoY, const char *suffix, char *fn, size_t len)
+{
+  const mseed_station *ms = &w->st[ch->sta];
+
+  // root/yyyy/ddd/NC.SIC.LI.CI.yyyy.ddd.mseed (station code without the padding), .mseed3 for miniSEED 3
+  snprintf(fn, len, "%s/%4i/%03i/%s.%.*s.%s.%s.%i.%03i.%s%s", ms->root, Yr, DoY, ms->NC, (int)strcspn(ms->SIC, " "), ms->SIC, ch->LI, ch->CI, Yr, DoY, (ms->v3) ? "mseed3" : "mseed", suffix);
+}
+
+static int used_records(int fd, int nrec, int reclen)
+{
+  char c;
+  int lo = 0, hi = nrec, mid;
+
+  // the last record is there (the Sequence Number never starts with a zero byte)
+  if ((nrec == 0) || ((pread(fd, &c, 1, (off_t)(nrec - 1) * reclen) == 1) && (c != 0)))
+    return nrec;
+
+  // records are written in order, so the zero-filled ones are all at the end
+  while (lo < hi)
+  {
+    mid = (lo + hi) / 2;
+    if ((pread(fd, &c, 1, (off_t)mid * reclen) == 1) && (c != 0))
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+static void close_volume(mseed_writer *w, mseed_channel *ch)
+{
+  // nothing may still be queued for the descriptor
+  submit_records(w);
+  unmap_volume(ch);
+  close(ch->fd);
+  ch->fd = -1;
+  if (ch->idx != -1)
+    close(ch->idx);
+  ch->idx = -1;
+}
+
+static void open_index(mseed_writer *w, mseed_channel *ch, const char *fn)
+{
+  mseed_index e;
+  struct stat st = {0};
+  char path[420];
+
+  if (!w->st[ch->sta].index)
+    return;
+
+  // root/yyyy/ddd/NC.SIC.LI.CI.yyyy.ddd.mseed.idx
+  snprintf(path, sizeof(path), "%s.idx", fn);
+  ch->idx = open(path, O_RDWR | O_CREAT, 0666);
+  if (ch->idx == -1)
+  {
+    perror(path);
+    return;
+  }
+
+  // an entry for every record of the volume, the last one ending where the volume does
+  fstat(ch->idx, &st);
+  if (st.st_size == (off_t)ch->nused * (off_t)sizeof(e))
+  {
+    if (ch->nused == 0)
+      return;
+    if ((pread(ch->idx, &e, sizeof(e), st.st_size - sizeof(e)) == sizeof(e)) && (memcmp(e.magic, "MSIX", 4) == 0) &&
+        (e.SeqNum == ch->nused) && (e.off + e.len == ((w->st[ch->sta].v3) ? ch->vend : (off_t)ch->nused * ch->reclen)))
+      return;
+  }
+  build_index(w, ch, path);
+}
+
+static void build_index(mseed_writer *w, mseed_channel *ch, const char *path)
+{
+  const mseed_station *ms = &w->st[ch->sta];
+  unsigned char h[MSEED_HDRLEN];
+  mseed_index e = {{'M', 'S', 'I', 'X'}};
+  off_t off = 0;
+  int n;
+
+  // an entry per record, from its header
+  if (ftruncate(ch->idx, 0) == -1)
+    perror(path);
+  for (n = 1; n <= ch->nused; n++)
+  {
+    if (pread(ch->fd, h, sizeof(h), off) < ((ms->v3) ? MSEED3_HDRLEN : MSEED_HDRLEN))
+      break;
+    e.SeqNum = n;
+    e.off = off;
+    if (ms->v3)
+    {
+      e.len = MSEED3_HDRLEN + h[offsetof(mseed3_header, SIDL)] + get16(h + offsetof(mseed3_header, EHL), 0) + get32(h + offsetof(mseed3_header, DL), 0);
+      e.NoS = get32(h + offsetof(mseed3_header, NoS), 0);
+      e.t = record_time3(h);
+    }
+    else
+    {
+      e.len = ch->reclen;
+      e.NoS = get16(h + offsetof(mseed_header, NoS), ms->big);
+      e.t = record_time(h, ms->big);
+    }
+    e.t_end = e.t + e.NoS / ms->fs;
+    if (pwrite(ch->idx, &e, sizeof(e), (off_t)(n - 1) * sizeof(e)) != sizeof(e))
+    {
+      perror(path);
+      break;
+    }
+    off += e.len;
+  }
+  if (ch->nused > 0)
+    fprintf(stderr, "mseed: %s built for %i records\n", path, n - 1);
+}
+
+static void index_record(mseed_writer *w, mseed_channel *ch, const unsigned char *rec, off_t off, int len)
+{
+  const mseed_station *st = &w->st[ch->sta];
+  mseed_index e = {{'M', 'S', 'I', 'X'}, ch->SeqNum, 0, len, off, ch->t_rec, 0};
+
+  if (ch->idx == -1)
+    return;
+  e.NoS = (st->v3) ? (int32_t)get32(rec + offsetof(mseed3_header, NoS), 0) : get16(rec + offsetof(mseed_header, NoS), st->big);
+  e.t_end = ch->t_rec + e.NoS / st->fs;
+
+  // (a record rewritten as it grows rewrites its entry; a lost entry only means a rebuild)
+  if (w->batching)
+    io_batch_write(&w->io, ch->idx, &e, sizeof(e), (off_t)(ch->SeqNum - 1) * sizeof(e));
+  else if (pwrite(ch->idx, &e, sizeof(e), (off_t)(ch->SeqNum - 1) * sizeof(e)) != sizeof(e))
+    perror("index_record");
+}
+
+static void map_volume(mseed_writer *w, mseed_channel *ch, double t)
+{
+  const mseed_station *st = &w->st[ch->sta];
+  int spr = (ch->NumSamp > 0) ? ch->NumSamp : STEIM_MIN_SAMP(ch->reclen);
+  double left = 86400.0 * (ch->day + 1) - t;
+
+  // (records in a volume with a tail file are only ever written whole)
+  if ((!st->mapped) | (st->tail) | (ch->fd == -1))
+    return;
+
+  // records closed every span seconds may hold fewer samples
+  if ((ch->span > 0) && (ch->span * st->fs < spr))
+    spr = (ch->span * st->fs < 1) ? 1 : (int)(ch->span * st->fs);
+
+  // the records already there and the ones the rest of the day takes
+  grow_volume(ch, ch->nused + (int)ceil(left * st->fs / spr) + 1);
+}
+
+static int grow_volume(mseed_channel *ch, int nrec)
+{
+  size_t len = (size_t)nrec * ch->reclen;
+  void *p = MAP_FAILED;
+
+  // reserve the blocks (a sparse file isn't mapped: a store into a page the
+  // disk or server can't back would kill the program with SIGBUS)
+  if (fallocate(ch->fd, 0, 0, (off_t)len) == 0)
+  {
+    if (ch->map == NULL)
+      p = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, ch->fd, 0);
+    else
+      p = mremap(ch->map, ch->maplen, len, MREMAP_MAYMOVE);
+  }
+
+  // carry on with pwrite()
+  if (p == MAP_FAILED)
+  {
+    perror("mseed: day volume not mapped");
+    unmap_volume(ch);
+    return -1;
+  }
+
+  ch->map = p;
+  ch->maplen = len;
+  return 0;
+}
+
+static int map_record(mseed_channel *ch)
+{
+  // the current record lies in the mapping (which grows by half if it doesn't)
+  if (ch->map == NULL)
+    return -1;
+  if ((size_t)ch->SeqNum * ch->reclen > ch->maplen)
+    return grow_volume(ch, ch->SeqNum + (int)(ch->maplen / ch->reclen / 2) + 1);
+  return 0;
+}
+
+static void unmap_volume(mseed_channel *ch)
+{
+  if (ch->map == NULL)
+    return;
+  munmap(ch->map, ch->maplen);
+  ch->map = NULL;
+  ch->maplen = 0;
+
+  // drop the preallocated records that weren't used
+  if (ftruncate(ch->fd, (off_t)ch->nused * ch->reclen) == -1)
+    perror("mseed: day volume not truncated");
+}
+
+static void resume_mseed(mseed_writer *w, mseed_channel *ch, double t, int nrec)
+{
+  unsigned char rec[MSEED_MAX_RECLEN];
+  mseed_checkpoint ck;
+  int last = nrec;
+
+  // the checkpoint names the last record (the file size is only the fallback)
+  if ((read_checkpoint(ch, &ck) == 0) && (ck.Yr == ch->Yr) && (ck.DoY == ch->DoY) &&
+      (ck.SeqNum >= 1) && (ck.SeqNum <= nrec))
+    last = ck.SeqNum;
+
+  // records written after the checkpoint that reached the disk
+  while ((last < nrec) && (read_record(w, ch, last + 1, rec) == 0))
+    last++;
+  ch->SeqNum = last + 1;
+
+  // the record must be one of this channel with the same sample rate
+  if (read_record(w, ch, last, rec) == -1)
+    return;
+  continue_record(w, ch, t, rec, last);
+}
+
+static void resume_tail(mseed_writer *w, mseed_channel *ch, double t, int nrec)
+{
+  unsigned char rec[MSEED_MAX_RECLEN];
+  char fn[420];
+  ssize_t n;
+  int fd;
+
+  volume_path(w, ch, ch->Yr, ch->DoY, ".tail", fn, sizeof(fn));
+  fd = open(fn, O_RDONLY);
+  if (fd == -1)
+    return;
+  n = pread(fd, rec, ch->reclen, 0);
+  close(fd);
+  ch->tailed = 1;
+
+  // only the record after the last one of the day volume (an older one is in it already)
+  if ((n != ch->reclen) || (check_record(w, ch, nrec + 1, rec) == -1))
+  {
+    drop_tail(w, ch);
+    return;
+  }
+  if (continue_record(w, ch, t, rec, nrec + 1) == 0)
+    return;
+
+  // the new samples start the record after it, so it is final as it is
+  // (with its own start time in the checkpoint and index)
+  ch->SeqNum = nrec + 1;
+  ch->t_rec = record_time(rec, w->st[ch->sta].big);
+  publish_record(w, ch, rec, 1);
+  ch->SeqNum = nrec + 2;
+}
+
+static void finish_tail(mseed_writer *w, mseed_channel *ch)
+{
+  unsigned char rec[MSEED_MAX_RECLEN];
+  mseed_checkpoint ck;
+  struct stat st = {0};
+  char fn[420], tail[420];
+  ssize_t n;
+  int fd;
+
+  // the tail record of the day the checkpoint was written on, if that was an earlier day
+  open_checkpoint(w, ch);
+  if ((read_checkpoint(ch, &ck) == -1) || ((ck.Yr == ch->Yr) & (ck.DoY == ch->DoY)))
+    return;
+  volume_path(w, ch, ck.Yr, ck.DoY, ".tail", tail, sizeof(tail));
+  fd = open(tail, O_RDONLY);
+  if (fd == -1)
+    return;
+  n = pread(fd, rec, ch->reclen, 0);
+  close(fd);
+  if ((n != ch->reclen) || (check_record(w, ch, ck.SeqNum, rec) == -1))
+    return;
+
+  // append it to its day volume, unless it is there already
+  volume_path(w, ch, ck.Yr, ck.DoY, "", fn, sizeof(fn));
+  fd = open(fn, O_RDWR);
+  if ((fd == -1) || (fstat(fd, &st) == -1))
+  {
+    perror(fn);
+    if (fd != -1)
+      close(fd);
+    return;
+  }
+  if (st.st_size == (off_t)(ck.SeqNum - 1) * ch->reclen)
+  {
+    if (pwrite(fd, rec, ch->reclen, st.st_size) == ch->reclen)
+      fprintf(stderr, "mseed: %s tail appended as record %i\n", fn, ck.SeqNum);
+    else
+      perror(fn);
+    fstat(fd, &st);
+  }
+  close(fd);
+  if (st.st_size >= (off_t)ck.SeqNum * ch->reclen)
+    unlink(tail);
+}
+
+static int continue_record(mseed_writer *w, mseed_channel *ch, double t, const unsigned char *rec, int SeqNum)
+{
+  const mseed_station *st = &w->st[ch->sta];
+  int32_t x[(MSEED_MAX_RECLEN - MSEED_HDRLEN) / 4 * 7];
+  mseed_checkpoint ck;
+  double t_rec;
+  uint16_t NoS;
+  int i, nframes = (ch->reclen - MSEED_HDRLEN) / STEIM_FRAME;
+
+  NoS = get16(rec + offsetof(mseed_header, NoS), st->big);
+  if ((NoS == 0) | ((ch->NumSamp > 0) & (NoS >= ch->NumSamp)))
+    return -1;
+
+  // start time of the record (exact from the checkpoint, to 100 us from the header)
+  if ((read_checkpoint(ch, &ck) == 0) && (ck.Yr == ch->Yr) && (ck.DoY == ch->DoY) && (ck.SeqNum == SeqNum) && (ck.NoS == NoS))
+    t_rec = ck.t_rec;
+  else
+    t_rec = record_time(rec, st->big);
+
+  // the new samples don't continue the record, which stays as it is
+  if (fabs(t - t_rec - NoS / st->fs) > 0.5 / st->fs)
+  {
+    fprintf(stderr, "mseed: %s.%s %i.%03i record %i not continued (gap), starting record %i\n", ch->LI, ch->CI, ch->Yr, ch->DoY, SeqNum, SeqNum + 1);
+    return -1;
+  }
+
+  // nor if its span ended with the sample before them
+  ch->t_end = record_end(w, ch, t_rec);
+  if (record_over(w, ch, t - 1 / st->fs))
+    return -1;
+
+  // pack the samples of a compressed record again (a full one can't take more)
+  if (is_steim(ch->EF))
+  {
+    if (steim_decode(rec + MSEED_HDRLEN, nframes, (ch->EF == 10) ? 1 : 2, NoS, x) != NoS)
+      return -1;
+    memcpy(ch->rec, rec, MSEED_HDRLEN);
+    steim_init(&ch->se, ch->se.level);
+    ch->se.last = steim_prior(rec + MSEED_HDRLEN, ch->se.level);
+    ch->se.have_last = 1;
+    steim_start(&ch->se, ch->rec + MSEED_HDRLEN, nframes);
+    for (i = 0; i < NoS; i++)
+    {
+      if (steim_add(&ch->se, x[i]))
+      {
+        steim_init(&ch->se, ch->se.level);
+        return -1;
+      }
+    }
+    ch->SampNum = steim_count(&ch->se) + 1;
+  }
+  else
+  {
+    memcpy(ch->rec, rec, ch->reclen);
+    ch->SampNum = NoS + 1;
+  }
+
+  ch->SeqNum = SeqNum;
+  ch->t_rec = t_rec;
+  ch->t_flush = t;
+  fprintf(stderr, "mseed: %s.%s %i.%03i resuming record %i (%i samples)\n", ch->LI, ch->CI, ch->Yr, ch->DoY, SeqNum, NoS);
+  return 0;
+}
+
+static int read_record(mseed_writer *w, mseed_channel *ch, int SeqNum, unsigned char *rec)
+{
+  // record SeqNum of the day volume
+  if (pread(ch->fd, rec, ch->reclen, (off_t)(SeqNum - 1) * ch->reclen) != ch->reclen)
+    return -1;
+  return check_record(w, ch, SeqNum, rec);
+}
+
+static int check_record(mseed_writer *w, mseed_channel *ch, int SeqNum, const unsigned char *rec)
+{
+  const mseed_header *h = &ch->hdr;
+  char SqNu[7];
+
+  // record SeqNum of this channel with the same sample rate, byte order and record length
+  snprintf(SqNu, sizeof(SqNu), "%06i", SeqNum);
+  if ((memcmp(rec, SqNu, 6) != 0) ||
+      (memcmp(rec + offsetof(mseed_header, SIC), h->SIC, 12) != 0) ||
+      (memcmp(rec + offsetof(mseed_header, SRF), h->SRF, 4) != 0) ||
+      (memcmp(rec + offsetof(mseed_header, EF), &h->EF, 3) != 0))
+    return -1;
+  return 0;
+}
+
+static int read_checkpoint(mseed_channel *ch, mseed_checkpoint *ck)
+{
+  if ((ch->ckpt == -1) || (pread(ch->ckpt, ck, sizeof(*ck), 0) != sizeof(*ck)) ||
+      (memcmp(ck->magic, "MSCP", 4) != 0) || (ck->EF != ch->EF))
+    return -1;
+  return 0;
+}
+
+static void open_checkpoint(mseed_writer *w, mseed_channel *ch)
+{
+  const mseed_station *ms = &w->st[ch->sta];
+  char fn[300];
+
+  if ((ch->ckpt != -1) | (ms->nockpt))
+    return;
+
+  // root/.checkpoint/NC.SIC.LI.CI
+  snprintf(fn, sizeof(fn), "%s/.checkpoint", ms->root);
+  if ((mkdir(fn, 0755) == -1) & (errno != EEXIST))
+    perror(fn);
+  snprintf(fn, sizeof(fn), "%s/.checkpoint/%s.%.*s.%s.%s", ms->root, ms->NC, (int)strcspn(ms->SIC, " "), ms->SIC, ch->LI, ch->CI);
+  ch->ckpt = open(fn, O_RDWR | O_CREAT, 0666);
+  if (ch->ckpt == -1)
+    perror(fn);
+}
+
+static void save_checkpoint(mseed_writer *w, mseed_channel *ch, const unsigned char *rec)
+{
+  mseed_checkpoint ck = {{'M', 'S', 'C', 'P'}, ch->Yr, ch->DoY, ch->SeqNum, 0, ch->EF, ch->t_rec};
+
+  if (ch->ckpt == -1)
+    return;
+  ck.NoS = get16(rec + offsetof(mseed_header, NoS), w->st[ch->sta].big);
+
+  // (a checkpoint ahead of the day volume is caught by the header checks of resume_mseed())
+  if (w->batching)
+  {
+    io_batch_write(&w->io, ch->ckpt, &ck, sizeof(ck), 0);
+    io_batch_sync(&w->io, ch->ckpt);
+    return;
+  }
+  if (pwrite(ch->ckpt, &ck, sizeof(ck), 0) != sizeof(ck))
+    perror("save_checkpoint");
+  fdatasync(ch->ckpt);
+}
+
+static void put_record(mseed_writer *w, mseed_channel *ch, const unsigned char *rec)
+{
+  off_t off = (off_t)(ch->SeqNum - 1) * ch->reclen;
+
+  // copy the record into a mapped day volume
+  if (map_record(ch) == 0)
+  {
+    memcpy(ch->map + off, rec, ch->reclen);
+    if (ch->SeqNum > ch->nused)
+      ch->nused = ch->SeqNum;
+    save_checkpoint(w, ch, rec);
+    return;
+  }
+
+  // queue the record and its checkpoint (io_batch_submit() reports a failed write)
+  if (w->batching)
+  {
+    io_batch_write(&w->io, ch->fd, rec, ch->reclen, off);
+    save_checkpoint(w, ch, rec);
+    return;
+  }
+
+  // write the whole record (header and samples) at once
+  if (pwrite(ch->fd, rec, ch->reclen, off) != ch->reclen)
+    perror("write_mseed_record");
+  else
+    save_checkpoint(w, ch, rec);
+}
+
+static void put_record3(mseed_writer *w, mseed_channel *ch, const unsigned char *rec, int final)
+{
+  size_t len = record_length(w, ch, rec);
+
+  // the record is the last one of the volume, so a rewrite that got shorter leaves nothing after it
+  if ((len < ch->vlen) && (ftruncate(ch->fd, ch->vend + (off_t)len) == -1))
+    perror("write_mseed_record");
+
+  if (w->batching)
+    io_batch_write(&w->io, ch->fd, rec, len, ch->vend);
+  else if (pwrite(ch->fd, rec, len, ch->vend) != (ssize_t)len)
+    perror("write_mseed_record");
+
+  // a final record is followed by the next one
+  ch->vlen = (final) ? 0 : len;
+  if (final)
+    ch->vend += (off_t)len;
+}
+
+static void publish_record(mseed_writer *w, mseed_channel *ch, const unsigned char *rec, int final)
+{
+  off_t off = ch->vend;
+
+  // miniSEED 3 records go wherever the last one ended, and a record that
+  // can still change goes to the tail file of the volume (and the index
+  // entry of a record follows it)
+  if (w->st[ch->sta].v3)
+  {
+    put_record3(w, ch, rec, final);
+    index_record(w, ch, rec, off, record_length(w, ch, rec));
+  }
+  else if ((w->st[ch->sta].tail) & (!final))
+    write_tail(w, ch, rec);
+  else
+  {
+    put_record(w, ch, rec);
+    index_record(w, ch, rec, (off_t)(ch->SeqNum - 1) * ch->reclen, ch->reclen);
+
+    // (a batched record is only written by io_batch_submit(), and the tail
+    // holds it until then)
+    if (w->batching)
+      ch->droptail = ch->tailed;
+    else
+      drop_tail(w, ch);
+  }
+
+  if (w->on_record != NULL)
+    w->on_record(w->on_arg, rec, record_length(w, ch, rec), final);
+}
+
+static void write_tail(mseed_writer *w, mseed_channel *ch, const unsigned char *rec)
+{
+  char fn[420], tmp[430];
+  int fd, err;
+
+  // the final record the old tail held is written before the tail is replaced
+  if (ch->droptail)
+    submit_records(w);
+
+  // readers find the old tail record or the new one, never part of one (and
+  // the record is on the disk before the checkpoint naming it is)
+  volume_path(w, ch, ch->Yr, ch->DoY, ".tail", fn, sizeof(fn));
+  snprintf(tmp, sizeof(tmp), "%s.tmp", fn);
+  fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  if (fd == -1)
+  {
+    perror(tmp);
+    return;
+  }
+  err = (pwrite(fd, rec, ch->reclen, 0) != ch->reclen) || (fdatasync(fd) == -1);
+  close(fd);
+  if ((err) || (rename(tmp, fn) == -1))
+  {
+    perror(fn);
+    return;
+  }
+
+  ch->tailed = 1;
+  save_checkpoint(w, ch, rec);
+}
+
+static void drop_tail(mseed_writer *w, mseed_channel *ch)
+{
+  char fn[420];
+
+  if (!ch->tailed)
+    return;
+  volume_path(w, ch, ch->Yr, ch->DoY, ".tail", fn, sizeof(fn));
+  if ((unlink(fn) == -1) & (errno != ENOENT))
+    perror(fn);
+  ch->tailed = 0;
+  ch->droptail = 0;
+}
+
+static void submit_records(mseed_writer *w)
+{
+  int i, failed;
+
+  // the tail files whose final records were in the batch go once it is
+  // written (and stay, to be checked on restart, if any write failed)
+  failed = io_batch_submit(&w->io);
+  for (i = 0; i < w->NumChan; i++)
+  {
+    if (!w->chan[i].droptail)
+      continue;
+    if (failed == 0)
+      drop_tail(w, &w->chan[i]);
+    w->chan[i].droptail = 0;
+  }
+}
+
+static double record_time(const unsigned char *h, int big)
+{
+  struct tm tt = {0};
+
+  tt.tm_year = get16(h + offsetof(mseed_header, Yr), big) - 1900;
+  tt.tm_mday = get16(h + offsetof(mseed_header, DoY), big); // timegm() normalizes day DoY of January
+  tt.tm_hour = h[offsetof(mseed_header, Hr)];
+  tt.tm_min = h[offsetof(mseed_header, Mn)];
+  tt.tm_sec = h[offsetof(mseed_header, Sc)];
+  return (double)timegm(&tt) + get16(h + offsetof(mseed_header, S0001), big) / 10000.0;
+}
+
+static double record_time3(const unsigned char *h)
+{
+  struct tm tt = {0};
+
+  tt.tm_year = get16(h + offsetof(mseed3_header, Yr), 0) - 1900;
+  tt.tm_mday = get16(h + offsetof(mseed3_header, DoY), 0);
+  tt.tm_hour = h[offsetof(mseed3_header, Hr)];
+  tt.tm_min = h[offsetof(mseed3_header, Mn)];
+  tt.tm_sec = h[offsetof(mseed3_header, Sc)];
+  return (double)timegm(&tt) + get32(h + offsetof(mseed3_header, NS), 0) / 1e9;
+}
+
+static double record_end(mseed_writer *w, mseed_channel *ch, double t_rec)
+{
+  const mseed_station *st = &w->st[ch->sta];
+  double d0 = 86400.0 * floor(t_rec / 86400);
+
+  // the first multiple of span seconds into the day after the first sample (0 = none)
+  if (ch->span == 0)
+    return 0;
+  return d0 + ch->span * (floor((t_rec - d0 + 0.5 / st->fs) / ch->span) + 1);
+}
+
+static int record_over(mseed_writer *w, mseed_channel *ch, double t)
+{
+  // the sample after the one at t would be at or past the end of the record's span
+  return (ch->span > 0) && (t + 1.5 / w->st[ch->sta].fs >= ch->t_end);
+}
+
+static void build_header(mseed_writer *w, mseed_channel *ch)
+{
+  const mseed_station *st = &w->st[ch->sta];
+  mseed_header *h = &ch->hdr;
+  int DRL = 0;
+
+  if (st->v3)
+  {
+    build_header3(w, ch);
+    return;
+  }
+  ch->hdrlen = MSEED_HDRLEN;
+  memset(h, 0, sizeof(*h));
+  while ((1 << DRL) < ch->reclen)
+    DRL++;
+
+  // Fixed Section of Data Header (48 bytes)
+  memcpy(h->SeqNum, "000000", 6);            // Sequence Number
+  h->DQI = 'D';                              // Data Quality Indicator
+  h->Reserved = ' ';                         // Reserved Byte
+  memcpy(h->SIC, st->SIC, 5);                // Station Identifier Code
+  memcpy(h->LI, ch->LI, 2);                  // Location Identifier
+  memcpy(h->CI, ch->CI, 3);                  // Channel Identifier
+  memcpy(h->NC, st->NC, 2);                  // Network Code
+  h->Unused = ' ';                           // Skip 1 Byte (unused)
+  put16(h->SRF, (uint16_t)st->SRF, st->big); // Sample Rate Factor
+  put16(h->SRM, (uint16_t)st->SRM, st->big); // Sample Rate Multiplier
+  h->NB = 1;                                 // Number Blockettes to Follow
+  put16(h->OBD, MSEED_HDRLEN, st->big);      // Offset to the Beginning of Data
+  put16(h->OFB, 48, st->big);                // Offset to the First Blockette
+  put16(h->BT, 1000, st->big);               // Blockette Type
+
+  // [1000] Data Only SEED Blockette (8 bytes)
+  h->EF = ch->EF;                            // Encoding Format
+  h->WO = (st->big | is_steim(ch->EF));      // Word Order (little endian headers with Steim frames give 1, as always)
+  h->DRL = (unsigned char)DRL;               // Data Record Length (12, since 2^12 = 4096, by default)
+}
+
+static void build_header3(mseed_writer *w, mseed_channel *ch)
+{
+  const mseed_station *st = &w->st[ch->sta];
+  mseed3_header *h = (mseed3_header *)ch->hdr3;
+  char sid[MSEED3_MAX_SID + 1];
+  double SR = (st->fs >= 1) ? st->fs : -1 / st->fs;
+  uint64_t u64;
+  int n;
+
+  memset(ch->hdr3, 0, sizeof(ch->hdr3));
+
+  // FDSN Source Identifier (the codes without their padding, the Channel
+  // Identifier split into band, source and subsource)
+  n = snprintf(sid, sizeof(sid), "FDSN:%s_%.*s_%.*s_%c_%c_%.*s", st->NC, (int)strcspn(st->SIC, " "), st->SIC, (int)strcspn(ch->LI, " "), ch->LI,
+               ch->CI[0], ch->CI[1], (int)strcspn(ch->CI + 2, " "), ch->CI + 2);
+  memcpy(ch->hdr3 + MSEED3_HDRLEN, sid, n);
+  ch->hdrlen = MSEED3_HDRLEN + n;
+
+  // Fixed Header (40 bytes)
+  memcpy(h->MS, "MS", 2);                    // Record Header Indicator
+  h->FV = 3;                                 // Format Version
+  h->EF = ch->EF;                            // Encoding Format
+  memcpy(&u64, &SR, sizeof(u64));
+  put64(h->SR, u64, 0);                      // Sample Rate (or the negated Sample Period, below 1 Hz)
+  h->PV = 1;                                 // Data Publication Version
+  h->SIDL = (unsigned char)n;                // Length of Identifier
+}
+
+static void write_mseed_header(mseed_writer *w, mseed_channel *ch, double t)
+{
+  const mseed_station *st = &w->st[ch->sta];
+  unsigned char *h = ch->rec;
+  char SqNu[7];
+  time_t t_temp;
+  struct tm tt;
+  uint64_t isc; uint32_t usc, S0001;
+
+  if (st->v3)
+  {
+    write_mseed3_header(w, ch, t);
+    return;
+  }
+
+  // start from the template and a zero-filled data block
+  memcpy(h, &ch->hdr, MSEED_HDRLEN);
+  memset(h + MSEED_HDRLEN, 0, ch->reclen - MSEED_HDRLEN);
+
+  // recompute isec and usec to match t (in units of 100 us, carried into
+  // the seconds when t rounds up to the next one)
+  isc = (uint64_t)t;
+  usc = (uint32_t)round(1000000 * (t - isc));
+  S0001 = usc / 100;
+  if (S0001 >= 10000)
+  {
+    isc++;
+    S0001 -= 10000;
+  }
+  t_temp = (time_t)isc;
+  gmtime_r(&t_temp, &tt);
+
+  // patch the Sequence Number and start time
+  snprintf(SqNu, sizeof(SqNu), "%06i", ch->SeqNum);
+  memcpy(h + offsetof(mseed_header, SeqNum), SqNu, 6);
+  put16(h + offsetof(mseed_header, Yr), (uint16_t)(tt.tm_year + 1900), st->big);
+  put16(h + offsetof(mseed_header, DoY), (uint16_t)(tt.tm_yday + 1), st->big);
+  h[offsetof(mseed_header, Hr)] = (uint8_t)tt.tm_hour;
+  h[offsetof(mseed_header, Mn)] = (uint8_t)tt.tm_min;
+  h[offsetof(mseed_header, Sc)] = (uint8_t)tt.tm_sec;
+  put16(h + offsetof(mseed_header, S0001), (uint16_t)S0001, st->big);
+
+  ch->t_flush = t;
+  ch->t_stream = t;
+  ch->t_rec = t;
+  ch->t_end = record_end(w, ch, t);
+}
+
+static void write_mseed3_header(mseed_writer *w, mseed_channel *ch, double t)
+{
+  unsigned char *h = ch->rec;
+  time_t t_temp;
+  struct tm tt;
+  uint64_t isc; uint32_t nsc;
+
+  // start from the template and a zero-filled data block
+  memcpy(h, ch->hdr3, ch->hdrlen);
+  memset(h + ch->hdrlen, 0, ch->reclen - ch->hdrlen);
+
+  // the start time to the nanosecond
+  isc = (uint64_t)t;
+  nsc = (uint32_t)round(1e9 * (t - isc));
+  if (nsc >= 1000000000)
+  {
+    isc++;
+    nsc -= 1000000000;
+  }
+  t_temp = (time_t)isc;
+  gmtime_r(&t_temp, &tt);
+  put32(h + offsetof(mseed3_header, NS), nsc, 0);
+  put16(h + offsetof(mseed3_header, Yr), (uint16_t)(tt.tm_year + 1900), 0);
+  put16(h + offsetof(mseed3_header, DoY), (uint16_t)(tt.tm_yday + 1), 0);
+  h[offsetof(mseed3_header, Hr)] = (uint8_t)tt.tm_hour;
+  h[offsetof(mseed3_header, Mn)] = (uint8_t)tt.tm_min;
+  h[offsetof(mseed3_header, Sc)] = (uint8_t)tt.tm_sec;
+
+  ch->t_flush = t;
+  ch->t_stream = t;
+  ch->t_rec = t;
+  ch->t_end = record_end(w, ch, t);
+}
+
+static void put_nos(mseed_writer *w, mseed_channel *ch, unsigned char *rec, int NoS)
+{
+  if (w->st[ch->sta].v3)
+    put32(rec + offsetof(mseed3_header, NoS), (uint32_t)NoS, 0);
+  else
+    put16(rec + offsetof(mseed_header, NoS), (uint16_t)NoS, w->st[ch->sta].big);
+}
+
+static void seal_record3(mseed_channel *ch, unsigned char *rec, int nframes)
+{
+  uint32_t len;
+
+  // the data payload is the Steim frames in use or the samples
+  if (is_steim(ch->EF))
+    len = (uint32_t)nframes * STEIM_FRAME;
+  else
+    len = get32(rec + offsetof(mseed3_header, NoS), 0) * sample_size(ch->EF);
+  put32(rec + offsetof(mseed3_header, DL), len, 0);
+
+  // CRC-32C of the whole record, taken with the CRC field zero
+  memset(rec + offsetof(mseed3_header, CRC), 0, 4);
+  put32(rec + offsetof(mseed3_header, CRC), crc32c(rec, ch->hdrlen + len), 0);
+}
+
+static uint32_t crc32c(const unsigned char *p, size_t len)
+{
+  // reflected Castagnoli polynomial 0x82F63B78, a nibble at a time
+  static const uint32_t tab[16] = {
+    0x00000000, 0x105EC76F, 0x20BD8EDE, 0x30E349B1, 0x417B1DBC, 0x5125DAD3, 0x61C69362, 0x7198540D,
+    0x82F63B78, 0x92A8FC17, 0xA24BB5A6, 0xB21572C9, 0xC38D26C4, 0xD3D3E1AB, 0xE330A81A, 0xF36E6F75};
+  uint32_t crc = 0xFFFFFFFF;
+  size_t i;
+
+  for (i = 0; i < len; i++)
+  {
+    crc ^= p[i];
+    crc = (crc >> 4) ^ tab[crc & 15];
+    crc = (crc >> 4) ^ tab[crc & 15];
+  }
+  return ~crc;
+}
+
+static void put16(unsigned char *p, uint16_t v, int big)
+{
+  if (big)
+  {
+    p[0] = (unsigned char)(v >> 8);
+    p[1] = (unsigned char)v;
+  }
+  else
+  {
+    p[0] = (unsigned char)v;
+    p[1] = (unsigned char)(v >> 8);
+  }
+}
+
+static void put32(unsigned char *p, uint32_t v, int big)
+{
+  int i;
+
+  for (i = 0; i < 4; i++)
+    p[(big) ? 3 - i : i] = (unsigned char)(v >> (8 * i));
+}
+
+static void put64(unsigned char *p, uint64_t v, int big)
+{
+  int i;
+
+  for (i = 0; i < 8; i++)
+    p[(big) ? 7 - i : i] = (unsigned char)(v >> (8 * i));
+}
+
+static uint16_t get16(const unsigned char *p, int big)
+{
+  return (big) ? (uint16_t)((p[0] << 8) | p[1]) : (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get32(const unsigned char *p, int big)
+{
+  uint32_t v = 0;
+  int i;
+
+  for (i = 0; i < 4; i++)
+    v |= (uint32_t)p[(big) ? 3 - i : i] << (8 * i);
+  return v;
+}
+
+static void write_mseed_record(mseed_writer *w, mseed_channel *ch, int final)
+{
+  unsigned char buf[MSEED_MAX_RECLEN];
+  struct stat st = {0};
+  char SqNu[12], fn[400];
+  int nrec;
+
+  // the day volume was deleted during data acquisition (how rude!), so
+  // recreate it and make the current record its first one
+  if ((fstat(ch->fd, &st) == 0) & (st.st_nlink == 0))
+  {
+    close_volume(w, ch);
+    w->st[ch->sta].dirday = -1;
+    open_mseed(w, ch);
+    map_volume(w, ch, ch->t_rec);
+    ch->SeqNum = 1;
+    snprintf(SqNu, sizeof(SqNu), "%06i", ch->SeqNum);
+    if (!w->st[ch->sta].v3)
+      memcpy(ch->rec, SqNu, 6);
+  }
+
+  // the day volume couldn't be opened (e.g., the NFS export was away, or the
+  // disk full), so try again every MSEED_RETRY seconds, going on after the
+  // records it holds; until then final records are dropped (and said so)
+  if ((ch->fd == -1) && (ch->t_rec - ch->t_retry >= MSEED_RETRY))
+  {
+    ch->t_retry = ch->t_rec;
+    w->st[ch->sta].dirday = -1;
+    nrec = open_mseed(w, ch);
+    if (ch->fd != -1)
+    {
+      map_volume(w, ch, ch->t_rec);
+      ch->SeqNum = nrec + 1;
+      snprintf(SqNu, sizeof(SqNu), "%06i", ch->SeqNum);
+      if (!w->st[ch->sta].v3)
+        memcpy(ch->rec, SqNu, 6);
+      volume_path(w, ch, ch->Yr, ch->DoY, "", fn, sizeof(fn));
+      fprintf(stderr, "mseed: %s open again, %lu records were dropped\n", fn, ch->lost);
+      ch->lost = 0;
+    }
+  }
+  if (ch->fd == -1)
+  {
+    if (final)
+    {
+      ch->lost++;
+      volume_path(w, ch, ch->Yr, ch->DoY, "", fn, sizeof(fn));
+      fprintf(stderr, "mseed: %s can't be opened, record %i dropped\n", fn, ch->SeqNum);
+    }
+    return;
+  }
+
+  publish_record(w, ch, ready_record(w, ch, buf), final);
+}
+
+static unsigned char *ready_record(mseed_writer *w, mseed_channel *ch, unsigned char *buf)
+{
+  // compress the queued samples into a copy of a Steim record (in buf),
+  // leaving the encoder free to pack them densely as more samples arrive
+  if (is_steim(ch->EF))
+  {
+    steim_encoder se = ch->se;
+
+    memcpy(buf, ch->rec, ch->reclen);
+    se.frames = buf + ch->hdrlen;
+    steim_finish(&se);
+    put_nos(w, ch, buf, se.nsamp);
+    if (w->st[ch->sta].v3)
+      seal_record3(ch, buf, steim_frames(&se));
+    return buf;
+  }
+
+  if (w->st[ch->sta].v3)
+    seal_record3(ch, ch->rec, 0);
+  return ch->rec;
+}
+
+static void stream_record(mseed_writer *w, mseed_channel *ch, double t)
+{
+  unsigned char buf[MSEED_MAX_RECLEN], *rec;
+
+  // the record being filled, for the callback only
+  ch->t_stream = t;
+  if (w->on_record == NULL)
+    return;
+  rec = ready_record(w, ch, buf);
+  w->on_record(w->on_arg, rec, record_length(w, ch, rec), 0);
+}
+
+static int record_length(mseed_writer *w, mseed_channel *ch, const unsigned char *rec)
+{
+  // (miniSEED 3 records are only as long as their data)
+  if (w->st[ch->sta].v3)
+    return ch->hdrlen + (int)get32(rec + offsetof(mseed3_header, DL), 0);
+  return ch->reclen;
+}
+
+static void flush_mseed_channel(mseed_writer *w, mseed_channel *ch)
+{
+  // nothing has been added since the last full record
+  if ((ch->day == -1) | (ch->SampNum == 1))
+    return;
+
+  write_mseed_record(w, ch, 0);
+}
+
+static void end_mseed_record(mseed_writer *w, mseed_channel *ch, int final)
+{
+  // nothing has been added since the last full record
+  if ((ch->day == -1) | (ch->SampNum == 1))
+    return;
+
+  // every queued Steim sample goes into this day volume, even if it takes another record
+  if (is_steim(ch->EF))
+  {
+    while (steim_finish(&ch->se))
+      next_steim_record(w, ch);
+  }
+
+  write_mseed_record(w, ch, final);
+  ch->SampNum = 1;
+}
+
+static void write_steim(mseed_writer *w, mseed_channel *ch, double t, int32_t x)
+{
+  const mseed_station *st = &w->st[ch->sta];
+  int full;
+
+  // the first sample to be written to a new data record block
+  if (ch->SampNum == 1)
+  {
+    write_mseed_header(w, ch, t);
+    steim_start(&ch->se, ch->rec + ch->hdrlen, (ch->reclen - ch->hdrlen) / STEIM_FRAME);
+  }
+
+  // write each full record and carry the leftover samples into the next one
+  full = steim_add(&ch->se, x);
+  while (full)
+    full = next_steim_record(w, ch);
+  ch->SampNum = steim_count(&ch->se) + 1;
+
+  // the last sample before the end of the record's span makes it final
+  if (record_over(w, ch, t))
+  {
+    end_mseed_record(w, ch, 1);
+    ch->SeqNum++;
+    return;
+  }
+
+  // the record is only written every flush interval
+  if ((st->flush > 0) && (t - ch->t_flush >= st->flush))
+  {
+    write_mseed_record(w, ch, 0);
+    ch->t_flush = t;
+  }
+  else if ((st->stream > 0) && (t - ch->t_stream >= st->stream))
+    stream_record(w, ch, t);
+}
+
+static int next_steim_record(mseed_writer *w, mseed_channel *ch)
+{
+  // finish the full record
+  put_nos(w, ch, ch->rec, ch->se.nsamp);
+  write_mseed_record(w, ch, 1);
+  ch->SeqNum++;
+
+  // the next record starts with the first leftover sample
+  ch->t_rec += ch->se.nsamp / w->st[ch->sta].fs;
+  write_mseed_header(w, ch, ch->t_rec);
+  return steim_start(&ch->se, ch->rec + ch->hdrlen, (ch->reclen - ch->hdrlen) / STEIM_FRAME);
+}
+
+static int is_steim(uint8_t EF)
+{
+  return (EF == 10) | (EF == 11);
+}
+
+static int sample_size(uint8_t EF)
+{
+  switch (EF)
+  {
+    case 1:
+      return sizeof(int16_t);
+    case 3:
+      return sizeof(int32_t);
+    case 4:
+      return sizeof(float);
+    default: // EF = 5
+      return sizeof(double);
+  }
+}
@@ -0,0 +1,339 @@
+// miniSEED day volume writer shared by the data acquisition programs
+//
+// by: Scott DeWolf
+//
+//  created: Saturday, October 17, 2026 (2026290)
+// modified: Saturday, October 17, 2026 (2026290)
+//  history:
+//           [2026290] - created document from the write_mseed() copies in the *_daq.c programs
+//           [2026290] - added Steim-1 and Steim-2 encodings for integer channels
+//           [2026290] - added the writer thread and sample queue (mseed_start_writer)
+//           [2026290] - added stations (mseed_add_station) so one writer serves several instruments
+//           [2026290] - resume the last record of a day volume on restart (checkpoint files)
+//           [2026290] - create the day directories once per station and day
+//           [2026290] - added write_mseed_frame() and batched record writes (io_batch)
+//           [2026290] - added preallocated, memory-mapped day volumes (mseed_map_volumes)
+//           [2026290] - added final-only day volumes with a tail file (mseed_tail_records)
+//           [2026290] - headers are copied from a per-channel template (mseed_header), either byte order
+//           [2026290] - record length (512 to 8192 bytes) and record closing interval per channel
+//           [2026290] - added FDSN miniSEED 3 day volumes (mseed_format3)
+//           [2026290] - records can be handed to a callback as well (mseed_on_record, mseed_stream_records)
+//           [2026290] - day volumes can have a time index (mseed_index_volumes, mseed_index)
+//           [2026290] - stations can go without checkpoint files (mseed_skip_checkpoints)
+//           [2026290] - a day volume that can't be opened is tried again every MSEED_RETRY seconds
+//           [2026290] - day volumes are only mapped where fallocate() reserves their blocks
+//           [2026290] - tail files are synced, and only removed once the final record is written
+//           [2026290] - added mseed_io_stats() (close_mseed() no longer prints the batch counters)
+//           [2026290] - the notes on each feature from mseed_writer.c are with their functions
+//
+
+#ifndef MSEED_WRITER_H
+#define MSEED_WRITER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <sys/types.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include "steim.h"
+#include "spsc_ring.h"
+#include "io_batch.h"
+
+#define MSEED_RECLEN 4096  // Data Record Length of a channel unless mseed_record_length() sets it (2^12)
+#define MSEED_MIN_RECLEN 512  // shortest Data Record Length (2^9)
+#define MSEED_MAX_RECLEN 8192 // longest Data Record Length (2^13)
+#define MSEED_HDRLEN 64    // Offset to the Beginning of Data
+#define MSEED3_HDRLEN 40   // fixed header of a miniSEED 3 record (the identifier follows it)
+#define MSEED3_MAX_SID 32  // longest FDSN Source Identifier written (FDSN:NC_SIC_LI_B_S_SS)
+#define MSEED_MAX_CHAN 64  // most channels a single writer holds
+#define MSEED_MAX_STATION 8 // most stations (instruments) a single writer holds
+#define MSEED_RETRY 10     // seconds (of sample time) between attempts to open a day volume that couldn't be
+
+// Fixed Section of Data Header and [1000] Data Only SEED Blockette as they
+// are laid out in a record (MSEED_HDRLEN bytes). The multi-byte fields are
+// byte arrays in the byte order of the record, so the struct has no padding
+// and doesn't depend on the byte order of the host.
+typedef struct
+{
+  char SeqNum[6];                   // Sequence Number (ASCII, patched per record)
+  char DQI;                         // Data Quality Indicator
+  char Reserved;                    // Reserved Byte
+  char SIC[5];                      // Station Identifier Code
+  char LI[2];                       // Location Identifier
+  char CI[3];                       // Channel Identifier
+  char NC[2];                       // Network Code
+  unsigned char Yr[2];              // Year (patched per record)
+  unsigned char DoY[2];             // Day of Year (patched per record)
+  unsigned char Hr, Mn, Sc;         // Hours, Minutes, Seconds (patched per record)
+  unsigned char Unused;             // Skip 1 Byte
+  unsigned char S0001[2];           // Seconds0001 (patched per record)
+  unsigned char NoS[2];             // Number of Samples (patched per sample)
+  unsigned char SRF[2], SRM[2];     // Sample Rate Factor and Multiplier
+  unsigned char AF, IOF, DQF;       // Activity, IO and Data Quality Flags
+  unsigned char NB;                 // Number Blockettes to Follow
+  unsigned char TC[4];              // Time Correction
+  unsigned char OBD[2];             // Offset to the Beginning of Data
+  unsigned char OFB[2];             // Offset to the First Blockette
+  unsigned char BT[2];              // Blockette Type (1000)
+  unsigned char ONB[2];             // Offset to the Next Blockette
+  unsigned char EF;                 // Encoding Format
+  unsigned char WO;                 // Word Order (0 = little endian, 1 = big endian)
+  unsigned char DRL;                // Data Record Length exponent
+  unsigned char Reserved1000;       // Reserved
+  unsigned char Pad[8];             // up to the data
+} mseed_header;
+
+// fixed header of an FDSN miniSEED 3 record (MSEED3_HDRLEN bytes, always
+// little endian), followed by the Source Identifier and the data payload
+typedef struct
+{
+  char MS[2];                       // Record Header Indicator ("MS")
+  unsigned char FV;                 // Format Version (3)
+  unsigned char Flags;              // Flags
+  unsigned char NS[4];              // Nanosecond (patched per record)
+  unsigned char Yr[2];              // Year (patched per record)
+  unsigned char DoY[2];             // Day of Year (patched per record)
+  unsigned char Hr, Mn, Sc;         // Hour, Minute, Second (patched per record)
+  unsigned char EF;                 // Encoding Format
+  unsigned char SR[8];              // Sample Rate (Hz, or the negated period in seconds), float64
+  unsigned char NoS[4];             // Number of Samples (patched per sample)
+  unsigned char CRC[4];             // CRC-32C of the record with this field zero (patched per write)
+  unsigned char PV;                 // Data Publication Version
+  unsigned char SIDL;               // Length of Identifier
+  unsigned char EHL[2];             // Length of Extra Headers
+  unsigned char DL[4];              // Length of Data Payload (patched per write)
+} mseed3_header;
+
+// entry of the time index of a day volume (root/yyyy/ddd/NC.SIC.LI.CI.yyyy.ddd.mseed.idx),
+// one per record, at (SeqNum - 1) * sizeof(mseed_index), in the byte order of the host
+typedef struct
+{
+  char magic[4];                    // "MSIX"
+  int32_t SeqNum;                   // record (1-based)
+  int32_t NoS;                      // Number of Samples
+  int32_t len;                      // bytes of the record
+  int64_t off;                      // where the record starts in the day volume
+  double t, t_end;                  // first sample, and when the sample after the last is due
+} mseed_index;
+
+// state of one channel: the open day volume and the record being filled
+typedef struct
+{
+  char LI[3];                       // Location Identifier
+  char CI[4];                       // Channel Identifier
+  uint8_t EF;                       // Encoding Format (1 = int16, 3 = int32, 4 = float32, 5 = float64,
+                                    //                  10 = Steim-1, 11 = Steim-2)
+  int sta;                          // station of the channel (index into mseed_writer.st)
+  int setlen;                       // Data Record Length of the channel (a power of 2 from MSEED_MIN_RECLEN to MSEED_MAX_RECLEN)
+  int reclen;                       // Data Record Length of the open day volume (setlen unless it was written with another)
+  double span;                      // seconds a record covers at most (0 = records close when full)
+  int NumSamp;                      // (Record Length - Header Size) / Data Size (0 = compressed)
+  int SeqNum, SampNum;              // current record and next sample within it (both 1-based)
+  int day;                          // days since the epoch of the open day volume (-1 = none)
+  int Yr, DoY;                      // year and day of year of the open day volume
+  int fd;                           // descriptor of the open day volume (-1 = none)
+  int ckpt;                         // descriptor of the checkpoint file (-1 = none)
+  int idx;                          // descriptor of the time index of the day volume (-1 = none)
+  unsigned char *map;               // mapped day volume (NULL = written with pwrite)
+  size_t maplen;                    // bytes preallocated and mapped
+  int nused;                        // records in the day volume (its length once truncated)
+  int tailed;                       // the tail file of the day volume may exist
+  int droptail;                     // remove the tail file once the batch holding the final record is written
+  mseed_header hdr;                 // header of every record, built by mseed_add_channel()
+  unsigned char hdr3[MSEED3_HDRLEN + MSEED3_MAX_SID]; // header and identifier of every miniSEED 3 record
+  int hdrlen;                       // bytes before the data (MSEED_HDRLEN, or the miniSEED 3 header and identifier)
+  off_t vend;                       // end of the final records of a miniSEED 3 day volume
+  size_t vlen;                      // bytes of the current miniSEED 3 record written at vend (0 = none)
+  double t_flush;                   // sample time the current record was last written
+  double t_rec;                     // sample time of the first sample of the current record
+  double t_end;                     // the current record is closed after the last sample before this (span > 0)
+  double t_stream;                  // sample time the current record was last handed to on_record
+  double t_retry;                   // sample time the day volume was last tried (while fd = -1)
+  unsigned long lost;               // final records dropped because the day volume couldn't be opened
+  steim_encoder se;                 // compression state (EF = 10 or 11)
+  unsigned char rec[MSEED_MAX_RECLEN]; // record being filled (header + samples, reclen bytes)
+} mseed_channel;
+
+// one sample handed from the sampling loop to the writer thread
+typedef struct
+{
+  int chan_idx;                     // channel
+  int flush;                        // write the partial record instead of adding a sample
+  double t, data;                   // sample time and value
+} mseed_sample;
+
+// settings shared by the channels of one station (or one instrument of it)
+typedef struct
+{
+  char root[200];                      // /home/station/Data
+  char NC[3];                          // Network Code
+  char SIC[6];                         // Station Identifier Code (space padded)
+  int16_t SRF, SRM;                    // Sample Rate Factor and Multiplier
+  double fs;                           // sample rate (Hz) given by SRF and SRM
+  double flush;                        // seconds between writes of a partial record (0 = only full records)
+  int dirday;                          // day whose root/yyyy/ddd directories exist (-1 = none yet)
+  int mapped;                          // day volumes are preallocated and mapped (mseed_map_volumes)
+  int tail;                            // records being filled go to tail files (mseed_tail_records)
+  int big;                             // records are big endian (mseed_big_endian)
+  int v3;                              // records are miniSEED 3 (mseed_format3)
+  int index;                           // day volumes have a time index (mseed_index_volumes)
+  int nockpt;                          // no checkpoint files (mseed_skip_checkpoints)
+  double stream;                       // seconds between records being filled handed to on_record (0 = at flushes only)
+} mseed_station;
+
+// called with every record written (final or not) and, every stream
+// interval, the record being filled (see mseed_on_record)
+typedef void (*mseed_record_fn)(void *arg, const unsigned char *rec, int len, int final);
+
+// the stations and channels written by one program
+typedef struct
+{
+  int NumStation;
+  mseed_station st[MSEED_MAX_STATION];
+  int NumChan;
+  mseed_channel chan[MSEED_MAX_CHAN];
+
+  // writer thread (only used after mseed_start_writer)
+  int async;                           // samples are queued for the writer thread
+  spsc_ring queue;                     // samples waiting to be written
+  sem_t ready;                         // posted for every queued sample
+  pthread_t thread;
+  atomic_int stop;                     // set by close_mseed() to end the writer thread
+  size_t max_depth;                    // most samples ever waiting in the queue
+  unsigned long drops;                 // samples lost because the queue was full
+  int dropping;                        // the queue is full right now
+
+  // records are also handed to on_record(on_arg, ...) (NULL = none)
+  mseed_record_fn on_record;
+  void *on_arg;
+
+  // record and checkpoint writes of a frame (or of a drained queue) go out together
+  io_batch io;
+  int batching;                        // writes are queued in io until io_batch_submit()
+} mseed_writer;
+
+// set up a writer for the station; day volumes go to root/yyyy/ddd/NC.SIC.LI.CI.yyyy.ddd.mseed
+// and the checkpoint of each channel (its last record written) to root/.checkpoint/NC.SIC.LI.CI.
+// The checkpoint is synced after every record; on a restart during the day it
+// says which record was the last one (a record written after it is found by
+// reading the next header), and if the new samples continue that record at
+// the sample rate it is filled up instead of being left half empty (Steim
+// records are decoded and packed again)
+void mseed_init(mseed_writer *w, const char *root, const char *NC, const char *SIC, int16_t SRF, int16_t SRM, double flush);
+
+// add another station, e.g., a second instrument with its own sample rate, and
+// return its index; the channels registered after it belong to it
+int mseed_add_station(mseed_writer *w, const char *root, const char *NC, const char *SIC, int16_t SRF, int16_t SRM, double flush);
+
+// register a channel of the last station and return its chan_idx; integer
+// channels may use EF = 10 (Steim-1) or 11 (Steim-2) to compress their records;
+// samples that don't fit in a full Steim record carry over to the next one,
+// and a partial one is written from a copy of the encoder, so flushing doesn't
+// change how the record is packed once it fills
+int mseed_add_channel(mseed_writer *w, const char *LI, const char *CI, uint8_t EF);
+
+// give a channel records of reclen bytes (a power of 2 from MSEED_MIN_RECLEN
+// to MSEED_MAX_RECLEN) instead of MSEED_RECLEN, and, if span > 0, close each
+// record at the latest after the last sample before the next multiple of span
+// seconds into the day, even if it isn't full, e.g., span = 600 makes a slow
+// channel's records final every 10 minutes; call it before the first sample
+// of the channel. Returns -1 if reclen isn't allowed. A day volume that
+// already holds records of another length keeps its length for that day.
+int mseed_record_length(mseed_writer *w, int chan_idx, int reclen, double span);
+
+// preallocate the day volumes of the last station with fallocate() (sized for
+// the rest of the day from the sample rate and encoding), map them and store
+// the samples of fixed-size encodings straight into the mapped record; each
+// volume is truncated to the records it holds at the day rollover and on close.
+// A volume is grown by half if gaps take more records than expected, and the
+// zero-filled records a crash leaves at its end are cut off when it is opened
+// again. A volume on a file system without fallocate() (e.g., NFSv3) is written
+// with pwrite() instead, since a store into a sparse page the disk can't back
+// raises SIGBUS.
+void mseed_map_volumes(mseed_writer *w);
+
+// write only final records to the day volumes of the last station (each
+// with one pwrite() appending it), and the record being filled to the tail
+// file root/yyyy/ddd/NC.SIC.LI.CI.yyyy.ddd.mseed.tail, replaced with
+// rename() every flush interval and on close; the tail record is the next
+// record of the volume if its Sequence Number follows the volume's last one.
+// On restart the tail record is resumed; one left behind on an earlier day is
+// appended to its own volume first. Overrides mseed_map_volumes().
+void mseed_tail_records(mseed_writer *w);
+
+// write the headers and samples of the last station's records big endian
+// (Word Order = 1) instead of little endian; Steim frames always are
+void mseed_big_endian(mseed_writer *w);
+
+// write the day volumes of the last station as FDSN miniSEED 3 instead of
+// miniSEED 2.4, to root/yyyy/ddd/NC.SIC.LI.CI.yyyy.ddd.mseed3: little endian
+// records with nanosecond start times, the Source Identifier
+// FDSN:NC_SIC_LI_B_S_SS and a CRC-32C. A record is only as long as the
+// samples it holds (at most the channel's record length), so one closed by
+// a gap, the span or the day rollover is short. The next record follows the
+// last complete one of a volume opened again (a record cut off by a crash is
+// truncated); records aren't resumed. The
+// station's records are neither mapped, nor tailed, nor big endian.
+void mseed_format3(mseed_writer *w);
+
+// keep a time index next to each day volume of the last station, NC.SIC.LI.CI.yyyy.ddd.mseed.idx
+// (or .mseed3.idx): an mseed_index entry per record, written along with the
+// record (batched like the checkpoint, but not synced), so a reader can find
+// the records of a time window without reading every header (see mseed_read.h).
+// An index that doesn't match the volume it is opened with is built again from
+// the headers.
+void mseed_index_volumes(mseed_writer *w);
+
+// write no checkpoint files for the channels of the last station, e.g., for
+// a program that writes whole day volumes at once; the last record of a day
+// volume opened again is then found from the volume alone
+void mseed_skip_checkpoints(mseed_writer *w);
+
+// hand every record written to fn (in the thread that writes it, so fn must
+// not block): final records, and partial ones when they are written at the
+// flush interval. The record is only valid during the call.
+void mseed_on_record(mseed_writer *w, mseed_record_fn fn, void *arg);
+
+// also hand the record being filled of each channel of the last station to
+// the mseed_on_record() callback every interval seconds (of sample time),
+// without writing it, so real-time consumers needn't wait for the flush
+// interval; 0 = only at the flushes
+void mseed_stream_records(mseed_writer *w, double interval);
+
+// write the day volumes from a separate thread; write_mseed() then only queues
+// the sample (up to qlen of them), so slow storage can't delay the sampling
+// loop. If the queue fills, samples are dropped and counted rather than waited
+// for, and the gap starts a new record, so the timing of the samples that are
+// written stays exact. Returns -1 (and keeps writing directly) if the thread
+// can't be started.
+int mseed_start_writer(mseed_writer *w, size_t qlen);
+
+// samples waiting in the queue, most ever waiting, and samples dropped
+void mseed_queue_stats(mseed_writer *w, size_t *depth, size_t *max_depth, unsigned long *drops);
+
+// record and checkpoint writes (and syncs) batched so far, batches, system
+// calls they took, and how they were submitted ("io_uring" or "pwritev");
+// call it before close_mseed()
+void mseed_io_stats(mseed_writer *w, unsigned long *ops, unsigned long *batches, unsigned long *calls, const char **path);
+
+// add one sample taken at epoch time t (in seconds) to a channel; a sample
+// that doesn't follow the previous one at the sample rate starts a new record
+void write_mseed(mseed_writer *w, int chan_idx, double t, double data);
+
+// add one sample of each of the n channels chan_idx, ..., chan_idx + n - 1,
+// all taken at epoch time t; the records and checkpoints this writes are
+// submitted as a single batch (see io_batch.h), and with the writer thread
+// the n samples are queued with a single wakeup (a frame reaching past the
+// channels added is dropped with a message). The batch goes out through one
+// io_uring_enter() where the kernel allows it, otherwise one pwritev() per
+// file; a record rewritten before then is only written once.
+void write_mseed_frame(mseed_writer *w, int chan_idx, int n, double t, const double *data);
+
+// write the partial record of a channel to its day volume
+void flush_mseed(mseed_writer *w, int chan_idx);
+
+// flush and close every channel (after stopping the writer thread, if any)
+void close_mseed(mseed_writer *w);
+
+#endif
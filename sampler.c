@@ -0,0 +1,110 @@
+// sample window scheduler shared by the data acquisition programs
+//
+// by: Scott DeWolf
+//
+// The programs used to spin on gettimeofday() until the end of each window,
+// which pins a core even when the instrument only needs a few reads per
+// window. Sleeping until absolute read instants keeps the window centers
+// exactly where they were (on multiples of 1/fs) while the CPU only wakes up
+// nreads times per window.
+//
+//  created: Saturday, October 17, 2026 (2026290)
+// modified: Saturday, October 17, 2026 (2026290)
+//  history:
+//           [2026290] - created document
+//           [2026290] - added sampler_next() for programs that wait in an event loop
+//
+
+#include <math.h>
+#include <time.h>
+#include "sampler.h"
+
+// local function definitions
+static void sleep_until(double t);
+
+void sampler_init(sampler *s, double fs, int nreads, const double *offsets)
+{
+  s->fs = fs;
+  s->nreads = (nreads > 0) ? nreads : 0;
+  s->offsets = offsets;
+  s->idx = INT64_MIN;
+  s->t_center = 0;
+  s->t_stop = 0;
+  s->k = 0;
+}
+
+double sampler_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1000000000;
+}
+
+double sampler_window(sampler *s)
+{
+  int64_t idx = (int64_t)floor(sampler_now() * s->fs) + 1;
+
+  // never repeat a window, e.g., when the last read finished before its center
+  if (idx <= s->idx)
+    idx = s->idx + 1;
+
+  s->idx = idx;
+  s->t_center = (double)idx / s->fs;
+  s->t_stop = s->t_center + 0.5 / s->fs;
+  s->k = 0;
+
+  return s->t_center;
+}
+
+int sampler_read(sampler *s)
+{
+  double t = sampler_next(s);
+
+  if (t == 0)
+    return 0;
+
+  // sleep until the read instant
+  if (s->nreads > 0)
+    sleep_until(t);
+  return 1;
+}
+
+double sampler_next(sampler *s)
+{
+  double now = sampler_now();
+  double off;
+
+  // read continuously until the end of the window (at least once)
+  if (s->nreads == 0)
+    return ((s->k++ == 0) || (now < s->t_stop)) ? now : 0;
+
+  if (s->k == s->nreads)
+    return 0;
+
+  // the reads fell behind and the window is already over
+  if ((s->k > 0) && (now >= s->t_stop))
+    return 0;
+
+  // read instant
+  if (s->offsets != NULL)
+    off = s->offsets[s->k];
+  else
+    off = (s->k + 0.5) / s->nreads - 0.5;
+
+  s->k++;
+  return s->t_center + off / s->fs;
+}
+
+static void sleep_until(double t)
+{
+  struct timespec ts;
+
+  ts.tv_sec = (time_t)floor(t);
+  ts.tv_nsec = (long)((t - floor(t)) * 1000000000);
+  if (ts.tv_nsec > 999999999)
+    ts.tv_nsec = 999999999;
+
+  // a signal (e.g., SIGTERM) ends the sleep early so the program can stop
+  clock_nanosleep(CLOCK_REALTIME, TIMER_ABSTIME, &ts, NULL);
+}
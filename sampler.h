@@ -0,0 +1,51 @@
+// sample window scheduler shared by the data acquisition programs
+//
+// by: Scott DeWolf
+//
+//  created: Saturday, October 17, 2026 (2026290)
+// modified: Saturday, October 17, 2026 (2026290)
+//  history:
+//           [2026290] - created document
+//           [2026290] - added sampler_next() for programs that wait in an event loop
+//
+
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <stdint.h>
+
+// sample windows of one program
+//
+// Each window is centered on a multiple of 1/fs and spans t_center +/- 0.5/fs.
+// With nreads > 0, sampler_read() sleeps (clock_nanosleep on an absolute time)
+// until each of the nreads read instants of the window; with nreads = 0 it
+// returns right away until the window is over, i.e., the instrument is read
+// as fast as it answers.
+typedef struct
+{
+  double fs;                        // sample rate (Hz)
+  int nreads;                       // reads per window (0 = read continuously)
+  const double *offsets;            // read instants from the window center (in sample periods, -0.5 to 0.5)
+  int64_t idx;                      // t_center * fs of the current window
+  double t_center, t_stop;          // center and end of the current window
+  int k;                            // reads started in the current window
+} sampler;
+
+// set up the windows; offsets may be NULL to spread the reads evenly
+// (and symmetrically about the center) over each window
+void sampler_init(sampler *s, double fs, int nreads, const double *offsets);
+
+// epoch time in seconds (CLOCK_REALTIME)
+double sampler_now(void);
+
+// start the next window that hasn't begun yet and return its center time
+double sampler_window(sampler *s);
+
+// wait for the next read of the window; returns 0 once the window is over
+int sampler_read(sampler *s);
+
+// same as sampler_read() without the wait: returns the epoch time of the next
+// read of the window (now with nreads = 0), or 0 once the window is over
+double sampler_next(sampler *s);
+
+#endif
@@ -0,0 +1,674 @@
+// SeedLink server for the records of a miniSEED writer
+//
+// by: Scott DeWolf
+//
+// Real-time clients (slinktool, SeisComP, ObsPy, ...) connect over TCP and get
+// each record as soon as the writer has it, instead of polling the day volumes
+// on the NFS export. The writer hands every record it writes (and, with
+// mseed_stream_records(), the record being filled every stream interval) to
+// seedlink_record(), which copies it into a ring of the last records under a
+// mutex and wakes the server thread through an eventfd; it never waits for a
+// client. The server thread runs its own epoll loop, so a slow or stuck client
+// can't delay the writer, let alone the sampling loop.
+//
+// Each client has its own place in the ring and its own partly sent packet
+// ("SL", 6 hex digits of sequence number, then the record), and is sent the
+// records of the stations and channels it selected, in order, as fast as its
+// socket takes them. A client that falls more than the ring behind skips
+// ahead to the oldest record still there. A record is sent again whenever it
+// is handed over again (with more samples, until it is final), each time with
+// a new sequence number. DATA and FETCH with a sequence number resume after
+// that record if it is still in the ring, and otherwise start with the next
+// new one. The sequence numbers start from the time of day the server started,
+// so a client resuming after a restart of the program is unlikely to find its
+// old number in the new ring.
+//
+// The SeedLink 3.1 commands served are HELLO, STATION, SELECT, DATA, FETCH,
+// END and BYE, in uni-station mode (DATA or FETCH without STATION starts the
+// transfer of every station) or multi-station mode (one STATION, SELECT,
+// DATA/FETCH group per station, then END). A selector is [!]LLCCC[.T] or
+// [!]CCC[.T], with ? matching any character and - a blank location; only
+// data records (type D) exist. TIME, INFO and CAT are answered with ERROR, and
+// commands received during the transfer other than BYE are ignored.
+// SeedLink 3 carries miniSEED 2 records only, so miniSEED 3 ones are skipped.
+// seedlink_check.c runs a client through these commands on 127.0.0.1.
+//
+//  created: Saturday, October 17, 2026 (2026290)
+// modified: Saturday, October 17, 2026 (2026290)
+//  history:
+//           [2026290] - created document
+//           [2026290] - added seedlink_check.c, a loopback check of the commands served
+//
+
+#define _GNU_SOURCE        // accept4()
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <stddef.h>
+#include <time.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "seedlink.h"
+
+// epoll data of the listening socket and the eventfd (clients use their index)
+enum { EV_LISTEN = SL_MAX_CLIENT, EV_RECORD };
+
+// local function definitions
+static void *seedlink_thread(void *arg);
+static void accept_clients(seedlink_server *s);
+static void receive(seedlink_server *s, sl_client *c);
+static void command(seedlink_server *s, sl_client *c, char *line);
+static sl_station *add_station(sl_client *c, const char *SIC, const char *NC);
+static int resume(seedlink_server *s, const char *hex, uint64_t *start);
+static void start_transfer(seedlink_server *s, sl_client *c);
+static void pump(seedlink_server *s, sl_client *c);
+static int next_packet(seedlink_server *s, sl_client *c);
+static int wanted(const sl_client *c, const sl_packet *p);
+static int selected(const sl_station *st, const sl_packet *p);
+static int match(const char *pat, const char *s, int n);
+static void reply(sl_client *c, const char *text);
+static int send_out(sl_client *c);
+static void drop(sl_client *c, const char *why);
+static void trim_code(char *dst, const unsigned char *src, int n);
+
+int seedlink_start(seedlink_server *s, const char *addr, int port, int cap)
+{
+  struct sockaddr_in sa = {0};
+  struct epoll_event ev = {0};
+  sigset_t all, old;
+  int i, on = 1, err;
+
+  memset(s, 0, sizeof(*s));
+  s->lfd = s->efd = s->epfd = -1;
+  for (i = 0; i < SL_MAX_CLIENT; i++)
+    s->client[i].fd = -1;
+
+  s->ring = calloc(cap, sizeof(sl_packet));
+  if (s->ring == NULL)
+  {
+    perror("seedlink_start");
+    return -1;
+  }
+  s->cap = cap;
+  s->first = s->next = (uint64_t)time(NULL) % 86400;
+  pthread_mutex_init(&s->lock, NULL);
+  atomic_init(&s->stop, 0);
+
+  // the listening socket
+  sa.sin_family = AF_INET;
+  sa.sin_port = htons(port);
+  sa.sin_addr.s_addr = htonl(INADDR_ANY);
+  if ((addr != NULL) && (inet_pton(AF_INET, addr, &sa.sin_addr) != 1))
+  {
+    fprintf(stderr, "seedlink_start: bad address %s\n", addr);
+    seedlink_stop(s);
+    return -1;
+  }
+  s->lfd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if ((s->lfd == -1) || (setsockopt(s->lfd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) == -1) ||
+      (bind(s->lfd, (struct sockaddr *)&sa, sizeof(sa)) == -1) || (listen(s->lfd, 16) == -1))
+  {
+    perror("seedlink_start");
+    seedlink_stop(s);
+    return -1;
+  }
+
+  // new records and new clients wake the server thread
+  s->efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  s->epfd = epoll_create1(EPOLL_CLOEXEC);
+  ev.events = EPOLLIN;
+  ev.data.u32 = EV_LISTEN;
+  if ((s->efd == -1) || (s->epfd == -1) || (epoll_ctl(s->epfd, EPOLL_CTL_ADD, s->lfd, &ev) == -1))
+  {
+    perror("seedlink_start");
+    seedlink_stop(s);
+    return -1;
+  }
+  ev.data.u32 = EV_RECORD;
+  epoll_ctl(s->epfd, EPOLL_CTL_ADD, s->efd, &ev);
+
+  // signals are left to the sampling loop
+  sigfillset(&all);
+  pthread_sigmask(SIG_BLOCK, &all, &old);
+  err = pthread_create(&s->thread, NULL, seedlink_thread, s);
+  pthread_sigmask(SIG_SETMASK, &old, NULL);
+  if (err != 0)
+  {
+    fprintf(stderr, "seedlink_start: %s\n", strerror(err));
+    seedlink_stop(s);
+    return -1;
+  }
+
+  fprintf(stderr, "seedlink: listening on %s:%i (%i records)\n", (addr != NULL) ? addr : "*", port, cap);
+  return 0;
+}
+
+void seedlink_record(void *arg, const unsigned char *rec, int len, int final)
+{
+  seedlink_server *s = arg;
+  sl_packet *p;
+  uint64_t one = 1;
+
+  // miniSEED 2 records only (a miniSEED 3 record starts with "MS")
+  if ((len < MSEED_HDRLEN) | (len > MSEED_MAX_RECLEN) || (memcmp(rec, "MS", 2) == 0))
+    return;
+
+  pthread_mutex_lock(&s->lock);
+  p = &s->ring[s->next % s->cap];
+  p->seq = s->next;
+  p->len = len;
+  trim_code(p->NC, rec + offsetof(mseed_header, NC), 2);
+  trim_code(p->SIC, rec + offsetof(mseed_header, SIC), 5);
+  memcpy(p->LI, rec + offsetof(mseed_header, LI), 2);
+  p->LI[2] = '\0';
+  memcpy(p->CI, rec + offsetof(mseed_header, CI), 3);
+  p->CI[3] = '\0';
+  memcpy(p->rec, rec, len);
+  s->next++;
+  pthread_mutex_unlock(&s->lock);
+
+  if (write(s->efd, &one, sizeof(one)) != sizeof(one))
+    perror("seedlink_record");
+}
+
+void seedlink_stop(seedlink_server *s)
+{
+  uint64_t one = 1;
+  int i;
+
+  if (s->ring == NULL)
+    return;
+
+  // (a server that didn't get as far as its thread has stop = 0 and no thread)
+  if (s->epfd != -1)
+  {
+    atomic_store(&s->stop, 1);
+    if ((write(s->efd, &one, sizeof(one)) == sizeof(one)) && (s->thread != 0))
+      pthread_join(s->thread, NULL);
+  }
+
+  for (i = 0; i < SL_MAX_CLIENT; i++)
+    if (s->client[i].fd != -1)
+      drop(&s->client[i], "server stopped");
+  if (s->lfd != -1)
+    close(s->lfd);
+  if (s->efd != -1)
+    close(s->efd);
+  if (s->epfd != -1)
+    close(s->epfd);
+  pthread_mutex_destroy(&s->lock);
+  free(s->ring);
+  s->ring = NULL;
+}
+
+static void *seedlink_thread(void *arg)
+{
+  seedlink_server *s = arg;
+  struct epoll_event ev[SL_MAX_CLIENT + 2];
+  uint64_t count;
+  sl_client *c;
+  int i, k, n;
+
+  while (!atomic_load(&s->stop))
+  {
+    n = epoll_wait(s->epfd, ev, SL_MAX_CLIENT + 2, -1);
+    if ((n == -1) & (errno != EINTR))
+    {
+      perror("seedlink: epoll_wait");
+      break;
+    }
+
+    for (i = 0; i < n; i++)
+    {
+      if (ev[i].data.u32 == EV_LISTEN)
+      {
+        accept_clients(s);
+        continue;
+      }
+
+      // new records for every client that is waiting for them
+      if (ev[i].data.u32 == EV_RECORD)
+      {
+        if (read(s->efd, &count, sizeof(count)) != sizeof(count))
+          continue;
+        for (k = 0; k < SL_MAX_CLIENT; k++)
+          if ((s->client[k].fd != -1) & (s->client[k].streaming))
+            pump(s, &s->client[k]);
+        continue;
+      }
+
+      // commands from a client, or room in its socket for more packets
+      c = &s->client[ev[i].data.u32];
+      if (c->fd == -1)
+        continue;
+      if (ev[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+        receive(s, c);
+      if (c->fd != -1)
+        pump(s, c);
+    }
+  }
+
+  return NULL;
+}
+
+static void accept_clients(seedlink_server *s)
+{
+  struct sockaddr_in sa;
+  struct epoll_event ev = {0};
+  socklen_t len;
+  sl_client *c;
+  int fd, i;
+
+  while (1)
+  {
+    len = sizeof(sa);
+    fd = accept4(s->lfd, (struct sockaddr *)&sa, &len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd == -1)
+    {
+      if ((errno != EAGAIN) & (errno != EWOULDBLOCK) & (errno != EINTR))
+        perror("seedlink: accept");
+      return;
+    }
+
+    for (i = 0; (i < SL_MAX_CLIENT) && (s->client[i].fd != -1); i++);
+    if (i == SL_MAX_CLIENT)
+    {
+      fprintf(stderr, "seedlink: too many clients (%i), refusing one\n", SL_MAX_CLIENT);
+      close(fd);
+      continue;
+    }
+
+    // (edge triggered: a client is read and written until it would block)
+    c = &s->client[i];
+    memset(c, 0, sizeof(*c));
+    c->fd = fd;
+    snprintf(c->addr, sizeof(c->addr), "%s:%i", inet_ntoa(sa.sin_addr), ntohs(sa.sin_port));
+    ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    ev.data.u32 = i;
+    if (epoll_ctl(s->epfd, EPOLL_CTL_ADD, fd, &ev) == -1)
+    {
+      perror("seedlink: epoll_ctl");
+      close(fd);
+      c->fd = -1;
+      continue;
+    }
+    fprintf(stderr, "seedlink: %s connected\n", c->addr);
+  }
+}
+
+static void receive(seedlink_server *s, sl_client *c)
+{
+  char *eol;
+  ssize_t n;
+
+  while (c->fd != -1)
+  {
+    n = recv(c->fd, c->in + c->nin, sizeof(c->in) - 1 - c->nin, 0);
+    if (n == 0)
+    {
+      drop(c, "disconnected");
+      return;
+    }
+    if (n == -1)
+    {
+      if ((errno != EAGAIN) & (errno != EWOULDBLOCK) & (errno != EINTR))
+        drop(c, strerror(errno));
+      return;
+    }
+    c->nin += n;
+    c->in[c->nin] = '\0';
+
+    // one command per line (ended by \r\n, or just \n)
+    while ((c->fd != -1) && ((eol = strchr(c->in, '\n')) != NULL))
+    {
+      *eol = '\0';
+      if ((eol > c->in) && (eol[-1] == '\r'))
+        eol[-1] = '\0';
+      command(s, c, c->in);
+      c->nin -= (int)(eol + 1 - c->in);
+      memmove(c->in, eol + 1, c->nin + 1);
+    }
+    if ((c->fd != -1) && (c->nin == (int)sizeof(c->in) - 1))
+      drop(c, "command too long");
+  }
+}
+
+static void command(seedlink_server *s, sl_client *c, char *line)
+{
+  char *argv[4], *p;
+  sl_station *st;
+  uint64_t start;
+  int argc = 0;
+
+  for (p = strtok(line, " \t"); (p != NULL) & (argc < 4); p = strtok(NULL, " \t"))
+    argv[argc++] = p;
+  if (argc == 0)
+    return;
+
+  // during the transfer only BYE is heard
+  if (strcasecmp(argv[0], "BYE") == 0)
+  {
+    drop(c, "said bye");
+    return;
+  }
+  if (c->streaming)
+    return;
+
+  if (strcasecmp(argv[0], "HELLO") == 0)
+  {
+    reply(c, "SeedLink v3.1 (daq) :: SLPROTO:3.1\r\n");
+    reply(c, "field_codes data acquisition\r\n");
+  }
+
+  // STATION sta [net] (multi-station mode)
+  else if (strcasecmp(argv[0], "STATION") == 0)
+  {
+    if ((argc < 2) || (strlen(argv[1]) > 5) || ((argc > 2) && (strlen(argv[2]) > 2)) ||
+        (add_station(c, argv[1], (argc > 2) ? argv[2] : "") == NULL))
+      reply(c, "ERROR\r\n");
+    else
+      reply(c, "OK\r\n");
+  }
+
+  // SELECT [pattern] (of the last station; none clears the selectors)
+  else if (strcasecmp(argv[0], "SELECT") == 0)
+  {
+    st = (c->nsta > 0) ? &c->sta[c->nsta - 1] : add_station(c, "", "");
+    p = (argc > 1) ? argv[1] + (argv[1][0] == '!') : NULL;
+    if (argc == 1)
+      st->nsel = 0;
+    else if ((st->nsel == SL_MAX_SELECT) || ((strcspn(p, ".") != 3) & (strcspn(p, ".") != 5)) ||
+             ((strchr(p, '.') != NULL) && (strlen(strchr(p, '.')) != 2)))
+    {
+      reply(c, "ERROR\r\n");
+      return;
+    }
+    else
+      snprintf(st->sel[st->nsel++], sizeof(st->sel[0]), "%s", argv[1]);
+    reply(c, "OK\r\n");
+  }
+
+  // DATA [seq [time]] or FETCH [seq [time]] (of the last station, or of all of them)
+  else if ((strcasecmp(argv[0], "DATA") == 0) | (strcasecmp(argv[0], "FETCH") == 0))
+  {
+    if (resume(s, (argc > 1) ? argv[1] : NULL, &start) == -1)
+    {
+      reply(c, "ERROR\r\n");
+      return;
+    }
+    c->fetch = (toupper((unsigned char)argv[0][0]) == 'F');
+    if ((c->nsta > 0) && (c->sta[c->nsta - 1].SIC[0] != '\0'))
+    {
+      c->sta[c->nsta - 1].start = start;
+      reply(c, "OK\r\n");
+      return;
+    }
+
+    // uni-station mode: the transfer starts right away
+    st = (c->nsta > 0) ? &c->sta[0] : add_station(c, "", "");
+    st->start = start;
+    start_transfer(s, c);
+  }
+
+  // END (multi-station mode)
+  else if ((strcasecmp(argv[0], "END") == 0) && (c->nsta > 0))
+    start_transfer(s, c);
+
+  else
+    reply(c, "ERROR\r\n");
+}
+
+static sl_station *add_station(sl_client *c, const char *SIC, const char *NC)
+{
+  sl_station *st;
+
+  if (c->nsta == SL_MAX_SELECT)
+    return NULL;
+  st = &c->sta[c->nsta++];
+  memset(st, 0, sizeof(*st));
+  snprintf(st->SIC, sizeof(st->SIC), "%s", SIC);
+  snprintf(st->NC, sizeof(st->NC), "%s", NC);
+  st->start = UINT64_MAX;
+  return st;
+}
+
+static int resume(seedlink_server *s, const char *hex, uint64_t *start)
+{
+  uint64_t i, lo;
+  unsigned long want;
+  char *end;
+
+  pthread_mutex_lock(&s->lock);
+  *start = s->next;
+
+  // the record after the one the client has, if it is still in the ring
+  if (hex != NULL)
+  {
+    want = strtoul(hex, &end, 16);
+    if ((*end != '\0') | (want > SL_SEQ_MASK))
+    {
+      pthread_mutex_unlock(&s->lock);
+      return -1;
+    }
+    lo = (s->next - s->first > (uint64_t)s->cap) ? s->next - s->cap : s->first;
+    for (i = s->next; i > lo; i--)
+    {
+      if (((i - 1) & SL_SEQ_MASK) == want)
+      {
+        *start = i;
+        break;
+      }
+    }
+  }
+
+  pthread_mutex_unlock(&s->lock);
+  return 0;
+}
+
+static void start_transfer(seedlink_server *s, sl_client *c)
+{
+  int i;
+
+  // from the earliest record any of its stations wants (one without DATA or FETCH gets new ones)
+  pthread_mutex_lock(&s->lock);
+  c->cursor = s->next;
+  pthread_mutex_unlock(&s->lock);
+  for (i = 0; i < c->nsta; i++)
+  {
+    if (c->sta[i].start == UINT64_MAX)
+      c->sta[i].start = c->cursor;
+    if (c->sta[i].start < c->cursor)
+      c->cursor = c->sta[i].start;
+  }
+  c->streaming = 1;
+  fprintf(stderr, "seedlink: %s %s from %06X\n", c->addr, (c->fetch) ? "fetching" : "streaming", (unsigned)(c->cursor & SL_SEQ_MASK));
+}
+
+static void pump(seedlink_server *s, sl_client *c)
+{
+  // send until the socket is full or the client has every record it wants
+  while (1)
+  {
+    if (send_out(c) != 0)
+      return;
+    if (!c->streaming)
+      return;
+    if (next_packet(s, c) == 0)
+      continue;
+
+    // a FETCH ends once the client is caught up
+    if (c->fetch)
+      drop(c, "caught up");
+    return;
+  }
+}
+
+static int next_packet(seedlink_server *s, sl_client *c)
+{
+  const sl_packet *p;
+  uint64_t oldest;
+  int found = -1;
+
+  pthread_mutex_lock(&s->lock);
+
+  // the records the client hadn't been sent yet were overwritten
+  oldest = (s->next - s->first > (uint64_t)s->cap) ? s->next - s->cap : s->first;
+  if (c->cursor < oldest)
+  {
+    fprintf(stderr, "seedlink: %s fell behind, skipping %llu records\n", c->addr, (unsigned long long)(oldest - c->cursor));
+    c->cursor = oldest;
+  }
+
+  // the next one it wants, as a packet
+  for (; c->cursor < s->next; c->cursor++)
+  {
+    p = &s->ring[c->cursor % s->cap];
+    if (!wanted(c, p))
+      continue;
+    snprintf((char *)c->out, 9, "SL%06X", (unsigned)(p->seq & SL_SEQ_MASK));
+    memcpy(c->out + 8, p->rec, p->len);
+    c->nout = 8 + p->len;
+    c->sent = 0;
+    c->cursor++;
+    found = 0;
+    break;
+  }
+
+  pthread_mutex_unlock(&s->lock);
+  return found;
+}
+
+static int wanted(const sl_client *c, const sl_packet *p)
+{
+  const sl_station *st;
+  int i;
+
+  for (i = 0; i < c->nsta; i++)
+  {
+    st = &c->sta[i];
+    if ((p->seq >= st->start) &&
+        ((st->SIC[0] == '\0') || (match(st->SIC, p->SIC, 6) == 0)) &&
+        ((st->NC[0] == '\0') || (match(st->NC, p->NC, 3) == 0)) &&
+        (selected(st, p)))
+      return 1;
+  }
+  return 0;
+}
+
+static int selected(const sl_station *st, const sl_packet *p)
+{
+  const char *pat, *dot;
+  int i, neg, n, in = 0, out = 0, any = 0;
+  char code[6];
+
+  if (st->nsel == 0)
+    return 1;
+
+  for (i = 0; i < st->nsel; i++)
+  {
+    neg = (st->sel[i][0] == '!');
+    pat = st->sel[i] + neg;
+    any |= !neg;
+
+    // data records only
+    dot = strchr(pat, '.');
+    if ((dot != NULL) && (toupper((unsigned char)dot[1]) != 'D'))
+      continue;
+
+    // LLCCC, or CCC at any location
+    n = (dot != NULL) ? (int)(dot - pat) : (int)strlen(pat);
+    snprintf(code, sizeof(code), "%s%s", p->LI, p->CI);
+    if (match(pat, (n == 5) ? code : code + 2, n) != 0)
+      continue;
+    if (neg)
+      out = 1;
+    else
+      in = 1;
+  }
+
+  // only exclusions select everything else
+  return ((in) | (!any)) & (!out);
+}
+
+static int match(const char *pat, const char *s, int n)
+{
+  int i;
+
+  // ? is any character and - a blank one
+  for (i = 0; i < n; i++)
+  {
+    if ((pat[i] == '\0') | (pat[i] == '.'))
+      return (s[i] == '\0') ? 0 : -1;
+    if (pat[i] == '?')
+    {
+      if (s[i] == '\0')
+        return -1;
+      continue;
+    }
+    if ((pat[i] == '-') & (s[i] == ' '))
+      continue;
+    if (toupper((unsigned char)pat[i]) != toupper((unsigned char)s[i]))
+      return -1;
+  }
+  return 0;
+}
+
+static void reply(sl_client *c, const char *text)
+{
+  int n = (int)strlen(text);
+
+  // (answers go out before any packet, through the same buffer)
+  if (c->nout + n > (int)sizeof(c->out))
+    return;
+  memcpy(c->out + c->nout, text, n);
+  c->nout += n;
+}
+
+static int send_out(sl_client *c)
+{
+  ssize_t n;
+
+  // 0 = all sent, 1 = the socket is full, -1 = the client is gone
+  while (c->sent < c->nout)
+  {
+    n = send(c->fd, c->out + c->sent, c->nout - c->sent, MSG_NOSIGNAL);
+    if (n == -1)
+    {
+      if ((errno == EAGAIN) | (errno == EWOULDBLOCK))
+        return 1;
+      if (errno == EINTR)
+        continue;
+      drop(c, strerror(errno));
+      return -1;
+    }
+    c->sent += n;
+  }
+  c->nout = 0;
+  c->sent = 0;
+  return 0;
+}
+
+static void drop(sl_client *c, const char *why)
+{
+  // (closing the socket takes it out of the epoll set)
+  fprintf(stderr, "seedlink: %s %s\n", c->addr, why);
+  close(c->fd);
+  c->fd = -1;
+}
+
+static void trim_code(char *dst, const unsigned char *src, int n)
+{
+  // a header code without its padding
+  memcpy(dst, src, n);
+  dst[n] = '\0';
+  while ((n > 0) && (dst[n - 1] == ' '))
+    dst[--n] = '\0';
+}
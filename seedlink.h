@@ -0,0 +1,85 @@
+// SeedLink server for the records of a miniSEED writer
+//
+// by: Scott DeWolf
+//
+//  created: Saturday, October 17, 2026 (2026290)
+// modified: Saturday, October 17, 2026 (2026290)
+//  history:
+//           [2026290] - created document
+//
+
+#ifndef SEEDLINK_H
+#define SEEDLINK_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "mseed_writer.h"
+
+#define SL_MAX_CLIENT 32      // most clients connected at once
+#define SL_MAX_SELECT 16      // most stations (and selectors per station) a client asks for
+#define SL_SEQ_MASK 0xFFFFFF  // SeedLink sequence numbers are 6 hex digits
+
+// one record in the ring
+typedef struct
+{
+  uint64_t seq;                     // sequence number (SL_SEQ_MASK of it is sent)
+  int len;                          // bytes of the record
+  char NC[3], SIC[6];               // Network and Station codes (without the padding)
+  char LI[3], CI[4];                // Location and Channel Identifiers (as in the header)
+  unsigned char rec[MSEED_MAX_RECLEN];
+} sl_packet;
+
+// a station a client asked for and the channels it selected
+typedef struct
+{
+  char NC[3], SIC[6];               // "" = every station (uni-station mode)
+  int nsel;
+  char sel[SL_MAX_SELECT][12];      // [!]LLCCC.T or [!]CCC.T patterns (? matches any character)
+  uint64_t start;                   // first sequence number the station wants
+} sl_station;
+
+// one connected client, with its own place in the ring and its own partly sent packet
+typedef struct
+{
+  int fd;                           // socket (-1 = free)
+  char addr[48];                    // for the log
+  char in[256];                     // command line being received
+  int nin;
+  int streaming;                    // DATA, FETCH or END was received
+  int fetch;                        // FETCH: disconnect once caught up
+  int nsta;
+  sl_station sta[SL_MAX_SELECT];
+  uint64_t cursor;                  // next packet of the ring to look at
+  unsigned char out[8 + MSEED_MAX_RECLEN]; // packet being sent ("SL" + sequence + record)
+  int nout, sent;
+} sl_client;
+
+// the server: a ring of the last records (shared with the writer) and the clients
+typedef struct
+{
+  int lfd, efd, epfd;               // listening socket, eventfd of new records, epoll
+  pthread_t thread;
+  atomic_int stop;                  // set by seedlink_stop() to end the server thread
+
+  pthread_mutex_t lock;             // guards the ring
+  sl_packet *ring;
+  int cap;                          // packets in the ring
+  uint64_t first, next;             // sequence numbers of the first record ever and of the next one
+
+  sl_client client[SL_MAX_CLIENT];
+} seedlink_server;
+
+// listen on port of addr (NULL = every interface) and keep the last cap
+// records for clients resuming from a sequence number; returns -1 (after
+// saying why) if the port can't be opened
+int seedlink_start(seedlink_server *s, const char *addr, int port, int cap);
+
+// add a miniSEED 2 record to the ring (an mseed_record_fn, for mseed_on_record());
+// never waits for a client, and skips miniSEED 3 records (SeedLink 3 can't carry them)
+void seedlink_record(void *arg, const unsigned char *rec, int len, int final);
+
+// disconnect the clients and stop the server
+void seedlink_stop(seedlink_server *s);
+
+#endif
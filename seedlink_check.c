@@ -0,0 +1,385 @@
+// loopback check of the SeedLink server
+//
+// by: Scott DeWolf
+//
+// Starts seedlink.c on a free port of 127.0.0.1, feeds it the records of three
+// channels of two stations (XX.CHK 00.HHZ and 00.HHN, XX.CHL 00.HHZ, 20 Hz,
+// 512-byte records) through mseed_writer.c and mseed_on_record(), and
+// connects to it as a client would (slinktool, SeisComP, ...), checking
+//
+//   - HELLO, and ERROR for a command it doesn't serve and a bad selector;
+//   - multi-station mode: STATION, SELECT and FETCH for each station, then
+//     END, gets exactly the selected records after the one resumed from, in
+//     order, and the server disconnects once the client is caught up;
+//   - uni-station mode: SELECT and DATA from a sequence number gets the
+//     selected records still in the ring after it, then the new ones as they
+//     are written, until BYE.
+//
+// Every packet must be "SL", the sequence number the record was given (6 hex
+// digits) and the record byte for byte. Any mismatch, or a packet that
+// doesn't come within 5 s, is reported and the program exits 1.
+//
+// usage: ./seedlink_check
+//
+//  created: Saturday, October 17, 2026 (2026290)
+// modified: Saturday, October 17, 2026 (2026290)
+//  history:
+//           [2026290] - created document
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stddef.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "mseed_writer.h"
+#include "seedlink.h"
+
+#define NCHAN 3
+#define RECLEN 512
+#define NSAMP1 1000                   // samples per channel before the clients connect
+#define NSAMP2 1500                   // and in all
+#define T0 1760745600                 // 2025:291:00:00:00
+#define MAXREC 64                     // records kept (also the ring of the server)
+
+// function definitions
+void keep_record(void *arg, const unsigned char *rec, int len, int final);
+void write_samples(int from, int to);
+int check_hello(void);
+int check_multi_station(void);
+int check_uni_station(void);
+int expect_packets(int fd, const char *what, int from, int to, int mask);
+int expect_eof(int fd, const char *what);
+int sl_connect(void);
+int command(int fd, const char *cmd, const char *answer);
+int send_line(int fd, const char *line);
+int read_line(int fd, char *line, int n);
+int read_packet(int fd, unsigned char *pkt);
+
+// the channels (the station of each, for the records kept)
+const char *SIC[NCHAN] = {"CHK", "CHK", "CHL"};
+const char *CI[NCHAN] = {"HHZ", "HHN", "HHZ"};
+
+// records handed to the server, with the sequence number each was given
+typedef struct
+{
+  uint64_t seq;
+  int chan;
+  unsigned char rec[RECLEN];
+} kept_record;
+
+// global variables
+mseed_writer w;
+seedlink_server sl;
+kept_record kept[MAXREC];
+int nrec = 0, port, failures = 0;
+
+int main(void)
+{
+  char root[] = "/tmp/seedlink_check.XXXXXX", cmd[100];
+  struct sockaddr_in sa;
+  socklen_t len = sizeof(sa);
+  int c, nrec1;
+
+  if (mkdtemp(root) == NULL)
+  {
+    perror(root);
+    return 1;
+  }
+
+  // the server, on a port the kernel picks
+  if (seedlink_start(&sl, "127.0.0.1", 0, MAXREC) == -1)
+    return 1;
+  if (getsockname(sl.lfd, (struct sockaddr *)&sa, &len) == -1)
+  {
+    perror("getsockname");
+    return 1;
+  }
+  port = ntohs(sa.sin_port);
+
+  // the writer, handing its records to the server
+  mseed_init(&w, root, "XX", "CHK", 20, 1, 0);
+  mseed_skip_checkpoints(&w);
+  mseed_add_channel(&w, "00", "HHZ", 3);
+  mseed_add_channel(&w, "00", "HHN", 3);
+  mseed_add_station(&w, root, "XX", "CHL", 20, 1, 0);
+  mseed_skip_checkpoints(&w);
+  mseed_add_channel(&w, "00", "HHZ", 3);
+  for (c = 0; c < NCHAN; c++)
+    if (mseed_record_length(&w, c, RECLEN, 0) == -1)
+      return 1;
+  mseed_on_record(&w, keep_record, &sl);
+
+  // records waiting in the ring before any client connects
+  write_samples(0, NSAMP1);
+  nrec1 = nrec;
+  printf("%i records of %i channels in the ring\n", nrec1, NCHAN);
+
+  check_hello();
+  check_multi_station();
+  check_uni_station();
+
+  close_mseed(&w);
+  seedlink_stop(&sl);
+  snprintf(cmd, sizeof(cmd), "rm -rf %s", root);
+  system(cmd);
+
+  if (failures > 0)
+  {
+    printf("%i failures\n", failures);
+    return 1;
+  }
+  printf("SeedLink server answers and streams as it should\n");
+  return 0;
+}
+
+void keep_record(void *arg, const unsigned char *rec, int len, int final)
+{
+  kept_record *k = &kept[nrec];
+  int c;
+
+  // (the writer calls this in this thread, which is the only one adding records)
+  if ((nrec < MAXREC) & (len == RECLEN))
+  {
+    k->seq = sl.next;
+    k->chan = -1;
+    for (c = 0; c < NCHAN; c++)
+      if ((memcmp(rec + offsetof(mseed_header, SIC), SIC[c], 3) == 0) && (memcmp(rec + offsetof(mseed_header, CI), CI[c], 3) == 0))
+        k->chan = c;
+    memcpy(k->rec, rec, len);
+    nrec++;
+  }
+  seedlink_record(arg, rec, len, final);
+}
+
+void write_samples(int from, int to)
+{
+  int j, c;
+
+  for (j = from; j < to; j++)
+    for (c = 0; c < NCHAN; c++)
+      write_mseed(&w, c, T0 + j / 20.0, (double)((j * 7919 + c * 104729) % 20001 - 10000));
+}
+
+int check_hello(void)
+{
+  char line[256];
+  int fd, fail = failures;
+
+  fd = sl_connect();
+  if (fd == -1)
+    return -1;
+
+  if ((send_line(fd, "HELLO") == -1) || (read_line(fd, line, sizeof(line)) == -1))
+    failures++;
+  else if (strncmp(line, "SeedLink v3.1", 13) != 0)
+  {
+    printf("HELLO: answered \"%s\"\n", line);
+    failures++;
+  }
+  else if (read_line(fd, line, sizeof(line)) == -1)
+    failures++;
+
+  command(fd, "INFO ID", "ERROR");
+  command(fd, "SELECT HHZZ.D", "ERROR");
+  if (send_line(fd, "BYE") == 0)
+    expect_eof(fd, "BYE");
+  close(fd);
+
+  printf("%-40s %s\n", "HELLO, ERROR and BYE", (failures == fail) ? "ok" : "FAILED");
+  return 0;
+}
+
+int check_multi_station(void)
+{
+  char cmd[32];
+  int fd, fail = failures;
+
+  fd = sl_connect();
+  if (fd == -1)
+    return -1;
+
+  // XX.CHK 00.HHZ and every channel of XX.CHL, after the first record
+  snprintf(cmd, sizeof(cmd), "FETCH %06X", (unsigned)(kept[0].seq & SL_SEQ_MASK));
+  if ((command(fd, "STATION CHK XX", "OK") == 0) && (command(fd, "SELECT 00HHZ.D", "OK") == 0) && (command(fd, cmd, "OK") == 0) &&
+      (command(fd, "STATION CHL XX", "OK") == 0) && (command(fd, "SELECT HHZ", "OK") == 0) && (command(fd, cmd, "OK") == 0) &&
+      (send_line(fd, "END") == 0))
+  {
+    expect_packets(fd, "multi-station FETCH", 1, nrec, (1 << 0) | (1 << 2));
+    expect_eof(fd, "multi-station FETCH");
+  }
+  close(fd);
+
+  printf("%-40s %s\n", "multi-station FETCH from a sequence", (failures == fail) ? "ok" : "FAILED");
+  return 0;
+}
+
+int check_uni_station(void)
+{
+  char cmd[32];
+  int fd, m = nrec / 2, nrec1 = nrec, fail = failures;
+
+  fd = sl_connect();
+  if (fd == -1)
+    return -1;
+
+  // every station's 00.HHN, from the middle of the ring, then the new records
+  snprintf(cmd, sizeof(cmd), "DATA %06X", (unsigned)(kept[m].seq & SL_SEQ_MASK));
+  if ((command(fd, "SELECT ??HHN.D", "OK") == 0) && (send_line(fd, cmd) == 0) &&
+      (expect_packets(fd, "uni-station DATA (ring)", m + 1, nrec1, 1 << 1) == 0))
+  {
+    write_samples(NSAMP1, NSAMP2);
+    if ((expect_packets(fd, "uni-station DATA (new)", nrec1, nrec, 1 << 1) == 0) && (send_line(fd, "BYE") == 0))
+      expect_eof(fd, "uni-station DATA");
+  }
+  else
+    write_samples(NSAMP1, NSAMP2);
+  close(fd);
+
+  printf("%-40s %s\n", "uni-station DATA from a sequence", (failures == fail) ? "ok" : "FAILED");
+  return 0;
+}
+
+int expect_packets(int fd, const char *what, int from, int to, int mask)
+{
+  unsigned char pkt[8 + RECLEN];
+  char hdr[9];
+  int k, n = 0, rc;
+
+  // the records of the selected channels, in order
+  for (k = from; k < to; k++)
+  {
+    if ((kept[k].chan == -1) || !(mask & (1 << kept[k].chan)))
+      continue;
+    rc = read_packet(fd, pkt);
+    if (rc != 1)
+    {
+      printf("%s: %s after %i packets\n", what, (rc == 0) ? "disconnected" : "no packet", n);
+      failures++;
+      return -1;
+    }
+    snprintf(hdr, sizeof(hdr), "SL%06X", (unsigned)(kept[k].seq & SL_SEQ_MASK));
+    if ((memcmp(pkt, hdr, 8) != 0) || (memcmp(pkt + 8, kept[k].rec, RECLEN) != 0))
+    {
+      printf("%s: packet %i is %.8s, not %s (XX.%s %s)\n", what, n + 1, pkt, hdr, SIC[kept[k].chan], CI[kept[k].chan]);
+      failures++;
+      return -1;
+    }
+    n++;
+  }
+  if (n == 0)
+  {
+    printf("%s: no records to check\n", what);
+    failures++;
+    return -1;
+  }
+  return 0;
+}
+
+int expect_eof(int fd, const char *what)
+{
+  unsigned char pkt[8 + RECLEN];
+  int rc = read_packet(fd, pkt);
+
+  // the server hangs up rather than sending anything more
+  if (rc == 0)
+    return 0;
+  printf("%s: %s instead of the end of the connection\n", what, (rc == 1) ? "another packet" : "nothing");
+  failures++;
+  return -1;
+}
+
+int sl_connect(void)
+{
+  struct sockaddr_in sa = {0};
+  struct timeval tv = {5, 0};
+  int fd;
+
+  sa.sin_family = AF_INET;
+  sa.sin_port = htons(port);
+  sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  fd = socket(AF_INET, SOCK_STREAM, 0);
+  if ((fd == -1) || (setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)) == -1) ||
+      (connect(fd, (struct sockaddr *)&sa, sizeof(sa)) == -1))
+  {
+    perror("sl_connect");
+    if (fd != -1)
+      close(fd);
+    failures++;
+    return -1;
+  }
+  return fd;
+}
+
+int command(int fd, const char *cmd, const char *answer)
+{
+  char line[256];
+
+  if ((send_line(fd, cmd) == -1) || (read_line(fd, line, sizeof(line)) == -1))
+    return -1;
+  if (strcmp(line, answer) != 0)
+  {
+    printf("%s: answered \"%s\", not \"%s\"\n", cmd, line, answer);
+    failures++;
+    return -1;
+  }
+  return 0;
+}
+
+int send_line(int fd, const char *line)
+{
+  char buf[256];
+  int n = snprintf(buf, sizeof(buf), "%s\r\n", line);
+
+  if (send(fd, buf, n, MSG_NOSIGNAL) != n)
+  {
+    perror(line);
+    failures++;
+    return -1;
+  }
+  return 0;
+}
+
+int read_line(int fd, char *line, int n)
+{
+  int i = 0;
+  char ch;
+
+  // answers end with \r\n
+  while (recv(fd, &ch, 1, 0) == 1)
+  {
+    if (ch == '\n')
+    {
+      line[(i > 0) && (line[i-1] == '\r') ? i - 1 : i] = '\0';
+      return 0;
+    }
+    if (i < n - 1)
+      line[i++] = ch;
+  }
+  printf("no answer\n");
+  failures++;
+  return -1;
+}
+
+int read_packet(int fd, unsigned char *pkt)
+{
+  ssize_t r;
+  int n = 0;
+
+  // 1 = a whole packet, 0 = the connection ended before one, -1 = timeout or error
+  while (n < 8 + RECLEN)
+  {
+    r = recv(fd, pkt + n, 8 + RECLEN - n, 0);
+    if (r == 0)
+      return (n == 0) ? 0 : -1;
+    if (r == -1)
+      return -1;
+    n += r;
+  }
+  return 1;
+}
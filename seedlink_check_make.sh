@@ -0,0 +1,7 @@
+#!/bin/bash
+
+echo -e "\nCompiling SeedLink loopback check . . . \c"
+gcc seedlink_check.c seedlink.c mseed_writer.c io_batch.c steim.c spsc_ring.c -O2 -g -Wall -pthread -lm -o seedlink_check
+echo -e "done!\n"
+
+rm -f *~ > /dev/null
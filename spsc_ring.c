@@ -0,0 +1,77 @@
+// lock-free single-producer/single-consumer ring of fixed-size elements
+//
+// by: Scott DeWolf
+//
+// head and tail count elements from the start and only ever increase, so the
+// ring is empty when they are equal and full when they differ by cap. Each
+// index is written by one thread only; the release store after copying an
+// element and the acquire load before touching it are all the ordering needed.
+//
+//  created: Saturday, October 17, 2026 (2026290)
+// modified: Saturday, October 17, 2026 (2026290)
+//  history:
+//           [2026290] - created document
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include "spsc_ring.h"
+
+int ring_init(spsc_ring *r, size_t elem, size_t cap)
+{
+  size_t n = 1;
+
+  // round up to a power of 2 so the index wraps with a mask
+  while (n < cap)
+    n <<= 1;
+
+  r->buf = malloc(n * elem);
+  if (r->buf == NULL)
+    return -1;
+  r->elem = elem;
+  r->cap = n;
+  atomic_init(&r->head, 0);
+  atomic_init(&r->tail, 0);
+  return 0;
+}
+
+int ring_push(spsc_ring *r, const void *e)
+{
+  size_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+  size_t head = atomic_load_explicit(&r->head, memory_order_acquire);
+
+  if (tail - head == r->cap)
+    return -1;
+
+  memcpy(r->buf + (tail & (r->cap - 1)) * r->elem, e, r->elem);
+  atomic_store_explicit(&r->tail, tail + 1, memory_order_release);
+  return 0;
+}
+
+int ring_pop(spsc_ring *r, void *e)
+{
+  size_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+  size_t tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+
+  if (head == tail)
+    return -1;
+
+  memcpy(e, r->buf + (head & (r->cap - 1)) * r->elem, r->elem);
+  atomic_store_explicit(&r->head, head + 1, memory_order_release);
+  return 0;
+}
+
+size_t ring_depth(spsc_ring *r)
+{
+  // head first, so the tail read after it can't be behind it
+  size_t head = atomic_load_explicit(&r->head, memory_order_acquire);
+  size_t tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+
+  return tail - head;
+}
+
+void ring_free(spsc_ring *r)
+{
+  free(r->buf);
+  r->buf = NULL;
+}
@@ -0,0 +1,40 @@
+// lock-free single-producer/single-consumer ring of fixed-size elements
+//
+// by: Scott DeWolf
+//
+//  created: Saturday, October 17, 2026 (2026290)
+// modified: Saturday, October 17, 2026 (2026290)
+//  history:
+//           [2026290] - created document
+//
+
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <stddef.h>
+#include <stdatomic.h>
+
+// one thread pushes and one thread pops; neither ever blocks or locks
+typedef struct
+{
+  unsigned char *buf;     // cap elements of elem bytes
+  size_t elem, cap;       // element size and capacity (a power of 2)
+  atomic_size_t head;     // next element to pop (advanced by the consumer)
+  atomic_size_t tail;     // next element to push (advanced by the producer)
+} spsc_ring;
+
+// allocate a ring for at least cap elements; returns -1 if out of memory
+int ring_init(spsc_ring *r, size_t elem, size_t cap);
+
+// copy an element in (producer); returns -1 if the ring is full
+int ring_push(spsc_ring *r, const void *e);
+
+// copy an element out (consumer); returns -1 if the ring is empty
+int ring_pop(spsc_ring *r, void *e);
+
+// elements waiting in the ring
+size_t ring_depth(spsc_ring *r);
+
+void ring_free(spsc_ring *r);
+
+#endif
@@ -0,0 +1,320 @@
+// Steim-1 and Steim-2 compression for integer miniSEED channels
+//
+// by: Scott DeWolf
+//
+// The data section of a record is a run of 64-byte frames of 16 big endian
+// words. Word 0 of each frame holds a 2-bit code for every word of the frame,
+// words 1 and 2 of the first frame hold the forward (X0 = first sample) and
+// reverse (Xn = last sample) integration constants, and every other word packs
+// as many first differences as it can:
+//
+//   Steim-1: 4 x 8 bits (code 1), 2 x 16 bits (code 2), 1 x 32 bits (code 3)
+//   Steim-2: 4 x 8 bits (code 1),
+//            1 x 30, 2 x 15, 3 x 10 bits (code 2, dnib 1, 2, 3),
+//            5 x 6, 6 x 5, 7 x 4 bits (code 3, dnib 0, 1, 2)
+//
+// A Steim-2 difference that needs more than 30 bits can't be packed, so the
+// sample starts a new record instead (its difference is then not needed, since
+// X0 gives the first sample of a record).
+//
+//  created: Saturday, October 17, 2026 (2026290)
+// modified: Saturday, October 17, 2026 (2026290)
+//  history:
+//           [2026290] - created document
+//           [2026290] - added steim_prior() for records resumed after a restart
+//           [2026290] - added steim_frames() for records only as long as their data
+//
+
+#include <string.h>
+#include <stdint.h>
+#include "steim.h"
+
+// word layouts, densest first
+typedef struct
+{
+  int n, bits;         // differences per word and bits per difference
+  uint32_t code, dnib; // 2-bit codes in the frame's word 0 and the word itself
+} steim_layout;
+
+static const steim_layout steim1_layout[] = {{4, 8, 1, 0}, {2, 16, 2, 0}, {1, 32, 3, 0}};
+static const steim_layout steim2_layout[] = {{7, 4, 3, 2}, {6, 5, 3, 1}, {5, 6, 3, 0}, {4, 8, 1, 0},
+                                             {3, 10, 2, 3}, {2, 15, 2, 2}, {1, 30, 2, 1}};
+
+// local function definitions
+static int pack_steim(steim_encoder *se, int final);
+static void pack_word(steim_encoder *se, int navail);
+static int fits(int64_t d, int bits);
+static void put_word(unsigned char *p, uint32_t v);
+static uint32_t get_word(const unsigned char *p);
+static int32_t sign_extend(uint32_t v, int bits);
+static int word_size(uint32_t w, uint32_t code, int level, int *bits);
+
+void steim_init(steim_encoder *se, int level)
+{
+  memset(se, 0, sizeof(*se));
+  se->level = level;
+}
+
+int steim_start(steim_encoder *se, unsigned char *frames, int nframes)
+{
+  se->frames = frames;
+  se->nframes = nframes;
+  memset(frames, 0, (size_t)nframes * STEIM_FRAME);
+
+  // words 1 and 2 of the first frame are the integration constants
+  se->fi = 0;
+  se->wi = 3;
+  se->nsamp = 0;
+
+  // samples left over from the previous record
+  return pack_steim(se, 0);
+}
+
+int steim_add(steim_encoder *se, int32_t x)
+{
+  int64_t d = (se->have_last) ? ((int64_t)x - se->last) : 0;
+  int brk = 0;
+
+  // the difference is too large for any word
+  if (!fits(d, (se->level == 1) ? 32 : 30))
+  {
+    d = 0;
+    brk = 1;
+  }
+
+  se->pend_d[se->npend] = (int32_t)d;
+  se->pend_x[se->npend] = x;
+  se->pend_b[se->npend] = (uint8_t)brk;
+  se->npend++;
+  se->last = x;
+  se->have_last = 1;
+
+  return pack_steim(se, 0);
+}
+
+int steim_finish(steim_encoder *se)
+{
+  return pack_steim(se, 1);
+}
+
+int steim_count(const steim_encoder *se)
+{
+  return se->nsamp + se->npend;
+}
+
+int steim_frames(const steim_encoder *se)
+{
+  // the frame being filled counts once a word of it is (the first one always does)
+  return (se->wi > 1) ? se->fi + 1 : se->fi;
+}
+
+int steim_decode(const unsigned char *frames, int nframes, int level, int nsamp, int32_t *out)
+{
+  const unsigned char *f;
+  uint32_t nib, w, code;
+  int32_t d[7], X0, Xn, x = 0;
+  int fi, wi, k, n, bits, i = 0;
+
+  if (nsamp <= 0)
+    return 0;
+
+  X0 = (int32_t)get_word(frames + 4);
+  Xn = (int32_t)get_word(frames + 8);
+
+  for (fi = 0; (fi < nframes) & (i < nsamp); fi++)
+  {
+    f = frames + fi * STEIM_FRAME;
+    nib = get_word(f);
+    for (wi = (fi == 0) ? 3 : 1; (wi < 16) & (i < nsamp); wi++)
+    {
+      w = get_word(f + 4 * wi);
+      code = (nib >> (30 - 2 * wi)) & 3;
+      if (code == 0)
+        continue;
+      n = word_size(w, code, level, &bits);
+      if (n == 0)
+        return -1;
+
+      // the first difference sits in the most significant bits
+      for (k = 0; k < n; k++)
+      {
+        if (bits == 32)
+          d[k] = (int32_t)w;
+        else
+          d[k] = sign_extend(w >> ((n - 1 - k) * bits), bits);
+      }
+
+      // integrate (the first sample of the record is X0)
+      for (k = 0; (k < n) & (i < nsamp); k++)
+      {
+        x = (i == 0) ? X0 : (int32_t)((uint32_t)x + (uint32_t)d[k]);
+        out[i++] = x;
+      }
+    }
+  }
+
+  if ((i < nsamp) | (x != Xn))
+    return -1;
+  return i;
+}
+
+int32_t steim_prior(const unsigned char *frames, int level)
+{
+  uint32_t nib = get_word(frames), w, code;
+  int32_t X0 = (int32_t)get_word(frames + 4);
+  int wi, n, bits;
+
+  // the first data word of the first frame holds the first difference
+  for (wi = 3; wi < 16; wi++)
+  {
+    code = (nib >> (30 - 2 * wi)) & 3;
+    if (code == 0)
+      continue;
+    w = get_word(frames + 4 * wi);
+    n = word_size(w, code, level, &bits);
+    if (n == 0)
+      break;
+    if (bits == 32)
+      return (int32_t)((uint32_t)X0 - w);
+    return (int32_t)((uint32_t)X0 - (uint32_t)sign_extend(w >> ((n - 1) * bits), bits));
+  }
+
+  return X0;
+}
+
+static int word_size(uint32_t w, uint32_t code, int level, int *bits)
+{
+  const int n2[4] = {0, 1, 2, 3}, b2[4] = {0, 30, 15, 10};
+  const int n3[4] = {5, 6, 7, 0}, b3[4] = {6, 5, 4, 0};
+
+  // differences in a word with the given code (0 = not a valid word)
+  if (code == 1)
+  {
+    *bits = 8;
+    return 4;
+  }
+  if (level == 1)
+  {
+    *bits = (code == 2) ? 16 : 32;
+    return (code == 2) ? 2 : 1;
+  }
+  *bits = (code == 2) ? b2[w >> 30] : b3[w >> 30];
+  return (code == 2) ? n2[w >> 30] : n3[w >> 30];
+}
+
+static int pack_steim(steim_encoder *se, int final)
+{
+  int maxn = (se->level == 1) ? 4 : 7;
+  int i, nb;
+
+  while (se->npend > 0)
+  {
+    // queued samples up to the next one that has to start a new record
+    nb = se->npend;
+    for (i = 1; i < se->npend; i++)
+    {
+      if (se->pend_b[i])
+      {
+        nb = i;
+        break;
+      }
+    }
+
+    // wait until there are enough differences to fill the densest word
+    if ((!final) & (nb == se->npend) & (se->npend < maxn))
+      return 0;
+
+    // the next sample starts a new record
+    if (se->pend_b[0])
+    {
+      if (se->nsamp > 0)
+        return 1;
+      se->pend_b[0] = 0;
+    }
+
+    // no room left in the record
+    if ((se->frames == NULL) | (se->fi >= se->nframes))
+      return 1;
+
+    pack_word(se, nb);
+  }
+
+  return 0;
+}
+
+static void pack_word(steim_encoder *se, int navail)
+{
+  const steim_layout *lay = (se->level == 1) ? steim1_layout : steim2_layout;
+  int nlay = (se->level == 1) ? 3 : 7;
+  unsigned char *f = se->frames + se->fi * STEIM_FRAME;
+  uint32_t w = 0, mask;
+  int i, k;
+
+  // densest layout that holds the next differences
+  for (i = 0; i < nlay - 1; i++)
+  {
+    if (lay[i].n > navail)
+      continue;
+    for (k = 0; k < lay[i].n; k++)
+      if (!fits(se->pend_d[k], lay[i].bits))
+        break;
+    if (k == lay[i].n)
+      break;
+  }
+  lay += i;
+
+  // first difference in the most significant bits
+  mask = (lay->bits == 32) ? 0xFFFFFFFF : ((1u << lay->bits) - 1);
+  for (k = 0; k < lay->n; k++)
+    w = (lay->bits == 32) ? (uint32_t)se->pend_d[k] : ((w << lay->bits) | ((uint32_t)se->pend_d[k] & mask));
+  if ((se->level == 2) & (lay->code != 1))
+    w |= lay->dnib << 30;
+
+  put_word(f + 4 * se->wi, w);
+  put_word(f, get_word(f) | (lay->code << (30 - 2 * se->wi)));
+
+  // integration constants
+  if (se->nsamp == 0)
+    put_word(se->frames + 4, (uint32_t)se->pend_x[0]);
+  put_word(se->frames + 8, (uint32_t)se->pend_x[lay->n - 1]);
+  se->nsamp += lay->n;
+
+  // drop the packed samples from the queue
+  se->npend -= lay->n;
+  memmove(se->pend_d, se->pend_d + lay->n, se->npend * sizeof(se->pend_d[0]));
+  memmove(se->pend_x, se->pend_x + lay->n, se->npend * sizeof(se->pend_x[0]));
+  memmove(se->pend_b, se->pend_b + lay->n, se->npend * sizeof(se->pend_b[0]));
+
+  // next word
+  if (++se->wi == 16)
+  {
+    se->fi++;
+    se->wi = 1;
+  }
+}
+
+static int fits(int64_t d, int bits)
+{
+  return (d >= -((int64_t)1 << (bits - 1))) & (d < ((int64_t)1 << (bits - 1)));
+}
+
+static void put_word(unsigned char *p, uint32_t v)
+{
+  p[0] = (unsigned char)(v >> 24);
+  p[1] = (unsigned char)(v >> 16);
+  p[2] = (unsigned char)(v >> 8);
+  p[3] = (unsigned char)v;
+}
+
+static uint32_t get_word(const unsigned char *p)
+{
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static int32_t sign_extend(uint32_t v, int bits)
+{
+  uint32_t m = 1u << (bits - 1);
+
+  v &= (1u << bits) - 1;
+  return (int32_t)((v ^ m) - m);
+}
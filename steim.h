@@ -0,0 +1,69 @@
+// Steim-1 and Steim-2 compression for integer miniSEED channels
+//
+// by: Scott DeWolf
+//
+//  created: Saturday, October 17, 2026 (2026290)
+// modified: Saturday, October 17, 2026 (2026290)
+//  history:
+//           [2026290] - created document
+//           [2026290] - added steim_prior() for records resumed after a restart
+//           [2026290] - added steim_frames() for records only as long as their data
+//
+
+#ifndef STEIM_H
+#define STEIM_H
+
+#include <stdint.h>
+
+#define STEIM_FRAME 64    // bytes per frame (16 32-bit words)
+#define STEIM_PENDING 8   // differences waiting to be packed (7 per word at most, plus the newest)
+
+// state of one record being compressed
+//
+// Samples are queued as first differences and packed into words once enough
+// are waiting to choose the densest word. The queue survives steim_start(), so
+// samples that did not fit in a full record go into the next one, and the
+// first difference of a record is taken from the last sample of the previous
+// record (the integration constant X0 holds the first sample itself).
+typedef struct
+{
+  int level;                      // 1 = Steim-1, 2 = Steim-2
+  unsigned char *frames;          // data section of the record
+  int nframes;                    // frames that fit in the data section
+  int fi, wi;                     // frame and word that are filled next
+  int nsamp;                      // samples packed into the record
+  int32_t last;                   // last sample added (for the next difference)
+  int have_last;                  // a previous sample exists
+  int npend;                      // queued samples
+  int32_t pend_d[STEIM_PENDING];  // queued differences
+  int32_t pend_x[STEIM_PENDING];  // queued samples
+  uint8_t pend_b[STEIM_PENDING];  // queued sample must start a new record
+} steim_encoder;
+
+// reset the encoder (e.g., on startup) for Steim-1 (level 1) or Steim-2 (level 2)
+void steim_init(steim_encoder *se, int level);
+
+// start a new, zero-filled record in frames; returns 1 if it is already full
+int steim_start(steim_encoder *se, unsigned char *frames, int nframes);
+
+// add a sample; returns 1 if the record is full (the sample is kept for the next record)
+int steim_add(steim_encoder *se, int32_t x);
+
+// pack every queued sample that still fits; returns 1 if some are left for the next record
+int steim_finish(steim_encoder *se);
+
+// number of samples in the record including the queued ones
+int steim_count(const steim_encoder *se);
+
+// number of frames the record uses so far (at least the first one)
+int steim_frames(const steim_encoder *se);
+
+// decompress nsamp samples from a record; returns the number decoded or -1
+// if the data do not integrate to the reverse integration constant
+int steim_decode(const unsigned char *frames, int nframes, int level, int nsamp, int32_t *out);
+
+// the sample before a record (X0 minus its first difference), which an encoder
+// resuming the record has to take its first difference from
+int32_t steim_prior(const unsigned char *frames, int level);
+
+#endif
@@ -0,0 +1,301 @@
+// round-trip check of the Steim-1 and Steim-2 encoders
+//
+// by: Scott DeWolf
+//
+// Compresses sample sequences with steim.c the way mseed_writer.c does (a
+// record started with steim_start(), samples added until steim_add() says it
+// is full and carried into the next one, partial records flushed from a copy
+// of the encoder, and steim_finish() at the end), decodes every record with
+// steim_decode(), and checks that
+//
+//   - the records give back the samples, in order;
+//   - X0 and Xn of every record are its first and last sample;
+//   - the first difference of a record is taken from the last sample of the
+//     previous record (steim_prior()), except where the difference was too
+//     wide to pack and the sample had to start a new record;
+//   - a flushed partial record decodes to the samples added so far, and the
+//     samples added after it still go into the same record (the records come
+//     out the same with and without flushes).
+//
+// The sequences step through differences at the edges of every word layout
+// (4, 5, 6, 8, 10, 15, 16, 30 and 32 bits, both signs, and one past), mixed
+// at random, plus differences wider than 30 bits, in records of a few frames
+// so that many samples are carried across record boundaries.
+//
+// usage: ./steim_check (exits 1 on any mismatch)
+//
+//  created: Saturday, October 17, 2026 (2026290)
+// modified: Saturday, October 17, 2026 (2026290)
+//  history:
+//           [2026290] - created document
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "steim.h"
+
+#define MAX_SAMPLES 20000
+#define MAX_FRAMES 7
+
+// function definitions
+int check_sequence(const char *name, int level, int nframes, const int32_t *x, int n, int flush_every);
+int check_record(const char *name, int level, const unsigned char *frames, int nframes, int nsamp, const int32_t *x, int off, int n, int partial);
+int starts_record(int level, const int32_t *x, int i);
+int boundary_sequence(int32_t *x, int level);
+int wide_sequence(int32_t *x);
+uint32_t get_word(const unsigned char *p);
+uint32_t lcg(void);
+
+// global variables
+uint32_t seed;
+int failures = 0;
+
+int main(void)
+{
+  static int32_t x[MAX_SAMPLES];
+  char name[64];
+  int level, nframes, n, flush_every, nrec[2][2];
+
+  for (level = 1; level <= 2; level++)
+  {
+    for (nframes = 1; nframes <= MAX_FRAMES; nframes += 3)
+    {
+      for (flush_every = 0; flush_every <= 37; flush_every += 37)
+      {
+        // differences at the edges of the word layouts
+        n = boundary_sequence(x, level);
+        snprintf(name, sizeof(name), "Steim-%i boundaries, %i frames, flush %i", level, nframes, flush_every);
+        nrec[flush_every>0][0] = check_sequence(name, level, nframes, x, n, flush_every);
+
+        // differences too wide to pack (new records)
+        n = wide_sequence(x);
+        snprintf(name, sizeof(name), "Steim-%i wide, %i frames, flush %i", level, nframes, flush_every);
+        nrec[flush_every>0][1] = check_sequence(name, level, nframes, x, n, flush_every);
+      }
+      if ((nrec[0][0] != nrec[1][0]) | (nrec[0][1] != nrec[1][1]))
+      {
+        printf("Steim-%i, %i frames: flushes changed the records (%i and %i, not %i and %i)\n", level, nframes, nrec[1][0], nrec[1][1], nrec[0][0], nrec[0][1]);
+        failures++;
+      }
+    }
+  }
+
+  if (failures > 0)
+  {
+    printf("%i failures\n", failures);
+    return 1;
+  }
+  printf("all records round-trip\n");
+  return 0;
+}
+
+int check_sequence(const char *name, int level, int nframes, const int32_t *x, int n, int flush_every)
+{
+  unsigned char rec[MAX_FRAMES*STEIM_FRAME], copy[MAX_FRAMES*STEIM_FRAME];
+  steim_encoder se, fe;
+  int i, full, off = 0, nrec = 0, nflush = 0, fail = failures;
+
+  // the first sample starts the first record
+  steim_init(&se, level);
+  for (i = 0; i < n; i++)
+  {
+    if (i == off)
+      steim_start(&se, rec, nframes);
+
+    // write each full record and carry the leftover samples into the next one
+    full = steim_add(&se, x[i]);
+    while (full)
+    {
+      check_record(name, level, rec, nframes, se.nsamp, x, off, n, 0);
+      off += se.nsamp;
+      nrec++;
+      full = steim_start(&se, rec, nframes);
+    }
+
+    // a partial record, compressed from a copy of the encoder
+    if ((flush_every > 0) && (i % flush_every == flush_every - 1))
+    {
+      fe = se;
+      memcpy(copy, rec, sizeof(copy));
+      fe.frames = copy;
+      steim_finish(&fe);
+      check_record(name, level, copy, nframes, fe.nsamp, x, off, n, 1);
+      if (off + fe.nsamp > i + 1)
+      {
+        printf("%s: partial record at sample %i holds %i samples past the last one added\n", name, off, off + fe.nsamp - i - 1);
+        failures++;
+      }
+      nflush++;
+    }
+  }
+
+  // every queued sample, even if it takes more records
+  while (steim_finish(&se))
+  {
+    check_record(name, level, rec, nframes, se.nsamp, x, off, n, 0);
+    off += se.nsamp;
+    nrec++;
+    steim_start(&se, rec, nframes);
+  }
+  check_record(name, level, rec, nframes, se.nsamp, x, off, n, 0);
+  off += se.nsamp;
+  nrec++;
+
+  if (off != n)
+  {
+    printf("%s: %i samples in the records, %i added\n", name, off, n);
+    failures++;
+  }
+  printf("%-44s %6i samples %5i records %4i flushes  %s\n", name, n, nrec, nflush, (failures == fail) ? "ok" : "FAILED");
+  return (failures == fail) ? nrec : -1;
+}
+
+int check_record(const char *name, int level, const unsigned char *frames, int nframes, int nsamp, const int32_t *x, int off, int n, int partial)
+{
+  static int32_t out[MAX_FRAMES*STEIM_FRAME];
+  int32_t X0, Xn, prior;
+  int i, k;
+
+  if ((nsamp <= 0) | (off + nsamp > n))
+  {
+    printf("%s: record at sample %i holds %i samples (of %i)\n", name, off, nsamp, n - off);
+    return failures++;
+  }
+
+  // the samples
+  k = steim_decode(frames, nframes, level, nsamp, out);
+  if (k != nsamp)
+  {
+    printf("%s: %s record at sample %i: steim_decode() returned %i for %i samples\n", name, (partial) ? "partial" : "full", off, k, nsamp);
+    return failures++;
+  }
+  for (i = 0; i < nsamp; i++)
+    if (out[i] != x[off+i])
+    {
+      printf("%s: record at sample %i: sample %i is %i, not %i\n", name, off, i, out[i], x[off+i]);
+      return failures++;
+    }
+
+  // the integration constants
+  X0 = (int32_t)get_word(frames + 4);
+  Xn = (int32_t)get_word(frames + 8);
+  if ((X0 != x[off]) | (Xn != x[off+nsamp-1]))
+  {
+    printf("%s: record at sample %i: X0 = %i, Xn = %i, not %i and %i\n", name, off, X0, Xn, x[off], x[off+nsamp-1]);
+    return failures++;
+  }
+
+  // the first difference, from the previous record (none for the first
+  // sample or one that starts a record because its difference is too wide)
+  prior = steim_prior(frames, level);
+  if ((off > 0) && (!starts_record(level, x, off)) && (prior != x[off-1]))
+  {
+    printf("%s: record at sample %i: first difference from %i, not from the previous sample %i\n", name, off, prior, x[off-1]);
+    return failures++;
+  }
+  if (((off == 0) || (starts_record(level, x, off))) && (prior != X0))
+  {
+    printf("%s: record at sample %i: first difference %i, not 0\n", name, off, X0 - prior);
+    return failures++;
+  }
+
+  // a sample whose difference is too wide starts a record
+  for (i = 1; i < nsamp; i++)
+    if (starts_record(level, x, off + i))
+    {
+      printf("%s: record at sample %i: sample %i has a difference too wide to pack\n", name, off, i);
+      return failures++;
+    }
+
+  return 0;
+}
+
+int starts_record(int level, const int32_t *x, int i)
+{
+  int64_t d, lim = (level == 1) ? ((int64_t)1 << 31) : ((int64_t)1 << 29);
+
+  if (i == 0)
+    return 0;
+  d = (int64_t)x[i] - x[i-1];
+  return (d < -lim) | (d >= lim);
+}
+
+int boundary_sequence(int32_t *x, int level)
+{
+  const int bits[] = {4, 5, 6, 8, 10, 15, 16, 30, 32};
+  int64_t d[4*9+1], v = 0, lim;
+  int nd = 0, i, k, n = 0, nb = (level == 1) ? 9 : 8;
+
+  // the same sequence every time
+  seed = 2026290;
+
+  // the largest and smallest difference of each width, and one past each
+  for (k = 0; k < nb; k++)
+  {
+    lim = (int64_t)1 << (bits[k] - 1);
+    d[nd++] = lim - 1;
+    d[nd++] = -lim;
+    if (bits[k] < ((level == 1) ? 32 : 30))
+    {
+      d[nd++] = lim;
+      d[nd++] = -lim - 1;
+    }
+  }
+  d[nd++] = 0;
+
+  // runs of one difference (so every layout fills whole words), then a mix
+  for (k = 0; k < nd; k++)
+    for (i = 0; i < 9; i++)
+    {
+      v += ((v + d[k] > INT32_MAX) | (v + d[k] < INT32_MIN)) ? -d[k] : d[k];
+      x[n++] = (int32_t)v;
+    }
+  while (n < MAX_SAMPLES / 2)
+  {
+    // mostly small differences, with a wide one now and then
+    k = (lcg() % 4 == 0) ? (int)(lcg() % nd) : (int)(lcg() % 12);
+    v += ((v + d[k] > INT32_MAX) | (v + d[k] < INT32_MIN)) ? -d[k] : d[k];
+    x[n++] = (int32_t)v;
+  }
+  return n;
+}
+
+int wide_sequence(int32_t *x)
+{
+  int n = 0, i;
+
+  // slow ramps broken by jumps of 2^30 and more (new records at Steim-2,
+  // 32-bit words at Steim-1) and from one end of the int32 range to the
+  // other (new records at both)
+  for (i = 0; i < 500; i++)
+  {
+    x[n] = (n > 0) ? x[n-1] + 3 : 0;
+    n++;
+    if (i % 97 == 50)
+    {
+      x[n] = x[n-1] + (1 << 30);
+      n++;
+    }
+    if (i % 131 == 70)
+    {
+      x[n] = INT32_MIN;
+      x[n+1] = INT32_MAX;
+      x[n+2] = -5;
+      n += 3;
+    }
+  }
+  return n;
+}
+
+uint32_t get_word(const unsigned char *p)
+{
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+uint32_t lcg(void)
+{
+  seed = seed * 1664525 + 1013904223;
+  return seed >> 8;
+}
@@ -0,0 +1,7 @@
+#!/bin/bash
+
+echo -e "\nCompiling Steim round-trip check . . . \c"
+gcc steim_check.c steim.c -O2 -g -Wall -o steim_check
+echo -e "done!\n"
+
+rm -f *~ > /dev/null
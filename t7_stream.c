@@ -0,0 +1,257 @@
+// hardware-timed stream acquisition from a LabJack T7
+//
+// by: Scott DeWolf
+//
+// The polled programs read the AINs with LJM_eReadNames() as fast as the
+// network allows, so the number of reads per window varies with jitter and
+// tops out at a few hundred per second. In stream mode the T7 scans the
+// channels on its own clock and LJM delivers them in blocks of ScansPerRead,
+// so the fringe channels can be oversampled at kHz rates and every scan has
+// an exact time. The scans are handed out one at a time and grouped into the
+// same t_center +/- 0.5/fs windows as the polled reads.
+//
+// After t7_stream_notify(), the LJM stream callback bumps an eventfd for each
+// block it has ready, and a block is only read once it was announced.
+//
+//  created: Saturday, October 17, 2026 (2026290)
+// modified: Saturday, October 17, 2026 (2026290)
+//  history:
+//           [2026290] - created document
+//           [2026290] - added t7_stream_notify() for programs that wait in an event loop
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <LabJackM.h>
+#include "t7_stream.h"
+
+// LJM fills the scans it couldn't recover with this value
+#define DUMMY_VALUE -9999.0
+
+// share of a later t0 estimate taken per block
+#define T0_GAIN 0.001
+
+// local function definitions
+static int read_block(t7_stream *s);
+static int block_ready(t7_stream *s);
+static void announce_block(void *arg);
+static double epoch_now(void);
+static void print_ljm_error(int err, const char *what);
+
+int t7_stream_start(t7_stream *s, int handle, int NumChan, const char **aNames, double ScanRate, int ScansPerRead)
+{
+  // stream configuration: no trigger, internal clock, default resolution and settling
+  enum { NUM_FRAMES_STREAM = 4 };
+  const char *aNamesStream[NUM_FRAMES_STREAM] = {"STREAM_TRIGGER_INDEX", "STREAM_CLOCK_SOURCE", "STREAM_RESOLUTION_INDEX", "STREAM_SETTLING_US"};
+  const double aValuesStream[NUM_FRAMES_STREAM] = {0, 0, 0, 0};
+  int aTypes[T7_STREAM_MAX_CHAN];
+  int errorAddress;
+
+  memset(s, 0, sizeof(*s));
+  s->handle = handle;
+  s->NumChan = NumChan;
+  s->ScanRate = ScanRate;
+  s->ScansPerRead = ScansPerRead;
+  s->next = ScansPerRead;
+  s->efd = -1;
+
+  if ((NumChan < 1) | (NumChan > T7_STREAM_MAX_CHAN))
+  {
+    fprintf(stderr, "t7_stream_start: %i channels (1 to %i allowed)\n", NumChan, T7_STREAM_MAX_CHAN);
+    return s->err = -1;
+  }
+
+  s->aData = malloc((size_t)ScansPerRead * NumChan * sizeof(double));
+  if (s->aData == NULL)
+  {
+    perror("t7_stream_start");
+    return s->err = -1;
+  }
+
+  // the scan list is given as Modbus addresses
+  s->err = LJM_NamesToAddresses(NumChan, aNames, s->aScanList, aTypes);
+  if (s->err != LJME_NOERROR)
+  {
+    print_ljm_error(s->err, "LJM_NamesToAddresses");
+    return s->err;
+  }
+
+  // stop a stream left running by an earlier run (an error here is expected)
+  LJM_eStreamStop(handle);
+
+  s->err = LJM_eWriteNames(handle, NUM_FRAMES_STREAM, aNamesStream, aValuesStream, &errorAddress);
+  if (s->err != LJME_NOERROR)
+  {
+    print_ljm_error(s->err, "LJM_eWriteNames");
+    return s->err;
+  }
+
+  // the T7 returns the scan rate it will actually use
+  s->err = LJM_eStreamStart(handle, ScansPerRead, NumChan, s->aScanList, &s->ScanRate);
+  if (s->err != LJME_NOERROR)
+  {
+    print_ljm_error(s->err, "LJM_eStreamStart");
+    return s->err;
+  }
+
+  return LJME_NOERROR;
+}
+
+double t7_stream_window(t7_stream *s, double fs)
+{
+  int64_t idx;
+
+  if ((s->next == s->ScansPerRead) && ((!block_ready(s)) || (read_block(s) != LJME_NOERROR)))
+    return 0;
+
+  // never repeat a window, e.g., when t0 moved back a little
+  idx = (int64_t)floor((s->t0 + (double)(s->scan + s->next) / s->ScanRate) * fs + 0.5);
+  if (idx <= s->idx)
+    idx = s->idx + 1;
+  s->idx = idx;
+
+  return (double)idx / fs;
+}
+
+int t7_stream_scan(t7_stream *s, double t_stop, double *aValues)
+{
+  const double *scan;
+  int i;
+
+  while (1)
+  {
+    if ((s->next == s->ScansPerRead) && (!block_ready(s)))
+      return -1;
+    if ((s->next == s->ScansPerRead) && (read_block(s) != LJME_NOERROR))
+      return 0;
+
+    // the scan belongs to the next window
+    if (s->t0 + (double)(s->scan + s->next) / s->ScanRate >= t_stop)
+      return 0;
+
+    scan = s->aData + s->next * s->NumChan;
+    s->next++;
+
+    // skip scans lost while LJM recovered the stream
+    for (i = 0; i < s->NumChan; i++)
+      if (scan[i] == DUMMY_VALUE)
+        break;
+    if (i < s->NumChan)
+    {
+      s->skipped++;
+      continue;
+    }
+
+    memcpy(aValues, scan, s->NumChan * sizeof(double));
+    return 1;
+  }
+}
+
+int t7_stream_notify(t7_stream *s)
+{
+  s->efd = eventfd(0, EFD_NONBLOCK);
+  if (s->efd == -1)
+  {
+    perror("t7_stream_notify");
+    return -1;
+  }
+
+  s->err = LJM_SetStreamCallback(s->handle, announce_block, s);
+  if (s->err != LJME_NOERROR)
+  {
+    print_ljm_error(s->err, "LJM_SetStreamCallback");
+    close(s->efd);
+    return s->efd = -1;
+  }
+
+  return s->efd;
+}
+
+int t7_stream_stop(t7_stream *s)
+{
+  int err = LJM_eStreamStop(s->handle);
+
+  if (s->efd != -1)
+    close(s->efd);
+  s->efd = -1;
+  free(s->aData);
+  s->aData = NULL;
+  if (s->skipped > 0)
+    fprintf(stderr, "t7_stream_stop: %lu scans lost during the stream\n", s->skipped);
+
+  return err;
+}
+
+static int read_block(t7_stream *s)
+{
+  int DeviceScanBacklog = 0, LJMScanBacklog = 0;
+  double t0;
+
+  s->err = LJM_eStreamRead(s->handle, s->aData, &DeviceScanBacklog, &LJMScanBacklog);
+  if (s->err != LJME_NOERROR)
+  {
+    print_ljm_error(s->err, "LJM_eStreamRead");
+    return s->err;
+  }
+  s->scan = s->blocks * s->ScansPerRead;
+  s->blocks++;
+
+  // time of scan 0 if the newest scan (including those still queued) was taken just now
+  t0 = epoch_now() - (double)(s->scan + s->ScansPerRead + DeviceScanBacklog + LJMScanBacklog) / s->ScanRate;
+  if ((s->blocks == 1) || (t0 < s->t0))
+    s->t0 = t0;
+  else
+    s->t0 += T0_GAIN * (t0 - s->t0);
+
+  s->next = 0;
+  return LJME_NOERROR;
+}
+
+static int block_ready(t7_stream *s)
+{
+  uint64_t n;
+
+  // without notification, LJM_eStreamRead() waits for the block
+  if (s->efd == -1)
+    return 1;
+
+  // take note of the blocks announced since the last look
+  if (read(s->efd, &n, sizeof(n)) == sizeof(n))
+    s->ready += n;
+  if (s->ready == 0)
+    return 0;
+
+  s->ready--;
+  return 1;
+}
+
+static void announce_block(void *arg)
+{
+  t7_stream *s = arg;
+  uint64_t one = 1;
+
+  // called by an LJM thread whenever ScansPerRead more scans are ready
+  if (write(s->efd, &one, sizeof(one)) != sizeof(one))
+    perror("t7_stream callback");
+}
+
+static double epoch_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1000000000;
+}
+
+static void print_ljm_error(int err, const char *what)
+{
+  char errName[LJM_STRING_ALLOCATION_SIZE];
+
+  LJM_ErrorToString(err, errName);
+  fprintf(stderr, "%s: %s (%i)\n", what, errName, err);
+}
@@ -0,0 +1,67 @@
+// hardware-timed stream acquisition from a LabJack T7
+//
+// by: Scott DeWolf
+//
+//  created: Saturday, October 17, 2026 (2026290)
+// modified: Saturday, October 17, 2026 (2026290)
+//  history:
+//           [2026290] - created document
+//           [2026290] - added t7_stream_notify() for programs that wait in an event loop
+//
+
+#ifndef T7_STREAM_H
+#define T7_STREAM_H
+
+#include <stdint.h>
+
+#define T7_STREAM_MAX_CHAN 16  // most channels in a scan list
+
+// state of one stream
+//
+// The T7 clocks the scans itself, so scan j of the stream was taken at
+// t0 + j / ScanRate. t0 is estimated from the host clock when each block
+// arrives: it follows an earlier estimate at once (the block was delivered
+// faster than before) and a later one slowly, which keeps the delivery
+// latency out of the time stamps while still tracking the drift of the T7
+// clock against the host. The scans are then stamped late by the shortest
+// delivery latency only (about a millisecond on the local network).
+typedef struct
+{
+  int handle;                           // LJM handle of the open T7
+  int NumChan;                          // channels in the scan list
+  int aScanList[T7_STREAM_MAX_CHAN];    // Modbus addresses of the channels
+  double ScanRate;                      // scans per second (as set by the T7)
+  int ScansPerRead;                     // scans delivered by each LJM_eStreamRead()
+  double *aData;                        // ScansPerRead scans of NumChan values
+  int next;                             // next scan in aData to hand out
+  uint64_t blocks;                      // blocks read since the stream started
+  uint64_t scan;                        // stream index of the first scan in aData
+  double t0;                            // epoch time of scan 0 of the stream
+  int64_t idx;                          // t_center * fs of the last window
+  unsigned long skipped;                // scans lost while LJM recovered the stream
+  int err;                              // last LJM error (LJME_NOERROR = none)
+  int efd;                              // eventfd counting the blocks LJM announced (-1 = none)
+  uint64_t ready;                       // announced blocks not read yet
+} t7_stream;
+
+// configure and start streaming the named channels (e.g., "AIN0") at ScanRate
+// scans per second; returns the LJM error code
+int t7_stream_start(t7_stream *s, int handle, int NumChan, const char **aNames, double ScanRate, int ScansPerRead);
+
+// center time of the sample window (of rate fs) holding the next scan
+double t7_stream_window(t7_stream *s, double fs);
+
+// copy the next scan into aValues if it was taken before t_stop; returns 0
+// (keeping the scan) once the window is over or on a read error (see err)
+int t7_stream_scan(t7_stream *s, double t_stop, double *aValues);
+
+// have LJM announce each block on a descriptor (returned, or -1 on error) so
+// an event loop can wait for it; from then on the stream never blocks:
+// t7_stream_window() returns 0 and t7_stream_scan() returns -1 when they
+// need a block that hasn't been announced yet
+int t7_stream_notify(t7_stream *s);
+
+// stop the stream; returns the LJM error code
+int t7_stream_stop(t7_stream *s);
+
+#endif
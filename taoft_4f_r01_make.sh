@@ -1,7 +1,7 @@
 #!/bin/bash
 
 echo -e "\nCompiling TAOFT-4F Rev.01 data acquisition code for the LabJack T7 . . . \c"
-gcc taoft_4f_r01_daq.c -g -Wall -lLabJackM -lm -o t4f1_daq
+gcc taoft_4f_r01_daq.c mseed_writer.c io_batch.c steim.c spsc_ring.c sampler.c t7_stream.c threefringe.c -O2 -g -Wall -pthread -lLabJackM -lm -o t4f1_daq
 echo -e "done!\n"
 
 rm -f *~ > /dev/null
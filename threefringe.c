@@ -0,0 +1,250 @@
+// block three-fringe phase kernel shared by the interferometer programs
+//
+// by: Scott DeWolf
+//
+// The phase of a scan is atan2(s, c) of its sine and cosine projections onto
+// the fitted ellipse, unwrapped by counting fringes (M). The programs used to
+// do this one scan at a time with libm atan2() and globals for the state;
+// here a whole block of scans goes through the projections and atan2() four
+// (AVX2) or two (SSE2) at a time, and the fringe counting runs over the block
+// afterwards, so only the cheap integer count is serial.
+//
+// atan2() follows the Cephes atan(): the ratio of the smaller to the larger of
+// |s| and |c| lies in [0, 1], above 0.66 it is mapped to (t - 1) / (t + 1)
+// around pi/4, and a 4/5 rational function does the rest. It stays within a
+// few units in the last place of libm atan2() (threefringe_bench reports the
+// bound), and every path computes the same operations in the same order.
+//
+// The old per-scan unwrapping compared abs(p_new - p_old) > pi with the
+// integer abs(), so only jumps of 4 rad or more were unwrapped; this uses the
+// full magnitude of the jump.
+//
+//  created: Saturday, October 17, 2026 (2026290)
+// modified: Saturday, October 17, 2026 (2026290)
+//  history:
+//           [2026290] - created document from the threefringe_phase() copies in the *_daq.c programs
+//
+
+#include <math.h>
+#include "threefringe.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86 1
+#endif
+
+// Cephes atan() constants
+#define PI 3.14159265358979323846
+#define PIO2 1.57079632679489661923
+#define PIO4 0.78539816339744830962
+#define MOREBITS 6.123233995736765886130E-17
+#define P0 -8.750608600031904122785E-1
+#define P1 -1.615753718733365076637E1
+#define P2 -7.500855792314704667340E1
+#define P3 -1.228866684490136173410E2
+#define P4 -6.485021904942025371773E1
+#define Q0 2.485846490142306297962E1
+#define Q1 1.650270098316988542046E2
+#define Q2 4.328810604912902668951E2
+#define Q3 4.853903996359136964868E2
+#define Q4 1.945506571482613964425E2
+
+// local function definitions
+static void wrapped_scalar(const threefringe *tf, int i, int n, const double *x, const double *y, const double *z, double *w);
+#ifdef HAVE_X86
+static void wrapped_sse2(const threefringe *tf, int n, const double *x, const double *y, const double *z, double *w);
+static void wrapped_avx2(const threefringe *tf, int n, const double *x, const double *y, const double *z, double *w);
+#endif
+
+void threefringe_init(threefringe *tf, double cx, double cy, double cz, double sx, double sy, double sz)
+{
+  tf->cx = cx;
+  tf->cy = cy;
+  tf->cz = cz;
+  tf->sx = sx;
+  tf->sy = sy;
+  tf->sz = sz;
+  tf->w_old = 0;
+  tf->M = 0;
+}
+
+void threefringe_block(threefringe *tf, int nint, int n, int stride, const double *x, const double *y, const double *z, double *p)
+{
+  int i, k;
+  double d;
+
+  for (k = 0; k < nint; k++, tf++, x += stride, y += stride, z += stride, p += stride)
+  {
+    // wrapped phase of every scan
+#ifdef HAVE_X86
+    if (__builtin_cpu_supports("avx2"))
+      wrapped_avx2(tf, n, x, y, z, p);
+    else
+      wrapped_sse2(tf, n, x, y, z, p);
+#else
+    wrapped_scalar(tf, 0, n, x, y, z, p);
+#endif
+
+    // count fringes across the block (and from the previous one)
+    for (i = 0; i < n; i++)
+    {
+      d = p[i] - tf->w_old;
+      tf->M += (d < -PI) - (d > PI);
+      tf->w_old = p[i];
+      p[i] += 2 * PI * tf->M;
+    }
+  }
+}
+
+const char *threefringe_path(void)
+{
+#ifdef HAVE_X86
+  if (__builtin_cpu_supports("avx2"))
+    return "avx2";
+  return "sse2";
+#else
+  return "scalar";
+#endif
+}
+
+double threefringe_atan2(double s, double c)
+{
+  double as = fabs(s), ac = fabs(c);
+  double mx = (as > ac) ? as : ac;
+  double mn = (as > ac) ? ac : as;
+  double t, u, y0 = 0, extra = 0, zz, num, den, r;
+
+  // atan() of the ratio in [0, 1]
+  t = (mx > 0) ? mn / mx : 0;
+  u = t;
+  if (t > 0.66)
+  {
+    u = (t - 1) / (t + 1);
+    y0 = PIO4;
+    extra = 0.5 * MOREBITS;
+  }
+  zz = u * u;
+  num = (((P0 * zz + P1) * zz + P2) * zz + P3) * zz + P4;
+  den = ((((zz + Q0) * zz + Q1) * zz + Q2) * zz + Q3) * zz + Q4;
+  r = y0 + (((u * zz) * num / den + u) + extra);
+
+  // back to the octant of (c, s)
+  if (as > ac)
+    r = (PIO2 - r) + MOREBITS;
+  if (c < 0)
+    r = (PI - r) + 2 * MOREBITS;
+  return copysign(r, s);
+}
+
+static void wrapped_scalar(const threefringe *tf, int i, int n, const double *x, const double *y, const double *z, double *w)
+{
+  for (; i < n; i++)
+    w[i] = threefringe_atan2(tf->sx * x[i] + tf->sy * y[i] + tf->sz * z[i], tf->cx * x[i] + tf->cy * y[i] + tf->cz * z[i]);
+}
+
+#ifdef HAVE_X86
+static void wrapped_sse2(const threefringe *tf, int n, const double *x, const double *y, const double *z, double *w)
+{
+  const __m128d sign = _mm_set1_pd(-0.0), zero = _mm_setzero_pd(), one = _mm_set1_pd(1.0);
+  const __m128d cx = _mm_set1_pd(tf->cx), cy = _mm_set1_pd(tf->cy), cz = _mm_set1_pd(tf->cz);
+  const __m128d sx = _mm_set1_pd(tf->sx), sy = _mm_set1_pd(tf->sy), sz = _mm_set1_pd(tf->sz);
+  __m128d X, Y, Z, C, S, as, ac, mx, mn, t, u, m, zz, num, den, r, y0, extra;
+  int i;
+
+  for (i = 0; i + 2 <= n; i += 2)
+  {
+    X = _mm_loadu_pd(x + i);
+    Y = _mm_loadu_pd(y + i);
+    Z = _mm_loadu_pd(z + i);
+    C = _mm_add_pd(_mm_add_pd(_mm_mul_pd(cx, X), _mm_mul_pd(cy, Y)), _mm_mul_pd(cz, Z));
+    S = _mm_add_pd(_mm_add_pd(_mm_mul_pd(sx, X), _mm_mul_pd(sy, Y)), _mm_mul_pd(sz, Z));
+
+    // atan() of the ratio in [0, 1] (0 / 0 is masked to 0)
+    as = _mm_andnot_pd(sign, S);
+    ac = _mm_andnot_pd(sign, C);
+    mx = _mm_max_pd(as, ac);
+    mn = _mm_min_pd(as, ac);
+    t = _mm_and_pd(_mm_div_pd(mn, mx), _mm_cmpgt_pd(mx, zero));
+    m = _mm_cmpgt_pd(t, _mm_set1_pd(0.66));
+    u = _mm_or_pd(_mm_and_pd(m, _mm_div_pd(_mm_sub_pd(t, one), _mm_add_pd(t, one))), _mm_andnot_pd(m, t));
+    y0 = _mm_and_pd(m, _mm_set1_pd(PIO4));
+    extra = _mm_and_pd(m, _mm_set1_pd(0.5 * MOREBITS));
+    zz = _mm_mul_pd(u, u);
+    num = _mm_add_pd(_mm_mul_pd(_mm_set1_pd(P0), zz), _mm_set1_pd(P1));
+    num = _mm_add_pd(_mm_mul_pd(num, zz), _mm_set1_pd(P2));
+    num = _mm_add_pd(_mm_mul_pd(num, zz), _mm_set1_pd(P3));
+    num = _mm_add_pd(_mm_mul_pd(num, zz), _mm_set1_pd(P4));
+    den = _mm_add_pd(zz, _mm_set1_pd(Q0));
+    den = _mm_add_pd(_mm_mul_pd(den, zz), _mm_set1_pd(Q1));
+    den = _mm_add_pd(_mm_mul_pd(den, zz), _mm_set1_pd(Q2));
+    den = _mm_add_pd(_mm_mul_pd(den, zz), _mm_set1_pd(Q3));
+    den = _mm_add_pd(_mm_mul_pd(den, zz), _mm_set1_pd(Q4));
+    r = _mm_div_pd(_mm_mul_pd(_mm_mul_pd(u, zz), num), den);
+    r = _mm_add_pd(y0, _mm_add_pd(_mm_add_pd(r, u), extra));
+
+    // back to the octant of (c, s)
+    m = _mm_cmpgt_pd(as, ac);
+    r = _mm_or_pd(_mm_and_pd(m, _mm_add_pd(_mm_sub_pd(_mm_set1_pd(PIO2), r), _mm_set1_pd(MOREBITS))), _mm_andnot_pd(m, r));
+    m = _mm_cmplt_pd(C, zero);
+    r = _mm_or_pd(_mm_and_pd(m, _mm_add_pd(_mm_sub_pd(_mm_set1_pd(PI), r), _mm_set1_pd(2 * MOREBITS))), _mm_andnot_pd(m, r));
+    r = _mm_or_pd(r, _mm_and_pd(sign, S));
+
+    _mm_storeu_pd(w + i, r);
+  }
+
+  wrapped_scalar(tf, i, n, x, y, z, w);
+}
+
+__attribute__((target("avx2")))
+static void wrapped_avx2(const threefringe *tf, int n, const double *x, const double *y, const double *z, double *w)
+{
+  const __m256d sign = _mm256_set1_pd(-0.0), zero = _mm256_setzero_pd(), one = _mm256_set1_pd(1.0);
+  const __m256d cx = _mm256_set1_pd(tf->cx), cy = _mm256_set1_pd(tf->cy), cz = _mm256_set1_pd(tf->cz);
+  const __m256d sx = _mm256_set1_pd(tf->sx), sy = _mm256_set1_pd(tf->sy), sz = _mm256_set1_pd(tf->sz);
+  __m256d X, Y, Z, C, S, as, ac, mx, mn, t, u, m, zz, num, den, r, y0, extra;
+  int i;
+
+  for (i = 0; i + 4 <= n; i += 4)
+  {
+    X = _mm256_loadu_pd(x + i);
+    Y = _mm256_loadu_pd(y + i);
+    Z = _mm256_loadu_pd(z + i);
+    C = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(cx, X), _mm256_mul_pd(cy, Y)), _mm256_mul_pd(cz, Z));
+    S = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(sx, X), _mm256_mul_pd(sy, Y)), _mm256_mul_pd(sz, Z));
+
+    // atan() of the ratio in [0, 1] (0 / 0 is masked to 0)
+    as = _mm256_andnot_pd(sign, S);
+    ac = _mm256_andnot_pd(sign, C);
+    mx = _mm256_max_pd(as, ac);
+    mn = _mm256_min_pd(as, ac);
+    t = _mm256_and_pd(_mm256_div_pd(mn, mx), _mm256_cmp_pd(mx, zero, _CMP_GT_OQ));
+    m = _mm256_cmp_pd(t, _mm256_set1_pd(0.66), _CMP_GT_OQ);
+    u = _mm256_blendv_pd(t, _mm256_div_pd(_mm256_sub_pd(t, one), _mm256_add_pd(t, one)), m);
+    y0 = _mm256_and_pd(m, _mm256_set1_pd(PIO4));
+    extra = _mm256_and_pd(m, _mm256_set1_pd(0.5 * MOREBITS));
+    zz = _mm256_mul_pd(u, u);
+    num = _mm256_add_pd(_mm256_mul_pd(_mm256_set1_pd(P0), zz), _mm256_set1_pd(P1));
+    num = _mm256_add_pd(_mm256_mul_pd(num, zz), _mm256_set1_pd(P2));
+    num = _mm256_add_pd(_mm256_mul_pd(num, zz), _mm256_set1_pd(P3));
+    num = _mm256_add_pd(_mm256_mul_pd(num, zz), _mm256_set1_pd(P4));
+    den = _mm256_add_pd(zz, _mm256_set1_pd(Q0));
+    den = _mm256_add_pd(_mm256_mul_pd(den, zz), _mm256_set1_pd(Q1));
+    den = _mm256_add_pd(_mm256_mul_pd(den, zz), _mm256_set1_pd(Q2));
+    den = _mm256_add_pd(_mm256_mul_pd(den, zz), _mm256_set1_pd(Q3));
+    den = _mm256_add_pd(_mm256_mul_pd(den, zz), _mm256_set1_pd(Q4));
+    r = _mm256_div_pd(_mm256_mul_pd(_mm256_mul_pd(u, zz), num), den);
+    r = _mm256_add_pd(y0, _mm256_add_pd(_mm256_add_pd(r, u), extra));
+
+    // back to the octant of (c, s)
+    m = _mm256_cmp_pd(as, ac, _CMP_GT_OQ);
+    r = _mm256_blendv_pd(r, _mm256_add_pd(_mm256_sub_pd(_mm256_set1_pd(PIO2), r), _mm256_set1_pd(MOREBITS)), m);
+    m = _mm256_cmp_pd(C, zero, _CMP_LT_OQ);
+    r = _mm256_blendv_pd(r, _mm256_add_pd(_mm256_sub_pd(_mm256_set1_pd(PI), r), _mm256_set1_pd(2 * MOREBITS)), m);
+    r = _mm256_or_pd(r, _mm256_and_pd(sign, S));
+
+    _mm256_storeu_pd(w + i, r);
+  }
+
+  wrapped_scalar(tf, i, n, x, y, z, w);
+}
+#endif
@@ -0,0 +1,37 @@
+// block three-fringe phase kernel shared by the interferometer programs
+//
+// by: Scott DeWolf
+//
+//  created: Saturday, October 17, 2026 (2026290)
+// modified: Saturday, October 17, 2026 (2026290)
+//  history:
+//           [2026290] - created document from the threefringe_phase() copies in the *_daq.c programs
+//
+
+#ifndef THREEFRINGE_H
+#define THREEFRINGE_H
+
+// state of one interferometer
+typedef struct
+{
+  double cx, cy, cz;                // non-dimensional ellipse parameters (cosine projection)
+  double sx, sy, sz;                // non-dimensional ellipse parameters (sine projection)
+  double w_old;                     // wrapped phase of the last scan
+  int M;                            // fringe count (unwrapped phase = wrapped phase + 2 pi M)
+} threefringe;
+
+// set up an interferometer with its ellipse parameters
+void threefringe_init(threefringe *tf, double cx, double cy, double cz, double sx, double sy, double sz);
+
+// unwrapped phase of n scans of nint interferometers, given as structure of
+// arrays: x[k * stride + i] is scan i of interferometer k (same for y, z, and
+// p). The unwrapping carries over from the previous block through tf[k].
+void threefringe_block(threefringe *tf, int nint, int n, int stride, const double *x, const double *y, const double *z, double *p);
+
+// the atan2() used by threefringe_block() (scalar version, for checking)
+double threefringe_atan2(double s, double c);
+
+// name of the code path threefringe_block() uses on this CPU ("avx2", "sse2" or "scalar")
+const char *threefringe_path(void);
+
+#endif
@@ -0,0 +1,195 @@
+// benchmark and error bound of the block three-fringe phase kernel
+//
+// by: Scott DeWolf
+//
+// Times threefringe_block() against the per-scan threefringe_phase() from
+// aofs_cc_r04_daq.c on synthetic fringes with the AVN4 ellipse parameters, and
+// reports how far threefringe_atan2() (and the phases of threefringe_block())
+// stray from libm atan2().
+//
+// usage: ./tf_bench [number of scans] [scans per block]
+//
+//  created: Saturday, October 17, 2026 (2026290)
+// modified: Saturday, October 17, 2026 (2026290)
+//  history:
+//           [2026290] - created document
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include "threefringe.h"
+
+// function definitions
+double threefringe_phase(double x, double y, double z);
+double elapsed(struct timespec *t0);
+
+// global constants
+const double pi = 3.1415926535897932; // can't live without pi!
+
+// non-dimensional ellipse parameters (AOFS-CC Rev.04)
+const double cx = -0.25401433640831838633999950616271;
+const double cy =  0.49982098573571354105382624766207;
+const double cz = -0.55350689053944612805224778639968;
+const double sx =  0.47605067102574716297880286219879;
+const double sy = -0.01927205902745755122795756619780;
+const double sz = -0.96175425280410009598597298463574;
+
+// global variables for phase computations (threefringe_phase)
+double p_old = 0, p_new = 0;
+int M = 0;
+
+int main(int argc, char **argv)
+{
+  int n = (argc > 1) ? atoi(argv[1]) : 4000000;
+  int B = (argc > 2) ? atoi(argv[2]) : 200;
+  double *x, *y, *z, *p_ref, *p_blk;
+  double gcc, gcs, gss, det, a[3], b[3], th, dth = 0, cs, sn, d, w, w_old = 0;
+  double t_scan, t_block, err, err_max = 0, rel_max = 0;
+  double s, c, r;
+  struct timespec t0;
+  threefringe tf;
+  int i, k, M_ref = 0, miss = 0;
+
+  x = malloc(n * sizeof(double));
+  y = malloc(n * sizeof(double));
+  z = malloc(n * sizeof(double));
+  p_ref = malloc(n * sizeof(double));
+  p_blk = malloc(n * sizeof(double));
+  if ((x == NULL) | (y == NULL) | (z == NULL) | (p_ref == NULL) | (p_blk == NULL))
+  {
+    perror("malloc");
+    return 1;
+  }
+
+  // x,y,z whose projections are (cos, sin) of the phase: the dual basis of the ellipse vectors
+  gcc = cx * cx + cy * cy + cz * cz;
+  gcs = cx * sx + cy * sy + cz * sz;
+  gss = sx * sx + sy * sy + sz * sz;
+  det = gcc * gss - gcs * gcs;
+  a[0] = (gss * cx - gcs * sx) / det;
+  a[1] = (gss * cy - gcs * sy) / det;
+  a[2] = (gss * cz - gcs * sz) / det;
+  b[0] = (gcc * sx - gcs * cx) / det;
+  b[1] = (gcc * sy - gcs * cy) / det;
+  b[2] = (gcc * sz - gcs * cz) / det;
+
+  // synthetic fringes: a wandering phase rate (up to 1.5 rad per scan) plus noise,
+  // with the reference phase unwrapped from libm atan2()
+  srand(1);
+  th = 0;
+  for (i = 0; i < n; i++)
+  {
+    dth += 0.01 * ((double)rand() / RAND_MAX - 0.5);
+    if (fabs(dth) > 1.5)
+      dth = copysign(1.5, dth);
+    th += dth;
+    cs = cos(th);
+    sn = sin(th);
+    x[i] = a[0] * cs + b[0] * sn + 0.001 * ((double)rand() / RAND_MAX - 0.5);
+    y[i] = a[1] * cs + b[1] * sn + 0.001 * ((double)rand() / RAND_MAX - 0.5);
+    z[i] = a[2] * cs + b[2] * sn + 0.001 * ((double)rand() / RAND_MAX - 0.5);
+
+    w = atan2(sx * x[i] + sy * y[i] + sz * z[i], cx * x[i] + cy * y[i] + cz * z[i]);
+    d = w - w_old;
+    M_ref += (d < -pi) - (d > pi);
+    w_old = w;
+    p_ref[i] = w + 2 * pi * M_ref;
+  }
+
+  // per-scan phase (as in the *_daq.c programs)
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  for (i = 0; i < n; i++)
+    p_blk[i] = threefringe_phase(x[i], y[i], z[i]);
+  t_scan = elapsed(&t0);
+  for (i = 0; i < n; i++)
+    if (fabs(p_blk[i] - p_ref[i]) > 1)
+      miss++;
+
+  // block phase
+  threefringe_init(&tf, cx, cy, cz, sx, sy, sz);
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  for (i = 0; i < n; i += B)
+  {
+    k = (n - i < B) ? n - i : B;
+    threefringe_block(&tf, 1, k, B, x + i, y + i, z + i, p_blk + i);
+  }
+  t_block = elapsed(&t0);
+  for (i = 0; i < n; i++)
+  {
+    err = fabs(p_blk[i] - p_ref[i]);
+    if (err > err_max)
+      err_max = err;
+  }
+
+  printf("%i scans, %i scans per block, %s path\n", n, B, threefringe_path());
+  printf("  threefringe_phase: %8.2f ns/scan  (%i scans off the reference by a fringe or more)\n", 1e9 * t_scan / n, miss);
+  printf("  threefringe_block: %8.2f ns/scan  (%0.1fx)\n", 1e9 * t_block / n, t_scan / t_block);
+  printf("  largest |block phase - libm phase|: %0.3g rad\n", err_max);
+
+  // atan2() against libm over every octant and a wide range of magnitudes
+  err_max = 0;
+  for (i = 0; i < 10000000; i++)
+  {
+    th = 2 * pi * ((double)rand() / RAND_MAX - 0.5);
+    r = pow(10, 12 * ((double)rand() / RAND_MAX - 0.5));
+    s = r * sin(th);
+    c = r * cos(th);
+    if (i % 1000 == 0)
+      s = 0;
+    if (i % 1000 == 1)
+      c = 0;
+    err = fabs(threefringe_atan2(s, c) - atan2(s, c));
+    if (err > err_max)
+      err_max = err;
+    if ((atan2(s, c) != 0) && (err / fabs(atan2(s, c)) > rel_max))
+      rel_max = err / fabs(atan2(s, c));
+  }
+  printf("  largest |threefringe_atan2 - atan2|: %0.3g rad (relative %0.3g) over 1e7 points\n", err_max, rel_max);
+
+  free(x);
+  free(y);
+  free(z);
+  free(p_ref);
+  free(p_blk);
+  return 0;
+}
+
+double threefringe_phase(double x, double y, double z)
+{
+  // declare intermediate variables
+  double cosp, sinp;
+
+  // compute phase
+  cosp = cx * x + cy * y + cz * z;
+  sinp = sx * x + sy * y + sz * z;
+  p_new = atan2(sinp, cosp) + 2 * M * pi;
+
+  // unwrap phase
+  if (abs(p_new - p_old) > pi)
+  {
+    if (p_new < p_old)
+    {
+      M++;
+      p_new = p_new + 2 * pi;
+    }
+    else // (p_new > p_old)
+    {
+      M--;
+      p_new = p_new - 2 * pi;
+    }
+  }
+  p_old = p_new;
+
+  // return instantaneous phase
+  return p_new;
+}
+
+double elapsed(struct timespec *t0)
+{
+  struct timespec t1;
+
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  return (double)(t1.tv_sec - t0->tv_sec) + (double)(t1.tv_nsec - t0->tv_nsec) / 1000000000;
+}
@@ -0,0 +1,7 @@
+#!/bin/bash
+
+echo -e "\nCompiling three-fringe phase kernel benchmark . . . \c"
+gcc threefringe_bench.c threefringe.c -O2 -g -Wall -lm -o tf_bench
+echo -e "done!\n"
+
+rm -f *~ > /dev/null
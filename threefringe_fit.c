@@ -0,0 +1,559 @@
+// online fit of the ellipse parameters of three-fringe interferometers
+//
+// by: Scott DeWolf
+//
+// The scans (x, y, z) of an interferometer lie on an ellipse, x = a + b cos p
+// + c sin p, in a plane that doesn't go through 0 V, and the ellipse
+// parameters are the two rows of the linear map that takes it to the unit
+// circle (cos p, sin p), with a in its null space. They used to be fitted by
+// hand from a stretch of data and compiled in; as the optics drift, the
+// phase gets worse until somebody fits them again.
+//
+// A fit here needs only the sums of x^i y^j z^k up to the fourth power (35
+// numbers per interferometer, about the first scan so the powers stay small),
+// so the statistics take the same memory however many scans went into them.
+// Fitting them:
+//
+//   - the mean and covariance of the scans give the plane (the eigenvectors
+//     of the two largest variances) and its normal;
+//   - the moments of the in-plane coordinates, worked out from the sums, give
+//     the least squares conic A u^2 + B u v + C v^2 + D u + E v = 1, whose
+//     center and shape give the map to the unit circle in the plane;
+//   - the constant of that map is moved onto the normal (which is constant
+//     in the plane), so the map is linear in (x, y, z) like the parameters;
+//   - and the map is turned (or mirrored) to be as close to the parameters in
+//     use as it can, since any rotation of the circle fits equally well and
+//     the phase should carry on rather than jump.
+//
+// The quality of a fit is the spread of the squared radius of the scans under
+// it (and under the parameters in use), how evenly the phases go around the
+// circle (a fit from scans at nearly one phase is not to be trusted), and how
+// flat the scans are. All of them are sums of the same moments.
+//
+// The fitter runs this in a thread of its own: the sampling loop hands it the
+// blocks of scans it has queued for the phase kernel anyway through a
+// lock-free ring (a copy, and nothing else, per scan), the thread adds them
+// to the statistics and fits them every interval seconds, and the fits come
+// back through a second ring and an eventfd the event loop waits on.
+//
+//  created: Saturday, October 17, 2026 (2026290)
+// modified: Saturday, October 17, 2026 (2026290)
+//  history:
+//           [2026290] - created document
+//
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include "threefringe_fit.h"
+
+#define MIN_SCANS 64     // fewest scans fitted
+
+// a polynomial in (x, y, z) of degree 4 at most: p[i][j][k] is the coefficient of x^i y^j z^k
+typedef double poly[5][5][5];
+
+// local function definitions
+static void *fit_thread(void *arg);
+static void linear(poly p, double a0, const double *a, const double *ref);
+static void multiply(const poly a, const poly b, poly c);
+static double mean(const poly p, const threefringe_stats *st);
+static void misfit(const threefringe_stats *st, const double *ref, const double *e, double *mis, double *res);
+static void eigen3(double A[3][3], double *lambda, double V[3][3]);
+static int solve5(double G[5][5], double *h, double *th);
+
+void threefringe_stats_clear(threefringe_stats *st)
+{
+  memset(st, 0, sizeof(*st));
+}
+
+void threefringe_stats_add(threefringe_stats *st, int n, const double *x, const double *y, const double *z)
+{
+  double sum[5][5][5] = {{{0}}}, px[5], py[5], pz[5], a;
+  int s, i, j, k;
+
+  if (n <= 0)
+    return;
+
+  // the first scan is the origin of the sums (s[4][4][4], s[3][4][4] and s[2][4][4] hold it)
+  if (st->s[0][0][0] == 0)
+  {
+    st->s[4][4][4] = x[0];
+    st->s[3][4][4] = y[0];
+    st->s[2][4][4] = z[0];
+  }
+
+  // the block is summed on its own first, so the totals add up like partial sums
+  for (s = 0; s < n; s++)
+  {
+    px[0] = py[0] = pz[0] = 1;
+    for (i = 1; i < 5; i++)
+    {
+      px[i] = px[i-1] * (x[s] - st->s[4][4][4]);
+      py[i] = py[i-1] * (y[s] - st->s[3][4][4]);
+      pz[i] = pz[i-1] * (z[s] - st->s[2][4][4]);
+    }
+    for (i = 0; i < 5; i++)
+      for (j = 0; i + j < 5; j++)
+      {
+        a = px[i] * py[j];
+        for (k = 0; i + j + k < 5; k++)
+          sum[i][j][k] += a * pz[k];
+      }
+  }
+  for (i = 0; i < 5; i++)
+    for (j = 0; i + j < 5; j++)
+      for (k = 0; i + j + k < 5; k++)
+        st->s[i][j][k] += sum[i][j][k];
+}
+
+int threefringe_fit(const threefringe_stats *st, const double *old, double *ellipse, threefringe_quality *q)
+{
+  static const int fp[5] = {2, 1, 0, 1, 0}, fq[5] = {0, 1, 2, 0, 1}; // u^2, u v, v^2, u, v
+  const double ref[3] = {st->s[4][4][4], st->s[3][4][4], st->s[2][4][4]};
+  double n = st->s[0][0][0], m[3], C[3][3], lambda[3], V[3][3], e[3][3];
+  double M[5][5], G[5][5], h[5], th[5], K[2][2], u0[2], r, W[2][2], S[2][2], sd, den, d, w[2], k[2];
+  double L[2][3], N[2][2], R[2][2], a, b, c, dd, angle, zero[3] = {0};
+  poly pu[5], pv[5], t;
+  int i, j, l;
+
+  memset(q, 0, sizeof(*q));
+  q->n = n;
+  if (n < MIN_SCANS)
+    return -1;
+
+  // mean and covariance of the scans (about the origin of the sums)
+  m[0] = st->s[1][0][0] / n;
+  m[1] = st->s[0][1][0] / n;
+  m[2] = st->s[0][0][1] / n;
+  C[0][0] = st->s[2][0][0] / n - m[0] * m[0];
+  C[1][1] = st->s[0][2][0] / n - m[1] * m[1];
+  C[2][2] = st->s[0][0][2] / n - m[2] * m[2];
+  C[0][1] = C[1][0] = st->s[1][1][0] / n - m[0] * m[1];
+  C[0][2] = C[2][0] = st->s[1][0][1] / n - m[0] * m[2];
+  C[1][2] = C[2][1] = st->s[0][1][1] / n - m[1] * m[2];
+  for (i = 0; i < 3; i++)
+    m[i] += ref[i];
+
+  // the plane of the scans (e[0], e[1]) and its normal (e[2])
+  eigen3(C, lambda, V);
+  for (i = 0; i < 3; i++)
+    for (j = 0; j < 3; j++)
+      e[i][j] = V[j][i];
+  if (!(lambda[1] > 0))
+    return -1;
+  q->flatness = fmax(lambda[2], 0) / lambda[1];
+
+  // moments of the in-plane coordinates u = e[0] . (x - m), v = e[1] . (x - m)
+  memset(pu[0], 0, sizeof(poly));
+  pu[0][0][0][0] = 1;
+  memcpy(pv[0], pu[0], sizeof(poly));
+  linear(t, -(e[0][0] * m[0] + e[0][1] * m[1] + e[0][2] * m[2]), e[0], ref);
+  for (i = 1; i < 5; i++)
+    multiply(pu[i-1], t, pu[i]);
+  linear(t, -(e[1][0] * m[0] + e[1][1] * m[1] + e[1][2] * m[2]), e[1], ref);
+  for (i = 1; i < 5; i++)
+    multiply(pv[i-1], t, pv[i]);
+  for (i = 0; i < 5; i++)
+    for (j = 0; i + j < 5; j++)
+    {
+      multiply(pu[i], pv[j], t);
+      M[i][j] = mean(t, st);
+    }
+
+  // the conic A u^2 + B u v + C v^2 + D u + E v = 1 (least squares)
+  for (i = 0; i < 5; i++)
+  {
+    for (j = 0; j < 5; j++)
+      G[i][j] = M[fp[i] + fp[j]][fq[i] + fq[j]];
+    h[i] = M[fp[i]][fq[i]];
+  }
+  if (solve5(G, h, th) == -1)
+    return -1;
+
+  // it must be an ellipse: (w - u0)' W (w - u0) = 1 with W positive definite
+  K[0][0] = th[0];
+  K[0][1] = K[1][0] = th[1] / 2;
+  K[1][1] = th[2];
+  d = K[0][0] * K[1][1] - K[0][1] * K[1][0];
+  if ((K[0][0] <= 0) | (d <= 0))
+    return -1;
+  u0[0] = -(K[1][1] * th[3] - K[0][1] * th[4]) / (2 * d);
+  u0[1] = -(K[0][0] * th[4] - K[1][0] * th[3]) / (2 * d);
+  r = 1 + u0[0] * (K[0][0] * u0[0] + K[0][1] * u0[1]) + u0[1] * (K[1][0] * u0[0] + K[1][1] * u0[1]);
+  if (r <= 0)
+    return -1;
+  for (i = 0; i < 2; i++)
+    for (j = 0; j < 2; j++)
+      W[i][j] = K[i][j] / r;
+
+  // its square root S takes the ellipse to the unit circle
+  sd = sqrt(W[0][0] * W[1][1] - W[0][1] * W[1][0]);
+  den = sqrt(W[0][0] + W[1][1] + 2 * sd);
+  S[0][0] = (W[0][0] + sd) / den;
+  S[0][1] = S[1][0] = W[0][1] / den;
+  S[1][1] = (W[1][1] + sd) / den;
+
+  // (cos, sin) = S (e' x - e' m - u0), with the constant moved onto the normal (e[2] . x = d in the plane)
+  d = e[2][0] * m[0] + e[2][1] * m[1] + e[2][2] * m[2];
+  if (fabs(d) < 1e-3 * sqrt(lambda[0]))
+    return -1;
+  for (i = 0; i < 2; i++)
+    w[i] = e[i][0] * m[0] + e[i][1] * m[1] + e[i][2] * m[2] + u0[i];
+  for (i = 0; i < 2; i++)
+  {
+    k[i] = -(S[i][0] * w[0] + S[i][1] * w[1]);
+    for (l = 0; l < 3; l++)
+      L[i][l] = S[i][0] * e[0][l] + S[i][1] * e[1][l] + k[i] * e[2][l] / d;
+  }
+
+  // turned (or mirrored) onto the parameters in use: the orthogonal R closest to old L'
+  for (i = 0; i < 2; i++)
+    for (j = 0; j < 2; j++)
+      N[i][j] = old[3*i] * L[j][0] + old[3*i+1] * L[j][1] + old[3*i+2] * L[j][2];
+  a = N[0][0];
+  b = N[0][1];
+  c = N[1][0];
+  dd = N[1][1];
+  if (hypot(a + dd, c - b) >= hypot(a - dd, b + c))
+  {
+    angle = atan2(c - b, a + dd);
+    R[0][0] = cos(angle);
+    R[0][1] = -sin(angle);
+    R[1][0] = sin(angle);
+    R[1][1] = cos(angle);
+  }
+  else
+  {
+    angle = atan2(b + c, a - dd);
+    R[0][0] = cos(angle);
+    R[0][1] = sin(angle);
+    R[1][0] = sin(angle);
+    R[1][1] = -cos(angle);
+  }
+  for (i = 0; i < 2; i++)
+    for (l = 0; l < 3; l++)
+      ellipse[3*i+l] = R[i][0] * L[0][l] + R[i][1] * L[1][l];
+
+  // how well the new and the old parameters describe the scans
+  misfit(st, ref, ellipse, &q->misfit, &q->resultant);
+  misfit(st, ref, old, &q->misfit_old, zero);
+  return 0;
+}
+
+void threefringe_fitter_init(threefringe_fitter *f)
+{
+  memset(f, 0, sizeof(*f));
+  f->efd = -1;
+}
+
+int threefringe_fitter_add(threefringe_fitter *f, double interval)
+{
+  if (f->nint == FIT_MAX)
+  {
+    fprintf(stderr, "threefringe_fitter_add: too many interferometers (%i)\n", FIT_MAX);
+    return -1;
+  }
+  f->interval[f->nint] = interval;
+  f->t0[f->nint] = 0;
+  threefringe_stats_clear(&f->st[f->nint]);
+  return f->nint++;
+}
+
+int threefringe_fitter_start(threefringe_fitter *f, size_t queue)
+{
+  if ((ring_init(&f->scans, sizeof(threefringe_scans), queue) == -1) || (ring_init(&f->results, sizeof(threefringe_result), 64) == -1))
+  {
+    perror("threefringe_fitter_start");
+    return -1;
+  }
+  f->efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  sem_init(&f->ready, 0, 0);
+  atomic_init(&f->stop, 0);
+  if ((f->efd == -1) || (pthread_create(&f->thread, NULL, fit_thread, f) != 0))
+  {
+    perror("threefringe_fitter_start");
+    if (f->efd != -1)
+      close(f->efd);
+    f->efd = -1;
+    sem_destroy(&f->ready);
+    ring_free(&f->scans);
+    ring_free(&f->results);
+    return -1;
+  }
+  return 0;
+}
+
+void threefringe_fitter_push(threefringe_fitter *f, int id, double t, const double *ellipse, int n, const double *x, const double *y, const double *z)
+{
+  threefringe_scans b;
+
+  if ((f->efd == -1) | (n <= 0))
+    return;
+  if (n > FIT_BLOCK)
+    n = FIT_BLOCK;
+
+  b.id = id;
+  b.n = n;
+  b.t = t;
+  memcpy(b.ellipse, ellipse, sizeof(b.ellipse));
+  memcpy(b.x, x, n * sizeof(double));
+  memcpy(b.y, y, n * sizeof(double));
+  memcpy(b.z, z, n * sizeof(double));
+  if (ring_push(&f->scans, &b) == -1)
+  {
+    f->drops++;
+    return;
+  }
+  sem_post(&f->ready);
+}
+
+int threefringe_fitter_result(threefringe_fitter *f, threefringe_result *r)
+{
+  uint64_t count;
+
+  // (the eventfd is cleared first, so a fit queued after it wakes the caller again)
+  if (f->efd == -1)
+    return -1;
+  if (read(f->efd, &count, sizeof(count)) == -1)
+    count = 0;
+  return ring_pop(&f->results, r);
+}
+
+void threefringe_fitter_stop(threefringe_fitter *f)
+{
+  if (f->efd == -1)
+    return;
+  atomic_store(&f->stop, 1);
+  sem_post(&f->ready);
+  pthread_join(f->thread, NULL);
+  sem_destroy(&f->ready);
+  close(f->efd);
+  f->efd = -1;
+  ring_free(&f->scans);
+  ring_free(&f->results);
+  if (f->drops > 0)
+    fprintf(stderr, "threefringe_fitter_stop: %lu blocks of scans dropped\n", f->drops);
+}
+
+static void *fit_thread(void *arg)
+{
+  threefringe_fitter *f = arg;
+  threefringe_scans b;
+  threefringe_result r;
+  uint64_t one = 1;
+  int id;
+
+  while (1)
+  {
+    sem_wait(&f->ready);
+    if (ring_pop(&f->scans, &b) == -1)
+    {
+      if (atomic_load(&f->stop))
+        break;
+      continue;
+    }
+    if ((b.id < 0) | (b.id >= f->nint))
+      continue;
+
+    // gather the interval's scans
+    id = b.id;
+    if (f->t0[id] == 0)
+      f->t0[id] = b.t;
+    threefringe_stats_add(&f->st[id], b.n, b.x, b.y, b.z);
+    if (b.t - f->t0[id] < f->interval[id])
+      continue;
+
+    // and fit them (a failed fit is handed back too, with ellipse NaN)
+    memset(&r, 0, sizeof(r));
+    r.id = id;
+    r.t0 = f->t0[id];
+    r.t1 = b.t;
+    if (threefringe_fit(&f->st[id], b.ellipse, r.ellipse, &r.q) == -1)
+      r.ellipse[0] = NAN;
+    if ((ring_push(&f->results, &r) == 0) && (write(f->efd, &one, sizeof(one)) != sizeof(one)))
+      perror("threefringe_fitter");
+    threefringe_stats_clear(&f->st[id]);
+    f->t0[id] = 0;
+  }
+
+  return NULL;
+}
+
+static void linear(poly p, double a0, const double *a, const double *ref)
+{
+  // a0 + a . x in the coordinates of the sums (x - ref)
+  memset(p, 0, sizeof(poly));
+  p[0][0][0] = a0 + a[0] * ref[0] + a[1] * ref[1] + a[2] * ref[2];
+  p[1][0][0] = a[0];
+  p[0][1][0] = a[1];
+  p[0][0][1] = a[2];
+}
+
+static void multiply(const poly a, const poly b, poly c)
+{
+  poly t = {{{0}}};
+  int i, j, k, l, m, n;
+
+  // (terms above the fourth degree are dropped; the fits never make any)
+  for (i = 0; i < 5; i++)
+    for (j = 0; i + j < 5; j++)
+      for (k = 0; i + j + k < 5; k++)
+      {
+        if (a[i][j][k] == 0)
+          continue;
+        for (l = 0; i + j + k + l < 5; l++)
+          for (m = 0; i + j + k + l + m < 5; m++)
+            for (n = 0; i + j + k + l + m + n < 5; n++)
+              t[i+l][j+m][k+n] += a[i][j][k] * b[l][m][n];
+      }
+  memcpy(c, t, sizeof(poly));
+}
+
+static double mean(const poly p, const threefringe_stats *st)
+{
+  double s = 0;
+  int i, j, k;
+
+  for (i = 0; i < 5; i++)
+    for (j = 0; i + j < 5; j++)
+      for (k = 0; i + j + k < 5; k++)
+        s += p[i][j][k] * st->s[i][j][k];
+  return s / st->s[0][0][0];
+}
+
+static void misfit(const threefringe_stats *st, const double *ref, const double *e, double *mis, double *res)
+{
+  poly c, s, cc, ss, rho2;
+  double r1, r2;
+  int i, j, k;
+
+  // squared radius (c . x)^2 + (s . x)^2 and its square
+  linear(c, 0, e, ref);
+  linear(s, 0, e + 3, ref);
+  multiply(c, c, cc);
+  multiply(s, s, ss);
+  for (i = 0; i < 5; i++)
+    for (j = 0; j < 5; j++)
+      for (k = 0; k < 5; k++)
+        cc[i][j][k] += ss[i][j][k];
+  multiply(cc, cc, rho2);
+  r1 = mean(cc, st);
+  r2 = mean(rho2, st);
+  *mis = (r1 > 0) ? sqrt(fmax(r2 - r1 * r1, 0)) / r1 : INFINITY;
+
+  // mean of (cos, sin)
+  *res = hypot(mean(c, st), mean(s, st));
+}
+
+static void eigen3(double A[3][3], double *lambda, double V[3][3])
+{
+  double a[3][3], c, s, theta, tau, t, g, h;
+  int i, j, p, q, r, sweep;
+
+  // cyclic Jacobi rotations (A is symmetric), eigenvalues in decreasing order
+  memcpy(a, A, sizeof(a));
+  for (i = 0; i < 3; i++)
+    for (j = 0; j < 3; j++)
+      V[i][j] = (i == j);
+  for (sweep = 0; sweep < 50; sweep++)
+  {
+    if (fabs(a[0][1]) + fabs(a[0][2]) + fabs(a[1][2]) < 1e-300)
+      break;
+    for (p = 0; p < 2; p++)
+      for (q = p + 1; q < 3; q++)
+      {
+        if (a[p][q] == 0)
+          continue;
+        theta = (a[q][q] - a[p][p]) / (2 * a[p][q]);
+        t = copysign(1, theta) / (fabs(theta) + sqrt(theta * theta + 1));
+        c = 1 / sqrt(t * t + 1);
+        s = t * c;
+        tau = s / (1 + c);
+        a[p][p] -= t * a[p][q];
+        a[q][q] += t * a[p][q];
+        a[p][q] = a[q][p] = 0;
+        for (r = 0; r < 3; r++)
+        {
+          if ((r == p) | (r == q))
+            continue;
+          g = a[r][p];
+          h = a[r][q];
+          a[r][p] = a[p][r] = g - s * (h + g * tau);
+          a[r][q] = a[q][r] = h + s * (g - h * tau);
+        }
+        for (r = 0; r < 3; r++)
+        {
+          g = V[r][p];
+          h = V[r][q];
+          V[r][p] = g - s * (h + g * tau);
+          V[r][q] = h + s * (g - h * tau);
+        }
+      }
+  }
+
+  for (i = 0; i < 3; i++)
+    lambda[i] = a[i][i];
+  for (i = 0; i < 2; i++)
+    for (j = i + 1; j < 3; j++)
+      if (lambda[j] > lambda[i])
+      {
+        t = lambda[i];
+        lambda[i] = lambda[j];
+        lambda[j] = t;
+        for (r = 0; r < 3; r++)
+        {
+          t = V[r][i];
+          V[r][i] = V[r][j];
+          V[r][j] = t;
+        }
+      }
+}
+
+static int solve5(double G[5][5], double *h, double *th)
+{
+  double a[5][6], t, scale = 0;
+  int i, j, k, p;
+
+  // Gaussian elimination with partial pivoting
+  for (i = 0; i < 5; i++)
+  {
+    for (j = 0; j < 5; j++)
+    {
+      a[i][j] = G[i][j];
+      scale = fmax(scale, fabs(G[i][j]));
+    }
+    a[i][5] = h[i];
+  }
+  for (k = 0; k < 5; k++)
+  {
+    p = k;
+    for (i = k + 1; i < 5; i++)
+      if (fabs(a[i][k]) > fabs(a[p][k]))
+        p = i;
+    if (!(fabs(a[p][k]) > 1e-14 * scale))
+      return -1;
+    for (j = 0; j < 6; j++)
+    {
+      t = a[k][j];
+      a[k][j] = a[p][j];
+      a[p][j] = t;
+    }
+    for (i = k + 1; i < 5; i++)
+    {
+      t = a[i][k] / a[k][k];
+      for (j = k; j < 6; j++)
+        a[i][j] -= t * a[k][j];
+    }
+  }
+  for (i = 4; i >= 0; i--)
+  {
+    t = a[i][5];
+    for (j = i + 1; j < 5; j++)
+      t -= a[i][j] * th[j];
+    th[i] = t / a[i][i];
+  }
+  return 0;
+}
@@ -0,0 +1,104 @@
+// online fit of the ellipse parameters of three-fringe interferometers
+//
+// by: Scott DeWolf
+//
+//  created: Saturday, October 17, 2026 (2026290)
+// modified: Saturday, October 17, 2026 (2026290)
+//  history:
+//           [2026290] - created document
+//
+
+#ifndef THREEFRINGE_FIT_H
+#define THREEFRINGE_FIT_H
+
+#include <stdatomic.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include "spsc_ring.h"
+#include "threefringe.h"
+
+#define FIT_MAX 32       // most interferometers one fitter serves
+#define FIT_BLOCK 256    // most scans handed over at once
+
+// sums of x^i y^j z^k (i + j + k <= 4) over the scans of one interferometer:
+// all a fit needs, however many scans there were
+typedef struct
+{
+  double s[5][5][5];
+} threefringe_stats;
+
+// how well a fit describes the scans it was made from
+typedef struct
+{
+  double n;                         // scans
+  double misfit;                    // RMS of the squared radius about its mean, relative to it (0 = on the ellipse)
+  double misfit_old;                // the same for the parameters in use
+  double resultant;                 // length of the mean of (cos, sin) of the phases (0 = all around, 1 = one point)
+  double flatness;                  // smallest over middle variance of the scans (0 = in a plane)
+} threefringe_quality;
+
+// scans of one interferometer on their way to the fit thread
+typedef struct
+{
+  int id, n;
+  double t;                         // time of the scans (epoch seconds)
+  double ellipse[6];                // cx, cy, cz, sx, sy, sz in use
+  double x[FIT_BLOCK], y[FIT_BLOCK], z[FIT_BLOCK];
+} threefringe_scans;
+
+// a fit on its way back
+typedef struct
+{
+  int id;
+  double t0, t1;                    // first and last scan fitted
+  double ellipse[6];                // cx, cy, cz, sx, sy, sz (ellipse[0] NaN if the fit failed)
+  threefringe_quality q;
+} threefringe_result;
+
+// a thread that gathers the statistics of each interferometer and fits them
+// every interval seconds of scans
+typedef struct
+{
+  int nint;
+  double interval[FIT_MAX];
+  double t0[FIT_MAX];               // first scan of the statistics being gathered (0 = none)
+  threefringe_stats st[FIT_MAX];
+  spsc_ring scans;                  // scans waiting for the fit thread
+  spsc_ring results;                // fits waiting for the caller
+  sem_t ready;                      // posted for every block of scans queued
+  pthread_t thread;
+  atomic_int stop;
+  int efd;                          // eventfd that is readable while fits are waiting (-1 = not started)
+  unsigned long drops;              // blocks of scans lost because the queue was full
+} threefringe_fitter;
+
+void threefringe_stats_clear(threefringe_stats *st);
+
+// add n scans to the statistics
+void threefringe_stats_add(threefringe_stats *st, int n, const double *x, const double *y, const double *z);
+
+// fit the ellipse parameters to the statistics: the plane of the scans, the
+// ellipse in it, and the linear maps c . (x, y, z) and s . (x, y, z) that take
+// it to the unit circle, turned to match the parameters in use (old) as
+// closely as they can so the phase carries on; returns -1 if the scans don't
+// give an ellipse (too few, all at one phase, or in a plane through 0 V)
+int threefringe_fit(const threefringe_stats *st, const double *old, double *ellipse, threefringe_quality *q);
+
+// set up a fitter; add returns the id of another interferometer fitted every
+// interval seconds, and start starts the thread (queue blocks of scans at most
+// waiting), returning -1 if it can't
+void threefringe_fitter_init(threefringe_fitter *f);
+int threefringe_fitter_add(threefringe_fitter *f, double interval);
+int threefringe_fitter_start(threefringe_fitter *f, size_t queue);
+
+// hand n scans (at most FIT_BLOCK) of interferometer id, taken up to time t
+// with the parameters ellipse, to the fit thread; it never waits, so scans
+// are dropped (and counted) rather than holding up the caller if the queue is full
+void threefringe_fitter_push(threefringe_fitter *f, int id, double t, const double *ellipse, int n, const double *x, const double *y, const double *z);
+
+// take a finished fit; returns -1 if there is none (f->efd is readable while there are)
+int threefringe_fitter_result(threefringe_fitter *f, threefringe_result *r);
+
+void threefringe_fitter_stop(threefringe_fitter *f);
+
+#endif
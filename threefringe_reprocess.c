@@ -0,0 +1,467 @@
+// reprocessing of archived fringe channels into phase with new ellipse parameters
+//
+// by: Scott DeWolf
+//
+// When the ellipse parameters (cx, cy, cz, sx, sy, sz) of an interferometer
+// are fitted again, the phase channel (BS1) archived before holds the phase of
+// the old ellipse, and the fringes are only on the disk as the fringe channels
+// (AYX, AYY, AYZ). This reads the fringe day volumes of a station's phase
+// channels, turns the counts back into volts with the inverse of the fringe
+// channels' calibration (the T7 calibration the *_daq.c programs applied as
+// fringe_counts()), computes the unwrapped phase of every sample with the
+// threefringe kernel and the ellipse parameters of the configuration file,
+// and writes new phase day volumes under the output root.
+//
+// The station, its channels and the new ellipse parameters come from the
+// station configuration file (see daq_config.c): each phase channel is
+// computed from the fringe channels (last or mean) of its x, y and z inputs,
+// whose calibration must be a straight line (poly with 2 coefficients, or
+// scale). The integer encodings store the calibrated value truncated toward
+// zero, so a count is taken as the middle of the values it stands for.
+//
+// The days are handed to a pool of threads (one per core unless -j says
+// otherwise), each taking the next day, reading its fringe volumes through
+// their time indexes (mseed_extract()), and computing the phases of the day
+// with the fringe count starting from 0. The fringe count a day really starts
+// from is the one the day before ended with, plus the fringe between the last
+// sample of that day and the first of this one, exactly as if the days were
+// processed one after another. So once a thread has computed a day, it waits
+// for the day before to publish where it ended (which takes no time once that
+// day is computed), publishes where this one ends, and only then writes its
+// day volume, with every phase shifted by the whole fringes carried over.
+// Writing and computing run in parallel; only the handing over of the count
+// is in day order. A day without fringe data hands the count on as it got it
+// (the unwrapping goes on across the gap, as daq does across a short one).
+//
+// The archived fringe channels hold one scan per sample (the last one of the
+// window), while daq averages the phases of every scan of the window, so the
+// new phase is that of the archived scan: fringes faster than half a fringe
+// per sample can't be counted from the archive. The count starts from 0 on
+// the first day, like daq on startup.
+//
+// usage: ./threefringe_reprocess [-j threads] station.conf first last root
+//        ./threefringe_reprocess -j 8 aofs_cc_r04.conf 2026:001 2026:289 /home/avn4/Reprocessed
+//
+// first and last are yyyy:ddd (UTC, inclusive). A phase day volume under root
+// is replaced; don't give the station's own root for a day daq is still writing.
+//
+//  created: Saturday, October 17, 2026 (2026290)
+// modified: Saturday, October 17, 2026 (2026290)
+//  history:
+//           [2026290] - created document
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include "daq.h"
+#include "mseed_read.h"
+#include "threefringe.h"
+
+#define MAX_THREADS 256
+
+// samples of one fringe channel of a day, in time order
+typedef struct
+{
+  double *t, *x;
+  long n, cap;
+  double fs;                        // sample rate of the records (Hz)
+} series;
+
+// a phase channel and the fringe channels of its x, y and z inputs
+typedef struct
+{
+  const daq_channel *ph;
+  const daq_channel *fr[3];
+} phase_job;
+
+// where the fringe count of a phase channel stands at the end of a day
+typedef struct
+{
+  int done;                         // published (the next day can go on from it)
+  int valid;                        // w is the wrapped phase of a sample (some day so far had data)
+  int M;                            // fringe count after the last sample
+  double w;                         // wrapped phase of the last sample
+} fringe_state;
+
+// local function definitions
+static int find_fringes(phase_job *job, const daq_channel *ph);
+static void *reprocess_thread(void *arg);
+static void reprocess_day(int d, series *s, double **p, long *np);
+static int add_record(void *arg, const char *path, const unsigned char *rec, int len);
+static long join_samples(series *s);
+static double fringe_volts(const daq_channel *fr, double counts);
+static void write_day(const phase_job *job, const double *t, const double *p, long n, int K);
+static int parse_day(const char *s, int *day);
+double elapsed(struct timespec *t0);
+
+// global variables
+daq_config cfg;                       // the station
+char out_root[200];                   // where the phase day volumes go
+phase_job job[DAQ_MAX_PHASE];
+int njob = 0;
+int first_day, ndays;                 // days since the epoch
+fringe_state *state;                  // state[(d + 1) * njob + k]: phase channel k at the end of day d (-1 = before the first)
+pthread_mutex_t state_lock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t state_done = PTHREAD_COND_INITIALIZER;
+atomic_int next_day;                  // next day a thread takes
+atomic_long nsamp;                    // phase samples written
+
+int main(int argc, char **argv)
+{
+  pthread_t thread[MAX_THREADS];
+  struct timespec t0;
+  int i, last_day, nthread = (int)sysconf(_SC_NPROCESSORS_ONLN), opt;
+
+  while ((opt = getopt(argc, argv, "j:")) != -1)
+  {
+    if ((opt == 'j') && (atoi(optarg) > 0))
+      nthread = atoi(optarg);
+    else
+      optind = argc + 1;
+  }
+  if ((argc - optind != 4) || (parse_day(argv[optind + 1], &first_day) == -1) || (parse_day(argv[optind + 2], &last_day) == -1) ||
+      (last_day < first_day))
+  {
+    fprintf(stderr, "usage: %s [-j threads] station.conf first last root\n", argv[0]);
+    fprintf(stderr, "       (first and last day as yyyy:ddd)\n");
+    return 2;
+  }
+  if (nthread > MAX_THREADS)
+    nthread = MAX_THREADS;
+
+  // the station and its phase channels
+  if (daq_read_config(&cfg, argv[optind]) == -1)
+    return 2;
+  snprintf(out_root, sizeof(out_root), "%s", argv[optind + 3]);
+  for (i = 0; i < cfg.nchan; i++)
+  {
+    if (cfg.chan[i].kind != DAQ_PHASE)
+      continue;
+    if (find_fringes(&job[njob], &cfg.chan[i]) == -1)
+      return 2;
+    njob++;
+  }
+  if (njob == 0)
+  {
+    fprintf(stderr, "%s: no phase channels\n", argv[optind]);
+    return 2;
+  }
+  if ((mkdir(out_root, 0755) == -1) & (errno != EEXIST))
+  {
+    perror(out_root);
+    return 2;
+  }
+
+  // every day starts out unpublished, and the count starts from 0
+  ndays = last_day - first_day + 1;
+  state = calloc((size_t)(ndays + 1) * njob, sizeof(fringe_state));
+  if (state == NULL)
+  {
+    perror("threefringe_reprocess");
+    return 2;
+  }
+  for (i = 0; i < njob; i++)
+    state[i].done = 1;
+
+  // reprocess them
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  if (nthread > ndays)
+    nthread = ndays;
+  atomic_init(&next_day, 0);
+  atomic_init(&nsamp, 0);
+  for (i = 0; i < nthread; i++)
+    if (pthread_create(&thread[i], NULL, reprocess_thread, NULL) != 0)
+      break;
+  if (i == 0)
+    reprocess_thread(NULL);
+  nthread = i;
+  for (i = 0; i < nthread; i++)
+    pthread_join(thread[i], NULL);
+
+  fprintf(stderr, "%i days, %li phase samples in %.2f s (%i threads)\n", ndays, atomic_load(&nsamp), elapsed(&t0), (nthread > 0) ? nthread : 1);
+
+  free(state);
+  return (atomic_load(&nsamp) > 0) ? 0 : 1;
+}
+
+static int find_fringes(phase_job *job, const daq_channel *ph)
+{
+  const daq_channel *ch;
+  int i, k;
+
+  // the channel that records each input (a last one before a mean one)
+  job->ph = ph;
+  for (k = 0; k < 3; k++)
+  {
+    job->fr[k] = NULL;
+    for (i = 0; i < cfg.nchan; i++)
+    {
+      ch = &cfg.chan[i];
+      if ((ch->in[0] != ph->in[k]) | ((ch->kind != DAQ_LAST) & (ch->kind != DAQ_MEAN)))
+        continue;
+      if ((job->fr[k] == NULL) || ((ch->kind == DAQ_LAST) & (job->fr[k]->kind != DAQ_LAST)))
+        job->fr[k] = ch;
+    }
+    ch = job->fr[k];
+    if (ch == NULL)
+    {
+      fprintf(stderr, "%s.%s: no channel records input %s\n", ph->LI, ph->CI, cfg.input[ph->in[k]].name);
+      return -1;
+    }
+
+    // volts are only given back by a straight line
+    if (!((ch->cal.type == CALIB_NONE) ||
+          ((ch->cal.type == CALIB_POLY) && (ch->cal.ncoef[0] == 2) && (ch->cal.coef[0][0] != 0)) ||
+          ((ch->cal.type == CALIB_SCALE) && (ch->cal.coef[0][0] != 0))))
+    {
+      fprintf(stderr, "%s.%s: the calibration of %s.%s can't be inverted (only a straight line can)\n", ph->LI, ph->CI, ch->LI, ch->CI);
+      return -1;
+    }
+  }
+  return 0;
+}
+
+static void *reprocess_thread(void *arg)
+{
+  series s[3] = {{0}};
+  double *p = NULL;
+  long np = 0;
+  int d, k;
+
+  // take the next day until there are none left
+  while ((d = atomic_fetch_add(&next_day, 1)) < ndays)
+    reprocess_day(d, s, &p, &np);
+
+  for (k = 0; k < 3; k++)
+  {
+    free(s[k].t);
+    free(s[k].x);
+  }
+  free(p);
+  return NULL;
+}
+
+static void reprocess_day(int d, series *s, double **p, long *np)
+{
+  fringe_state *prev, *cur;
+  threefringe tf;
+  time_t t_temp;
+  struct tm tt;
+  double t0 = 86400.0 * (first_day + d), dw;
+  long n, i;
+  int j, k, K;
+
+  t_temp = (time_t)t0;
+  gmtime_r(&t_temp, &tt);
+  for (j = 0; j < njob; j++)
+  {
+    // the fringe samples of the day, matched up by time, in volts
+    for (k = 0; k < 3; k++)
+    {
+      s[k].n = 0;
+      s[k].fs = 0;
+      mseed_extract(cfg.root, cfg.NC, cfg.SIC, job[j].fr[k]->LI, job[j].fr[k]->CI, t0, t0 + 86400, add_record, &s[k]);
+    }
+    n = join_samples(s);
+    for (k = 0; k < 3; k++)
+      for (i = 0; i < n; i++)
+        s[k].x[i] = fringe_volts(job[j].fr[k], s[k].x[i]);
+
+    // their phases, unwrapped from a count of 0 (the first sample doesn't move it)
+    if (n > *np)
+    {
+      *np = n;
+      *p = realloc(*p, n * sizeof(double));
+      if (*p == NULL)
+      {
+        perror("threefringe_reprocess");
+        exit(1);
+      }
+    }
+    threefringe_init(&tf, job[j].ph->ellipse[0], job[j].ph->ellipse[1], job[j].ph->ellipse[2],
+                     job[j].ph->ellipse[3], job[j].ph->ellipse[4], job[j].ph->ellipse[5]);
+    if (n > 0)
+      threefringe_block(&tf, 1, (int)n, (int)n, s[0].x, s[1].x, s[2].x, *p);
+
+    // the count the day starts from, once the day before has ended
+    pthread_mutex_lock(&state_lock);
+    prev = &state[d * njob + j];
+    cur = &state[(d + 1) * njob + j];
+    while (!prev->done)
+      pthread_cond_wait(&state_done, &state_lock);
+    *cur = *prev;
+    K = prev->M;
+    if (n > 0)
+    {
+      dw = (*p)[0] - prev->w;
+      if (prev->valid)
+        K += (dw < -M_PI) - (dw > M_PI);
+      cur->valid = 1;
+      cur->M = K + tf.M;
+      cur->w = tf.w_old;
+    }
+    cur->done = 1;
+    pthread_cond_broadcast(&state_done);
+    pthread_mutex_unlock(&state_lock);
+
+    if (n == 0)
+    {
+      fprintf(stderr, "%i:%03i: no fringe samples for %s.%s (the fringe count carries over)\n", tt.tm_year + 1900, tt.tm_yday + 1, job[j].ph->LI, job[j].ph->CI);
+      continue;
+    }
+    write_day(&job[j], s[0].t, *p, n, K);
+    atomic_fetch_add(&nsamp, n);
+    printf("%i:%03i  %s.%s.%s.%s  %li samples  fringe count %i to %i\n", tt.tm_year + 1900, tt.tm_yday + 1,
+           cfg.NC, cfg.SIC, job[j].ph->LI, job[j].ph->CI, n, K, K + tf.M);
+  }
+}
+
+static int add_record(void *arg, const char *path, const unsigned char *rec, int len)
+{
+  series *s = arg;
+  double t, fs;
+  int NoS, i;
+
+  if (s->n + MSEED_MAX_NOS > s->cap)
+  {
+    s->cap = (s->cap > 0) ? 2 * s->cap : 1 << 20;
+    s->t = realloc(s->t, s->cap * sizeof(double));
+    s->x = realloc(s->x, s->cap * sizeof(double));
+    if ((s->t == NULL) | (s->x == NULL))
+    {
+      perror("threefringe_reprocess");
+      exit(1);
+    }
+  }
+
+  // a record that doesn't decode is left out (mseed_scan says what is wrong with it)
+  NoS = mseed_decode(rec, len, &t, &fs, s->x + s->n, MSEED_MAX_NOS);
+  if (NoS == -1)
+  {
+    fprintf(stderr, "%s: a record doesn't decode\n", path);
+    return 0;
+  }
+  for (i = 0; i < NoS; i++)
+    s->t[s->n + i] = t + i / fs;
+  s->n += NoS;
+  s->fs = fs;
+  return 0;
+}
+
+static long join_samples(series *s)
+{
+  long i[3] = {0}, n = 0;
+  double tol, tmax;
+  int k;
+
+  // the samples all three channels have (within half a sample), moved to the front
+  if ((s[0].fs <= 0) | (s[1].fs <= 0) | (s[2].fs <= 0))
+    return 0;
+  tol = 0.5 / s[0].fs;
+  while ((i[0] < s[0].n) & (i[1] < s[1].n) & (i[2] < s[2].n))
+  {
+    tmax = fmax(s[0].t[i[0]], fmax(s[1].t[i[1]], s[2].t[i[2]]));
+    if ((s[0].t[i[0]] < tmax - tol) | (s[1].t[i[1]] < tmax - tol) | (s[2].t[i[2]] < tmax - tol))
+    {
+      for (k = 0; k < 3; k++)
+        if (s[k].t[i[k]] < tmax - tol)
+          i[k]++;
+      continue;
+    }
+    for (k = 0; k < 3; k++)
+    {
+      s[k].t[n] = s[k].t[i[k]];
+      s[k].x[n] = s[k].x[i[k]];
+      i[k]++;
+    }
+    n++;
+  }
+  return n;
+}
+
+static double fringe_volts(const daq_channel *fr, double counts)
+{
+  const calib_channel *cal = &fr->cal;
+
+  // the writer truncates integer samples toward zero
+  if (((fr->EF == 1) | (fr->EF == 3) | (fr->EF == 10) | (fr->EF == 11)) & (counts != 0))
+    counts += (counts > 0) ? 0.5 : -0.5;
+
+  // y = c0 x + c1, or y = a (x + b)
+  switch (cal->type)
+  {
+    case CALIB_POLY:
+      return (counts - cal->coef[0][1]) / cal->coef[0][0];
+    case CALIB_SCALE:
+      return counts / cal->coef[0][0] - cal->coef[0][1];
+  }
+  return counts;
+}
+
+static void write_day(const phase_job *job, const double *t, const double *p, long n, int K)
+{
+  mseed_writer ms;
+  time_t t_temp;
+  struct tm tt;
+  char fn[400];
+  long i;
+  int c, k;
+
+  // the phase day volume (and index) of the day written before goes
+  t_temp = (time_t)floor(t[0]);
+  gmtime_r(&t_temp, &tt);
+  for (k = 0; k < 2; k++)
+  {
+    snprintf(fn, sizeof(fn), "%s/%4i/%03i/%s.%s.%s.%s.%i.%03i.%s%s", out_root, tt.tm_year + 1900, tt.tm_yday + 1, cfg.NC, cfg.SIC,
+             job->ph->LI, job->ph->CI, tt.tm_year + 1900, tt.tm_yday + 1, (cfg.v3) ? "mseed3" : "mseed", (k == 0) ? "" : ".idx");
+    if ((unlink(fn) == -1) & (errno != ENOENT))
+      perror(fn);
+  }
+
+  // written like daq writes it, but with no checkpoints and only full records until the end
+  mseed_init(&ms, out_root, cfg.NC, cfg.SIC, cfg.SRF, cfg.SRM, 0);
+  if (cfg.big)
+    mseed_big_endian(&ms);
+  if (cfg.v3)
+    mseed_format3(&ms);
+  if (cfg.index)
+    mseed_index_volumes(&ms);
+  mseed_skip_checkpoints(&ms);
+  c = mseed_add_channel(&ms, job->ph->LI, job->ph->CI, job->ph->EF);
+  if (job->ph->reclen > 0)
+    mseed_record_length(&ms, c, job->ph->reclen, job->ph->span);
+  for (i = 0; i < n; i++)
+    write_mseed(&ms, c, t[i], p[i] + 2 * M_PI * K);
+  close_mseed(&ms);
+}
+
+static int parse_day(const char *s, int *day)
+{
+  struct tm tt = {0};
+  int yr, doy;
+  char c;
+
+  // yyyy:ddd
+  if ((sscanf(s, "%d:%d%c", &yr, &doy, &c) != 2) | (doy < 1) | (doy > 366))
+    return -1;
+  tt.tm_year = yr - 1900;
+  tt.tm_mday = doy;                     // timegm() normalizes day doy of January
+  *day = (int)(timegm(&tt) / 86400);
+  return 0;
+}
+
+double elapsed(struct timespec *t0)
+{
+  struct timespec t1;
+
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  return (t1.tv_sec - t0->tv_sec) + 1e-9 * (t1.tv_nsec - t0->tv_nsec);
+}
@@ -0,0 +1,7 @@
+#!/bin/bash
+
+echo -e "\nCompiling fringe reprocessing code . . . \c"
+gcc threefringe_reprocess.c daq_config.c calib.c mseed_read.c mseed_writer.c io_batch.c steim.c spsc_ring.c threefringe.c -O2 -g -Wall -pthread -lm -o threefringe_reprocess
+echo -e "done!\n"
+
+rm -f *~ > /dev/null
@@ -0,0 +1,182 @@
+// fringe counts of three-fringe interferometers kept across restarts
+//
+// by: Scott DeWolf
+//
+// The unwrapped phase is the wrapped phase of a scan plus 2 pi times the
+// fringe count M, and M used to start from 0 whenever a program started, so
+// every restart put a step of a whole number of fringes into the phase
+// channels. The counts (and the wrapped phase of the last scan they were
+// counted to) are kept here in a small file mapped into memory: saving them
+// after every sample window is a few stores, and the kernel writes them back.
+// On the next start, if the phase can't have moved by half a fringe since
+// (the caller says how long a gap that is), counting carries on from them
+// and the phase carries on without a step.
+//
+// The file is a header (magic, a sequence number, the number of
+// interferometers and the time of the last save) and one entry per
+// interferometer, found by name, so adding or reordering the phase channels
+// of a station doesn't mix up their counts. The sequence number is odd while
+// a save is under way, so a file left by a program killed in the middle of
+// one is not restored from. The file is updated in place while it holds the
+// same interferometers; a new layout is written to a new file that replaces it.
+//
+//  created: Saturday, October 17, 2026 (2026290)
+// modified: Saturday, October 17, 2026 (2026290)
+//  history:
+//           [2026290] - created document
+//           [2026290] - a changed layout goes to a new file renamed over the old one (no truncation)
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "threefringe_state.h"
+
+// layout of the file
+typedef struct
+{
+  char magic[4];                    // TFST
+  uint32_t seq;                     // odd while a save is under way
+  int32_t nint;
+  int32_t unused;
+  double t;                         // time of the last scan saved (epoch seconds)
+} state_header;
+
+typedef struct
+{
+  char name[THREEFRINGE_NAME];
+  double w_old;                     // wrapped phase of the last scan
+  int32_t M;                        // fringe count
+  int32_t unused;
+} state_entry;
+
+int threefringe_state_open(threefringe_state *s, const char *path, threefringe *tf, int nint, const char name[][THREEFRINGE_NAME], double t, double max_gap)
+{
+  state_header h = {{0}};
+  state_entry *e = NULL;
+  struct stat sb;
+  size_t len = sizeof(state_header) + nint * sizeof(state_entry);
+  char tmp[300];
+  int fd, i, k, n = 0, old = 0, same;
+
+  memset(s, 0, sizeof(*s));
+  fd = open(path, O_RDWR | O_CREAT, 0666);
+  if (fd == -1)
+  {
+    perror(path);
+    return -1;
+  }
+
+  // the file as it is
+  if ((fstat(fd, &sb) == 0) && (sb.st_size >= (off_t)sizeof(h)) && (pread(fd, &h, sizeof(h), 0) == sizeof(h)) &&
+      (memcmp(h.magic, "TFST", 4) == 0) && (h.nint > 0) && (sb.st_size == (off_t)(sizeof(h) + h.nint * sizeof(state_entry))))
+  {
+    e = malloc(h.nint * sizeof(state_entry));
+    if ((e != NULL) && (pread(fd, e, h.nint * sizeof(state_entry), sizeof(h)) == (ssize_t)(h.nint * sizeof(state_entry))))
+      old = h.nint;
+  }
+
+  // the counts saved last, if the save was complete and recent enough
+  if (((h.seq & 1) == 0) && (t >= h.t) && (t - h.t <= max_gap))
+  {
+    for (k = 0; k < nint; k++)
+      for (i = 0; i < old; i++)
+        if (strncmp(e[i].name, name[k], THREEFRINGE_NAME) == 0)
+        {
+          tf[k].w_old = e[i].w_old;
+          tf[k].M = e[i].M;
+          n++;
+          break;
+        }
+  }
+
+  // the same interferometers in the same order are saved in place; any
+  // other layout is built in a new file that then replaces the old one, so a
+  // crash in between leaves the old counts rather than none
+  same = (old == nint);
+  for (k = 0; (k < nint) & (same); k++)
+    same = (strncmp(e[k].name, name[k], THREEFRINGE_NAME) == 0);
+  free(e);
+  if (!same)
+  {
+    close(fd);
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    fd = open(tmp, O_RDWR | O_CREAT | O_TRUNC, 0666);
+    if ((fd == -1) || (ftruncate(fd, len) == -1))
+    {
+      perror(tmp);
+      if (fd != -1)
+        close(fd);
+      return -1;
+    }
+  }
+
+  s->map = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (s->map == MAP_FAILED)
+  {
+    perror(path);
+    s->map = NULL;
+    return -1;
+  }
+  s->nint = nint;
+  s->len = len;
+  if (!same)
+  {
+    memcpy(((state_header *)s->map)->magic, "TFST", 4);
+    ((state_header *)s->map)->nint = nint;
+    e = (state_entry *)((char *)s->map + sizeof(state_header));
+    for (k = 0; k < nint; k++)
+      snprintf(e[k].name, sizeof(e[k].name), "%s", name[k]);
+  }
+  threefringe_state_save(s, tf, t);
+
+  // (the new file is complete on the disk before it takes the old one's name)
+  if ((!same) && ((msync(s->map, len, MS_SYNC) == -1) || (rename(tmp, path) == -1)))
+  {
+    perror(path);
+    threefringe_state_close(s);
+    return -1;
+  }
+
+  return n;
+}
+
+void threefringe_state_save(threefringe_state *s, const threefringe *tf, double t)
+{
+  state_header *h = s->map;
+  state_entry *e;
+  int k;
+
+  if (h == NULL)
+    return;
+  e = (state_entry *)(h + 1);
+
+  // seq is odd from before the first store to after the last (even if a
+  // save was cut short before the file was opened)
+  h->seq |= 1;
+  atomic_thread_fence(memory_order_release);
+  for (k = 0; k < s->nint; k++)
+  {
+    e[k].w_old = tf[k].w_old;
+    e[k].M = tf[k].M;
+  }
+  h->t = t;
+  atomic_thread_fence(memory_order_release);
+  h->seq++;
+}
+
+void threefringe_state_close(threefringe_state *s)
+{
+  if (s->map == NULL)
+    return;
+  msync(s->map, s->len, MS_SYNC);
+  munmap(s->map, s->len);
+  s->map = NULL;
+}
@@ -0,0 +1,40 @@
+// fringe counts of three-fringe interferometers kept across restarts
+//
+// by: Scott DeWolf
+//
+//  created: Saturday, October 17, 2026 (2026290)
+// modified: Saturday, October 17, 2026 (2026290)
+//  history:
+//           [2026290] - created document
+//
+
+#ifndef THREEFRINGE_STATE_H
+#define THREEFRINGE_STATE_H
+
+#include <stddef.h>
+#include "threefringe.h"
+
+#define THREEFRINGE_NAME 16   // longest interferometer name (LI.CI) kept, with its '\0'
+
+// a fringe state file mapped into memory
+typedef struct
+{
+  int nint;
+  void *map;                        // the file (NULL = none)
+  size_t len;
+} threefringe_state;
+
+// open (creating it if needed) the fringe state file of nint interferometers
+// named name[k], and restore the fringe counts saved there at most max_gap
+// seconds before t into tf (interferometers not in the file, or saved too
+// long ago, keep theirs); returns how many were restored, or -1 (after saying
+// why) if the file can't be used, in which case saving does nothing
+int threefringe_state_open(threefringe_state *s, const char *path, threefringe *tf, int nint, const char name[][THREEFRINGE_NAME], double t, double max_gap);
+
+// save the fringe counts of the scans up to time t (stores into the mapped
+// file, no system call)
+void threefringe_state_save(threefringe_state *s, const threefringe *tf, double t);
+
+void threefringe_state_close(threefringe_state *s);
+
+#endif
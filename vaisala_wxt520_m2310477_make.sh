@@ -1,7 +1,7 @@
 #!/bin/bash
 
 echo -e "\nCompiling Vaisala WXT520 SN: M2310477 data acquisition code using RS232 . . . \c"
-gcc vaisala_wxt520_m2310477_daq.c -g -Wall -lm -o met1_daq
+gcc vaisala_wxt520_m2310477_daq.c mseed_writer.c io_batch.c steim.c spsc_ring.c sampler.c -g -Wall -pthread -lm -o met1_daq
 echo -e "done!\n"
 
 rm -f *~ > /dev/null